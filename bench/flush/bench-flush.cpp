@@ -0,0 +1,114 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+//unix
+#include <unistd.h>
+#include <fcntl.h>
+//ummap-io
+#include <ummap.h>
+
+/*******************  FUNCTION  *********************/
+/**
+ * Build the driver to be measured.
+ * @param name Name of the driver (file or mem).
+ * @param size Size of the storage.
+ * @param fname File to be used for the file driver.
+**/
+static ummap_driver_t * build_driver(const char * name, size_t size, const char * fname)
+{
+	if (strcmp(name, "mem") == 0) {
+		return ummap_driver_create_memory(size);
+	} else {
+		int fd = open(fname, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			perror("open");
+			exit(EXIT_FAILURE);
+		}
+		if (ftruncate(fd, size) != 0) {
+			perror("ftruncate");
+			exit(EXIT_FAILURE);
+		}
+		ummap_driver_t * driver = ummap_driver_create_fd(fd);
+		close(fd);
+		return driver;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Fill the whole mapping then measure the umunmap(sync) time.
+ * @param name Name of the driver (file or mem).
+ * @param size Size of the mapping.
+ * @param segment_size Size of the segments.
+ * @param threads Number of threads to flush.
+ * @param fname File to be used for the file driver.
+**/
+static void bench_flush(const char * name, size_t size, size_t segment_size, unsigned int threads, const char * fname)
+{
+	//map
+	ummap_set_flush_threads(threads);
+	ummap_driver_t * driver = build_driver(name, size, fname);
+	char * ptr = (char*)ummap(NULL, size, segment_size, 0, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, driver, NULL, "none");
+
+	//fill
+	memset(ptr, 1, size);
+
+	//flush
+	auto start = std::chrono::steady_clock::now();
+	umunmap(ptr, true);
+	auto stop = std::chrono::steady_clock::now();
+
+	//print
+	double time = std::chrono::duration<double>(stop - start).count();
+	printf("%-6s %10zu %10zu %8u %10.3f %10.1f\n", name, size / 1024 / 1024, segment_size / 1024, threads, time, (double)size / 1024.0 / 1024.0 / time);
+}
+
+/*******************  FUNCTION  *********************/
+int main(int argc, char ** argv)
+{
+	//defaults
+	size_t size = 1024UL*1024UL*1024UL;
+	size_t segment_size = 64*1024;
+	unsigned int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	const char * fname = "/tmp/ummap-bench-flush.raw";
+
+	//args
+	if (argc >= 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+		printf("%s [size_MB] [segment_size_KB] [max_threads] [file]\n", argv[0]);
+		return EXIT_SUCCESS;
+	}
+	if (argc >= 2)
+		size = atol(argv[1]) * 1024UL * 1024UL;
+	if (argc >= 3)
+		segment_size = atol(argv[2]) * 1024UL;
+	if (argc >= 4)
+		max_threads = atoi(argv[3]);
+	if (argc >= 5)
+		fname = argv[4];
+
+	//init
+	ummap_init();
+
+	//run
+	printf("%-6s %10s %10s %8s %10s %10s\n", "driver", "size(MB)", "seg(KB)", "threads", "time(s)", "MB/s");
+	const char * drivers[] = {"mem", "file"};
+	for (int d = 0 ; d < 2 ; d++)
+		for (unsigned int threads = 1 ; threads <= max_threads ; threads *= 2)
+			bench_flush(drivers[d], size, segment_size, threads, fname);
+
+	//clean
+	unlink(fname);
+	ummap_finalize();
+
+	//ok
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+//ummap-io
+#include <ummap.h>
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the time elapsed since the given start point in seconds.
+**/
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Create many small mappings, touch them and unmap them by measuring each step.
+ * @param mode Name of the mode (ummap, light or batch).
+ * @param count Number of mappings.
+ * @param size Size of each mapping.
+ * @param segment_size Size of the segments.
+ * @param policy_group Name of the policy group to attach the mappings to.
+**/
+static void bench_map(const char * mode, size_t count, size_t size, size_t segment_size, const char * policy_group)
+{
+	//vars
+	std::vector<ummap_batch_entry_t> entries(count);
+	int flags = (strcmp(mode, "ummap") == 0) ? UMMAP_DEFAULT : UMMAP_LIGHTWEIGHT;
+
+	//prepare the drivers out of the measurement
+	for (size_t i = 0 ; i < count ; i++) {
+		entries[i].size = size;
+		entries[i].storage_offset = 0;
+		entries[i].driver = ummap_driver_create_dummy(0);
+		entries[i].local_policy = NULL;
+		entries[i].addr = NULL;
+	}
+
+	//map
+	auto start = std::chrono::steady_clock::now();
+	if (strcmp(mode, "batch") == 0) {
+		ummap_batch(entries.data(), count, segment_size, PROT_READ|PROT_WRITE, flags, policy_group);
+	} else {
+		for (size_t i = 0 ; i < count ; i++)
+			entries[i].addr = ummap(NULL, size, segment_size, 0, PROT_READ|PROT_WRITE, flags, entries[i].driver, NULL, policy_group);
+	}
+	double mapTime = elapsed(start);
+
+	//touch the first segment of each mapping
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0 ; i < count ; i++)
+		*(char*)entries[i].addr = 1;
+	double touchTime = elapsed(start);
+
+	//unmap
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0 ; i < count ; i++)
+		umunmap(entries[i].addr, false);
+	double unmapTime = elapsed(start);
+
+	//print
+	printf("%-6s %10zu %10zu %14.0f %14.0f %14.0f\n", mode, count, size / 1024, count / mapTime, count / touchTime, count / unmapTime);
+}
+
+/*******************  FUNCTION  *********************/
+int main(int argc, char ** argv)
+{
+	//defaults
+	size_t max_count = 10000;
+	size_t size = 16*1024;
+	size_t segment_size = 4096;
+
+	//args
+	if (argc >= 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+		printf("%s [max_count] [size_KB] [segment_size_KB]\n", argv[0]);
+		printf("Each mapping needs at least one kernel VMA, raise vm.max_map_count for more than 60000 mappings.\n");
+		return EXIT_SUCCESS;
+	}
+	if (argc >= 2)
+		max_count = atol(argv[1]);
+	if (argc >= 3)
+		size = atol(argv[2]) * 1024UL;
+	if (argc >= 4)
+		segment_size = atol(argv[3]) * 1024UL;
+
+	//init
+	ummap_init();
+	ummap_policy_group_register("bench", ummap_policy_create_fifo(max_count * segment_size, false));
+
+	//run
+	printf("%-6s %10s %10s %14s %14s %14s\n", "mode", "mappings", "size(KB)", "map/s", "touch/s", "unmap/s");
+	const char * modes[] = {"ummap", "light", "batch"};
+	for (size_t count = 1000 ; count <= max_count ; count *= 10)
+		for (int m = 0 ; m < 3 ; m++)
+			bench_map(modes[m], count, size, segment_size, "bench");
+
+	//clean
+	ummap_policy_group_destroy("bench");
+	ummap_finalize();
+
+	//ok
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,440 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cassert>
+#include <cstdint>
+//internal
+#include "Debug.hpp"
+//local
+#include "SegmentList.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*********************  CONSTS  *********************/
+/** Used to mark an empty link or hash table entry. **/
+static const uint32_t SEGMENT_LIST_NONE = UINT32_MAX;
+/** Initial size of the hash table (power of 2). **/
+static const size_t SEGMENT_LIST_INIT_TABLE = 16;
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the segment list.
+ * @param lists Number of lists to handle, their IDs goes from 0 to lists-1.
+**/
+SegmentList::SegmentList(unsigned int lists)
+{
+	//check
+	assumeArg(lists > 0 && lists <= UMMAP_SEGMENT_LIST_MAX_LISTS, "Invalid number of lists : %1").arg(lists).end();
+
+	//setup
+	this->lists = lists;
+	this->count = 0;
+	this->freeNodes = SEGMENT_LIST_NONE;
+	this->table.resize(SEGMENT_LIST_INIT_TABLE, SEGMENT_LIST_NONE);
+
+	//create the roots
+	this->nodes.resize(lists);
+	for (unsigned int i = 0 ; i < lists ; i++) {
+		SegmentListNode & root = this->nodes[i];
+		root.prev = root.next = i;
+		root.segment = 0;
+		root.owner = 0;
+		root.list = i;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the segment list.
+**/
+SegmentList::~SegmentList(void)
+{
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Compute the hash table slot where to start searching the given segment.
+ * @param owner ID of the owner mapping.
+ * @param segment Index of the segment in the mapping.
+**/
+size_t SegmentList::getSlot(uint32_t owner, uint32_t segment) const
+{
+	uint64_t key = (static_cast<uint64_t>(owner) << 32) | segment;
+	uint64_t hash = key * 0x9E3779B97F4A7C15ULL;
+	return (hash ^ (hash >> 29)) & (this->table.size() - 1);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Search the node of the given segment.
+ * @param owner ID of the owner mapping.
+ * @param segment Index of the segment in the mapping.
+ * @return The node index or SEGMENT_LIST_NONE if not in a list.
+**/
+uint32_t SegmentList::lookup(uint32_t owner, uint32_t segment) const
+{
+	//vars
+	const size_t mask = this->table.size() - 1;
+	size_t slot = this->getSlot(owner, segment);
+
+	//linear probing
+	while (this->table[slot] != SEGMENT_LIST_NONE) {
+		const SegmentListNode & node = this->nodes[this->table[slot]];
+		if (node.owner == owner && node.segment == segment)
+			return this->table[slot];
+		slot = (slot + 1) & mask;
+	}
+
+	//not found
+	return SEGMENT_LIST_NONE;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Register the given node in the hash table.
+ * @param node Index of the node.
+**/
+void SegmentList::hashInsert(uint32_t node)
+{
+	//vars
+	const size_t mask = this->table.size() - 1;
+	size_t slot = this->getSlot(this->nodes[node].owner, this->nodes[node].segment);
+
+	//search free slot
+	while (this->table[slot] != SEGMENT_LIST_NONE)
+		slot = (slot + 1) & mask;
+
+	//set
+	this->table[slot] = node;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Remove the given node from the hash table by shifting back the next
+ * entries of the probing sequence so we do not need tombstones.
+ * @param node Index of the node.
+**/
+void SegmentList::hashRemove(uint32_t node)
+{
+	//vars
+	const size_t mask = this->table.size() - 1;
+	size_t slot = this->getSlot(this->nodes[node].owner, this->nodes[node].segment);
+
+	//search
+	while (this->table[slot] != node) {
+		assert(this->table[slot] != SEGMENT_LIST_NONE);
+		slot = (slot + 1) & mask;
+	}
+
+	//remove & shift back
+	this->table[slot] = SEGMENT_LIST_NONE;
+	size_t next = slot;
+	while (true) {
+		next = (next + 1) & mask;
+		if (this->table[next] == SEGMENT_LIST_NONE)
+			break;
+		const SegmentListNode & cur = this->nodes[this->table[next]];
+		size_t home = this->getSlot(cur.owner, cur.segment);
+		bool stay = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+		if (stay == false) {
+			this->table[slot] = this->table[next];
+			this->table[next] = SEGMENT_LIST_NONE;
+			slot = next;
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Rebuild the hash table with the given capacity.
+ * @param capacity New capacity (power of 2).
+**/
+void SegmentList::rehash(size_t capacity)
+{
+	//reset
+	this->table.assign(capacity, SEGMENT_LIST_NONE);
+
+	//insert all used nodes
+	for (size_t i = this->lists ; i < this->nodes.size() ; i++)
+		if (this->nodes[i].prev != SEGMENT_LIST_NONE)
+			this->hashInsert(i);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Take a node from the free list or extend the node table.
+ * @return Index of the node.
+**/
+uint32_t SegmentList::allocateNode(unsigned int list, uint32_t owner, uint32_t segment)
+{
+	//get one
+	uint32_t node = this->freeNodes;
+	if (node != SEGMENT_LIST_NONE) {
+		this->freeNodes = this->nodes[node].next;
+	} else {
+		assume(this->nodes.size() < SEGMENT_LIST_NONE, "Reach the maximum number of segments in a segment list !");
+		node = this->nodes.size();
+		this->nodes.push_back(SegmentListNode());
+	}
+
+	//setup
+	SegmentListNode & cur = this->nodes[node];
+	cur.prev = cur.next = node;
+	cur.owner = owner;
+	cur.segment = segment;
+	cur.list = list;
+
+	//ret
+	return node;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Push the node in the free list.
+ * @param node Index of the node.
+**/
+void SegmentList::freeNode(uint32_t node)
+{
+	this->nodes[node].prev = SEGMENT_LIST_NONE;
+	this->nodes[node].next = this->freeNodes;
+	this->freeNodes = node;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Remove the node from its list.
+ * @param node Index of the node.
+**/
+void SegmentList::unlink(uint32_t node)
+{
+	SegmentListNode & cur = this->nodes[node];
+	this->nodes[cur.prev].next = cur.next;
+	this->nodes[cur.next].prev = cur.prev;
+	cur.prev = cur.next = node;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Insert the node after the given position.
+ * @param position Index of the node after which to insert.
+ * @param node Index of the node to insert.
+**/
+void SegmentList::insertAfter(uint32_t position, uint32_t node)
+{
+	SegmentListNode & cur = this->nodes[node];
+	cur.prev = position;
+	cur.next = this->nodes[position].next;
+	this->nodes[cur.next].prev = node;
+	this->nodes[position].next = node;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Check if the given segment is in one of the lists.
+ * @param owner ID of the owner mapping.
+ * @param segment Index of the segment in the mapping.
+**/
+bool SegmentList::contains(uint32_t owner, uint32_t segment) const
+{
+	return this->lookup(owner, segment) != SEGMENT_LIST_NONE;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the ID of the list containing the given segment.
+ * @param owner ID of the owner mapping.
+ * @param segment Index of the segment in the mapping.
+ * @return The list ID or -1 if not in a list.
+**/
+int SegmentList::getList(uint32_t owner, uint32_t segment) const
+{
+	uint32_t node = this->lookup(owner, segment);
+	if (node == SEGMENT_LIST_NONE)
+		return -1;
+	else
+		return this->nodes[node].list;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Remove the given segment from its list.
+ * @param owner ID of the owner mapping.
+ * @param segment Index of the segment in the mapping.
+ * @return True if the segment was in a list, false otherwise.
+**/
+bool SegmentList::remove(uint32_t owner, uint32_t segment)
+{
+	//search
+	uint32_t node = this->lookup(owner, segment);
+	if (node == SEGMENT_LIST_NONE)
+		return false;
+
+	//remove
+	this->unlink(node);
+	this->hashRemove(node);
+	this->freeNode(node);
+	this->count--;
+
+	//ok
+	return true;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Insert the segment at the head of the list (the newest side).
+ * The segment must not be already in a list.
+ * @param list ID of the list.
+ * @param owner ID of the owner mapping.
+ * @param segment Index of the segment in the mapping.
+**/
+void SegmentList::pushFront(unsigned int list, uint32_t owner, uint32_t segment)
+{
+	//check
+	assert(list < this->lists);
+	assert(owner < UMMAP_SEGMENT_LIST_MAX_OWNERS);
+	assert(this->contains(owner, segment) == false);
+
+	//grow hash table to keep it half empty
+	this->count++;
+	if (this->count * 2 > this->table.size())
+		this->rehash(this->table.size() * 2);
+
+	//insert
+	uint32_t node = this->allocateNode(list, owner, segment);
+	this->insertAfter(list, node);
+	this->hashInsert(node);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Insert the segment at the tail of the list (the popBack() side).
+ * The segment must not be already in a list.
+ * @param list ID of the list.
+ * @param owner ID of the owner mapping.
+ * @param segment Index of the segment in the mapping.
+**/
+void SegmentList::pushBack(unsigned int list, uint32_t owner, uint32_t segment)
+{
+	//check
+	assert(list < this->lists);
+	assert(owner < UMMAP_SEGMENT_LIST_MAX_OWNERS);
+	assert(this->contains(owner, segment) == false);
+
+	//grow hash table to keep it half empty
+	this->count++;
+	if (this->count * 2 > this->table.size())
+		this->rehash(this->table.size() * 2);
+
+	//insert
+	uint32_t node = this->allocateNode(list, owner, segment);
+	this->insertAfter(this->nodes[list].prev, node);
+	this->hashInsert(node);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Remove the segment at the tail of the list.
+ * @param list ID of the list.
+ * @param owner Return the ID of the owner of the segment.
+ * @param segment Return the index of the segment.
+ * @return False if the list is empty.
+**/
+bool SegmentList::popBack(unsigned int list, uint32_t & owner, uint32_t & segment)
+{
+	//check
+	assert(list < this->lists);
+
+	//empty
+	uint32_t node = this->nodes[list].prev;
+	if (node == list)
+		return false;
+
+	//extract
+	owner = this->nodes[node].owner;
+	segment = this->nodes[node].segment;
+
+	//remove
+	this->unlink(node);
+	this->hashRemove(node);
+	this->freeNode(node);
+	this->count--;
+
+	//ok
+	return true;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Remove all the segments of the given owner from the list.
+ * @param list ID of the list.
+ * @param owner ID of the owner mapping.
+ * @param segments Number of segments of the owner if known. When it is smaller
+ * than the number of nodes, the segments are searched one by one in the hash
+ * table instead of walking the whole list so removing a small mapping does not
+ * depend on the number of segments tracked for the others.
+ * @return The number of removed segments.
+**/
+size_t SegmentList::removeOwner(unsigned int list, uint32_t owner, size_t segments)
+{
+	//check
+	assert(list < this->lists);
+
+	//vars
+	size_t removed = 0;
+
+	//search each segment of a small owner
+	if (segments < this->count) {
+		for (size_t i = 0 ; i < segments ; i++) {
+			uint32_t node = this->lookup(owner, i);
+			if (node != SEGMENT_LIST_NONE && this->nodes[node].list == list) {
+				this->unlink(node);
+				this->hashRemove(node);
+				this->freeNode(node);
+				this->count--;
+				removed++;
+			}
+		}
+		return removed;
+	}
+
+	//loop
+	uint32_t node = this->nodes[list].next;
+	while (node != list) {
+		uint32_t next = this->nodes[node].next;
+		if (this->nodes[node].owner == owner) {
+			this->unlink(node);
+			this->hashRemove(node);
+			this->freeNode(node);
+			this->count--;
+			removed++;
+		}
+		node = next;
+	}
+
+	//ret
+	return removed;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of segments in all the lists.
+**/
+size_t SegmentList::getSize(void) const
+{
+	return this->count;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the memory used by the node and hash tables.
+**/
+size_t SegmentList::getMemory(void) const
+{
+	return this->nodes.capacity() * sizeof(SegmentListNode) + this->table.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,93 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_SEGMENT_LIST_HPP
+#define UMMAP_SEGMENT_LIST_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  DEFINES  ********************/
+/** Maximum number of owners (mappings) which can be tracked by a SegmentList. **/
+#define UMMAP_SEGMENT_LIST_MAX_OWNERS (1UL << 24)
+/** Maximum number of lists handled by a SegmentList. **/
+#define UMMAP_SEGMENT_LIST_MAX_LISTS 256
+
+/*********************  STRUCT  *********************/
+/**
+ * Node of a SegmentList. The links are 32-bit indexes in the node table
+ * instead of pointers to keep the node on 16 bytes.
+**/
+struct SegmentListNode
+{
+	/** Index of the previous node. **/
+	uint32_t prev;
+	/** Index of the next node (or the next free node if not used). **/
+	uint32_t next;
+	/** Index of the segment in the mapping. **/
+	uint32_t segment;
+	/** ID of the mapping owning the segment. **/
+	uint32_t owner:24;
+	/** ID of the list containing the node. **/
+	uint32_t list:8;
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Set of double linked lists of segments used by the FIFO/LIFO policies.
+ * Contrary to a ListElement array per mapping, only the segments currently
+ * in a list (the resident ones) consume memory: the nodes are allocated in a
+ * shared table and found back from their (owner, segment) key by an open
+ * addressing hash table. This keep the metadata proportional to the memory
+ * allowed by the policy, not to the size of the mappings.
+**/
+class SegmentList
+{
+	public:
+		SegmentList(unsigned int lists = 1);
+		~SegmentList(void);
+		bool contains(uint32_t owner, uint32_t segment) const;
+		int getList(uint32_t owner, uint32_t segment) const;
+		bool remove(uint32_t owner, uint32_t segment);
+		void pushFront(unsigned int list, uint32_t owner, uint32_t segment);
+		void pushBack(unsigned int list, uint32_t owner, uint32_t segment);
+		bool popBack(unsigned int list, uint32_t & owner, uint32_t & segment);
+		size_t removeOwner(unsigned int list, uint32_t owner, size_t segments = SIZE_MAX);
+		size_t getSize(void) const;
+		size_t getMemory(void) const;
+	private:
+		uint32_t allocateNode(unsigned int list, uint32_t owner, uint32_t segment);
+		void freeNode(uint32_t node);
+		void unlink(uint32_t node);
+		void insertAfter(uint32_t position, uint32_t node);
+		uint32_t lookup(uint32_t owner, uint32_t segment) const;
+		size_t getSlot(uint32_t owner, uint32_t segment) const;
+		void hashInsert(uint32_t node);
+		void hashRemove(uint32_t node);
+		void rehash(size_t capacity);
+	private:
+		/** Table of nodes, the first ones are the roots of the lists. **/
+		std::vector<SegmentListNode> nodes;
+		/** Open addressing hash table pointing the nodes. **/
+		std::vector<uint32_t> table;
+		/** Head of the free nodes chained by their next field. **/
+		uint32_t freeNodes;
+		/** Number of lists (and of root nodes). **/
+		unsigned int lists;
+		/** Number of segments in the lists. **/
+		size_t count;
+};
+
+}
+
+#endif //UMMAP_SEGMENT_LIST_HPP
@@ -0,0 +1,179 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include "../SegmentList.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentList, constructor)
+{
+	//create
+	SegmentList list;
+
+	//check status
+	ASSERT_EQ(0u, list.getSize());
+	ASSERT_FALSE(list.contains(0, 0));
+	ASSERT_EQ(-1, list.getList(0, 0));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentList, pushFront_popBack)
+{
+	//create
+	SegmentList list;
+
+	//insert
+	list.pushFront(0, 1, 10);
+	list.pushFront(0, 2, 10);
+	list.pushFront(0, 1, 11);
+	ASSERT_EQ(3u, list.getSize());
+	ASSERT_TRUE(list.contains(2, 10));
+	ASSERT_FALSE(list.contains(2, 11));
+
+	//pop in FIFO order
+	uint32_t owner;
+	uint32_t segment;
+	ASSERT_TRUE(list.popBack(0, owner, segment));
+	ASSERT_EQ(1u, owner);
+	ASSERT_EQ(10u, segment);
+	ASSERT_TRUE(list.popBack(0, owner, segment));
+	ASSERT_EQ(2u, owner);
+	ASSERT_EQ(10u, segment);
+	ASSERT_TRUE(list.popBack(0, owner, segment));
+	ASSERT_EQ(1u, owner);
+	ASSERT_EQ(11u, segment);
+	ASSERT_FALSE(list.popBack(0, owner, segment));
+	ASSERT_EQ(0u, list.getSize());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentList, pushBack)
+{
+	//create
+	SegmentList list;
+
+	//insert
+	list.pushFront(0, 0, 1);
+	list.pushBack(0, 0, 2);
+
+	//pop
+	uint32_t owner;
+	uint32_t segment;
+	ASSERT_TRUE(list.popBack(0, owner, segment));
+	ASSERT_EQ(2u, segment);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentList, remove)
+{
+	//create
+	SegmentList list;
+
+	//insert
+	list.pushFront(0, 0, 1);
+	list.pushFront(0, 0, 2);
+	list.pushFront(0, 0, 3);
+
+	//remove
+	ASSERT_TRUE(list.remove(0, 2));
+	ASSERT_FALSE(list.remove(0, 2));
+	ASSERT_FALSE(list.contains(0, 2));
+	ASSERT_TRUE(list.contains(0, 3));
+
+	//pop
+	uint32_t owner;
+	uint32_t segment;
+	ASSERT_TRUE(list.popBack(0, owner, segment));
+	ASSERT_EQ(1u, segment);
+	ASSERT_TRUE(list.popBack(0, owner, segment));
+	ASSERT_EQ(3u, segment);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentList, multiple_lists)
+{
+	//create
+	SegmentList list(2);
+
+	//insert
+	list.pushFront(0, 0, 1);
+	list.pushFront(1, 0, 2);
+	ASSERT_EQ(0, list.getList(0, 1));
+	ASSERT_EQ(1, list.getList(0, 2));
+
+	//pop
+	uint32_t owner;
+	uint32_t segment;
+	ASSERT_TRUE(list.popBack(1, owner, segment));
+	ASSERT_EQ(2u, segment);
+	ASSERT_FALSE(list.popBack(1, owner, segment));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentList, removeOwner)
+{
+	//create
+	SegmentList list;
+
+	//insert
+	for (uint32_t i = 0 ; i < 100 ; i++)
+		list.pushFront(0, i % 3, i);
+
+	//remove
+	ASSERT_EQ(34u, list.removeOwner(0, 0));
+	ASSERT_EQ(66u, list.getSize());
+	for (uint32_t i = 0 ; i < 100 ; i++)
+		ASSERT_EQ(i % 3 != 0, list.contains(i % 3, i)) << "Index: " << i;
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentList, removeOwner_segments)
+{
+	//create
+	SegmentList list(2);
+
+	//insert a small owner among a large one
+	for (uint32_t i = 0 ; i < 100 ; i++)
+		list.pushFront(0, 0, i);
+	list.pushFront(0, 1, 0);
+	list.pushFront(0, 1, 3);
+	list.pushFront(1, 1, 2);
+
+	//remove by lookup
+	ASSERT_EQ(2u, list.removeOwner(0, 1, 4));
+	ASSERT_EQ(101u, list.getSize());
+	ASSERT_FALSE(list.contains(1, 0));
+	ASSERT_FALSE(list.contains(1, 3));
+	ASSERT_EQ(1, list.getList(1, 2));
+	ASSERT_TRUE(list.contains(0, 99));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentList, large)
+{
+	//create
+	SegmentList list;
+
+	//insert many to rehash
+	const uint32_t cnt = 100000;
+	for (uint32_t i = 0 ; i < cnt ; i++)
+		list.pushFront(0, 1, i * 7);
+
+	//remove half
+	for (uint32_t i = 0 ; i < cnt ; i += 2)
+		ASSERT_TRUE(list.remove(1, i * 7));
+
+	//check
+	for (uint32_t i = 0 ; i < cnt ; i++)
+		ASSERT_EQ(i % 2 == 1, list.contains(1, i * 7)) << "Index: " << i;
+
+	//memory is far below a full table of pointers
+	ASSERT_LT(list.getMemory(), cnt * 32);
+}
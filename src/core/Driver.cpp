@@ -5,6 +5,9 @@
 *****************************************************/
 
 /********************  HEADERS  *********************/
+//std
+#include <cstdio>
+//local
 #include "Driver.hpp"
 
 /***************** USING NAMESPACE ******************/
@@ -68,6 +71,46 @@ const std::string & Driver::getUri(void) const
 	return this->uri;
 }
 
+/*******************  FUNCTION  *********************/
+ssize_t Driver::pwritev(const struct iovec * iov, int iovcnt, size_t offset)
+{
+	//vars
+	ssize_t total = 0;
+
+	//loop on buffers
+	for (int i = 0 ; i < iovcnt ; i++) {
+		ssize_t res = this->pwrite(iov[i].iov_base, iov[i].iov_len, offset + total);
+		if (res < 0)
+			return res;
+		total += res;
+		if (static_cast<size_t>(res) != iov[i].iov_len)
+			break;
+	}
+
+	//ok
+	return total;
+}
+
+/*******************  FUNCTION  *********************/
+std::string Driver::getObjectKey(void)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "driver:%p", (void*)this);
+	return buffer;
+}
+
+/*******************  FUNCTION  *********************/
+bool Driver::cloneTo(Driver * target, size_t offset, size_t size)
+{
+	return false;
+}
+
+/*******************  FUNCTION  *********************/
+bool Driver::discard(size_t offset, size_t size)
+{
+	return false;
+}
+
 /*******************  FUNCTION  *********************/
 void * Driver::directMmap(void *addr, size_t size, size_t offset, bool read, bool write, bool exec, bool mapFixed)
 {
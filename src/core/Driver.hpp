@@ -11,6 +11,8 @@
 //std
 #include <cstdlib>
 #include <string>
+//unix
+#include <sys/uio.h>
 
 /********************  NAMESPACE  *******************/
 namespace ummapio
@@ -49,6 +51,38 @@ class Driver
 		 * @param size Size of the segment to sync.
 		**/
 		virtual void sync(void *ptr, size_t offset, size_t size) = 0;
+		/**
+		 * Apply a vectorized write operation to dump several memory buffers into a contiguous
+		 * range of the storage. The default implementation calls pwrite() for each buffer.
+		 * @param iov List of buffers to write.
+		 * @param iovcnt Number of buffers in the list.
+		 * @param offset Offset in the storage element.
+		 * @return The writted size.
+		**/
+		virtual ssize_t pwritev(const struct iovec * iov, int iovcnt, size_t offset);
+		/**
+		 * Return a key identifying the storage object accessed by the driver so
+		 * we can detect several drivers accessing the same object. By default
+		 * each driver is considered as a different object.
+		**/
+		virtual std::string getObjectKey(void);
+		/**
+		 * Try to make a cheap copy of the given range (reflink or copy on write) from
+		 * the current object into the target one at the same offset.
+		 * @param target The driver to copy into.
+		 * @param offset Offset of the range in the storage element.
+		 * @param size Size of the range.
+		 * @return True if done, false if not supported so the caller need to copy the data.
+		**/
+		virtual bool cloneTo(Driver * target, size_t offset, size_t size);
+		/**
+		 * Deallocate the given range of the storage, its content is no more needed
+		 * and must read back as zeroes. By default nothing is done.
+		 * @param offset Offset of the range in the storage element.
+		 * @param size Size of the range.
+		 * @return True if the storage has been released, false if not supported.
+		**/
+		virtual bool discard(size_t offset, size_t size);
 		/**
 		 * Let the driver making the memory mapping. This is to be used
 		 * by direct access modes
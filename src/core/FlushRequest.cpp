@@ -0,0 +1,92 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cassert>
+//internal
+#include "../common/Debug.hpp"
+//local
+#include "Mapping.hpp"
+#include "FlushRequest.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+/**
+ * Start the asynchronous flush operation. It must be called after the
+ * segments have been marked in-flight by the mapping.
+ * @param mapping The mapping to flush.
+ * @param offset Offset of the range to flush (aligned on segment size).
+ * @param size Size of the range to flush (aligned on segment size).
+ * @param flags Flush flags to apply (UMMAP_FLUSH_SYNC, UMMAP_FLUSH_UNMAP).
+ * @param pool Pool running the write operations, it must outlive the request.
+**/
+FlushRequest::FlushRequest(Mapping * mapping, size_t offset, size_t size, int flags, WorkerPool & pool)
+	:done(false)
+{
+	//check
+	assert(mapping != NULL);
+
+	//set
+	this->mapping = mapping;
+	this->offset = offset;
+	this->size = size;
+	this->flags = flags;
+
+	//start
+	pool.post([this]{this->run();});
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor, make sure the task of the pool is finished.
+**/
+FlushRequest::~FlushRequest(void)
+{
+	this->wait();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Task run by the pool, write the segments and notify the mapping
+ * the request is finished.
+**/
+void FlushRequest::run(void)
+{
+	//flush
+	this->mapping->flushInFlight(this->offset, this->size, this->flags);
+
+	//notify mapping, it might be destroyed just after
+	this->mapping->endAsyncRequest();
+	this->mapping = NULL;
+
+	//mark done, wait() can delete the request as soon as the mutex is released
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	this->done.store(true);
+	this->cond.notify_all();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Check if the request has completed.
+ * @return True if all the data has been written (and synced if requested).
+**/
+bool FlushRequest::test(void) const
+{
+	return this->done.load();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Wait the request to complete.
+**/
+void FlushRequest::wait(void)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->cond.wait(lock, [this]{return this->done.load();});
+}
@@ -0,0 +1,62 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_FLUSH_REQUEST_HPP
+#define UMMAP_FLUSH_REQUEST_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+//local
+#include "WorkerPool.hpp"
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  CLASS  **********************/
+class Mapping;
+
+/*********************  CLASS  **********************/
+/**
+ * Handle tracking an asynchronous flush operation. The segments to flush are
+ * first marked in-flight by Mapping::flushAsync() then this object posts a
+ * task to the worker pool writing them to the storage so the caller can
+ * continue to work on the rest of the mapping.
+ * The handle must be completed by calling wait() before being destroyed.
+**/
+class FlushRequest
+{
+	public:
+		FlushRequest(Mapping * mapping, size_t offset, size_t size, int flags, WorkerPool & pool);
+		~FlushRequest(void);
+		bool test(void) const;
+		void wait(void);
+	private:
+		void run(void);
+	private:
+		/** Mapping to flush, it waits all the pending requests before being destroyed. **/
+		Mapping * mapping;
+		/** Offset of the range to flush (aligned on segment size). **/
+		size_t offset;
+		/** Size of the range to flush (aligned on segment size). **/
+		size_t size;
+		/** Flush flags to apply (UMMAP_FLUSH_SYNC, UMMAP_FLUSH_UNMAP). **/
+		int flags;
+		/** Become true when all the data has been written. **/
+		std::atomic<bool> done;
+		/** Protect the completion for wait(). **/
+		std::mutex mutex;
+		/** Wake up wait() when the task of the pool is finished. **/
+		std::condition_variable cond;
+};
+
+}
+
+#endif //UMMAP_FLUSH_REQUEST_HPP
@@ -0,0 +1,162 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cassert>
+#include <climits>
+#include <algorithm>
+#include <map>
+//internal
+#include "../common/Debug.hpp"
+//local
+#include "FlushScheduler.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/********************  MACROS  **********************/
+/** Maximal number of buffers in a vectorized write. **/
+#ifdef IOV_MAX
+	#define UMMAP_FLUSH_MAX_IOV IOV_MAX
+#else
+	#define UMMAP_FLUSH_MAX_IOV 1024
+#endif
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the scheduler.
+**/
+FlushScheduler::FlushScheduler(void)
+{
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the scheduler.
+**/
+FlushScheduler::~FlushScheduler(void)
+{
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Register a mapping to be flushed by the next run() call.
+ * @param mapping The mapping to flush.
+**/
+void FlushScheduler::addMapping(Mapping * mapping)
+{
+	assert(mapping != NULL);
+	this->mappings.push_back(mapping);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Flush all the registered mappings. All the segments of all the
+ * mappings are taken for the whole operation, by ordering the mappings on
+ * their address to avoid dead locks between two schedulers.
+ * @param sync Apply a sync operation on the drivers after the writes.
+**/
+void FlushScheduler::run(bool sync)
+{
+	//order & remove duplicates
+	std::sort(this->mappings.begin(), this->mappings.end());
+	this->mappings.erase(std::unique(this->mappings.begin(), this->mappings.end()), this->mappings.end());
+
+	//mappings handled directly by the driver do not need to be scheduled
+	std::vector<Mapping *> scheduled;
+	for (auto mapping : this->mappings) {
+		bool direct = mapping->getDriver()->directMSync(mapping->getAddress(), mapping->getSize(), mapping->getStorageOffset());
+		if (direct == false)
+			scheduled.push_back(mapping);
+	}
+
+	//lock all
+	for (auto mapping : scheduled)
+		mapping->lockAllSegments();
+
+	//gather per object
+	std::map<std::string, std::vector<MappingDirtySegment> > objects;
+	for (auto mapping : scheduled)
+		mapping->collectDirtySegments(objects[mapping->getDriver()->getObjectKey()]);
+
+	//flush objects
+	for (auto & it : objects)
+		this->flushObject(it.second);
+
+	//sync
+	if (sync)
+		for (auto mapping : scheduled)
+			mapping->getDriver()->sync(mapping->getAddress(), 0, mapping->getAlignedSize());
+
+	//unlock all
+	for (auto it = scheduled.rbegin() ; it != scheduled.rend() ; ++it)
+		(*it)->unlockAllSegments();
+
+	//clear
+	this->mappings.clear();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Flush the dirty segments of an object by ordering them by storage offset
+ * and merging the neighbours in vectorized writes.
+ * @param segments List of dirty segments of the object.
+**/
+void FlushScheduler::flushObject(std::vector<MappingDirtySegment> & segments)
+{
+	//order by storage offset
+	std::stable_sort(segments.begin(), segments.end(), [](const MappingDirtySegment & a, const MappingDirtySegment & b) {
+		return a.storageOffset < b.storageOffset;
+	});
+
+	//loop on runs
+	std::vector<struct iovec> iov;
+	size_t start = 0;
+	while (start < segments.size()) {
+		//init run
+		const MappingDirtySegment & first = segments[start];
+		size_t runSize = first.size;
+		size_t end = start + 1;
+		iov.clear();
+		iov.push_back({(char*)first.mapping->getAddress() + first.offset, first.size});
+
+		//extend run
+		while (end < segments.size() && runSize < UMMAP_FLUSH_MAX_RUN_SIZE) {
+			//check contiguous in storage
+			const MappingDirtySegment & cur = segments[end];
+			if (cur.storageOffset != first.storageOffset + runSize)
+				break;
+
+			//extend last buffer if contiguous in memory or add a new one
+			char * ptr = (char*)cur.mapping->getAddress() + cur.offset;
+			struct iovec & last = iov.back();
+			if ((char*)last.iov_base + last.iov_len == ptr) {
+				last.iov_len += cur.size;
+			} else if (iov.size() < UMMAP_FLUSH_MAX_IOV) {
+				iov.push_back({ptr, cur.size});
+			} else {
+				break;
+			}
+
+			//move
+			runSize += cur.size;
+			end++;
+		}
+
+		//write
+		ssize_t res = first.mapping->getDriver()->pwritev(iov.data(), iov.size(), first.storageOffset);
+		assumeArg(res != -1, "Fail to pwritev : %1").argStrErrno().end();
+		assumeArg(res == static_cast<ssize_t>(runSize), "Fail to fully write the segments, got %1 instead of %2").arg(res).arg(runSize).end();
+
+		//mark flushed
+		for (size_t i = start ; i < end ; i++)
+			segments[i].mapping->markSegmentFlushed(segments[i].offset);
+
+		//move
+		start = end;
+	}
+}
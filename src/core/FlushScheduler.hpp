@@ -0,0 +1,45 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_FLUSH_SCHEDULER_HPP
+#define UMMAP_FLUSH_SCHEDULER_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <vector>
+//local
+#include "Mapping.hpp"
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  CLASS  **********************/
+/**
+ * Flush several mappings at once by gathering the dirty segments of all the
+ * mappings accessing the same storage object (see Driver::getObjectKey()).
+ * The segments are sorted by their absolute storage offset and the neighbours
+ * are merged, even across mapping boundaries, to issue large vectorized writes
+ * in increasing offset order. This is more friendly for sequential storage
+ * like HDDs or object stores than flushing each mapping independently.
+**/
+class FlushScheduler
+{
+	public:
+		FlushScheduler(void);
+		~FlushScheduler(void);
+		void addMapping(Mapping * mapping);
+		void run(bool sync);
+	private:
+		void flushObject(std::vector<MappingDirtySegment> & segments);
+	private:
+		/** List of mappings to flush. **/
+		std::vector<Mapping *> mappings;
+};
+
+}
+
+#endif //UMMAP_FLUSH_SCHEDULER_HPP
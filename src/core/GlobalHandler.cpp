@@ -11,12 +11,18 @@
 #include <cstdint>
 #include <cassert>
 #include <signal.h>
+//std
+#include <mutex>
+#include <condition_variable>
 //local
 #ifdef HAVE_HTOPML
 #include "../htopml/HtopmlMappings.hpp"
 #endif //HAVE_HTOPML
 #include "../common/Debug.hpp"
+#include "../portability/OS.hpp"
 #include "PolicyQuotaInterProc.hpp"
+#include "FlushRequest.hpp"
+#include "FlushScheduler.hpp"
 #include "GlobalHandler.hpp"
 
 /***************** USING NAMESPACE ******************/
@@ -103,7 +109,11 @@ void ummapio::segfaultHandler(int sig, siginfo_t *si, void *context)
  * mappings.
 **/
 GlobalHandler::GlobalHandler(void)
+	:loadScheduler(workerPool)
 {
+	//default
+	this->flushThreads = 0;
+
 	#ifdef HAVE_HTOPML
 	HtopmlMappingsHttpNode::registerMapping(&mappingRegistry);
 	#endif //HAVE_HTOPML
@@ -251,13 +261,62 @@ void * GlobalHandler::ummap(void * addr, size_t size, size_t segmentSize, size_t
 		globalPolicy = this->policyRegistry.get(policyGroup);
 
 	//create mapping
-	Mapping * mapping = new Mapping(NULL, size, segmentSize, storageOffset, protection, flags, driver, localPolicy, globalPolicy);
+	Mapping * mapping = new Mapping(NULL, size, segmentSize, storageOffset, protection, flags, driver, localPolicy, globalPolicy, &this->statusPool, &this->segmentCaches);
 	this->mappingRegistry.registerMapping(mapping);
 	
 	//return
 	return mapping->getAddress();
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Establish several mappings at once. The address range of all the mappings is
+ * reserved by a single mmap() call, the policy group is resolved once and the
+ * mappings are registered by taking the registry lock only once.
+ * @param entries Describe the mappings to create, the addr field is filled with
+ * the address of each mapping.
+ * @param count Number of entries.
+ * @param segmentSize Segment size used by all the mappings.
+ * @param protection Access protection of all the mappings.
+ * @param flags Flags applied to all the mappings, UMMAP_FIXED is not supported.
+ * @param policyGroup Name of the policy group shared by the mappings or "none".
+**/
+void GlobalHandler::ummapBatch(ummap_batch_entry_t * entries, size_t count, size_t segmentSize, int protection, int flags, const std::string & policyGroup)
+{
+	//check
+	assert(entries != NULL || count == 0);
+	assume(segmentSize > 0, "Do not accept null segment size");
+	assume((flags & UMMAP_FIXED) == 0, "Cannot use UMMAP_FIXED with ummap_batch() !");
+
+	//nothing to do
+	if (count == 0)
+		return;
+
+	//get policy
+	Policy * globalPolicy = NULL;
+	if (policyGroup != "none")
+		globalPolicy = this->policyRegistry.get(policyGroup);
+
+	//compute the size of the whole range
+	size_t totalSize = 0;
+	for (size_t i = 0 ; i < count ; i++)
+		totalSize += (entries[i].size + segmentSize - 1) / segmentSize * segmentSize;
+
+	//reserve
+	char * cur = (char*)OS::mmapProtNone(NULL, totalSize, false);
+
+	//create mappings
+	std::vector<Mapping *> mappings(count);
+	for (size_t i = 0 ; i < count ; i++) {
+		mappings[i] = new Mapping(cur, entries[i].size, segmentSize, entries[i].storage_offset, protection, flags | UMMAP_MAPPING_RESERVED, (Driver*)entries[i].driver, (Policy*)entries[i].local_policy, globalPolicy, &this->statusPool, &this->segmentCaches);
+		entries[i].addr = mappings[i]->getAddress();
+		cur += mappings[i]->getAlignedSize();
+	}
+
+	//register all
+	this->mappingRegistry.registerMappings(mappings.data(), count);
+}
+
 /*******************  FUNCTION  *********************/
 /**
  * Unmap the mapping identifed by the given address.
@@ -278,7 +337,7 @@ int GlobalHandler::uunmap(void * ptr, bool sync)
 
 	//sync
 	if (sync)
-		mapping->flush(0, mapping->getAlignedSize(), UMMAP_FLUSH_SYNC);
+		mapping->flushParallel(0, mapping->getAlignedSize(), UMMAP_FLUSH_SYNC, this->getFlushThreads(), this->workerPool);
 
 	//delete
 	delete mapping;
@@ -287,6 +346,35 @@ int GlobalHandler::uunmap(void * ptr, bool sync)
 	return 0;
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Resize or move the mapping identified by the given address (see Mapping::remap()).
+ * @param ptr Base address of the mapping.
+ * @param newSize New size of the mapping.
+ * @param flags UMMAP_REMAP_MAYMOVE and/or UMMAP_REMAP_FIXED.
+ * @param newAddr Target address with UMMAP_REMAP_FIXED.
+ * @return The new base address or NULL if the mapping cannot grow in place.
+**/
+void * GlobalHandler::remap(void * ptr, size_t newSize, int flags, void * newAddr)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to remap : %1").arg(ptr).end();
+	assumeArg(mapping->getAddress() == ptr, "Should remap with the base address of the mapping, got %1 !").arg(ptr).end();
+
+	//apply
+	void * res = mapping->remap(newSize, flags, newAddr);
+
+	//update the registry
+	if (res != NULL)
+		this->mappingRegistry.updateMapping(mapping, ptr);
+
+	//ok
+	return res;
+}
+
 /*******************  FUNCTION  *********************/
 void GlobalHandler::makeDirty(void * ptr)
 {
@@ -343,6 +431,40 @@ UriHandler & GlobalHandler::getUriHandler(void)
 	return this->uriHandler;
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Compute the range to flush inside the mapping aligned on the segment size.
+ * @param mapping The mapping to flush.
+ * @param ptr Define the base address from where to start the flush operation.
+ * @param offset Return the offset of the range in the mapping.
+ * @param size Size of the range to flush, 0 for all the mapping after ptr. It
+ * is updated to be aligned on the segment size.
+**/
+static void computeFlushRange(Mapping * mapping, void * ptr, size_t & offset, size_t & size)
+{
+	//compute
+	offset = (char*)ptr - (char*)mapping->getAddress();
+	size_t segmentSize = mapping->getSegmentSize();
+
+	//size
+	if (size == 0)
+		size = mapping->getAlignedSize() - offset;
+	
+	//align
+	if (offset % segmentSize != 0) {
+		size_t delta = offset % segmentSize;
+		offset -= delta;
+		size += delta;
+	}
+	if (size % segmentSize != 0) {
+		size += segmentSize - size % segmentSize;
+	}
+
+	//check
+	assume(offset + size <= mapping->getAlignedSize(),
+		"Invalid flush size, not fit in ummap mapping !");
+}
+
 /*******************  FUNCTION  *********************/
 /**
  * Apply a flush operation of the given segment. This will send
@@ -360,31 +482,405 @@ void GlobalHandler::flush(void * ptr, size_t size, bool evict, bool sync)
 	//error
 	assumeArg(mapping != NULL, "Fail to find ummap mapping to unmap : %1").arg(ptr).end();
 
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
+
+	//apply
+	int flags = 0;
+	if (sync)
+		flags |= UMMAP_FLUSH_SYNC;
+	if (evict)
+		flags |= UMMAP_FLUSH_UNMAP;
+	mapping->flushParallel(offset, size, flags, this->getFlushThreads(), this->workerPool);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Flush and sync all the mappings attached to the given policy group.
+ * The dirty segments of all the mappings accessing the same storage object
+ * are written in storage offset order by the flush scheduler.
+ * @param policyGroup Name of the policy group.
+**/
+void GlobalHandler::syncGroup(const std::string & policyGroup)
+{
+	//get policy
+	Policy * policy = this->policyRegistry.get(policyGroup);
+
+	//schedule
+	FlushScheduler scheduler;
+	for (auto mapping : this->mappingRegistry.getMappingsWithPolicy(policy))
+		scheduler.addMapping(mapping);
+
+	//apply
+	scheduler.run(true);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Make an incremental checkpoint of the mapping into the given URI.
+ * @param ptr Address inside the mapping.
+ * @param uri URI of the checkpoint storage.
+ * @return The checkpoint epoch number.
+**/
+size_t GlobalHandler::checkpoint(void * ptr, const std::string & uri)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to checkpoint : %1").arg(ptr).end();
+
+	//build target
+	Driver * target = this->uriHandler.buildDriver(uri);
+
+	//apply
+	return mapping->checkpoint(target);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Apply an access hint on the given range.
+ * @param ptr Address inside the mapping.
+ * @param size Size of the range (0 for the end of the mapping).
+ * @param advice The hint to apply.
+**/
+void GlobalHandler::advise(void * ptr, size_t size, ummap_advice_t advice)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to advise : %1").arg(ptr).end();
+
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
+
+	//apply
+	mapping->advise(offset, size, advice);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Load the segments of the given range in background (see LoadScheduler).
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @param callback Function called once the range is loaded, can be NULL.
+ * @param userData Pointer given to the callback.
+**/
+void GlobalHandler::loadAsync(void * ptr, size_t size, ummap_load_callback_t callback, void * userData)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to load : %1").arg(ptr).end();
+
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
+
+	//queue
+	this->loadScheduler.push(mapping, offset, size, callback, userData);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Load and pin the segments of the given range (see Mapping::pin()).
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @return 0 on success, -1 if the pin budget of a policy is exceeded.
+**/
+int GlobalHandler::pin(void * ptr, size_t size)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to pin : %1").arg(ptr).end();
+
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
+
+	//apply
+	if (mapping->pin(offset, size))
+		return 0;
+	else
+		return -1;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Unpin the segments of the given range (see Mapping::unpin()).
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+**/
+void GlobalHandler::unpin(void * ptr, size_t size)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to unpin : %1").arg(ptr).end();
+
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
+
+	//apply
+	mapping->unpin(offset, size);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Load, map and pin the segments of the given range (see Mapping::acquire()).
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @param mode Access to open, PROT_READ or PROT_READ|PROT_WRITE.
+ * @return 0 on success, -1 if the pin budget of a policy is exceeded.
+**/
+int GlobalHandler::acquire(void * ptr, size_t size, int mode)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to acquire : %1").arg(ptr).end();
+
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
+
+	//apply
+	if (mapping->acquire(offset, size, mode))
+		return 0;
+	else
+		return -1;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release the segments of the given range (see Mapping::release()).
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+**/
+void GlobalHandler::release(void * ptr, size_t size)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to release : %1").arg(ptr).end();
+
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
+
+	//apply
+	mapping->release(offset, size);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Drop the segments of the given range without write back and release the
+ * storage (see Mapping::discard()). Unlike the other range operations the
+ * range is rounded inward so only the segments fully covered are discarded,
+ * the data of the partially covered ones at the ends of the range is kept.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+**/
+void GlobalHandler::discard(void * ptr, size_t size)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to discard : %1").arg(ptr).end();
+
 	//compute
 	size_t offset = (char*)ptr - (char*)mapping->getAddress();
 	size_t segmentSize = mapping->getSegmentSize();
 
-	//printf("flush internal %lu -> %lu -> %lu\n", offset, size, mapping->getAlignedSize());
-
-	//size
+	//0 goes to the end of the mapping as in computeFlushRange(), before rounding
 	if (size == 0)
 		size = mapping->getAlignedSize() - offset;
-	
-	//align
-	if (offset % segmentSize != 0) {
-		size_t delta = offset - offset % segmentSize;
-		offset -= delta;
-		size += delta;
-	}
-	if (size % segmentSize != 0) {
-		size += segmentSize - offset % segmentSize;
+	size_t end = offset + size;
+
+	//check
+	assume(end <= mapping->getAlignedSize(), "Invalid discard size, not fit in ummap mapping !");
+
+	//round inward, the last segment is fully covered if the range reaches the end of the data
+	if (end >= mapping->getSize())
+		end = mapping->getAlignedSize();
+	offset = ((offset + segmentSize - 1) / segmentSize) * segmentSize;
+	end = (end / segmentSize) * segmentSize;
+
+	//apply
+	if (end > offset)
+		mapping->discard(offset, end - offset);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Get the residency of the segments of the given range (see Mapping::getResidency()).
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @param vec Filled with one byte per segment of the range.
+ * @return Number of resident segments in the range.
+**/
+size_t GlobalHandler::residency(void * ptr, size_t size, unsigned char * vec)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to get residency : %1").arg(ptr).end();
+
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
+
+	//apply
+	return mapping->getResidency(offset, size, vec);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Call the handler on each segment of the range, the resident ones first. The
+ * missing ones are prefetched in order by a task of the worker pool meanwhile,
+ * if the handler reach one before it is loaded it simply faults on it. The
+ * prefetcher stays ahead of the handler by at most the memory the policies
+ * can still give so it does not evict the segments waiting to be handled.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @param handler Function to call on each segment.
+ * @param userData Pointer given to the handler.
+**/
+void GlobalHandler::forEachResidentFirst(void * ptr, size_t size, ummap_segment_handler_t handler, void * userData)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to iterate : %1").arg(ptr).end();
+
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
+	const size_t segmentSize = mapping->getSegmentSize();
+
+	//build order
+	std::vector<size_t> order;
+	const size_t resident = mapping->getResidentFirstOrder(offset, size, order);
+
+	//bound the lead of the prefetcher to the free memory of the policies
+	const size_t lead = mapping->getPolicyFreeMemory() / segmentSize;
+
+	//progress of the handler, waited by the prefetcher to stay within the lead
+	std::mutex mutex;
+	std::condition_variable cond;
+	size_t handled = 0;
+
+	//prefetch the missing ones meanwhile
+	std::vector<std::function<void()>> tasks;
+	if (resident < order.size() && lead > 0) {
+		tasks.push_back([mapping, &order, resident, segmentSize, lead, &mutex, &cond, &handled]{
+			size_t i = resident;
+			while (i < order.size()) {
+				//wait to be in the lead, skip the ones already reached by the handler
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cond.wait(lock, [i, lead, &handled]{return i < handled + lead;});
+					if (i < handled)
+						i = handled;
+				}
+
+				//load
+				if (i < order.size())
+					mapping->prefetch(order[i], segmentSize);
+				i++;
+			}
+		});
 	}
 
-	//printf("flush internal %lu -> %lu -> %lu\n", offset, size, mapping->getAlignedSize());
+	//handle all from the calling thread
+	char * base = (char*)mapping->getAddress();
+	tasks.push_back([&order, base, segmentSize, handler, userData, &mutex, &cond, &handled]{
+		for (size_t i = 0 ; i < order.size() ; i++) {
+			handler(base + order[i], segmentSize, userData);
+			std::lock_guard<std::mutex> lockGuard(mutex);
+			handled = i + 1;
+			cond.notify_one();
+		}
+	});
+
+	//run and wait
+	this->workerPool.run(tasks);
+}
 
-	//check
-	assume((char*)ptr + size <= (char*)mapping->getAddress() + mapping->getAlignedSize(),
-		"Invalid flush size, not fit in ummap mapping !");
+/*******************  FUNCTION  *********************/
+/**
+ * Set the fault-around window of the given mapping (see Mapping::setFaultAround()).
+ * @param ptr Address of the mapping or inside the mapping.
+ * @param size Size of the window, 0 to disable.
+**/
+void GlobalHandler::setFaultAround(void * ptr, size_t size)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to set fault-around : %1").arg(ptr).end();
+
+	//apply
+	mapping->setFaultAround(size);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Define the number of threads to be used to flush the large ranges.
+ * @param threads Number of threads, 0 to use the CPU count, 1 to disable
+ * the parallel flush.
+**/
+void GlobalHandler::setFlushThreads(unsigned int threads)
+{
+	this->flushThreads = threads;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of threads to be used to flush the large ranges.
+**/
+unsigned int GlobalHandler::getFlushThreads(void) const
+{
+	if (this->flushThreads == 0)
+		return OS::cpuNumber();
+	else
+		return this->flushThreads;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Start an asynchronous flush operation of the given segment.
+ * @param ptr Define the base address from where to start the flush operation.
+ * @param size Define the size of the region to flush.
+ * @param evict Enable of disable the automatic eviction of the flushed pages.
+ * @param sync Define if we sync to final storage after the flush.
+ * @return The request handle to be completed by FlushRequest::wait().
+**/
+FlushRequest * GlobalHandler::flushAsync(void * ptr, size_t size, bool evict, bool sync)
+{
+	//get mapping
+	Mapping * mapping = this->mappingRegistry.getMapping(ptr);
+
+	//error
+	assumeArg(mapping != NULL, "Fail to find ummap mapping to flush : %1").arg(ptr).end();
+
+	//compute
+	size_t offset = 0;
+	computeFlushRange(mapping, ptr, offset, size);
 
 	//apply
 	int flags = 0;
@@ -392,7 +888,7 @@ void GlobalHandler::flush(void * ptr, size_t size, bool evict, bool sync)
 		flags |= UMMAP_FLUSH_SYNC;
 	if (evict)
 		flags |= UMMAP_FLUSH_UNMAP;
-	mapping->flush(offset, size, flags);
+	return mapping->flushAsync(offset, size, flags, this->workerPool);
 }
 
 /*******************  FUNCTION  *********************/
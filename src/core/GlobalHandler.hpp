@@ -18,6 +18,7 @@
 #include "common/Debug.hpp"
 #include "MappingRegistry.hpp"
 #include "PolicyRegistry.hpp"
+#include "LoadScheduler.hpp"
 #include "../uri/UriHandler.hpp"
 #include "../public-api/ummap.h"
 
@@ -48,8 +49,25 @@ class GlobalHandler
 		GlobalHandler(void);
 		~GlobalHandler(void);
 		void * ummap(void * addr, size_t size, size_t segmentSize, size_t storageOffset, int protection, int flags, Driver * driver, Policy * localPolicy, const std::string & policyGroup);
+		void ummapBatch(ummap_batch_entry_t * entries, size_t count, size_t segmentSize, int protection, int flags, const std::string & policyGroup);
 		int uunmap(void * ptr, bool sync);
+		void * remap(void * ptr, size_t newSize, int flags, void * newAddr);
 		void flush(void * ptr, size_t size, bool evict, bool sync);
+		FlushRequest * flushAsync(void * ptr, size_t size, bool evict, bool sync);
+		void setFlushThreads(unsigned int threads);
+		void syncGroup(const std::string & policyGroup);
+		size_t checkpoint(void * ptr, const std::string & uri);
+		void advise(void * ptr, size_t size, ummap_advice_t advice);
+		void loadAsync(void * ptr, size_t size, ummap_load_callback_t callback, void * userData);
+		void setFaultAround(void * ptr, size_t size);
+		int pin(void * ptr, size_t size);
+		void unpin(void * ptr, size_t size);
+		int acquire(void * ptr, size_t size, int mode);
+		void release(void * ptr, size_t size);
+		void discard(void * ptr, size_t size);
+		size_t residency(void * ptr, size_t size, unsigned char * vec);
+		void forEachResidentFirst(void * ptr, size_t size, ummap_segment_handler_t handler, void * userData);
+		unsigned int getFlushThreads(void) const;
 		void skipFirstRead(void * ptr);
 		void registerPolicy(const std::string & name, Policy * policy);
 		void unregisterPolicy(const std::string & name);
@@ -66,12 +84,29 @@ class GlobalHandler
 		template <class T> int applySwitch(const char * driverName, void * addr, ummap_switch_clean_t cleanAction, std::function<void(T * driver)> action);
 		void initMero(const std::string & ressourceFile, int ressourceIndex);
 	private:
+		/**
+		 * Pool of segment status used by the lightweight mappings. It is declared before
+		 * the registry so it is destroyed after the remaining mappings.
+		**/
+		SegmentStatusPool statusPool;
+		/** Caches of the segments shared by the mappings of a same object (see UMMAP_SHARED_CACHE). **/
+		SegmentCacheRegistry segmentCaches;
+		/**
+		 * Threads used by the parallel flushes (see Mapping::flushParallel()) and the
+		 * asynchronous requests, kept between the calls. It is declared before the
+		 * registry so the remaining mappings can wait their pending requests on destruction.
+		**/
+		WorkerPool workerPool;
+		/** Loads the ranges of ummap_load_async() with the worker pool. **/
+		LoadScheduler loadScheduler;
 		/** Registry of all active mappings in use. **/
 		MappingRegistry mappingRegistry;
 		/** Registry of global policies in use. **/
 		PolicyRegistry policyRegistry;
 		/** URI handler to be used to build drivers and policies from strings. **/
 		UriHandler uriHandler;
+		/** Number of threads to use to flush large ranges (0 to use the CPU count). **/
+		unsigned int flushThreads;
 };
 
 /*******************  FUNCTION  *********************/
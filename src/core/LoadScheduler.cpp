@@ -0,0 +1,98 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cassert>
+//local
+#include "Mapping.hpp"
+#include "LoadScheduler.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the scheduler.
+ * @param pool Pool running the requests, it must outlive the scheduler.
+**/
+LoadScheduler::LoadScheduler(WorkerPool & pool)
+	:pool(pool)
+{
+	this->pending = 0;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the scheduler. It waits the pending requests.
+**/
+LoadScheduler::~LoadScheduler(void)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->cond.wait(lock, [this]{return this->pending == 0;});
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Queue the loading of a range. The mapping counts the request as an
+ * asynchronous one so it cannot be destroyed or remapped before the end
+ * of the loading.
+ * @param mapping Mapping to load.
+ * @param offset Offset of the range in the mapping (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+ * @param callback Function to call once loaded, can be NULL.
+ * @param userData Pointer given to the callback.
+**/
+void LoadScheduler::push(Mapping * mapping, size_t offset, size_t size, ummap_load_callback_t callback, void * userData)
+{
+	//check
+	assert(mapping != NULL);
+
+	//count request to be waited by the mapping destructor and by ours
+	mapping->beginAsyncRequest();
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+		this->pending++;
+	}
+
+	//queue
+	LoadRequest request = {mapping, offset, size, callback, userData};
+	this->pool.post([this, request]{this->load(request);});
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of requests not yet finished.
+**/
+size_t LoadScheduler::getPendingRequests(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	return this->pending;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Load a range in a thread of the pool and call its callback.
+ * @param request The request to handle.
+**/
+void LoadScheduler::load(const LoadRequest & request)
+{
+	//load, it stops at the memory allowed by the policies
+	void * addr = (char*)request.mapping->getAddress() + request.offset;
+	size_t loaded = request.mapping->prefetch(request.offset, request.size);
+
+	//release the mapping before calling back as the callback can unmap it
+	request.mapping->endAsyncRequest();
+
+	//notify
+	if (request.callback != NULL)
+		request.callback(addr, loaded, request.userData);
+
+	//done
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	if (--this->pending == 0)
+		this->cond.notify_all();
+}
@@ -0,0 +1,73 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_LOAD_SCHEDULER_HPP
+#define UMMAP_LOAD_SCHEDULER_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <mutex>
+#include <condition_variable>
+//internal
+#include "../public-api/ummap.h"
+#include "WorkerPool.hpp"
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  CLASS  **********************/
+class Mapping;
+
+/*********************  STRUCT  *********************/
+/**
+ * Describe a range waiting to be loaded by the scheduler.
+**/
+struct LoadRequest
+{
+	/** Mapping to load, it waits the pending requests before being destroyed. **/
+	Mapping * mapping;
+	/** Offset of the range to load (aligned on segment size). **/
+	size_t offset;
+	/** Size of the range to load (aligned on segment size). **/
+	size_t size;
+	/** Function to call once loaded (can be NULL). **/
+	ummap_load_callback_t callback;
+	/** Pointer given to the callback. **/
+	void * userData;
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Load ranges of mappings in background by calling Mapping::prefetch() from
+ * the threads of a worker pool so the caller can overlap the storage reads
+ * with its computation. A callback is called when a range is loaded with the
+ * size actually loaded, it is used to resume the coroutines of the C++ API.
+**/
+class LoadScheduler
+{
+	public:
+		LoadScheduler(WorkerPool & pool);
+		~LoadScheduler(void);
+		void push(Mapping * mapping, size_t offset, size_t size, ummap_load_callback_t callback, void * userData);
+		size_t getPendingRequests(void);
+	private:
+		void load(const LoadRequest & request);
+	private:
+		/** Pool running the requests, shared with the other asynchronous operations. **/
+		WorkerPool & pool;
+		/** Number of requests not yet finished. **/
+		size_t pending;
+		/** Protect the pending counter. **/
+		std::mutex mutex;
+		/** Used by the destructor to wait the pending requests. **/
+		std::condition_variable cond;
+};
+
+}
+
+#endif //UMMAP_LOAD_SCHEDULER_HPP
@@ -9,15 +9,34 @@
 #include <cstring>
 #include <ctime>
 #include <cassert>
+#include <functional>
+#include <vector>
 //internal
 #include "../common/Debug.hpp"
 #include "../portability/OS.hpp"
 //local
 #include "Mapping.hpp"
+#include "FlushRequest.hpp"
 
 /***************** USING NAMESPACE ******************/
 using namespace ummapio;
 
+/*********************  CLASS  **********************/
+/**
+ * Lock a segment of a mapping for the current scope as std::lock_guard.
+**/
+class MappingSegmentGuard
+{
+	public:
+		MappingSegmentGuard(Mapping & mapping, size_t segmentId) : mapping(mapping), segmentId(segmentId) {mapping.lockSegment(segmentId);};
+		~MappingSegmentGuard(void) {mapping.unlockSegment(segmentId);};
+	private:
+		/** Mapping containing the segment. **/
+		Mapping & mapping;
+		/** ID of the locked segment. **/
+		size_t segmentId;
+};
+
 /*******************  FUNCTION  *********************/
 /**
  * Establish a new memory mapping.
@@ -36,8 +55,10 @@ using namespace ummapio;
  * @param driver Pointer to the given driver. It will be destroyed automatically depending on its status about auto clean.
  * @param localPolicy Define the local policy to be used.
  * @param globalPolicy Define the global policy to be used and shared between multiple mappings.
+ * @param statusPool Pool to take the segment status from if the UMMAP_LIGHTWEIGHT flag is set.
+ * @param cacheRegistry Registry to take the segment cache from if the UMMAP_SHARED_CACHE flag is set.
 **/
-Mapping::Mapping(void *addr, size_t size, size_t segmentSize, size_t storageOffset, int protection, int flags, Driver * driver, Policy * localPolicy, Policy * globalPolicy)
+Mapping::Mapping(void *addr, size_t size, size_t segmentSize, size_t storageOffset, int protection, int flags, Driver * driver, Policy * localPolicy, Policy * globalPolicy, SegmentStatusPool * statusPool, SegmentCacheRegistry * cacheRegistry)
 {
 	//checks
 	assume(size > 0, "Do not accept null size mapping");
@@ -59,6 +80,12 @@ Mapping::Mapping(void *addr, size_t size, size_t segmentSize, size_t storageOffs
 	this->size = size;
 	this->storageOffset = storageOffset;
 	this->threadSafe = true;
+	this->asyncRequests = 0;
+	this->checkpointDriver = NULL;
+	this->checkpointEpoch = 0;
+	this->faultAround = 0;
+	this->predictWrite = (flags & UMMAP_PREDICT_WRITE);
+	this->pinnedSegments = 0;
 
 	//pre check
 	this->registerRange();
@@ -76,22 +103,39 @@ Mapping::Mapping(void *addr, size_t size, size_t segmentSize, size_t storageOffs
 		assume(driver->checkThreadSafety(), "Ask for mapping thread safety but the driver does not support it !");
 
 	//if use map fixed
-	bool mapFixed = (flags & UMMAP_FIXED);
+	bool mapFixed = (flags & (UMMAP_FIXED | UMMAP_MAPPING_RESERVED));
 
-	//establish mapping
+	//establish mapping, the range might already be reserved by the caller
 	this->baseAddress = (char*)driver->directMmap(addr, size, storageOffset, protection & PROT_READ, protection & PROT_WRITE, protection & PROT_EXEC, mapFixed);
-	if (this->baseAddress == NULL)
+	this->directMapped = (this->baseAddress != NULL);
+	if (this->baseAddress == NULL && (flags & UMMAP_MAPPING_RESERVED))
+		this->baseAddress = (char*)addr;
+	else if (this->baseAddress == NULL)
 		this->baseAddress = (char*)OS::mmapProtNone(addr, mapSize, mapFixed);
 
 	//sizes
 	this->segments = mapSize / segmentSize;
 	this->segmentSize = segmentSize;
 
-	//establish state tracking
-	this->segmentStatus = new SegmentStatus[this->segments];
-	memset(this->segmentStatus, 0, sizeof(SegmentStatus) * this->segments);
-	for (size_t i = 0 ; i < this->segments ; i++)
-		this->segmentStatus[i].needRead = true;
+	//establish state tracking, allocated on first touch or taken from the pool
+	this->segmentStatus = NULL;
+	this->statusPool = NULL;
+	if ((flags & UMMAP_LIGHTWEIGHT) && statusPool != NULL) {
+		this->segmentStatus = statusPool->acquire(this->segments);
+		if (this->segmentStatus != NULL)
+			this->statusPool = statusPool;
+	}
+	if (this->segmentStatus == NULL)
+		this->segmentStatus = new SegmentStatusTable(this->segments);
+
+	//share the segments with the other mappings of the object
+	this->segmentCache = NULL;
+	this->cacheRegistry = NULL;
+	if ((flags & UMMAP_SHARED_CACHE) && cacheRegistry != NULL && this->directMapped == false) {
+		this->segmentCache = cacheRegistry->acquire(driver, storageOffset, segmentSize);
+		if (this->segmentCache != NULL)
+			this->cacheRegistry = cacheRegistry;
+	}
 
 	//build policy status local storage
 	if (localPolicy != NULL)
@@ -101,19 +145,6 @@ Mapping::Mapping(void *addr, size_t size, size_t segmentSize, size_t storageOffs
 	if (globalPolicy != NULL)
 		globalPolicy->allocateElementStorage(this, this->segments);
 
-	//build mutexes to protect segments
-	//
-	//Rational 1: we use X mutexes so spread the contention. The access code will use
-	//a modulo to select the right mutex based on the segment ID.
-	//
-	//Rational 2: The +1 is used to break possible aligned accesses between two threads
-	//with distance exactly modulo. With an odd number there is less chance to fall in
-	//those multiples
-	this->segmentMutexesCnt = (OS::cpuNumber() * 4) + 1;
-	if (static_cast<size_t>(this->segmentMutexesCnt) > this->segments)
-		this->segmentMutexesCnt = this->segments;
-	this->segmentMutexes = new std::mutex[this->segmentMutexesCnt];
-
 	//no first read
 	if (flags & UMMAP_NO_FIRST_READ)
 		this->skipFirstRead();
@@ -126,12 +157,32 @@ Mapping::Mapping(void *addr, size_t size, size_t segmentSize, size_t storageOffs
 **/
 Mapping::~Mapping(void)
 {
+	//wait pending async flush
+	this->waitAsyncRequests();
+
 	//unregister mapping
 	this->unregisterRange();
 
+	//give back the pinned segments to the policies before releasing them
+	if (this->pinnedSegments.load() > 0)
+		for (size_t id = this->segmentStatus->nextResident(0, this->segments) ; id < this->segments ; id = this->segmentStatus->nextResident(id + 1, this->segments))
+			if (this->segmentStatus->isPinned(id))
+				this->unpinSegment(id);
+
+	//release the shared segments, waiting first for the other mappings still shrinking our policies
+	if (this->segmentCache != NULL) {
+		this->segmentCache->leave(this);
+		for (size_t id = this->segmentStatus->nextResident(0, this->segments) ; id < this->segments ; id = this->segmentStatus->nextResident(id + 1, this->segments))
+			this->releaseCachedRun(id, id + 1);
+		this->shrinkChargedHolders();
+		this->segmentCache->forget(this);
+	}
+
 	//unmap
 	if (driver->directMunmap(this->baseAddress, size, storageOffset) == false)
 		OS::munmap(this->baseAddress, this->getAlignedSize());
+	if (this->segmentCache != NULL)
+		this->cacheRegistry->release(this->segmentCache);
 
 	//policies
 	if (this->localPolicy != NULL)
@@ -143,8 +194,15 @@ Mapping::~Mapping(void)
 	if (this->localPolicy != NULL)
 		delete this->localPolicy;
 
-	//destroy all mutexes
-	delete [] this->segmentMutexes;
+	//destroy status
+	if (this->statusPool != NULL)
+		this->statusPool->release(this->segmentStatus);
+	else
+		delete this->segmentStatus;
+
+	//destroy last checkpoint
+	if (this->checkpointDriver != NULL)
+		delete this->checkpointDriver;
 
 	//destroy driver dup()
 	if (this->driver->hasAutoclean())
@@ -225,6 +283,12 @@ void Mapping::loadAndSwapSegment(size_t offset, bool writeAccess)
 	//if a second thread made first touch while the first one is reading the
 	//data if we just made madvise on the pre-existing PROT_NONE segment.
 
+	//shared with the other mappings of the object
+	if (this->segmentCache != NULL) {
+		this->loadCachedSegment(offset / this->segmentSize, writeAccess);
+		return;
+	}
+
 	//map a page in RW access
 	void * ptr = NULL;
 	if (threadSafe) {
@@ -240,6 +304,7 @@ void Mapping::loadAndSwapSegment(size_t offset, bool writeAccess)
 		.arg(res)
 		.arg(segmentSize)
 		.end();
+	this->counters.inc(STATS_READ_BYTES, res);
 
 	//make read only
 	if (!writeAccess)
@@ -250,6 +315,259 @@ void Mapping::loadAndSwapSegment(size_t offset, bool writeAccess)
 		OS::mremapForced(ptr, segmentSize, this->baseAddress + offset);
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Load a faulting segment with its not yet loaded neighbours of the same
+ * fault-around window by a single driver request. The run is extended forward
+ * then backward as long as the neighbours can be locked without waiting and the
+ * policies have free memory for them, keeping room for the faulting segment.
+ * The neighbours are marked as mapped read only and unlocked, the caller has to
+ * notify them to the policies.
+ * @param segmentId ID of the faulting segment, it must be locked by the caller.
+ * @param writeAccess Open the faulting segment in write mode.
+ * @param first Return the first segment of the loaded run.
+ * @param last Return the last segment of the loaded run.
+**/
+void Mapping::loadAround(size_t segmentId, bool writeAccess, size_t & first, size_t & last)
+{
+	//window aligned on its size
+	size_t windowFirst = segmentId - segmentId % this->faultAround;
+	size_t windowEnd = windowFirst + this->faultAround;
+	if (windowEnd > this->segments)
+		windowEnd = this->segments;
+
+	//number of neighbours the policies can afford
+	size_t budget = this->getPolicyFreeMemory() / this->segmentSize;
+	budget = (budget > 0) ? budget - 1 : 0;
+
+	//extend the run
+	first = segmentId;
+	last = segmentId;
+	while (budget > 0 && last + 1 < windowEnd && this->tryLockAround(last + 1)) {
+		last++;
+		budget--;
+	}
+	while (budget > 0 && first > windowFirst && this->tryLockAround(first - 1)) {
+		first--;
+		budget--;
+	}
+
+	//nothing to add
+	if (first == last) {
+		this->loadAndSwapSegment(segmentId * this->segmentSize, writeAccess);
+		return;
+	}
+
+	//load all with one request, only the faulting segment in write mode
+	if (writeAccess)
+		this->loadSegmentsRun(first, last + 1, segmentId, segmentId + 1);
+	else
+		this->loadSegmentsRun(first, last + 1, 0, 0);
+	this->counters.inc(STATS_FAULT_AROUND, last - first);
+
+	//mark the neighbours
+	for (size_t id = first ; id <= last ; id++) {
+		if (id == segmentId)
+			continue;
+		SegmentStatus & status = this->segmentStatus->get(id);
+		status.mapped = true;
+		status.evicted = false;
+		this->segmentStatus->updateIndex(id);
+		this->segmentStatus->unlock(id);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Load a run of contiguous segments with a single driver request. Like
+ * loadAndSwapSegment() the data are read in a temp buffer moved over the
+ * PROT_NONE segments to be atomic. The caller must hold the segment locks
+ * and update their status.
+ * @param firstId First segment of the run.
+ * @param endId Segment after the last one of the run.
+ * @param writeFirst First segment to open in write mode.
+ * @param writeEnd Segment after the last one to open in write mode (equal to
+ * writeFirst to open all in read only).
+**/
+void Mapping::loadSegmentsRun(size_t firstId, size_t endId, size_t writeFirst, size_t writeEnd)
+{
+	//shared segments are mapped one by one from the cache
+	if (this->segmentCache != NULL) {
+		for (size_t id = firstId ; id < endId ; id++)
+			this->loadCachedSegment(id, id >= writeFirst && id < writeEnd);
+		return;
+	}
+
+	//map the run in RW access
+	const size_t offset = firstId * this->segmentSize;
+	const size_t runSize = (endId - firstId) * this->segmentSize;
+	char * ptr = NULL;
+	if (threadSafe) {
+		ptr = (char*)OS::mmapProtFull(runSize, protection & PROT_EXEC);
+	} else {
+		ptr = this->baseAddress + offset;
+		OS::mprotect(ptr, runSize, true, true, protection & PROT_EXEC);
+	}
+
+	//read all with one request
+	const size_t readSize = runSize - this->segmentSize + readWriteSize((endId - 1) * this->segmentSize);
+	ssize_t res = this->driver->pread(ptr, readSize, this->storageOffset + offset);
+	assumeArg(res >= 0, "Fail to read all data, got %1 instead of %2 !")
+		.arg(res)
+		.arg(readSize)
+		.end();
+	this->counters.inc(STATS_READ_BYTES, res);
+
+	//make read only except the requested write range
+	OS::mprotect(ptr, runSize, true, false, protection & PROT_EXEC);
+	if (writeEnd > writeFirst)
+		OS::mprotect(ptr + (writeFirst - firstId) * this->segmentSize, (writeEnd - writeFirst) * this->segmentSize, true, true, protection & PROT_EXEC);
+
+	//move over the PROT_NONE segments
+	if (threadSafe)
+		OS::mremapForced(ptr, runSize, this->baseAddress + offset);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Map a segment from the cache shared with the other mappings of the object
+ * (see UMMAP_SHARED_CACHE). It is read from the storage only if no other mapping
+ * holds it. The not yet read segments (skipRead) are mapped the same way so the
+ * writes are shared. The caller must hold the segment lock.
+ * @param segmentId ID of the segment.
+ * @param writeAccess Open the segment in write mode.
+**/
+void Mapping::loadCachedSegment(size_t segmentId, bool writeAccess)
+{
+	//vars
+	const size_t offset = segmentId * this->segmentSize;
+	const bool skipRead = this->segmentStatus->peek(segmentId).skipRead;
+	size_t readBytes = 0;
+
+	//map
+	bool hit = this->segmentCache->map(this->baseAddress + offset, this->storageOffset + offset, readWriteSize(offset), skipRead, writeAccess, protection & PROT_EXEC, this->driver, this, readBytes);
+
+	//count
+	this->counters.inc(STATS_READ_BYTES, readBytes);
+	if (hit)
+		this->counters.inc(STATS_CACHE_HITS);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release the given run of shared segments being unmapped so the cache can
+ * free them if no other mapping holds them. Nothing is done if the mapping
+ * does not use the shared cache.
+ * @param firstId First segment of the run.
+ * @param endId Segment after the last one of the run.
+**/
+void Mapping::releaseCachedRun(size_t firstId, size_t endId)
+{
+	//nothing to do
+	if (this->segmentCache == NULL)
+		return;
+
+	//release and remember the mappings whose policies must be shrunk (see shrinkChargedHolders())
+	std::vector<Mapping *> charged;
+	this->segmentCache->release(this->storageOffset + firstId * this->segmentSize, (endId - firstId) * this->segmentSize, this, charged);
+	if (charged.empty() == false) {
+		std::lock_guard<std::mutex> lockGuard(this->chargedMutex);
+		this->chargedHolders.insert(this->chargedHolders.end(), charged.begin(), charged.end());
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Shrink the policies of the mappings which received the charge of the shared
+ * segments we released (see releaseCachedRun()). It must be called out of
+ * the locks of the mapping as the policies can evict any segment, including
+ * ours.
+**/
+void Mapping::shrinkChargedHolders(void)
+{
+	//nothing to do
+	if (this->segmentCache == NULL)
+		return;
+
+	//take the list
+	std::vector<Mapping *> holders;
+	{
+		std::lock_guard<std::mutex> lockGuard(this->chargedMutex);
+		holders.swap(this->chargedHolders);
+	}
+
+	//shrink, the holder waits for us before being destroyed (see SegmentCache::leave())
+	for (auto holder : holders) {
+		if (holder->localPolicy != NULL)
+			holder->localPolicy->shrinkMemory();
+		if (holder->globalPolicy != NULL)
+			holder->globalPolicy->shrinkMemory();
+		this->segmentCache->endCharge(holder);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Check if the given mapped segment is charged to the policies of the mapping.
+ * A segment shared with the other mappings of the object (UMMAP_SHARED_CACHE)
+ * is charged only to the one which loaded it, until it unmaps it.
+ * @param segmentId ID of the segment.
+**/
+bool Mapping::isCharged(size_t segmentId)
+{
+	if (this->segmentCache == NULL)
+		return true;
+	else
+		return this->segmentCache->isCharged(this->storageOffset + segmentId * this->segmentSize, this);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Called by the shared cache (see SegmentCache::release()) when the mapping
+ * charged for a segment unmaps it while this one still maps it, so the charge
+ * is moved to our policies. The cache lock is held so nothing is evicted, the
+ * releasing mapping shrinks our policies afterward (see shrinkChargedHolders()).
+ * @param storageOffset Offset of the segment in the storage.
+**/
+void Mapping::chargeCachedSegment(size_t storageOffset)
+{
+	//check
+	assert(storageOffset >= this->storageOffset);
+	const size_t segmentId = (storageOffset - this->storageOffset) / this->segmentSize;
+	assert(segmentId < this->segments);
+
+	//charge
+	if (this->localPolicy != NULL)
+		this->localPolicy->notifyCharge(this, segmentId);
+	if (this->globalPolicy != NULL)
+		this->globalPolicy->notifyCharge(this, segmentId);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Try to lock a neighbour of a faulting segment for the fault-around. We
+ * already hold the lock of the faulting segment so we do not wait not to
+ * dead lock with a thread holding the neighbour and locking our segment.
+ * @param segmentId ID of the neighbour.
+ * @return True if locked and not yet loaded, false otherwise.
+**/
+bool Mapping::tryLockAround(size_t segmentId)
+{
+	//try
+	if (this->segmentStatus->tryLock(segmentId) == false)
+		return false;
+
+	//already there or no need to read
+	SegmentStatus status = this->segmentStatus->peek(segmentId);
+	if (status.mapped || status.skipRead) {
+		this->segmentStatus->unlock(segmentId);
+		return false;
+	}
+
+	//ok
+	return true;
+}
+
 /*******************  FUNCTION  *********************/
 /**
  * Recive notification of segmentation fault on a an address of the mapping.
@@ -271,33 +589,62 @@ void Mapping::onSegmentationFault(void * address, bool isWrite)
 	size_t offset = this->segmentSize * segmentId;
 	void * segmentBase = this->baseAddress + offset;
 	SegmentStatus oldStatus;
+	size_t aroundFirst = segmentId;
+	size_t aroundLast = segmentId;
 
 	//check
 	if (this->protection == PROT_NONE)
 		UMMAP_FATAL("Try to access a segment which is PROT_NONE");
 	if (isWrite && (this->protection & PROT_WRITE) == 0)
 		UMMAP_FATAL("Try to write access a segment which is not writable");
+
+	//fast path without lock, already handled by another thread
+	oldStatus = this->segmentStatus->load(segmentId);
+	if (oldStatus.mapped && isWrite == oldStatus.dirty)
+		return;
 	
 	//CRITICAL SECTION
 	{
 		//lock to access
-		int mutexId = segmentId % this->segmentMutexesCnt;
-		std::lock_guard<std::mutex> lockGuard(this->segmentMutexes[mutexId]);
+		MappingSegmentGuard lockGuard(*this, segmentId);
 
 		//check status
-		SegmentStatus & status = this->segmentStatus[segmentId];
+		SegmentStatus & status = this->segmentStatus->get(segmentId);
 		oldStatus = status;
 
+		//the segment is waiting an async flush, write it now before opening write access
+		if (isWrite && status.inFlight) {
+			this->writeSegment(offset);
+			status.inFlight = false;
+			status.skipRead = false;
+			this->segmentStatus->updateIndex(segmentId);
+		}
+
 		//already done
 		if (isWrite == status.dirty && status.mapped)
 			return;
 
-		//if not mapped
-		if (!status.mapped && status.needRead){
-			//Load in a temp buffer and swap for atomicity
-			this->loadAndSwapSegment(offset, isWrite);
-			if (isWrite) {
+		//count
+		this->counters.inc(isWrite ? STATS_WRITE_FAULTS : STATS_READ_FAULTS);
+		if (!status.mapped && status.evicted)
+			this->counters.inc(STATS_REFAULTS);
+		status.evicted = false;
+
+		//if not mapped, the shared segments are always taken from the cache
+		if (!status.mapped && (!status.skipRead || this->segmentCache != NULL)){
+			//reload in write mode if it was dirty on eviction to avoid the next write fault
+			bool writeAccess = isWrite;
+			if (this->predictWrite && (this->protection & PROT_WRITE) && this->segmentStatus->hasWriteIntent(segmentId))
+				writeAccess = true;
+
+			//Load in a temp buffer and swap for atomicity, with the neighbours if enabled
+			if (this->faultAround > 1 && status.advice != UMMAP_ADV_RANDOM)
+				this->loadAround(segmentId, writeAccess, aroundFirst, aroundLast);
+			else
+				this->loadAndSwapSegment(offset, writeAccess);
+			if (writeAccess) {
 				status.dirty = true;
+				status.changed = true;
 			}
 		} else if (isWrite) {
 			//this is a write, open write access
@@ -305,6 +652,7 @@ void Mapping::onSegmentationFault(void * address, bool isWrite)
 
 			//mark dirty
 			status.dirty = true;
+			status.changed = true;
 
 			//update dirty time for latter flush operation
 		} else {
@@ -314,13 +662,44 @@ void Mapping::onSegmentationFault(void * address, bool isWrite)
 
 		//mark as mapped
 		status.mapped = true;
+		this->segmentStatus->updateIndex(segmentId);
 	}
 
-	//notify eviction policy
-	if (this->localPolicy != NULL)
-		this->localPolicy->notifyTouch(this, segmentId, isWrite, oldStatus.mapped, oldStatus.dirty);
-	if (this->globalPolicy != NULL)
-		this->globalPolicy->notifyTouch(this, segmentId, isWrite, oldStatus.mapped, oldStatus.dirty);
+	//notify eviction policy, unless the segment is charged to another mapping sharing it
+	const bool charged = this->isCharged(segmentId);
+	if (charged && this->localPolicy != NULL)
+		this->localPolicy->notifyTouch(this, segmentId, isWrite, oldStatus.mapped, oldStatus.dirty, false);
+	if (charged && this->globalPolicy != NULL)
+		this->globalPolicy->notifyTouch(this, segmentId, isWrite, oldStatus.mapped, oldStatus.dirty, false);
+
+	//track the reuse distance of the loads for the miss-ratio curves
+	if (!oldStatus.mapped) {
+		if (this->localPolicy != NULL)
+			this->localPolicy->notifyMiss(this, segmentId);
+		if (this->globalPolicy != NULL)
+			this->globalPolicy->notifyMiss(this, segmentId);
+	}
+
+	//notify the neighbours loaded by the fault-around, they go on the eviction side
+	for (size_t id = aroundFirst ; id <= aroundLast ; id++) {
+		if (id == segmentId || this->isCharged(id) == false)
+			continue;
+		if (this->localPolicy != NULL)
+			this->localPolicy->notifyTouch(this, id, false, false, false, true);
+		if (this->globalPolicy != NULL)
+			this->globalPolicy->notifyTouch(this, id, false, false, false, true);
+	}
+
+	//read ahead the next segments on sequential access, keep room for the
+	//current one so it is not evicted by the policy
+	if (oldStatus.advice == UMMAP_ADV_SEQUENTIAL && !oldStatus.mapped) {
+		size_t readAhead = UMMAP_ADVISE_READ_AHEAD * segmentSize;
+		size_t maxMemory = this->getPolicyMaxMemory();
+		maxMemory = (maxMemory > segmentSize) ? maxMemory - segmentSize : 0;
+		if (readAhead > maxMemory)
+			readAhead = maxMemory - maxMemory % segmentSize;
+		this->prefetch(offset + segmentSize, readAhead);
+	}
 }
 
 /*******************  FUNCTION  *********************/
@@ -337,18 +716,8 @@ SegmentStatus Mapping::getSegmentStatus(size_t offset)
 	//compute
 	size_t segmentId = offset / this->segmentSize;
 
-	//CRITICAL SECTION
-	{
-		//lock to access
-		int mutexId = segmentId % this->segmentMutexesCnt;
-		std::lock_guard<std::mutex> lockGuard(this->segmentMutexes[mutexId]);
-
-		//check status
-		SegmentStatus & status = this->segmentStatus[segmentId];
-
-		//ok
-		return status;
-	}
+	//read atomically, do not allocate if never touched
+	return this->segmentStatus->load(segmentId);
 }
 
 /*******************  FUNCTION  *********************/
@@ -369,43 +738,6 @@ size_t Mapping::getAlignedSize(void) const
 	return this->segmentSize * this->segments;
 }
 
-/*******************  FUNCTION  *********************/
-/**
- * Return the list of mutex to be taken to cover the given memory range.
- * @param offset to start with.
- * @param size Range to consider.
- * @param buffer A potential static buffer to be used to avoid allocation.
- * @param bufferSize Size of the static buffer to check if enough.
-**/
-const bool * Mapping::getMutexRange(size_t offset, size_t size, bool * buffer, size_t bufferSize) const
-{
-	//check
-	assert(offset < this->getSize());
-	assert(offset % this->segmentSize == 0);
-	assert(offset + size <= this->getAlignedSize());
-	assert(size % this->segmentSize == 0);
-
-	//allocate
-	bool * list = buffer;
-	if (list == NULL || bufferSize < static_cast<size_t>(this->segmentMutexesCnt))
-		list = new bool[this->segmentMutexesCnt];
-
-	//init
-	for (int i = 0 ; i < this->segmentMutexesCnt ; i++)
-		list[i] = false;
-
-	//range
-	size_t baseId = offset / this->segmentSize;
-	size_t cnt = size / this->segmentSize;
-
-	//loop
-	for (size_t id = baseId ; id < baseId + cnt ; id++)
-		list[id % this->segmentMutexesCnt] = true;
-
-	//final
-	return list;
-}
-
 /*******************  FUNCTION  *********************/
 /**
  * Apply a sync operation on the wall segment.
@@ -434,6 +766,73 @@ size_t Mapping::readWriteSize(size_t offset)
 		return size - offset;
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Lock all the segments (see lockRange()).
+**/
+void Mapping::lockAllSegments(void)
+{
+	this->lockRange(0, this->segments);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Unlock all the segments.
+**/
+void Mapping::unlockAllSegments(void)
+{
+	this->unlockRange();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Lock a range of segments for an operation on the range. The range lock is
+ * taken in exclusive mode to serialize the range operations and exclude the
+ * evictions, then the accesses to the segments of the range are excluded
+ * without taking their lock bits one by one (see SegmentStatusTable::lockRange()).
+ * The accesses to the other segments keep running.
+ * @param firstId First segment of the range.
+ * @param endId Segment after the last one.
+**/
+void Mapping::lockRange(size_t firstId, size_t endId)
+{
+	this->rangeLock.lock();
+	this->segmentStatus->lockRange(firstId, endId);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Unlock the range locked by lockRange().
+**/
+void Mapping::unlockRange(void)
+{
+	this->segmentStatus->unlockRange();
+	this->rangeLock.unlock();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Lock the given segment by taking its lock bit. It waits if the segment is
+ * in a range locked by a range operation (see lockRange()). It must not be
+ * called while holding another segment lock, use tryLock() or lockSegments()
+ * of the status table for this.
+ * @param segmentId ID of the segment to lock.
+**/
+void Mapping::lockSegment(size_t segmentId)
+{
+	this->segmentStatus->lock(segmentId);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Unlock the given segment.
+ * @param segmentId ID of the segment to unlock.
+**/
+void Mapping::unlockSegment(size_t segmentId)
+{
+	this->segmentStatus->unlock(segmentId);
+}
+
 /*******************  FUNCTION  *********************/
 /**
  * Drop the clean pages from the memory.
@@ -443,34 +842,57 @@ void Mapping::dropClean(void)
 	//CRITICAL SECTION
 	{
 		//lock the whole segment
-		for (int i = 0 ; i < this->segmentMutexesCnt ; i++)
-			this->segmentMutexes[i].lock();
+		this->lockAllSegments();
+
+		//loop on the runs of resident clean segments
+		size_t id = this->segmentStatus->nextResident(0, this->segments);
+		while (id < this->segments) {
+			//skip dirty
+			const SegmentStatus & status = this->segmentStatus->get(id);
+			if (status.dirty || status.inFlight) {
+				id = this->segmentStatus->nextResident(id + 1, this->segments);
+				continue;
+			}
 
-		//loop on all
-		for (size_t i = 0 ; i < this->segments ; i++) {
-			//get segment
-			SegmentStatus & status = this->segmentStatus[i];
+			//search end of run
+			size_t end = id + 1;
+			while (end < this->segments) {
+				const SegmentStatus * next = this->segmentStatus->find(end);
+				if (next == NULL || next->mapped == false || next->dirty || next->inFlight)
+					break;
+				end++;
+			}
 
-			//check if drop
-			if (status.mapped && status.dirty == false) {
-				//calc addr
-				void * addr = this->baseAddress + this->segmentSize * i;
+			//calc addr
+			void * addr = this->baseAddress + this->segmentSize * id;
+			size_t runSize = (end - id) * this->segmentSize;
 
-				//protect
-				OS::mprotect(addr, segmentSize, false, false, protection & PROT_EXEC);
+			//protect
+			OS::mprotect(addr, runSize, false, false, protection & PROT_EXEC);
 
-				//unamp
-				OS::madviseDontNeed(addr, segmentSize);
+			//unamp
+			OS::madviseDontNeed(addr, runSize);
+			this->releaseCachedRun(id, end);
 
-				//mark unmapped
-				status.mapped = false;
+			//mark unmapped
+			for (size_t i = id ; i < end ; i++) {
+				SegmentStatus & cur = this->segmentStatus->get(i);
+				cur.mapped = false;
+				cur.evicted = true;
+				this->segmentStatus->updateIndex(i);
 			}
+			this->counters.inc(STATS_CLEAN_EVICTIONS, end - id);
+
+			//move
+			id = this->segmentStatus->nextResident(end, this->segments);
 		}
 
 		//unlock the whole segment
-		for (int i = 0 ; i < this->segmentMutexesCnt ; i++)
-			this->segmentMutexes[i].unlock();
+		this->unlockAllSegments();
 	}
+
+	//the mappings sharing the segments are now charged for them
+	this->shrinkChargedHolders();
 }
 
 /*******************  FUNCTION  *********************/
@@ -482,33 +904,103 @@ void Mapping::markCleanAsDirty(void)
 	//CRITICAL SECTION
 	{
 		//lock the whole segment
-		for (int i = 0 ; i < this->segmentMutexesCnt ; i++)
-			this->segmentMutexes[i].lock();
-
-		//loop on all
-		for (size_t i = 0 ; i < this->segments ; i++) {
-			//get segment
-			SegmentStatus & status = this->segmentStatus[i];
+		this->lockAllSegments();
+
+		//loop on the runs of resident clean segments
+		size_t id = this->segmentStatus->nextResident(0, this->segments);
+		while (id < this->segments && (protection & PROT_WRITE)) {
+			//skip dirty
+			if (this->segmentStatus->get(id).dirty) {
+				id = this->segmentStatus->nextResident(id + 1, this->segments);
+				continue;
+			}
 
-			//check if drop
-			if (status.mapped && status.dirty == false && (protection & PROT_WRITE)) {
-				//calc addr
-				void * addr = this->baseAddress + this->segmentSize * i;
+			//search end of run
+			size_t end = id + 1;
+			while (end < this->segments) {
+				const SegmentStatus * next = this->segmentStatus->find(end);
+				if (next == NULL || next->mapped == false || next->dirty)
+					break;
+				end++;
+			}
 
-				//protect
-				OS::mprotect(addr, segmentSize, true, true, protection & PROT_EXEC);
+			//protect
+			void * addr = this->baseAddress + this->segmentSize * id;
+			OS::mprotect(addr, (end - id) * this->segmentSize, true, true, protection & PROT_EXEC);
 
-				//mark unmapped
-				status.dirty = true;
+			//mark dirty
+			for (size_t i = id ; i < end ; i++) {
+				SegmentStatus & cur = this->segmentStatus->get(i);
+				cur.dirty = true;
+				cur.changed = true;
+				cur.inFlight = false;
+				this->segmentStatus->updateIndex(i);
 			}
+
+			//move
+			id = this->segmentStatus->nextResident(end, this->segments);
 		}
 
 		//unlock the whole segment
-		for (int i = 0 ; i < this->segmentMutexesCnt ; i++)
-			this->segmentMutexes[i].unlock();
+		this->unlockAllSegments();
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Collect the dirty segments so they can be written by an external scheduler
+ * and write protect them. The caller must hold all the segment locks
+ * (see lockAllSegments()) until the segments are marked flushed.
+ * @param segments List to fill.
+**/
+void Mapping::collectDirtySegments(std::vector<MappingDirtySegment> & segments)
+{
+	//count
+	this->counters.inc(STATS_FLUSHES);
+
+	for (size_t i = this->segmentStatus->nextDirty(0, this->segments) ; i < this->segments ; i = this->segmentStatus->nextDirty(i + 1, this->segments)) {
+		//get segment
+		SegmentStatus & status = this->segmentStatus->get(i);
+
+		//check if need flush
+		if ((status.dirty || status.inFlight) && status.mapped) {
+			//calc
+			size_t offset = this->segmentSize * i;
+
+			//protect
+			if (threadSafe)
+				OS::mprotect(this->baseAddress + offset, segmentSize, true, false, protection & PROT_EXEC);
+
+			//push
+			MappingDirtySegment entry = {this, offset, this->storageOffset + offset, readWriteSize(offset)};
+			segments.push_back(entry);
+		}
 	}
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Mark the given segment as flushed after being written by an external scheduler.
+ * The caller must hold all the segment locks.
+ * @param offset Offset of the segment in the mapping.
+**/
+void Mapping::markSegmentFlushed(size_t offset)
+{
+	//get
+	SegmentStatus & status = this->segmentStatus->get(offset / this->segmentSize);
+
+	//update status
+	status.dirty = false;
+	status.inFlight = false;
+	status.skipRead = false;
+	this->segmentStatus->updateIndex(offset / this->segmentSize);
+	this->counters.inc(STATS_WRITTEN_BYTES, readWriteSize(offset));
+
+	//same than flush()
+	if (!threadSafe)
+		OS::mprotect(this->baseAddress + offset, segmentSize, true, false, protection & PROT_EXEC);
+}
+
 /*******************  FUNCTION  *********************/
 /**
  * Apply a sync operation.
@@ -538,122 +1030,1316 @@ void Mapping::flush(size_t offset, size_t size, int flags)
 	if (flags & UMMAP_FLUSH_UNMAP) unmap = true;
 	if (flags & UMMAP_FLUSH_NO_LOCK) lock = false;
 
+	//count, the not locked ones are evictions
+	if (lock)
+		this->counters.inc(STATS_FLUSHES);
+
 	//direct sync
 	bool res = driver->directMSync((char*)getAddress() + offset, size, storageOffset);
 	if (res)
 		return;
 
-	//what to lock
-	const int stackToLockSize = 2048;
-	bool stackToLock[stackToLockSize];
-	const bool * toLock = getMutexRange(offset, size, stackToLock, stackToLockSize);
-
 	//CRITICAL SECTION
 	{
-		//lock the whole segment
-		//@TODO Can search to lock only related pages
+		//lock the whole range
 		if (lock)
-			for (int i = 0 ; i < this->segmentMutexesCnt ; i++)
-				if (toLock[i])
-					this->segmentMutexes[i].lock();
-
-		//loop on all
-		//@TODO: bulk operation
-		for (size_t curOffset = offset ; curOffset < offset + size ; curOffset += this->segmentSize) {
-			size_t id = curOffset / this->segmentSize;
-			//check status
-			SegmentStatus & status = this->segmentStatus[id];
-			if (status.dirty && status.mapped) {
-				//compute
-				void * segmentPtr = this->baseAddress + curOffset;
+			this->lockRange(offset / this->segmentSize, (offset + size) / this->segmentSize);
 
-				//mprotect the whole considered segment
-				//BUG: on centos/redhat7, this mprotect leads to a kernel live lock
-				//     when used with IOC driver. Cannot IB register a segment which
-				//     is read only. It make the process un-killable.
-				//     The problem seems fixed in centos/redhat 8.
-				if (threadSafe)
-					OS::mprotect(this->baseAddress + curOffset, segmentSize, true, !threadSafe/*TODO*/, protection & PROT_EXEC);
+		//write and unmap by runs of segments
+		this->flushSegmentsRange(offset / this->segmentSize, (offset + size) / this->segmentSize, unmap, false);
+
+		//sync
+		if (sync)
+			driver->sync(getAddress(), offset, size);
 
-				//apply
-				ssize_t res = this->driver->pwrite(segmentPtr, readWriteSize(curOffset), this->storageOffset + curOffset);
+		//unlock
+		if (lock)
+			this->unlockRange();
+	}
 
-				//errors
-				assumeArg(res != -1, "Fail to pwrite : %1").argStrErrno().end();
-				assumeArg(res >= 0, "Fail to fully write the segment, got : %1").arg(res).end();
+	//the mappings sharing the segments are now charged for them, done by the caller if not locked
+	if (lock)
+		this->shrinkChargedHolders();
+}
 
-				//update status
-				status.dirty = false;
-				status.needRead = true;
-			}
+/*******************  FUNCTION  *********************/
+/**
+ * Flush the given range by splitting the dirty segments over several threads.
+ * The range lock is taken in exclusive mode by the caller thread for the
+ * whole operation as for flush() and each worker write its dirty segments 
+ * by coalescing the neighbours in large write operations.
+ * It fallback to flush() if the mapping is not thread safe or if the number of
+ * dirty segments is too small.
+ * @param offset Flush from the given offset.
+ * @param size Define the range of the memory to flush.
+ * @param flags Define flags. You can look on :
+ *  - UMMAP_FLUSH_DEFAULT
+ *  - UMMAP_FLUSH_SYNC
+ *  - UMMAP_FLUSH_UNMAP
+ * @param threads Number of threads to use, including the calling one.
+ * @param pool Pool running the workers so the threads are not created on each call.
+**/
+void Mapping::flushParallel(size_t offset, size_t size, int flags, unsigned int threads, WorkerPool & pool)
+{
+	//check
+	assumeArg(offset < this->getSize(), "Offset (%1) is not in valid range !").arg(offset).end();
+	assumeArg(offset + size <= this->getAlignedSize(), "'Offset (%1) + size' is not in valid range !").arg(offset).end();
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+
+	//fallback on sequential mode
+	if (threads <= 1 || this->threadSafe == false || (flags & UMMAP_FLUSH_NO_LOCK) || size / segmentSize < UMMAP_FLUSH_PARALLEL_MIN_SEGMENTS) {
+		this->flush(offset, size, flags);
+		return;
+	}
 
-			if (status.mapped) {
-				//if unmap
-				if (unmap) {
-					//protect
-					OS::mprotect(this->baseAddress + curOffset, segmentSize, false, false, protection & PROT_EXEC);
+	//count
+	this->counters.inc(STATS_FLUSHES);
 
-					//unamp
-					OS::madviseDontNeed(this->baseAddress + curOffset, segmentSize);
+	//direct sync
+	bool res = driver->directMSync((char*)getAddress() + offset, size, storageOffset);
+	if (res)
+		return;
 
-					//mark unmapped
-					status.mapped = false;
-				} else if (!threadSafe) {
-					OS::mprotect(this->baseAddress + curOffset, segmentSize, true, false/*TODO*/, protection & PROT_EXEC);
+	//CRITICAL SECTION
+	{
+		//range
+		size_t firstId = offset / segmentSize;
+		size_t lastId = (offset + size) / segmentSize;
+
+		//lock
+		this->lockRange(firstId, lastId);
+		bool unmap = (flags & UMMAP_FLUSH_UNMAP);
+
+		//count dirty
+		size_t dirty = 0;
+		for (size_t id = this->segmentStatus->nextDirty(firstId, lastId) ; id < lastId ; id = this->segmentStatus->nextDirty(id + 1, lastId))
+			dirty++;
+
+		//split to get the same amount of dirty segments on each worker
+		std::vector<std::function<void()>> tasks;
+		if (dirty >= UMMAP_FLUSH_PARALLEL_MIN_SEGMENTS) {
+			size_t perWorker = (dirty + threads - 1) / threads;
+			size_t cnt = 0;
+			for (size_t id = this->segmentStatus->nextDirty(firstId, lastId) ; id < lastId && tasks.size() < threads - 1 ; id = this->segmentStatus->nextDirty(id + 1, lastId)) {
+				cnt++;
+				if (cnt == perWorker) {
+					size_t start = firstId;
+					firstId = id + 1;
+					tasks.push_back([this, start, id, unmap]{
+						this->flushSegmentsRange(start, id + 1, unmap, true);
+					});
+					cnt = 0;
 				}
 			}
 		}
 
+		//last part is handled by the current thread
+		size_t start = firstId;
+		tasks.push_back([this, start, lastId, unmap]{
+			this->flushSegmentsRange(start, lastId, unmap, true);
+		});
+
+		//run and wait workers
+		pool.run(tasks);
+
 		//sync
-		if (sync)
+		if (flags & UMMAP_FLUSH_SYNC)
 			driver->sync(getAddress(), offset, size);
 
 		//unlock
-		if (lock)
-			for (int i = 0 ; i < this->segmentMutexesCnt ; i++)
-				if (toLock[i])
-					this->segmentMutexes[i].unlock();
-		
-		if (toLock != stackToLock)
-			delete toLock;
+		this->unlockRange();
 	}
+
+	//the mappings sharing the segments are now charged for them
+	this->shrinkChargedHolders();
 }
 
 /*******************  FUNCTION  *********************/
 /**
- * Use to prefeatch the given range. But not implemented yet.
+ * Write the dirty segments of the given range by runs of neighbour segments
+ * so the protection changes and the unmap are applied with one system call
+ * per run. The caller must hold the locks.
+ * @param firstId ID of the first segment to flush.
+ * @param lastId ID of the segment after the last one to flush.
+ * @param unmap Unmap the segments after flushing them.
+ * @param coalesceWrites Write each run in a single write operation instead
+ * of one per segment.
 **/
-void Mapping::prefetch(size_t offset, size_t size)
+void Mapping::flushSegmentsRange(size_t firstId, size_t lastId, bool unmap, bool coalesceWrites)
 {
+	//max run
+	size_t maxRun = UMMAP_FLUSH_MAX_RUN_SIZE / segmentSize;
+	if (maxRun == 0)
+		maxRun = 1;
+
+	//remember the segments evicted dirty (see UMMAP_PREDICT_WRITE)
+	if (unmap && this->predictWrite) {
+		for (size_t id = this->segmentStatus->nextResident(firstId, lastId) ; id < lastId ; id = this->segmentStatus->nextResident(id + 1, lastId)) {
+			SegmentStatus cur = this->segmentStatus->peek(id);
+			this->segmentStatus->setWriteIntent(id, cur.dirty || cur.inFlight);
+		}
+	}
 
-}
+	//pinned segments are written but stay mapped (see pin())
+	const bool keepPinned = unmap && this->pinnedSegments.load() > 0;
+	size_t writtenPinned = 0;
+
+	//loop on runs of dirty segments
+	size_t id = this->segmentStatus->nextDirty(firstId, lastId);
+	size_t written = 0;
+	while (id < lastId) {
+		//search end of run
+		size_t end = id + 1;
+		while (end < lastId && end - id < maxRun) {
+			const SegmentStatus * next = this->segmentStatus->find(end);
+			if (next == NULL || (next->dirty || next->inFlight) == false || next->mapped == false)
+				break;
+			end++;
+		}
 
-/*******************  FUNCTION  *********************/
-/**
- * When evicting a segment we need to notify the local
- * and global policies.
- * @param sourcePolicy Define the policy which has initiated the eviction
- * operation of NULL if none. This is used to not self notify itself.
+		//compute
+		size_t offset = id * segmentSize;
+		size_t runSize = (end - id) * segmentSize;
+		size_t writeSize = runSize - segmentSize + readWriteSize((end - 1) * segmentSize);
+
+		//protect the whole run to capture the next writes
+		//BUG: on centos/redhat7, this mprotect leads to a kernel live lock
+		//     when used with IOC driver. Cannot IB register a segment which
+		//     is read only. It make the process un-killable.
+		//     The problem seems fixed in centos/redhat 8.
+		if (threadSafe)
+			OS::mprotect(this->baseAddress + offset, runSize, true, false, protection & PROT_EXEC);
+
+		//write
+		if (coalesceWrites) {
+			size_t done = 0;
+			while (done < writeSize) {
+				ssize_t res = this->driver->pwrite(this->baseAddress + offset + done, writeSize - done, this->storageOffset + offset + done);
+				assumeArg(res != -1, "Fail to pwrite : %1").argStrErrno().end();
+				assumeArg(res > 0, "Fail to fully write the segment, got : %1").arg(res).end();
+				done += res;
+			}
+			this->counters.inc(STATS_WRITTEN_BYTES, writeSize);
+		} else {
+			for (size_t i = id ; i < end ; i++)
+				this->writeSegment(i * segmentSize);
+		}
+		written += end - id;
+
+		//without thread safety we protect only after writing
+		if (!threadSafe && !unmap)
+			OS::mprotect(this->baseAddress + offset, runSize, true, false, protection & PROT_EXEC);
+
+		//update status
+		for (size_t i = id ; i < end ; i++) {
+			SegmentStatus & cur = this->segmentStatus->get(i);
+			cur.dirty = false;
+			cur.inFlight = false;
+			cur.skipRead = false;
+			this->segmentStatus->updateIndex(i);
+			if (keepPinned && this->segmentStatus->isPinned(i)) {
+				if (!threadSafe)
+					OS::mprotect(this->baseAddress + i * segmentSize, segmentSize, true, false, protection & PROT_EXEC);
+				writtenPinned++;
+			}
+		}
+
+		//move
+		id = this->segmentStatus->nextDirty(end, lastId);
+	}
+
+	//unmap
+	if (unmap) {
+		size_t unmapped = 0;
+		id = this->segmentStatus->nextResident(firstId, lastId);
+		while (id < lastId) {
+			//skip pinned
+			if (keepPinned && this->segmentStatus->isPinned(id)) {
+				id = this->segmentStatus->nextResident(id + 1, lastId);
+				continue;
+			}
+
+			//search end of run
+			size_t end = id + 1;
+			while (end < lastId) {
+				const SegmentStatus * next = this->segmentStatus->find(end);
+				if (next == NULL || next->mapped == false || (keepPinned && this->segmentStatus->isPinned(end)))
+					break;
+				end++;
+			}
+
+			//unmap the whole run
+			void * addr = this->baseAddress + id * segmentSize;
+			OS::mprotect(addr, (end - id) * segmentSize, false, false, protection & PROT_EXEC);
+			OS::madviseDontNeed(addr, (end - id) * segmentSize);
+			this->releaseCachedRun(id, end);
+			for (size_t i = id ; i < end ; i++) {
+				SegmentStatus & cur = this->segmentStatus->get(i);
+				cur.mapped = false;
+				cur.evicted = true;
+				this->segmentStatus->updateIndex(i);
+			}
+			unmapped += end - id;
+
+			//move
+			id = this->segmentStatus->nextResident(end, lastId);
+		}
+
+		//count, all the written segments have been unmapped except the pinned ones
+		this->counters.inc(STATS_DIRTY_EVICTIONS, written - writtenPinned);
+		this->counters.inc(STATS_CLEAN_EVICTIONS, unmapped - written + writtenPinned);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Write the content of the given segment to the storage. The caller
+ * must hold the segment lock.
+ * @param offset Offset of the segment to write.
+**/
+void Mapping::writeSegment(size_t offset)
+{
+	//compute
+	void * segmentPtr = this->baseAddress + offset;
+
+	//apply
+	ssize_t res = this->driver->pwrite(segmentPtr, readWriteSize(offset), this->storageOffset + offset);
+
+	//errors
+	assumeArg(res != -1, "Fail to pwrite : %1").argStrErrno().end();
+	assumeArg(res >= 0, "Fail to fully write the segment, got : %1").arg(res).end();
+	this->counters.inc(STATS_WRITTEN_BYTES, res);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Start an asynchronous flush operation. The dirty segments of the range
+ * are write protected and marked in-flight then a task of the worker pool
+ * write them to the storage. A write access on an in-flight segment will write it
+ * immediately before opening the access so the rest of the mapping can be
+ * used while the flush is running.
+ * @param offset Flush from the given offset.
+ * @param size Define the range of the memory to flush.
+ * @param flags Define flags. You can look on :
+ *  - UMMAP_FLUSH_DEFAULT
+ *  - UMMAP_FLUSH_SYNC
+ *  - UMMAP_FLUSH_UNMAP
+ * @param pool Pool running the write operations.
+ * @return Return the request handle to be completed with FlushRequest::wait()
+ * and deleted by the caller.
+**/
+FlushRequest * Mapping::flushAsync(size_t offset, size_t size, int flags, WorkerPool & pool)
+{
+	//check
+	assumeArg(offset < this->getSize(), "Offset (%1) is not in valid range !").arg(offset).end();
+	assumeArg(offset + size <= this->getAlignedSize(), "'Offset (%1) + size' is not in valid range !").arg(offset).end();
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+	assume((flags & UMMAP_FLUSH_NO_LOCK) == 0, "Cannot make async flush without locking !");
+
+	//count
+	this->counters.inc(STATS_FLUSHES);
+
+	//CRITICAL SECTION
+	{
+		//lock
+		const size_t firstId = offset / this->segmentSize;
+		const size_t lastId = (offset + size) / this->segmentSize;
+		this->lockRange(firstId, lastId);
+
+		//mark the dirty segments as in-flight
+		for (size_t id = this->segmentStatus->nextDirty(firstId, lastId) ; id < lastId ; id = this->segmentStatus->nextDirty(id + 1, lastId)) {
+			size_t curOffset = id * this->segmentSize;
+			SegmentStatus & status = this->segmentStatus->get(id);
+			if (status.dirty && status.mapped) {
+				//make read only so we capture the next write accesses
+				OS::mprotect(this->baseAddress + curOffset, segmentSize, true, false, protection & PROT_EXEC);
+
+				//update status
+				status.dirty = false;
+				status.inFlight = true;
+			}
+		}
+
+		//unlock
+		this->unlockRange();
+	}
+
+	//count request to be waited by the destructor
+	this->beginAsyncRequest();
+
+	//start
+	return new FlushRequest(this, offset, size, flags, pool);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Write the in-flight segments of the given range. This is called by the
+ * task of an asynchronous flush request. It locks the segments by runs of
+ * neighbours to write each run with one operation via flushSegmentsRange().
+ * The run is extended only with the segments which can be locked without
+ * waiting so the segments used by a fault handler are not delayed, the other
+ * segments of the mapping are still accessible.
+ * @param offset Flush from the given offset.
+ * @param size Define the range of the memory to flush.
+ * @param flags Define flags. You can look on :
+ *  - UMMAP_FLUSH_DEFAULT
+ *  - UMMAP_FLUSH_SYNC
+ *  - UMMAP_FLUSH_UNMAP
+**/
+void Mapping::flushInFlight(size_t offset, size_t size, int flags)
+{
+	//direct sync
+	bool res = driver->directMSync((char*)getAddress() + offset, size, storageOffset);
+	if (res)
+		return;
+
+	//max run
+	size_t maxRun = UMMAP_FLUSH_MAX_RUN_SIZE / this->segmentSize;
+	if (maxRun == 0)
+		maxRun = 1;
+
+	//loop on the in-flight ones, or on all the resident ones if we need to unmap them
+	const size_t firstId = offset / this->segmentSize;
+	const size_t lastId = (offset + size) / this->segmentSize;
+	const bool unmap = (flags & UMMAP_FLUSH_UNMAP);
+	size_t id = unmap ? this->segmentStatus->nextResident(firstId, lastId) : this->segmentStatus->nextDirty(firstId, lastId);
+	while (id < lastId) {
+		//lock the first one, skip it if already written by a fault handler
+		this->segmentStatus->lock(id);
+		if (unmap == false && this->segmentStatus->peek(id).inFlight == false) {
+			this->segmentStatus->unlock(id);
+			id = this->segmentStatus->nextDirty(id + 1, lastId);
+			continue;
+		}
+
+		//extend with the free neighbours to handle, the dirty ones are written on the next flush
+		size_t end = id + 1;
+		while (end < lastId && end - id < maxRun && this->segmentStatus->tryLock(end)) {
+			SegmentStatus status = this->segmentStatus->peek(end);
+			if (status.mapped == false || (unmap == false && status.inFlight == false)) {
+				this->segmentStatus->unlock(end);
+				break;
+			}
+			end++;
+		}
+
+		//write and unmap the run
+		this->flushSegmentsRange(id, end, unmap, true);
+		this->segmentStatus->unlockSegments(id, end);
+
+		//move
+		id = unmap ? this->segmentStatus->nextResident(end, lastId) : this->segmentStatus->nextDirty(end, lastId);
+	}
+
+	//sync
+	if (flags & UMMAP_FLUSH_SYNC)
+		driver->sync(getAddress(), offset, size);
+
+	//the mappings sharing the segments are now charged for them
+	this->shrinkChargedHolders();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Count a new asynchronous request (flush or load) running on the mapping so
+ * the destructor and remap() wait for it.
+**/
+void Mapping::beginAsyncRequest(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->asyncMutex);
+	this->asyncRequests++;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Notify the end of an asynchronous request.
+**/
+void Mapping::endAsyncRequest(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->asyncMutex);
+	assert(this->asyncRequests > 0);
+	this->asyncRequests--;
+	this->asyncCond.notify_all();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Wait all the pending asynchronous requests to finish.
+**/
+void Mapping::waitAsyncRequests(void)
+{
+	std::unique_lock<std::mutex> lock(this->asyncMutex);
+	this->asyncCond.wait(lock, [this]{return this->asyncRequests == 0;});
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Load in advance the not yet mapped segments of the given range with read
+ * access so the next accesses do not fault. They are loaded by runs of
+ * neighbour segments with one driver request per run like acquire(), the
+ * segments of a batch of UMMAP_LOAD_MAX_RUN_SIZE bytes being locked together.
+ * The segments are notified as read touches to the policies which can evict
+ * some others to make room. The range is truncated to the memory allowed by
+ * the policies not to evict itself.
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+ * @return Size of the range from offset which is now resident, smaller than
+ * size if truncated to the mapping or to the policy memory.
+**/
+size_t Mapping::prefetch(size_t offset, size_t size)
+{
+	//check
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+
+	//cannot load without read access
+	if ((this->protection & PROT_READ) == 0)
+		return 0;
+
+	//truncate to mapping
+	const size_t alignedSize = this->getAlignedSize();
+	if (offset >= alignedSize)
+		return 0;
+	if (offset + size > alignedSize)
+		size = alignedSize - offset;
+
+	//truncate to policy memory
+	size_t maxMemory = this->getPolicyMaxMemory();
+	if (size > maxMemory)
+		size = maxMemory - maxMemory % segmentSize;
+
+	//vars
+	const size_t firstId = offset / this->segmentSize;
+	const size_t endId = (offset + size) / this->segmentSize;
+	size_t maxRun = UMMAP_LOAD_MAX_RUN_SIZE / this->segmentSize;
+	if (maxRun == 0)
+		maxRun = 1;
+	std::vector<size_t> loaded;
+
+	//loop on batches
+	for (size_t batchId = firstId ; batchId < endId ; batchId += maxRun) {
+		const size_t batchEnd = (endId - batchId > maxRun) ? batchId + maxRun : endId;
+
+		//CRITICAL SECTION
+		{
+			//lock the batch
+			this->segmentStatus->lockSegments(batchId, batchEnd);
+
+			//load the runs of not yet mapped segments
+			size_t id = batchId;
+			while (id < batchEnd) {
+				//get
+				SegmentStatus & status = this->segmentStatus->get(id);
+
+				//already there
+				if (status.mapped) {
+					id++;
+					continue;
+				}
+
+				//no need to read
+				size_t end = id + 1;
+				if (status.skipRead && this->segmentCache == NULL) {
+					OS::mprotect(this->baseAddress + id * segmentSize, segmentSize, true, false, protection & PROT_EXEC);
+				} else {
+					//search end of run
+					while (end < batchEnd) {
+						SegmentStatus next = this->segmentStatus->peek(end);
+						if (next.mapped || (next.skipRead && this->segmentCache == NULL))
+							break;
+						end++;
+					}
+
+					//load
+					this->loadSegmentsRun(id, end, 0, 0);
+				}
+
+				//mark
+				for (size_t i = id ; i < end ; i++) {
+					SegmentStatus & cur = this->segmentStatus->get(i);
+					cur.mapped = true;
+					cur.evicted = false;
+					this->segmentStatus->updateIndex(i);
+					loaded.push_back(i);
+				}
+
+				//move
+				id = end;
+			}
+
+			//unlock
+			this->segmentStatus->unlockSegments(batchId, batchEnd);
+		}
+
+		//notify eviction policy, unless charged to another mapping sharing the segment
+		for (auto id : loaded) {
+			if (this->isCharged(id) == false)
+				continue;
+			if (this->localPolicy != NULL)
+				this->localPolicy->notifyTouch(this, id, false, false, false, false);
+			if (this->globalPolicy != NULL)
+				this->globalPolicy->notifyTouch(this, id, false, false, false, false);
+		}
+		loaded.clear();
+	}
+
+	//ok
+	return size;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Apply an access hint on the given range, see ummap_advise().
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+ * @param advice The hint to apply.
+**/
+void Mapping::advise(size_t offset, size_t size, ummap_advice_t advice)
+{
+	//check
+	assumeArg(offset + size <= this->getAlignedSize(), "'Offset (%1) + size' is not in valid range !").arg(offset).end();
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+
+	//apply
+	switch (advice) {
+		case UMMAP_ADV_NORMAL:
+		case UMMAP_ADV_SEQUENTIAL:
+		case UMMAP_ADV_RANDOM:
+		case UMMAP_ADV_NOREUSE:
+			//keep track on segments, the never touched chunks only remember the hint
+			if (size > 0) {
+				this->lockRange(offset / this->segmentSize, (offset + size) / this->segmentSize);
+				this->segmentStatus->adviseRange(offset / this->segmentSize, (offset + size) / this->segmentSize, advice);
+				this->unlockRange();
+			}
+			break;
+		case UMMAP_ADV_WILLNEED:
+			this->prefetch(offset, size);
+			break;
+		case UMMAP_ADV_DONTNEED:
+			this->dropRange(offset, size);
+			break;
+		default:
+			UMMAP_FATAL_ARG("Invalid advice given to ummap_advise() : %1").arg(advice).end();
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Write back the dirty segments of the given range and evict all the mapped
+ * ones. It notifies the policies as done by evict() then unmap all the
+ * segments with one flush operation so the neighbour ones are unmapped
+ * together.
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+**/
+void Mapping::dropRange(size_t offset, size_t size)
+{
+	//nothing to do
+	if (size == 0)
+		return;
+
+	//CRITICAL SECTION
+	{
+		//lock
+		const size_t firstId = offset / this->segmentSize;
+		const size_t lastId = (offset + size) / this->segmentSize;
+		this->lockRange(firstId, lastId);
+
+		//notify policies, the segments charged to another mapping sharing them are not in their lists
+		for (size_t id = this->segmentStatus->nextResident(firstId, lastId) ; id < lastId ; id = this->segmentStatus->nextResident(id + 1, lastId)) {
+			const bool pinned = this->segmentStatus->isPinned(id);
+			if (pinned == false && this->isCharged(id) == false)
+				continue;
+			if (localPolicy != NULL)
+				localPolicy->notifyEvict(this, id);
+			if (globalPolicy != NULL)
+				globalPolicy->notifyEvict(this, id);
+			if (pinned) {
+				this->segmentStatus->setPinned(id, false);
+				this->pinnedSegments--;
+			}
+		}
+
+		//flush memory
+		flush(offset, size, UMMAP_FLUSH_UNMAP | UMMAP_FLUSH_NO_LOCK);
+
+		//unlock
+		this->unlockRange();
+	}
+
+	//the mappings sharing the segments are now charged for them
+	this->shrinkChargedHolders();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Drop the segments of the given range without writing them back, even the
+ * dirty ones, and ask the driver to deallocate the related storage. The
+ * segments read back as zeroes on the next access, even if the driver does
+ * not support the deallocation and still has the old content.
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+**/
+void Mapping::discard(size_t offset, size_t size)
+{
+	//check
+	assumeArg(offset + size <= this->getAlignedSize(), "'Offset (%1) + size' is not in valid range !").arg(offset).end();
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+
+	//nothing to do
+	if (size == 0)
+		return;
+
+	//CRITICAL SECTION
+	{
+		//lock
+		const size_t firstId = offset / this->segmentSize;
+		const size_t lastId = (offset + size) / this->segmentSize;
+		this->lockRange(firstId, lastId);
+
+		//notify policies, the segments charged to another mapping sharing them are not in their lists
+		for (size_t id = this->segmentStatus->nextResident(firstId, lastId) ; id < lastId ; id = this->segmentStatus->nextResident(id + 1, lastId)) {
+			const bool pinned = this->segmentStatus->isPinned(id);
+			if (pinned == false && this->isCharged(id) == false)
+				continue;
+			if (localPolicy != NULL)
+				localPolicy->notifyEvict(this, id);
+			if (globalPolicy != NULL)
+				globalPolicy->notifyEvict(this, id);
+			if (pinned) {
+				this->segmentStatus->setPinned(id, false);
+				this->pinnedSegments--;
+			}
+		}
+
+		//unmap the runs of resident segments, the content is lost
+		size_t id = this->segmentStatus->nextResident(firstId, lastId);
+		while (id < lastId) {
+			//search end of run
+			size_t end = id + 1;
+			while (end < lastId && this->segmentStatus->peek(end).mapped)
+				end++;
+
+			//unmap
+			void * addr = this->baseAddress + id * segmentSize;
+			OS::mprotect(addr, (end - id) * segmentSize, false, false, protection & PROT_EXEC);
+			OS::madviseDontNeed(addr, (end - id) * segmentSize);
+			this->releaseCachedRun(id, end);
+
+			//move
+			id = this->segmentStatus->nextResident(end, lastId);
+		}
+
+		//the other mappings of the object also see zeroes
+		if (this->segmentCache != NULL)
+			this->segmentCache->discard(this->storageOffset + offset, size);
+
+		//reset all the range to read back as zeroes, the never touched chunks are not allocated
+		this->segmentStatus->discardRange(firstId, lastId);
+
+		//release the storage
+		if (offset < this->size) {
+			size_t storageSize = size;
+			if (offset + storageSize > this->size)
+				storageSize = this->size - offset;
+			this->driver->discard(this->storageOffset + offset, storageSize);
+		}
+
+		//unlock
+		this->unlockRange();
+	}
+
+	//the mappings sharing the segments are now charged for them
+	this->shrinkChargedHolders();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Grow, shrink or move the mapping like mremap() without losing the resident
+ * segments. The segments removed by a shrink are written back and evicted, as
+ * well as the one containing the end of the storage range if it changes so it
+ * is reloaded with the new data or not written out of the new range. The
+ * moved segments keep their content and protection. Other threads must not
+ * access the mapping during the call.
+ * @param newSize New size of the mapping, it can be a non multiple of the segment size.
+ * @param flags UMMAP_REMAP_MAYMOVE to move the mapping if it cannot grow in place,
+ * UMMAP_REMAP_FIXED to move it to newAddr.
+ * @param newAddr Target address with UMMAP_REMAP_FIXED, it must not overlap the
+ * current mapping. Ignored otherwise.
+ * @return The new base address, or NULL if the mapping cannot grow in place
+ * without UMMAP_REMAP_MAYMOVE. In this case the mapping is left unchanged.
+**/
+void * Mapping::remap(size_t newSize, int flags, void * newAddr)
+{
+	//check
+	assume(newSize > 0, "Do not accept null size mapping");
+	assume(this->directMapped == false, "Cannot remap a mapping made directly by the driver !");
+	assume((flags & UMMAP_REMAP_FIXED) == 0 || (newAddr != NULL && (size_t)newAddr % UMMAP_PAGE_SIZE == 0),
+		"Invalid target address for UMMAP_REMAP_FIXED !");
+
+	//wait pending async flush as they work on the current range
+	this->waitAsyncRequests();
+
+	//compute
+	const size_t oldSegments = this->segments;
+	const size_t newSegments = (newSize + this->segmentSize - 1) / this->segmentSize;
+	const size_t oldAlignedSize = this->getAlignedSize();
+	const size_t newAlignedSize = newSegments * this->segmentSize;
+	const bool fixed = (flags & UMMAP_REMAP_FIXED);
+	char * newBase = this->baseAddress;
+
+	//reserve the address space first so we can fail without side effects
+	if (fixed && (char*)newAddr != this->baseAddress) {
+		newBase = (char*)OS::mmapProtNone(newAddr, newAlignedSize, true);
+	} else if (newAlignedSize > oldAlignedSize) {
+		char * hint = this->baseAddress + oldAlignedSize;
+		char * tail = (char*)OS::mmapProtNone(hint, newAlignedSize - oldAlignedSize, fixed);
+		if (tail != hint) {
+			OS::munmap(tail, newAlignedSize - oldAlignedSize);
+			if ((flags & UMMAP_REMAP_MAYMOVE) == 0)
+				return NULL;
+			newBase = (char*)OS::mmapProtNone(NULL, newAlignedSize, false);
+		}
+	}
+
+	//evict the removed segments
+	if (newSegments < oldSegments)
+		this->dropRange(newAlignedSize, oldAlignedSize - newAlignedSize);
+
+	//evict the segment containing the end of the storage range if it changes
+	const size_t minSize = (newSize < this->size) ? newSize : this->size;
+	if (newSize != this->size && minSize % this->segmentSize != 0)
+		this->dropRange(minSize - minSize % this->segmentSize, this->segmentSize);
+
+	//CRITICAL SECTION
+	{
+		//lock all
+		this->rangeLock.lock();
+
+		//move the resident segments, they keep their protection
+		if (newBase != this->baseAddress) {
+			const size_t kept = (newSegments < oldSegments) ? newSegments : oldSegments;
+			for (size_t id = this->segmentStatus->nextResident(0, kept) ; id < kept ; id = this->segmentStatus->nextResident(id + 1, kept))
+				OS::mremapForced(this->baseAddress + id * this->segmentSize, this->segmentSize, newBase + id * this->segmentSize);
+			OS::munmap(this->baseAddress, oldAlignedSize);
+		} else if (newAlignedSize < oldAlignedSize) {
+			OS::munmap(this->baseAddress + newAlignedSize, oldAlignedSize - newAlignedSize);
+		}
+
+		//resize the status table, a window of the pool cannot grow so move to our own table
+		if (newSegments != oldSegments) {
+			if (this->statusPool != NULL) {
+				SegmentStatusTable * table = new SegmentStatusTable(newSegments);
+				table->copyFrom(*this->segmentStatus);
+				this->statusPool->release(this->segmentStatus);
+				this->segmentStatus = table;
+				this->statusPool = NULL;
+			} else {
+				this->segmentStatus->resize(newSegments);
+			}
+		}
+
+		//update the range registered on the driver
+		this->unregisterRange();
+		this->size = newSize;
+		this->segments = newSegments;
+		this->baseAddress = newBase;
+		this->registerRange();
+
+		//policies
+		if (this->localPolicy != NULL)
+			this->localPolicy->resizeElementStorage(this, newSegments);
+		if (this->globalPolicy != NULL)
+			this->globalPolicy->resizeElementStorage(this, newSegments);
+
+		//unlock
+		this->rangeLock.unlock();
+	}
+
+	//ok
+	return newBase;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Check if the given segment has been advised to be evicted before the others
+ * (UMMAP_ADV_NOREUSE). It is used by the policies to place it on the eviction side.
+ * @param segmentId ID of the segment to check.
+**/
+bool Mapping::isLowPriority(size_t segmentId) const
+{
+	assert(segmentId < this->segments);
+	return this->segmentStatus->peek(segmentId).advice == UMMAP_ADV_NOREUSE;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Check if the given segment is pinned. It is used by the policies to keep it
+ * out of their eviction lists.
+ * @param segmentId ID of the segment to check.
+**/
+bool Mapping::isPinned(size_t segmentId) const
+{
+	assert(segmentId < this->segments);
+	return this->segmentStatus->isPinned(segmentId);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Load the segments of the given range and pin them so they are not evicted
+ * by the policies until unpin(). They stay charged to the policies memory
+ * within their pin budget (see Policy::setMaxPinnedMemory()).
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+ * @return False if the pin budget of one of the policies is exceeded, in this
+ * case none of the segments of the range are pinned by the call.
+**/
+bool Mapping::pin(size_t offset, size_t size)
+{
+	//check
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+	assume(this->protection & PROT_READ, "Cannot pin segments without read access !");
+
+	//truncate to mapping
+	const size_t alignedSize = this->getAlignedSize();
+	if (offset >= alignedSize)
+		return true;
+	if (offset + size > alignedSize)
+		size = alignedSize - offset;
+
+	//loop on all
+	const size_t firstId = offset / this->segmentSize;
+	const size_t lastId = (offset + size) / this->segmentSize;
+	std::vector<size_t> pinned;
+	for (size_t id = firstId ; id < lastId ; id++) {
+		//already pinned
+		if (this->segmentStatus->isPinned(id))
+			continue;
+
+		//pin
+		if (this->pinSegment(id)) {
+			pinned.push_back(id);
+		} else {
+			//rollback
+			for (auto it : pinned)
+				this->unpinSegment(it);
+			if (this->localPolicy != NULL)
+				this->localPolicy->shrinkMemory();
+			if (this->globalPolicy != NULL)
+				this->globalPolicy->shrinkMemory();
+			return false;
+		}
+	}
+
+	//ok
+	return true;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Load the given segment if needed and pin it in the policies.
+ * @param segmentId ID of the segment.
+ * @return False if the pin budget of one of the policies is exceeded.
+**/
+bool Mapping::pinSegment(size_t segmentId)
+{
+	//loop until it is loaded and still mapped when pinning it
+	while (true) {
+		//vars
+		bool loaded = false;
+
+		//CRITICAL SECTION
+		{
+			//lock to access
+			MappingSegmentGuard lockGuard(*this, segmentId);
+
+			//get
+			SegmentStatus & status = this->segmentStatus->get(segmentId);
+			size_t offset = segmentId * this->segmentSize;
+
+			//pin if mapped
+			if (this->segmentStatus->isPinned(segmentId)) {
+				return true;
+			} else if (status.mapped) {
+				if (this->localPolicy != NULL && this->localPolicy->notifyPin(this, segmentId) == false)
+					return false;
+				if (this->globalPolicy != NULL && this->globalPolicy->notifyPin(this, segmentId) == false) {
+					if (this->localPolicy != NULL)
+						this->localPolicy->notifyUnpin(this, segmentId);
+					return false;
+				}
+				this->segmentStatus->setPinned(segmentId, true);
+				this->pinnedSegments++;
+				return true;
+			}
+
+			//load it
+			if (!status.skipRead || this->segmentCache != NULL)
+				this->loadAndSwapSegment(offset, false);
+			else
+				OS::mprotect(this->baseAddress + offset, segmentSize, true, false, protection & PROT_EXEC);
+			status.mapped = true;
+			status.evicted = false;
+			this->segmentStatus->updateIndex(segmentId);
+			loaded = true;
+		}
+
+		//notify eviction policy, out of the lock as it might evict, unless charged
+		//to another mapping sharing the segment
+		if (loaded && this->isCharged(segmentId)) {
+			if (this->localPolicy != NULL)
+				this->localPolicy->notifyTouch(this, segmentId, false, false, false, false);
+			if (this->globalPolicy != NULL)
+				this->globalPolicy->notifyTouch(this, segmentId, false, false, false, false);
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Unpin the pinned segments of the given range so they go back in the
+ * eviction lists of the policies.
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+**/
+void Mapping::unpin(size_t offset, size_t size)
+{
+	//check
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+
+	//truncate to mapping
+	const size_t alignedSize = this->getAlignedSize();
+	if (offset >= alignedSize)
+		return;
+	if (offset + size > alignedSize)
+		size = alignedSize - offset;
+
+	//pinned segments are resident
+	const size_t lastId = (offset + size) / this->segmentSize;
+	for (size_t id = this->segmentStatus->nextResident(offset / this->segmentSize, lastId) ; id < lastId ; id = this->segmentStatus->nextResident(id + 1, lastId))
+		if (this->segmentStatus->isPinned(id))
+			this->unpinSegment(id);
+
+	//the policies might now be over their limit, evict out of the segment locks
+	if (this->localPolicy != NULL)
+		this->localPolicy->shrinkMemory();
+	if (this->globalPolicy != NULL)
+		this->globalPolicy->shrinkMemory();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Unpin the given segment if still pinned.
+ * @param segmentId ID of the segment.
+**/
+void Mapping::unpinSegment(size_t segmentId)
+{
+	//lock to access
+	MappingSegmentGuard lockGuard(*this, segmentId);
+
+	//might have been done by another thread
+	if (this->segmentStatus->isPinned(segmentId) == false)
+		return;
+
+	//unpin
+	this->segmentStatus->setPinned(segmentId, false);
+	this->pinnedSegments--;
+	if (this->localPolicy != NULL)
+		this->localPolicy->notifyUnpin(this, segmentId);
+	if (this->globalPolicy != NULL)
+		this->globalPolicy->notifyUnpin(this, segmentId);
+
+	//back in the lists, unless charged to another mapping sharing it
+	if (this->segmentStatus->peek(segmentId).mapped && this->isCharged(segmentId) == false) {
+		if (this->localPolicy != NULL)
+			this->localPolicy->notifyEvict(this, segmentId);
+		if (this->globalPolicy != NULL)
+			this->globalPolicy->notifyEvict(this, segmentId);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Load, map and pin a whole range so it can be accessed without any fault
+ * until release(). The not yet loaded segments are read by runs of contiguous
+ * segments with one driver request each and the policies are updated once for
+ * the whole range. The segments are charged to the pin budget of the policies.
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+ * @param mode Access to open, PROT_READ or PROT_READ|PROT_WRITE. On write
+ * access the segments are marked dirty.
+ * @return False if the range does not fit in the pin budget of the policies,
+ * nothing is done in this case.
+**/
+bool Mapping::acquire(size_t offset, size_t size, int mode)
+{
+	//check
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+	assumeArg((mode & PROT_READ) && (mode & ~(this->protection | PROT_EXEC)) == 0, "Invalid acquire mode (%1) for the mapping protection !").arg(mode).end();
+
+	//truncate to mapping
+	const size_t alignedSize = this->getAlignedSize();
+	if (offset >= alignedSize)
+		return true;
+	if (offset + size > alignedSize)
+		size = alignedSize - offset;
+
+	//vars
+	const size_t firstId = offset / this->segmentSize;
+	const size_t endId = (offset + size) / this->segmentSize;
+	const bool writeAccess = (mode & PROT_WRITE);
+	size_t maxRun = UMMAP_LOAD_MAX_RUN_SIZE / this->segmentSize;
+	if (maxRun == 0)
+		maxRun = 1;
+
+	//lock all the segments, in order not to dead lock with another acquire
+	this->segmentStatus->lockSegments(firstId, endId);
+
+	//pin in the policies first as it might fail
+	bool pinned = true;
+	if (this->localPolicy != NULL && this->localPolicy->notifyPinRange(this, firstId, endId) == false) {
+		pinned = false;
+	} else if (this->globalPolicy != NULL && this->globalPolicy->notifyPinRange(this, firstId, endId) == false) {
+		if (this->localPolicy != NULL)
+			this->localPolicy->notifyUnpinRange(this, firstId, endId);
+		pinned = false;
+	}
+
+	//load by runs
+	size_t id = firstId;
+	while (pinned && id < endId) {
+		//get
+		SegmentStatus & status = this->segmentStatus->get(id);
+
+		//already there
+		if (status.mapped || (status.skipRead && this->segmentCache == NULL)) {
+			//the segment is waiting an async flush, write it now before opening write access
+			if (writeAccess && status.inFlight)
+				this->writeSegment(id * segmentSize);
+			//first touch without read or write access on a read only one
+			if (status.mapped == false || (writeAccess && status.dirty == false))
+				OS::mprotect(this->baseAddress + id * segmentSize, segmentSize, true, writeAccess, protection & PROT_EXEC);
+			id++;
+			continue;
+		}
+
+		//search end of run
+		size_t end = id + 1;
+		while (end < endId && end - id < maxRun) {
+			SegmentStatus next = this->segmentStatus->peek(end);
+			if (next.mapped || (next.skipRead && this->segmentCache == NULL))
+				break;
+			end++;
+		}
+
+		//load
+		if (writeAccess)
+			this->loadSegmentsRun(id, end, id, end);
+		else
+			this->loadSegmentsRun(id, end, 0, 0);
+
+		//mark, dirty state is updated after
+		for (size_t i = id ; i < end ; i++) {
+			SegmentStatus & cur = this->segmentStatus->get(i);
+			cur.mapped = true;
+			cur.evicted = false;
+		}
+
+		//move
+		id = end;
+	}
+
+	//update status
+	for (id = firstId ; pinned && id < endId ; id++) {
+		SegmentStatus & status = this->segmentStatus->get(id);
+		status.mapped = true;
+		if (writeAccess) {
+			status.dirty = true;
+			status.changed = true;
+			status.inFlight = false;
+			status.skipRead = false;
+		}
+		this->segmentStatus->updateIndex(id);
+		if (this->segmentStatus->isPinned(id) == false) {
+			this->segmentStatus->setPinned(id, true);
+			this->pinnedSegments++;
+		}
+	}
+
+	//unlock
+	this->segmentStatus->unlockSegments(firstId, endId);
+
+	//the range is charged at once, the policies might now be over their limit,
+	//evict out of the segment locks
+	if (pinned && this->localPolicy != NULL)
+		this->localPolicy->shrinkMemory();
+	if (pinned && this->globalPolicy != NULL)
+		this->globalPolicy->shrinkMemory();
+
+	//ok
+	return pinned;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release a range acquired by acquire() so its segments can be evicted again.
+ * It unpins them, including the ones pinned by pin().
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+**/
+void Mapping::release(size_t offset, size_t size)
+{
+	this->unpin(offset, size);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Fill one byte per segment of the range with its residency like mincore().
+ * The state is read without taking the segment locks so it can be outdated
+ * when returning. It runs in O(resident) thanks to the status table indexes.
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+ * @param vec Filled with UMMAP_RESIDENT for the mapped segments plus
+ * UMMAP_RESIDENT_DIRTY if not yet written to the storage, 0 otherwise.
+ * @return Number of resident segments in the range.
+**/
+size_t Mapping::getResidency(size_t offset, size_t size, unsigned char * vec) const
+{
+	//check
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+	assume(offset + size <= this->getAlignedSize(), "Invalid range, not fit in the mapping !");
+
+	//vars
+	const size_t firstId = offset / this->segmentSize;
+	const size_t endId = (offset + size) / this->segmentSize;
+	size_t resident = 0;
+
+	//default
+	memset(vec, 0, endId - firstId);
+
+	//resident
+	for (size_t id = this->segmentStatus->nextResident(firstId, endId) ; id < endId ; id = this->segmentStatus->nextResident(id + 1, endId)) {
+		vec[id - firstId] |= UMMAP_RESIDENT;
+		resident++;
+	}
+
+	//dirty
+	for (size_t id = this->segmentStatus->nextDirty(firstId, endId) ; id < endId ; id = this->segmentStatus->nextDirty(id + 1, endId))
+		vec[id - firstId] |= UMMAP_RESIDENT | UMMAP_RESIDENT_DIRTY;
+
+	//ok
+	return resident;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Build the list of the segments of the range with the resident ones first,
+ * each part in address order. Like getResidency() the state is read without
+ * locks so it is a hint.
+ * @param offset Offset of the range (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+ * @param order Filled with the offsets of the segments in the mapping.
+ * @return Number of resident segments placed at the beginning of the list.
+**/
+size_t Mapping::getResidentFirstOrder(size_t offset, size_t size, std::vector<size_t> & order) const
+{
+	//check
+	assumeArg(offset % segmentSize == 0, "Should get offset (%1) multiple of segment size !").arg(offset).end();
+	assumeArg(size % segmentSize == 0, "Should get size (%1) multiple of segment size !").arg(size).end();
+	assume(offset + size <= this->getAlignedSize(), "Invalid range, not fit in the mapping !");
+
+	//vars
+	const size_t firstId = offset / this->segmentSize;
+	const size_t endId = (offset + size) / this->segmentSize;
+	order.clear();
+	order.reserve(endId - firstId);
+
+	//resident first, remember where the holes are
+	size_t prev = firstId;
+	std::vector<std::pair<size_t, size_t> > holes;
+	for (size_t id = this->segmentStatus->nextResident(firstId, endId) ; id < endId ; id = this->segmentStatus->nextResident(id + 1, endId)) {
+		order.push_back(id * this->segmentSize);
+		if (id > prev)
+			holes.push_back(std::make_pair(prev, id));
+		prev = id + 1;
+	}
+	if (endId > prev)
+		holes.push_back(std::make_pair(prev, endId));
+	const size_t resident = order.size();
+
+	//then the missing ones
+	for (auto & hole : holes)
+		for (size_t id = hole.first ; id < hole.second ; id++)
+			order.push_back(id * this->segmentSize);
+
+	//ok
+	return resident;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Enable the fault-around: on a fault, the not yet loaded segments of the
+ * aligned window containing the faulting one are loaded with it by a single
+ * driver request, as far as the policies can afford them. They are then
+ * handled with low priority by the policies until being accessed.
+ * @param size Size of the window, rounded down to the segment size. 0 or a
+ * single segment disables it.
+**/
+void Mapping::setFaultAround(size_t size)
+{
+	this->faultAround = size / this->segmentSize;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * When evicting a segment we need to notify the local
+ * and global policies.
+ * @param sourcePolicy Define the policy which has initiated the eviction
+ * operation of NULL if none. This is used to not self notify itself.
  * @param segmentId Define the ID of the segment to be evicted.
 **/
 void Mapping::evict(Policy * sourcePolicy, size_t segmentId)
 {
 	//CRITICAL SECTION
 	{
-		//lock to access
-		int mutexId = segmentId % this->segmentMutexesCnt;
-		std::lock_guard<std::mutex> lockGuard(this->segmentMutexes[mutexId]);
+		//removed by remap() after being selected by the policy
+		this->rangeLock.lockShared();
+		if (segmentId >= this->segments) {
+			this->rangeLock.unlockShared();
+			return;
+		}
 
+		//lock to access
+		this->lockSegment(segmentId);
+
+		//pinned after being selected by the policy, it is now charged as pinned
+		if (this->segmentStatus->isPinned(segmentId) == false) {
+			//notify policies
+			if (sourcePolicy != localPolicy && localPolicy != NULL)
+				localPolicy->notifyEvict(this, segmentId);
+			if (sourcePolicy != globalPolicy && globalPolicy != NULL)
+				globalPolicy->notifyEvict(this, segmentId);
+		
+			//flush memory
+			flush(segmentId * segmentSize, segmentSize, UMMAP_FLUSH_UNMAP | UMMAP_FLUSH_NO_LOCK);
+		}
 
-		//notify policies
-		if (sourcePolicy != localPolicy && localPolicy != NULL)
-			localPolicy->notifyEvict(this, segmentId);
-		if (sourcePolicy != globalPolicy && globalPolicy != NULL)
-			globalPolicy->notifyEvict(this, segmentId);
-	
-		//flush memory
-		flush(segmentId * segmentSize, segmentSize, UMMAP_FLUSH_UNMAP | UMMAP_FLUSH_NO_LOCK);
+		//unlock
+		this->unlockSegment(segmentId);
+		this->rangeLock.unlockShared();
 	}
+
+	//the mappings sharing the segment are now charged for it
+	this->shrinkChargedHolders();
 }
 
 /*******************  FUNCTION  *********************/
@@ -663,8 +2349,7 @@ void Mapping::evict(Policy * sourcePolicy, size_t segmentId)
 **/
 void Mapping::skipFirstRead(void)
 {
-	for (size_t i = 0 ; i < this->segments ; i++)
-		this->segmentStatus[i].needRead = false;
+	this->segmentStatus->setSkipRead();
 }
 
 /*******************  FUNCTION  *********************/
@@ -685,6 +2370,172 @@ Driver * Mapping::getDriver(void)
 	return this->driver;
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Copy a segment from a driver to another one at the same offset.
+ * @param buffer Temporary buffer of segment size.
+ * @param source Driver to read from.
+ * @param target Driver to write into.
+ * @param offset Offset of the segment in the mapping.
+**/
+void Mapping::copySegment(char * buffer, Driver * source, Driver * target, size_t offset)
+{
+	//vars
+	size_t copySize = readWriteSize(offset);
+	ssize_t status;
+
+	//copy
+	status = source->pread(buffer, copySize, this->storageOffset + offset);
+	assumeArg(status == static_cast<ssize_t>(copySize), "Failed to read data from the source driver ! (%1 != %2)").arg(status).arg(copySize).end();
+	status = target->pwrite(buffer, copySize, this->storageOffset + offset);
+	assumeArg(status == static_cast<ssize_t>(copySize), "Failed to write data to the target driver ! (%1 != %2)").arg(status).arg(copySize).end();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Make an incremental checkpoint of the mapping into the target driver.
+ * The whole range is first cloned from the previous checkpoint (or from the
+ * origin storage for the first one) if the driver supports it (reflink), then
+ * only the segments modified since the last checkpoint are written. If the
+ * clone is not supported the unchanged segments are also copied.
+ * The dirty segments are always considered as modified as the writes on them
+ * are not tracked, they are still considered as modified at the next checkpoint
+ * even if flushed in between.
+ * @param target The driver of the checkpoint. The mapping takes its ownership
+ * and keeps it as base for the next checkpoint.
+ * @return The checkpoint epoch number.
+**/
+size_t Mapping::checkpoint(Driver * target)
+{
+	//check
+	assume(target != NULL, "Get an invalid NULL driver to checkpoint !");
+	assume(target != this->driver, "Cannot checkpoint on the driver of the mapping !");
+
+	//base to reuse the unchanged data
+	Driver * base = this->checkpointDriver;
+	if (base == NULL)
+		base = this->driver;
+
+	//allocate buffer
+	char * buffer = new char[this->segmentSize];
+
+	//CRITICAL SECTION
+	{
+		//lock the whole segment
+		this->lockAllSegments();
+
+		//try to clone the whole range
+		bool cloned = base->cloneTo(target, this->storageOffset, this->size);
+
+		//the never touched segments did not change since the last checkpoint so
+		//only the touched chunks are scanned, except for a copy or the first checkpoint
+		bool scanAll = (cloned == false || this->checkpointDriver == NULL);
+		size_t first = scanAll ? 0 : this->segmentStatus->nextTouched(0, this->segments);
+		for (size_t i = first ; i < this->segments ; i = scanAll ? i + 1 : this->segmentStatus->nextTouched(i + 1, this->segments)) {
+			//get segment
+			SegmentStatus * touched = this->segmentStatus->find(i);
+			SegmentStatus status = (touched != NULL) ? *touched : this->segmentStatus->peek(i);
+			size_t offset = i * this->segmentSize;
+			bool changed = status.changed || status.dirty;
+			char * addr = this->baseAddress + offset;
+
+			//apply depending on where is the up to date data
+			if (status.mapped && (changed || !cloned)) {
+				//protect while writing
+				if (status.dirty && threadSafe)
+					OS::mprotect(addr, segmentSize, true, false, protection & PROT_EXEC);
+
+				//write from memory
+				ssize_t res = target->pwrite(addr, readWriteSize(offset), this->storageOffset + offset);
+				assumeArg(res == static_cast<ssize_t>(readWriteSize(offset)), "Failed to write data to the target driver ! (%1)").arg(res).end();
+
+				//restore
+				if (status.dirty && threadSafe)
+					OS::mprotect(addr, segmentSize, true, true, protection & PROT_EXEC);
+			} else if (status.mapped == false && status.skipRead) {
+				//content will be zeroes on first access
+				if (this->checkpointDriver == NULL || !cloned || status.changed) {
+					memset(buffer, 0, segmentSize);
+					ssize_t res = target->pwrite(buffer, readWriteSize(offset), this->storageOffset + offset);
+					assumeArg(res == static_cast<ssize_t>(readWriteSize(offset)), "Failed to write data to the target driver ! (%1)").arg(res).end();
+				}
+			} else if (changed) {
+				//flushed and evicted since last checkpoint
+				this->copySegment(buffer, this->driver, target, offset);
+			} else if (!cloned) {
+				//unchanged since last checkpoint
+				this->copySegment(buffer, base, target, offset);
+			}
+
+			//reset, a dirty segment stays writable so the next writes are not tracked
+			//and it must be considered as changed until flushed
+			if (touched != NULL)
+				touched->changed = status.dirty;
+			else if (status.changed)
+				this->segmentStatus->get(i).changed = false;
+		}
+
+		//unlock the whole segment
+		this->unlockAllSegments();
+	}
+
+	//free buffer
+	delete [] buffer;
+
+	//replace the base
+	if (this->checkpointDriver != NULL)
+		delete this->checkpointDriver;
+	this->checkpointDriver = target;
+
+	//ok
+	return ++this->checkpointEpoch;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of checkpoints made on the mapping.
+**/
+size_t Mapping::getCheckpointEpoch(void) const
+{
+	return this->checkpointEpoch;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Fill the given struct with the mapping counters. The resident and dirty
+ * sizes are read from the segment indexes without taking the locks so it is
+ * only a snapshot which might be a bit out of date.
+ * @param stats The struct to fill.
+**/
+void Mapping::getStats(ummap_stats_t & stats) const
+{
+	//counters
+	stats.read_faults = this->counters.get(STATS_READ_FAULTS);
+	stats.write_faults = this->counters.get(STATS_WRITE_FAULTS);
+	stats.refaults = this->counters.get(STATS_REFAULTS);
+	stats.read_bytes = this->counters.get(STATS_READ_BYTES);
+	stats.written_bytes = this->counters.get(STATS_WRITTEN_BYTES);
+	stats.clean_evictions = this->counters.get(STATS_CLEAN_EVICTIONS);
+	stats.dirty_evictions = this->counters.get(STATS_DIRTY_EVICTIONS);
+	stats.flushes = this->counters.get(STATS_FLUSHES);
+	stats.fault_around = this->counters.get(STATS_FAULT_AROUND);
+	stats.cache_hits = this->counters.get(STATS_CACHE_HITS);
+
+	//current state
+	stats.resident_bytes = this->segmentStatus->getResidentCount() * this->segmentSize;
+	stats.dirty_bytes = this->segmentStatus->getDirtyCount() * this->segmentSize;
+	stats.pinned_bytes = this->pinnedSegments.load() * this->segmentSize;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the global policy of the mapping (NULL if none).
+**/
+Policy * Mapping::getGlobalPolicy(void)
+{
+	return this->globalPolicy;
+}
+
 /*******************  FUNCTION  *********************/
 void Mapping::copyExtraNotMappedPart(char * buffer, Driver * newDriver, size_t offset, size_t size)
 {
@@ -735,7 +2586,7 @@ void Mapping::copyMappedPart(char * buffer, Driver * newDriver, size_t storageSi
 			copySize = mappingEnd - this->getStorageOffset() - i;
 
 		//get segment info
-		SegmentStatus & curStatus = this->segmentStatus[i/this->segmentSize];
+		SegmentStatus curStatus = this->segmentStatus->peek(i/this->segmentSize);
 		
 		//apply copy mode if already have synced data in memory
 		const size_t offset = this->storageOffset + i;
@@ -807,6 +2658,34 @@ size_t Mapping::getPolicyMaxMemory(void)
 	return max;
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Return the memory the policies can still give before evicting (the lower
+ * of the local and global ones). It is only a hint read without lock.
+**/
+size_t Mapping::getPolicyFreeMemory(void)
+{
+	//vars
+	size_t free = SIZE_MAX;
+
+	//get policy
+	if (this->localPolicy != NULL) {
+		size_t policyFree = this->localPolicy->getFreeMemory();
+		if (policyFree < free)
+			free = policyFree;
+	}
+
+	//get policy
+	if (this->globalPolicy != NULL) {
+		size_t policyFree = this->globalPolicy->getFreeMemory();
+		if (policyFree < free)
+			free = policyFree;
+	}
+
+	//ok
+	return free;
+}
+
 /*******************  FUNCTION  *********************/
 #ifdef HAVE_HTOPML
 /**
@@ -818,10 +2697,30 @@ void ummapio::convertToJson(htopml::JsonState & json,const SegmentStatus & value
 		//json.printField("time", value.time);
 		json.printField("mapped", value.mapped);
 		json.printField("dirty", value.dirty);
-		json.printField("needRead", value.needRead);
+		json.printField("skipRead", value.skipRead);
+		json.printField("inFlight", value.inFlight);
+		json.printField("changed", value.changed);
 	json.closeStruct();
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Dump the miss-ratio curve of a policy as an array of points.
+**/
+static void printMissRatioCurve(htopml::JsonState & json, const char * name, MissRatioCurve & curve)
+{
+	ummap_mrc_point_t points[UMMAP_MRC_BUCKETS];
+	size_t cnt = curve.getCurve(points, UMMAP_MRC_BUCKETS);
+	json.openFieldArray(name);
+	for (size_t i = 0 ; i < cnt ; i++) {
+		json.openStruct();
+			json.printField("memory", points[i].memory);
+			json.printField("missRatio", points[i].miss_ratio);
+		json.closeStruct();
+	}
+	json.closeFieldArray(name);
+}
+
 /*******************  FUNCTION  *********************/
 /**
  * When htopml is enabled this function is used to dump the mapping state in a json format.
@@ -842,9 +2741,30 @@ void ummapio::convertToJson(htopml::JsonState & json,const Mapping & value)
 			json.printField("globalPolicyUri", "none://");
 		else
 			json.printField("globalPolicyUri", value.globalPolicy->getUri());
+		ummap_stats_t stats;
+		value.getStats(stats);
+		json.openFieldStruct("stats");
+			json.printField("readFaults", stats.read_faults);
+			json.printField("writeFaults", stats.write_faults);
+			json.printField("refaults", stats.refaults);
+			json.printField("readBytes", stats.read_bytes);
+			json.printField("writtenBytes", stats.written_bytes);
+			json.printField("cleanEvictions", stats.clean_evictions);
+			json.printField("dirtyEvictions", stats.dirty_evictions);
+			json.printField("flushes", stats.flushes);
+			json.printField("faultAround", stats.fault_around);
+			json.printField("cacheHits", stats.cache_hits);
+			json.printField("residentBytes", stats.resident_bytes);
+			json.printField("dirtyBytes", stats.dirty_bytes);
+			json.printField("pinnedBytes", stats.pinned_bytes);
+		json.closeFieldStruct("stats");
+		if (value.localPolicy != NULL && value.localPolicy->getMissRatioCurve() != NULL)
+			printMissRatioCurve(json, "localPolicyMrc", *value.localPolicy->getMissRatioCurve());
+		if (value.globalPolicy != NULL && value.globalPolicy->getMissRatioCurve() != NULL)
+			printMissRatioCurve(json, "globalPolicyMrc", *value.globalPolicy->getMissRatioCurve());
 		json.openFieldArray("status");
 		for (size_t i = 0 ; i < value.segments ; i++)
-			json.printValue(value.segmentStatus[i]);
+			json.printValue(value.segmentStatus->peek(i));
 		json.closeFieldArray("status");
 	json.closeStruct();
 }
@@ -13,6 +13,9 @@
 //std
 #include <cstdlib>
 #include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <atomic>
 //unix
 #include <sys/mman.h>
 //htopml
@@ -22,6 +25,12 @@
 //internal
 #include "Policy.hpp"
 #include "Driver.hpp"
+#include "MappingStats.hpp"
+#include "SegmentStatusTable.hpp"
+#include "SegmentStatusPool.hpp"
+#include "SegmentCache.hpp"
+#include "WorkerPool.hpp"
+#include "../portability/RWLock.hpp"
 #include "public-api/ummap.h"
 
 /********************  NAMESPACE  *******************/
@@ -37,29 +46,38 @@ namespace ummapio
 #define UMMAP_FLUSH_UNMAP 2
 /** Do not take locks when flushing data. **/
 #define UMMAP_FLUSH_NO_LOCK 4
+/** Minimal number of dirty segments to use the parallel flush. **/
+#define UMMAP_FLUSH_PARALLEL_MIN_SEGMENTS 64
+/** Maximal size of a coalesced write operation when flushing in parallel. **/
+#define UMMAP_FLUSH_MAX_RUN_SIZE (16UL*1024UL*1024UL)
+/** Number of segments loaded after a fault on a segment advised as UMMAP_ADV_SEQUENTIAL. **/
+#define UMMAP_ADVISE_READ_AHEAD 4
+/** Maximal size of a read operation when loading a range by acquire(). **/
+#define UMMAP_LOAD_MAX_RUN_SIZE (16UL*1024UL*1024UL)
+/**
+ * Internal mapping flag telling the address range is already reserved as PROT_NONE by the
+ * caller (see GlobalHandler::ummapBatch()) so the mapping does not need to call mmap().
+**/
+#define UMMAP_MAPPING_RESERVED (1 << 16)
+
+/*********************  CLASS  **********************/
+class FlushRequest;
+class Mapping;
 
 /*********************  STRUCT  *********************/
 /**
- * Struct defining the status variable to track the stage of each segment of a mapping.
+ * Describe a dirty segment to be written by an external flush scheduler.
 **/
-struct SegmentStatus
+struct MappingDirtySegment
 {
-	/** Last write access. **/
-	//size_t time:56;
-	/** Unused **/
-	unsigned int unused:5;
-	/** True if the segment is mapped **/
-	bool mapped:1;
-	/** 
-	 * True if the segment has been touched by a write access and is out of 
-	 * sync with the storage. 
-	**/
-	bool dirty:1;
-	/**
-	 * If true the segment will be read on the first read access. If not it will be filled
-	 * by zeroes on the first access.
-	**/
-	bool needRead:1;
+	/** Mapping containing the segment. **/
+	Mapping * mapping;
+	/** Offset of the segment in the mapping. **/
+	size_t offset;
+	/** Absolute offset of the segment in the storage. **/
+	size_t storageOffset;
+	/** Size of the data to write (smaller than segment size for the last segment). **/
+	size_t size;
 };
 
 /*********************  CLASS  **********************/
@@ -71,13 +89,39 @@ struct SegmentStatus
 class Mapping
 {
 	public:
-		Mapping(void * addr, size_t size, size_t segmentSize, size_t storageOffset, int protection, int flags, Driver * driver, Policy * localPolicy = NULL, Policy * globalPolicy = NULL);
+		Mapping(void * addr, size_t size, size_t segmentSize, size_t storageOffset, int protection, int flags, Driver * driver, Policy * localPolicy = NULL, Policy * globalPolicy = NULL, SegmentStatusPool * statusPool = NULL, SegmentCacheRegistry * cacheRegistry = NULL);
 		virtual ~Mapping(void);
 		void onSegmentationFault(void * address, bool isWrite);
 		void flush(bool sync);
 		void flush(size_t offset, size_t size, int flags = UMMAP_FLUSH_DEFAULT);
-		void prefetch(size_t offset, size_t size);
+		void flushParallel(size_t offset, size_t size, int flags, unsigned int threads, WorkerPool & pool);
+		FlushRequest * flushAsync(size_t offset, size_t size, int flags, WorkerPool & pool);
+		void flushInFlight(size_t offset, size_t size, int flags);
+		void beginAsyncRequest(void);
+		void endAsyncRequest(void);
+		void lockAllSegments(void);
+		void unlockAllSegments(void);
+		void lockRange(size_t firstId, size_t endId);
+		void unlockRange(void);
+		void lockSegment(size_t segmentId);
+		void unlockSegment(size_t segmentId);
+		void collectDirtySegments(std::vector<MappingDirtySegment> & segments);
+		void markSegmentFlushed(size_t offset);
+		size_t prefetch(size_t offset, size_t size);
+		void advise(size_t offset, size_t size, ummap_advice_t advice);
+		bool isLowPriority(size_t segmentId) const;
+		bool isPinned(size_t segmentId) const;
+		bool pin(size_t offset, size_t size);
+		void unpin(size_t offset, size_t size);
+		bool acquire(size_t offset, size_t size, int mode);
+		void release(size_t offset, size_t size);
+		void discard(size_t offset, size_t size);
+		void * remap(size_t newSize, int flags, void * newAddr = NULL);
+		void setFaultAround(size_t size);
+		size_t getResidency(size_t offset, size_t size, unsigned char * vec) const;
+		size_t getResidentFirstOrder(size_t offset, size_t size, std::vector<size_t> & order) const;
 		virtual void evict(Policy * sourcePolicy, size_t segmentId);
+		void chargeCachedSegment(size_t storageOffset);
 		void * getAddress(void);
 		void skipFirstRead(void);
 		SegmentStatus getSegmentStatus(size_t offset);
@@ -87,6 +131,7 @@ class Mapping
 		size_t getStorageOffset(void) const;
 		void disableThreadSafety();
 		Driver * getDriver(void);
+		Policy * getGlobalPolicy(void);
 		void unregisterRange(void);
 		void registerRange(void);
 		void dropClean(void);
@@ -94,16 +139,33 @@ class Mapping
 		void copyToDriver(Driver * newDriver, size_t storageSize);
 		void directMmapCow(Driver * newDriver);
 		size_t getPolicyMaxMemory(void);
+		size_t getPolicyFreeMemory(void);
+		size_t checkpoint(Driver * target);
+		size_t getCheckpointEpoch(void) const;
+		void getStats(ummap_stats_t & stats) const;
 	public:
 		#ifdef HAVE_HTOPML
 		friend void convertToJson(htopml::JsonState & json,const Mapping & value);
 		#endif
 	private:
 		void loadAndSwapSegment(size_t offset, bool writeAccess);
-		const bool * getMutexRange(size_t offset, size_t size, bool * buffer, size_t bufferSize) const;
+		void loadAround(size_t segmentId, bool writeAccess, size_t & first, size_t & last);
+		bool tryLockAround(size_t segmentId);
+		void loadSegmentsRun(size_t firstId, size_t endId, size_t writeFirst, size_t writeEnd);
+		void loadCachedSegment(size_t segmentId, bool writeAccess);
+		void releaseCachedRun(size_t firstId, size_t endId);
+		void shrinkChargedHolders(void);
+		bool isCharged(size_t segmentId);
+		bool pinSegment(size_t segmentId);
+		void unpinSegment(size_t segmentId);
+		void writeSegment(size_t offset);
+		void flushSegmentsRange(size_t firstId, size_t lastId, bool unmap, bool coalesceWrites);
+		void waitAsyncRequests(void);
+		void dropRange(size_t offset, size_t size);
 		size_t readWriteSize(size_t offset);
 		void copyExtraNotMappedPart(char * buffer, Driver * newDriver, size_t offset, size_t size);
 		void copyMappedPart(char * buffer, Driver * newDriver, size_t storageSize);
+		void copySegment(char * buffer, Driver * source, Driver * target, size_t offset);
 	private:
 		/** Driver to access the storage and read/write data from it. **/
 		Driver * driver;
@@ -132,25 +194,54 @@ class Mapping
 		size_t size;
 		/** Define the offset in the storage. No necessily aligned on segmentSize. **/
 		size_t storageOffset;
-		/** Table of segment status.**/
-		SegmentStatus * segmentStatus;
+		/** Table of segment status, allocated lazily on first touch. **/
+		SegmentStatusTable * segmentStatus;
+		/** Pool from which the status table has been taken (NULL if allocated by the mapping). **/
+		SegmentStatusPool * statusPool;
+		/** Cache shared with the other mappings of the object (NULL if not using UMMAP_SHARED_CACHE). **/
+		SegmentCache * segmentCache;
+		/** Registry from which the cache has been taken. **/
+		SegmentCacheRegistry * cacheRegistry;
+		/** Mappings which received the charge of a segment we released, to be shrunk (see shrinkChargedHolders()). **/
+		std::vector<Mapping *> chargedHolders;
+		/** Protect the chargedHolders list. **/
+		std::mutex chargedMutex;
 		/** Keep track of driver ID to identify the mapping. **/
 		int64_t mappingDriverId;
-		/** 
-		 * Table of mutex to protect the various segment. This avoid to contention on a uniq
-		 * mutex.
-		**/
-		std::mutex * segmentMutexes;
 		/**
-		 * Number of segment mutex in use. The choice is derived from the number of CPU threads
-		 * observed when spawning the segment.
+		 * Taken in exclusive mode by the operations on a range of segments (see lockRange())
+		 * and remap(), in shared mode by evict() so a segment selected by a policy is not
+		 * removed meanwhile. The accesses to a single segment only take its lock bit.
 		**/
-		int segmentMutexesCnt;
+		RWLock rangeLock;
 		/**
 		 * Enable of disable the thread safety concerning the mprotect/mremap operations. (locks
 		 * are kept).
 		**/
 		bool threadSafe;
+		/** Number of asynchronous requests (flush or load) still running on the mapping. **/
+		int asyncRequests;
+		/** Protect the asyncRequests counter. **/
+		std::mutex asyncMutex;
+		/** Used to wait the end of the asynchronous requests before destroying the mapping. **/
+		std::condition_variable asyncCond;
+		/** Driver of the last checkpoint used as a base for the next one (NULL if none). **/
+		Driver * checkpointDriver;
+		/** Number of checkpoints made on the mapping. **/
+		size_t checkpointEpoch;
+		/**
+		 * Size of the aligned window (in segments) in which the not yet loaded neighbours of
+		 * a faulting segment are loaded with it (see setFaultAround()). Disabled if lower than 2.
+		**/
+		size_t faultAround;
+		/** Reload in write mode the segments which were dirty when evicted (UMMAP_PREDICT_WRITE). **/
+		bool predictWrite;
+		/** Number of pinned segments (see pin()). **/
+		std::atomic<size_t> pinnedSegments;
+		/** True if the memory has been mapped by the driver (see Driver::directMmap()). **/
+		bool directMapped;
+		/** Event counters exposed by ummap_get_stats(). **/
+		MappingStats counters;
 };
 
 /*******************  FUNCTION  *********************/
@@ -36,32 +36,48 @@ MappingRegistry::~MappingRegistry(void)
 /*******************  FUNCTION  *********************/
 /**
  * Registry the given mapping to the registry. This functions
- * if protected by a spinlock for thread safetry.
+ * if protected by a lock for thread safetry.
  * @param mapping Pointer to the mapping to register.
 **/
 void MappingRegistry::registerMapping(Mapping * mapping)
+{
+	this->registerMappings(&mapping, 1);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Register several mappings by taking the lock only once.
+ * @param mappings Array of mappings to register.
+ * @param count Number of mappings in the array.
+**/
+void MappingRegistry::registerMappings(Mapping ** mappings, size_t count)
 {
 	//check
-	assert(mapping != NULL);
-	assert(!contain(mapping));
+	assert(mappings != NULL);
+	for (size_t i = 0 ; i < count ; i++) {
+		assert(mappings[i] != NULL);
+		assert(!contain(mappings[i]));
+	}
 
 	//CRITICAL SECTION
 	{
-		std::lock_guard<Spinlock> lockGuard(this->lock);
+		std::lock_guard<RWLock> lockGuard(this->lock);
 
-		//extract
-		char * base = (char*)mapping->getAddress();
-		size_t size = mapping->getSize();
+		for (size_t i = 0 ; i < count ; i++) {
+			//extract
+			char * base = (char*)mappings[i]->getAddress();
+			size_t size = mappings[i]->getSize();
 
-		//build
-		MappingRegistryEntry entry = {
-			mapping,
-			base,
-			base + size,
-		};
+			//build
+			MappingRegistryEntry entry = {
+				mappings[i],
+				base,
+				base + size,
+			};
 
-		//register
-		this->entries.push_back(entry);
+			//register
+			this->entries[base] = entry;
+		}
 	}
 }
 
@@ -72,20 +88,16 @@ void MappingRegistry::registerMapping(Mapping * mapping)
 **/
 bool MappingRegistry::contain(Mapping * mapping)
 {
+	//check
+	assert(mapping != NULL);
+
 	//CRITICAL SECTION
 	{
-		std::lock_guard<Spinlock> lockGuard(this->lock);
-
-		//check
-		assert(mapping != NULL);
-
-		//loop all
-		for (auto it : this->entries)
-			if (it.mapping == mapping)
-				return true;
-		
-		//not found
-		return false;
+		std::lock_guard<RWLock> lockGuard(this->lock);
+
+		//search
+		auto it = this->entries.find((char*)mapping->getAddress());
+		return (it != this->entries.end() && it->second.mapping == mapping);
 	}
 }
 
@@ -101,16 +113,45 @@ void MappingRegistry::unregisterMapping(Mapping * mapping)
 
 	//CRITICAL SECTION
 	{
-		std::lock_guard<Spinlock> lockGuard(this->lock);
+		std::lock_guard<RWLock> lockGuard(this->lock);
 
-		//loop
-		for (auto it = entries.begin() ; it != entries.end() ; ++it) {
-			if (it->mapping == mapping) {
-				auto tmp = it;
-				++it;
-				entries.erase(tmp);
-			}
-		}
+		//search
+		auto it = this->entries.find((char*)mapping->getAddress());
+		if (it != this->entries.end() && it->second.mapping == mapping)
+			this->entries.erase(it);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Update the entry of a mapping which has been resized or moved (see Mapping::remap()).
+ * @param mapping Pointer to the mapping to update.
+ * @param oldBase Base address of the mapping before the change.
+**/
+void MappingRegistry::updateMapping(Mapping * mapping, void * oldBase)
+{
+	//check
+	assert(mapping != NULL);
+
+	//CRITICAL SECTION
+	{
+		std::lock_guard<RWLock> lockGuard(this->lock);
+
+		//remove old
+		auto it = this->entries.find((char*)oldBase);
+		if (it != this->entries.end() && it->second.mapping == mapping)
+			this->entries.erase(it);
+
+		//build
+		char * base = (char*)mapping->getAddress();
+		MappingRegistryEntry entry = {
+			mapping,
+			base,
+			base + mapping->getSize(),
+		};
+
+		//register
+		this->entries[base] = entry;
 	}
 }
 
@@ -127,16 +168,46 @@ Mapping * MappingRegistry::getMapping(void * addr)
 
 	//CRITICAL SECTION
 	{
-		std::lock_guard<Spinlock> lockGuard(this->lock);
+		this->lock.lockShared();
+
+		//search the last mapping starting before addr
+		Mapping * res = NULL;
+		auto it = this->entries.upper_bound((char*)addr);
+		if (it != this->entries.begin()) {
+			--it;
+			if (addr >= it->second.base && addr < it->second.end)
+				res = it->second.mapping;
+		}
+
+		this->lock.unlockShared();
+		return res;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the list of mappings using the given global policy.
+ * @param policy The global policy to search.
+**/
+std::vector<Mapping *> MappingRegistry::getMappingsWithPolicy(Policy * policy)
+{
+	//vars
+	std::vector<Mapping *> res;
+
+	//CRITICAL SECTION
+	{
+		this->lock.lockShared();
 
 		//loop
-		for (auto it : this->entries)
-			if (addr >= it.base && addr < it.end)
-				return it.mapping;
-		
-		//not found
-		return NULL;
+		for (auto & it : this->entries)
+			if (it.second.mapping->getGlobalPolicy() == policy)
+				res.push_back(it.second.mapping);
+
+		this->lock.unlockShared();
 	}
+
+	//ret
+	return res;
 }
 
 /*******************  FUNCTION  *********************/
@@ -147,11 +218,11 @@ void MappingRegistry::deleteAllMappings(void)
 {
 	//CRITICAL SECTION
 	{
-		std::lock_guard<Spinlock> lockGuard(this->lock);
+		std::lock_guard<RWLock> lockGuard(this->lock);
 
 		//loop to delete
-		for (auto it : this->entries)
-			delete it.mapping;
+		for (auto & it : this->entries)
+			delete it.second.mapping;
 
 		//clear all
 		this->entries.clear();
@@ -166,7 +237,7 @@ bool MappingRegistry::isEmpty(void)
 {
 	//CRITICAL SECTION
 	{
-		std::lock_guard<Spinlock> lockGuard(this->lock);
+		std::lock_guard<RWLock> lockGuard(this->lock);
 		return this->entries.empty();
 	}
 }
@@ -179,8 +250,8 @@ bool MappingRegistry::isEmpty(void)
 void ummapio::convertToJson(htopml::JsonState & json,const MappingRegistry & value)
 {
 	json.openArray();
-	for (auto it : value.entries)
-		json.printValue(*it.mapping);
+	for (auto & it : value.entries)
+		json.printValue(*it.second.mapping);
 	json.closeArray();
 }
 #endif //HAVE_HTOPML
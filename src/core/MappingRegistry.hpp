@@ -11,13 +11,14 @@
 //config
 #include "config.h"
 //std
-#include <list>
+#include <map>
+#include <vector>
 //htopml
 #ifdef HAVE_HTOPML
 #include <htopml/JsonState.h>
 #endif
 //local
-#include "portability/Spinlock.hpp"
+#include "portability/RWLock.hpp"
 #include "Mapping.hpp"
 
 /********************  NAMESPACE  *******************/
@@ -40,7 +41,9 @@ struct MappingRegistryEntry
 
 /*********************  CLASS  **********************/
 /**
- * Class to implement a registry of all the active mappings.
+ * Class to implement a registry of all the active mappings. The entries are
+ * sorted by base address so the lookups made on each segmentation fault and
+ * the (un)registrations stay in O(log n) with hundreds of thousands of mappings.
 **/
 class MappingRegistry
 {
@@ -48,10 +51,13 @@ class MappingRegistry
 		MappingRegistry(void);
 		~MappingRegistry(void);
 		void registerMapping(Mapping * mapping);
+		void registerMappings(Mapping ** mappings, size_t count);
 		void unregisterMapping(Mapping * mapping);
+		void updateMapping(Mapping * mapping, void * oldBase);
 		void deleteAllMappings(void);
 		bool isEmpty(void);
 		Mapping * getMapping(void * addr);
+		std::vector<Mapping *> getMappingsWithPolicy(Policy * policy);
 	public:
 		#ifdef HAVE_HTOPML
 		friend void convertToJson(htopml::JsonState & json,const MappingRegistry & value);
@@ -59,10 +65,13 @@ class MappingRegistry
 	private:
 		bool contain(Mapping * mapping);
 	private:
-		/** Spinlock to protect the registry from concurrent accesses. **/
-		Spinlock lock;
-		/** List of entries **/
-		std::list<MappingRegistryEntry> entries;
+		/**
+		 * Protect the registry from concurrent accesses, the lookups take it in shared mode
+		 * so the faults on different mappings do not serialize.
+		**/
+		mutable RWLock lock;
+		/** Entries indexed by their base address. **/
+		std::map<char *, MappingRegistryEntry> entries;
 };
 
 /*******************  FUNCTION  *********************/
@@ -0,0 +1,125 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cassert>
+//internal
+#include "../portability/OS.hpp"
+//local
+#include "MappingStats.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/********************  GLOBALS  *********************/
+/** Used to give an ID to each thread updating the counters. **/
+static std::atomic<size_t> gblNextThreadSlot(0);
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor, allocate the pointers of one slot per CPU, the slots
+ * themselves are allocated on first use.
+**/
+MappingStats::MappingStats(void)
+{
+	this->slotsCnt = OS::cpuNumber();
+	if (this->slotsCnt == 0)
+		this->slotsCnt = 1;
+	this->slots = new std::atomic<Slot*>[this->slotsCnt];
+	for (size_t i = 0 ; i < this->slotsCnt ; i++)
+		this->slots[i].store(NULL, std::memory_order_relaxed);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor, free the slots.
+**/
+MappingStats::~MappingStats(void)
+{
+	for (size_t i = 0 ; i < this->slotsCnt ; i++)
+		delete this->slots[i].load(std::memory_order_relaxed);
+	delete [] this->slots;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Allocate the given slot if not already done by another thread.
+ * @param id ID of the slot.
+ * @return Pointer to the slot.
+**/
+MappingStats::Slot * MappingStats::allocateSlot(size_t id)
+{
+	//allocate with reset counters
+	Slot * ptr = new Slot;
+	for (int c = 0 ; c < STATS_COUNTERS ; c++)
+		ptr->counters[c].store(0, std::memory_order_relaxed);
+
+	//register, another thread of the same slot might race with us
+	Slot * expected = NULL;
+	if (this->slots[id].compare_exchange_strong(expected, ptr, std::memory_order_acq_rel)) {
+		return ptr;
+	} else {
+		delete ptr;
+		return expected;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the ID of the current thread used to select a slot.
+**/
+size_t MappingStats::getThreadSlot(void)
+{
+	static thread_local size_t slot = gblNextThreadSlot.fetch_add(1, std::memory_order_relaxed);
+	return slot;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Increment a counter in the slot of the current thread.
+ * @param counter The counter to increment.
+ * @param value Value to add.
+**/
+void MappingStats::inc(MappingStatsCounter counter, size_t value)
+{
+	assert(counter < STATS_COUNTERS);
+	size_t id = getThreadSlot() % this->slotsCnt;
+	Slot * slot = this->slots[id].load(std::memory_order_acquire);
+	if (slot == NULL)
+		slot = this->allocateSlot(id);
+	slot->counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Sum the value of a counter over all the slots.
+ * @param counter The counter to read.
+**/
+size_t MappingStats::get(MappingStatsCounter counter) const
+{
+	assert(counter < STATS_COUNTERS);
+	size_t sum = 0;
+	for (size_t i = 0 ; i < this->slotsCnt ; i++) {
+		const Slot * slot = this->slots[i].load(std::memory_order_acquire);
+		if (slot != NULL)
+			sum += slot->counters[counter].load(std::memory_order_relaxed);
+	}
+	return sum;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the memory used by the counters.
+**/
+size_t MappingStats::getMemory(void) const
+{
+	size_t memory = this->slotsCnt * sizeof(std::atomic<Slot*>);
+	for (size_t i = 0 ; i < this->slotsCnt ; i++)
+		if (this->slots[i].load(std::memory_order_relaxed) != NULL)
+			memory += sizeof(Slot);
+	return memory;
+}
@@ -0,0 +1,88 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_MAPPING_STATS_HPP
+#define UMMAP_MAPPING_STATS_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <atomic>
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  ENUM  ***********************/
+/**
+ * List of the event counters tracked by MappingStats.
+**/
+enum MappingStatsCounter
+{
+	/** Number of segmentation faults due to a read access. **/
+	STATS_READ_FAULTS,
+	/** Number of segmentation faults due to a write access. **/
+	STATS_WRITE_FAULTS,
+	/** Number of faults on a segment which has been evicted before. **/
+	STATS_REFAULTS,
+	/** Bytes read from the driver. **/
+	STATS_READ_BYTES,
+	/** Bytes written to the driver. **/
+	STATS_WRITTEN_BYTES,
+	/** Number of segments evicted without needing a write. **/
+	STATS_CLEAN_EVICTIONS,
+	/** Number of segments evicted after being written. **/
+	STATS_DIRTY_EVICTIONS,
+	/** Number of flush operations. **/
+	STATS_FLUSHES,
+	/** Number of segments loaded in advance by the fault-around. **/
+	STATS_FAULT_AROUND,
+	/** Number of segments mapped from the shared cache without reading the storage. **/
+	STATS_CACHE_HITS,
+	/** Number of counters, keep it last. **/
+	STATS_COUNTERS
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Event counters of a mapping. To avoid contention between the threads
+ * handling the faults the counters are split in slots, each thread
+ * updating the one selected by its thread ID. The values are summed
+ * when reading them. Only the slot pointers are allocated with the mapping,
+ * a slot is allocated on the first update from one of its threads so a
+ * mapping used by few threads does not pay one slot per CPU.
+**/
+class MappingStats
+{
+	public:
+		MappingStats(void);
+		~MappingStats(void);
+		void inc(MappingStatsCounter counter, size_t value = 1);
+		size_t get(MappingStatsCounter counter) const;
+		size_t getMemory(void) const;
+	private:
+		static size_t getThreadSlot(void);
+	private:
+		/** Counters of a slot, padded to a cache line to avoid false sharing. **/
+		struct Slot
+		{
+			/** The counters. **/
+			std::atomic<size_t> counters[STATS_COUNTERS];
+			/** Padding to reach the next cache line. **/
+			char padding[64 - (STATS_COUNTERS * sizeof(size_t)) % 64];
+		};
+	private:
+		Slot * allocateSlot(size_t id);
+	private:
+		/** Pointers to the counter slots, NULL if not yet allocated. **/
+		std::atomic<Slot*> * slots;
+		/** Number of slots. **/
+		size_t slotsCnt;
+};
+
+}
+
+#endif //UMMAP_MAPPING_STATS_HPP
@@ -0,0 +1,335 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cassert>
+#include <algorithm>
+//internal
+#include "../common/Debug.hpp"
+//local
+#include "MissRatioCurve.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the estimator.
+ * @param maxMemory Maximum memory of the policy, the curve covers twice it.
+ * @param sampling Sampling period, 1 segment over sampling is tracked at start.
+ * @param maxKeys Maximal number of tracked segments before lowering the sampling rate.
+**/
+MissRatioCurve::MissRatioCurve(size_t maxMemory, unsigned int sampling, size_t maxKeys)
+{
+	//check
+	assume(sampling > 0, "Invalid sampling period for the miss-ratio curve, it must not be 0 !");
+	assume(maxKeys > 0, "Invalid maximal number of segments for the miss-ratio curve, it must not be 0 !");
+
+	//setup
+	this->threshold = std::max(UMMAP_MRC_MODULUS / sampling, 1U);
+	this->maxKeys = maxKeys;
+	this->bucketSize = std::max(2 * maxMemory / UMMAP_MRC_BUCKETS, (size_t)1);
+	this->histogram.resize(UMMAP_MRC_BUCKETS, 0.0);
+	this->far = 0.0;
+	this->cold = 0.0;
+	this->now = 0;
+	this->tree.resize(4096 + 1, 0);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the estimator.
+**/
+MissRatioCurve::~MissRatioCurve(void)
+{
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Hash a segment to decide if it is sampled.
+ * @param owner Mapping of the segment.
+ * @param index Index of the segment in the mapping.
+**/
+uint64_t MissRatioCurve::hash(const void * owner, size_t index)
+{
+	//splitmix64 finalizer
+	uint64_t value = ((uint64_t)(uintptr_t)owner * 0x9E3779B97F4A7C15ULL) ^ index;
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	return value ^ (value >> 31);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Register an access to a segment. The not sampled segments return
+ * immediately without taking the lock.
+ * @param owner Mapping of the segment.
+ * @param index Index of the segment in the mapping.
+ * @param segmentSize Size of the segments of the mapping.
+**/
+void MissRatioCurve::access(const void * owner, size_t index, size_t segmentSize)
+{
+	//not sampled
+	const uint64_t key = hash(owner, index);
+	const uint32_t low = key % UMMAP_MRC_MODULUS;
+	if (low >= this->threshold.load(std::memory_order_relaxed))
+		return;
+
+	//CRITICAL SECTION
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+	//the rate might have changed meanwhile
+	if (low >= this->threshold)
+		return;
+
+	//each sample accounts for 1/rate accesses
+	const double rate = (double)this->threshold / UMMAP_MRC_MODULUS;
+	const double weight = 1.0 / rate;
+
+	//compute the reuse distance
+	auto it = this->entries.find(key);
+	if (it != this->entries.end()) {
+		//distinct sampled segments accessed since the last access
+		size_t distance = this->treeSum(this->now) - this->treeSum(it->second.time);
+		this->treeAdd(it->second.time, -1);
+
+		//memory needed to keep the segment resident
+		size_t required = (size_t)((distance / rate + 1.0) * segmentSize);
+		size_t bucket = (required - 1) / this->bucketSize;
+		if (bucket < this->histogram.size())
+			this->histogram[bucket] += weight;
+		else
+			this->far += weight;
+	} else {
+		//first access
+		this->cold += weight;
+
+		//make room
+		if (this->entries.size() >= this->maxKeys) {
+			this->halveRate();
+			if (low >= this->threshold)
+				return;
+		}
+	}
+
+	//move time
+	if (this->now + 1 >= this->tree.size())
+		this->compact();
+	this->now++;
+
+	//mark the access
+	this->treeAdd(this->now, 1);
+	MissRatioCurveEntry entry = {this->now, low};
+	this->entries[key] = entry;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Halve the sampling rate and forget the segments not sampled anymore. The
+ * caller must hold the lock.
+**/
+void MissRatioCurve::halveRate(void)
+{
+	//cannot go lower
+	if (this->threshold <= 1)
+		return;
+
+	//update
+	this->threshold = this->threshold / 2;
+
+	//remove
+	for (auto it = this->entries.begin() ; it != this->entries.end() ; ) {
+		if (it->second.hash >= this->threshold) {
+			this->treeAdd(it->second.time, -1);
+			it = this->entries.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Renumber the times of the tracked segments from 1 when reaching the end of
+ * the tree. The tree is sized to several times the tracked segments so it
+ * happens rarely. The caller must hold the lock.
+**/
+void MissRatioCurve::compact(void)
+{
+	//sort by time
+	std::vector<std::pair<size_t, uint64_t> > order;
+	order.reserve(this->entries.size());
+	for (auto & it : this->entries)
+		order.push_back(std::make_pair(it.second.time, it.first));
+	std::sort(order.begin(), order.end());
+
+	//rebuild
+	this->tree.assign(std::max(4 * order.size(), (size_t)4096) + 1, 0);
+	for (size_t i = 0 ; i < order.size() ; i++) {
+		this->entries[order[i].second].time = i + 1;
+		this->treeAdd(i + 1, 1);
+	}
+
+	//update
+	this->now = order.size();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Add the given value at the given time in the Fenwick tree.
+**/
+void MissRatioCurve::treeAdd(size_t time, int value)
+{
+	assert(time > 0);
+	for ( ; time < this->tree.size() ; time += time & (~time + 1))
+		this->tree[time] += value;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of marked times lower or equal to the given one.
+**/
+size_t MissRatioCurve::treeSum(size_t time) const
+{
+	long sum = 0;
+	for ( ; time > 0 ; time -= time & (~time + 1))
+		sum += this->tree[time];
+	assert(sum >= 0);
+	return sum;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the estimated accesses which would hit with the given memory. The
+ * caller must hold the lock.
+ * @param memory The memory budget in bytes.
+**/
+double MissRatioCurve::getHits(size_t memory) const
+{
+	//full buckets
+	double hits = 0.0;
+	size_t full = std::min(memory / this->bucketSize, this->histogram.size());
+	for (size_t i = 0 ; i < full ; i++)
+		hits += this->histogram[i];
+
+	//interpolate the last one
+	if (full < this->histogram.size())
+		hits += this->histogram[full] * (double)(memory % this->bucketSize) / this->bucketSize;
+
+	//ok
+	return hits;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the estimated fraction of the current faults which would remain with
+ * the given memory.
+ * @param memory The memory budget in bytes.
+ * @return The ratio between 0 and 1, 0 if no access has been seen yet.
+**/
+double MissRatioCurve::getMissRatio(size_t memory)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	double total = this->getTotal();
+	if (total == 0.0)
+		return 0.0;
+	return (total - this->getHits(memory)) / total;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Fill the points of the curve, they are evenly spread up to twice the maximum
+ * memory of the policy.
+ * @param points Array to fill.
+ * @param maxPoints Size of the array.
+ * @return Number of points filled.
+**/
+size_t MissRatioCurve::getCurve(ummap_mrc_point_t * points, size_t maxPoints)
+{
+	//check
+	assert(points != NULL || maxPoints == 0);
+
+	//nothing to do
+	if (maxPoints == 0)
+		return 0;
+
+	//CRITICAL SECTION
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+	//fill
+	const size_t buckets = this->histogram.size();
+	const size_t step = (buckets + maxPoints - 1) / maxPoints;
+	const double total = this->getTotal();
+	size_t cnt = 0;
+	for (size_t i = step - 1 ; i < buckets ; i += step) {
+		size_t memory = (i + 1) * this->bucketSize;
+		points[cnt].memory = memory;
+		points[cnt].miss_ratio = (total == 0.0) ? 0.0 : (total - this->getHits(memory)) / total;
+		cnt++;
+	}
+
+	//ok
+	return cnt;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Sum the estimated accesses, the histogram is small so it is done on demand.
+ * The caller must hold the lock.
+**/
+double MissRatioCurve::getTotal(void) const
+{
+	double total = this->cold + this->far;
+	for (auto value : this->histogram)
+		total += value;
+	return total;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the estimated number of accesses seen by the estimator.
+**/
+double MissRatioCurve::getAccesses(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	return this->getTotal();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the current sampling rate.
+**/
+double MissRatioCurve::getSamplingRate(void)
+{
+	return (double)this->threshold / UMMAP_MRC_MODULUS;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of currently tracked segments.
+**/
+size_t MissRatioCurve::getTrackedSegments(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	return this->entries.size();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Forget all the accesses, for example to follow a new phase of the application.
+ * The sampling rate is kept.
+**/
+void MissRatioCurve::reset(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	this->entries.clear();
+	this->tree.assign(4096 + 1, 0);
+	this->now = 0;
+	std::fill(this->histogram.begin(), this->histogram.end(), 0.0);
+	this->far = 0.0;
+	this->cold = 0.0;
+}
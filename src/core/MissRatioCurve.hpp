@@ -0,0 +1,109 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_MISS_RATIO_CURVE_HPP
+#define UMMAP_MISS_RATIO_CURVE_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+//internal
+#include "public-api/ummap.h"
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  DEFINES  ********************/
+/** Default sampling period, 1 segment over UMMAP_MRC_DEFAULT_SAMPLING is tracked. **/
+#define UMMAP_MRC_DEFAULT_SAMPLING 64
+/** Maximal number of sampled segments tracked before lowering the sampling rate. **/
+#define UMMAP_MRC_MAX_KEYS 65536
+/** Number of points of the curve, they cover twice the policy maximum memory. **/
+#define UMMAP_MRC_BUCKETS 64
+/** Modulus used to compare the hash of the segments to the sampling threshold. **/
+#define UMMAP_MRC_MODULUS (1U << 24)
+
+/*********************  STRUCT  *********************/
+/**
+ * Last access of a sampled segment.
+**/
+struct MissRatioCurveEntry
+{
+	/** Logical time of the last access (position in the tree). **/
+	size_t time;
+	/** Hash of the segment modulo UMMAP_MRC_MODULUS to be compared to the threshold. **/
+	uint32_t hash;
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Online estimation of the miss-ratio curve of a policy by measuring the reuse
+ * distance of the faults with spatially hashed sampling (SHARDS). Only the
+ * segments whose hash is under a threshold are tracked, and their reuse distance
+ * (number of distinct sampled segments accessed since their last access, scaled
+ * by the sampling rate) tells the memory needed to keep them resident.
+ *
+ * The accesses seen by ummap are the faults, the accesses to resident segments
+ * are not visible. The curve therefore tells the fraction of the current faults
+ * which would remain with a given memory: it is accurate for budgets larger than
+ * the current one and a lower bound for the smaller ones.
+ *
+ * The number of tracked segments is bounded, the threshold is halved each time
+ * it is reached (fixed-size SHARDS). The histogram counts are already scaled by
+ * the rate at which they were sampled so they do not need to be adjusted.
+**/
+class MissRatioCurve
+{
+	public:
+		MissRatioCurve(size_t maxMemory, unsigned int sampling = UMMAP_MRC_DEFAULT_SAMPLING, size_t maxKeys = UMMAP_MRC_MAX_KEYS);
+		~MissRatioCurve(void);
+		void access(const void * owner, size_t index, size_t segmentSize);
+		double getMissRatio(size_t memory);
+		size_t getCurve(ummap_mrc_point_t * points, size_t maxPoints);
+		double getAccesses(void);
+		double getSamplingRate(void);
+		size_t getTrackedSegments(void);
+		void reset(void);
+	private:
+		static uint64_t hash(const void * owner, size_t index);
+		double getHits(size_t memory) const;
+		double getTotal(void) const;
+		void halveRate(void);
+		void compact(void);
+		void treeAdd(size_t time, int value);
+		size_t treeSum(size_t time) const;
+	private:
+		/** Sampled segments indexed by their hash. **/
+		std::unordered_map<uint64_t, MissRatioCurveEntry> entries;
+		/** Fenwick tree marking the times of the last access of the sampled segments. **/
+		std::vector<int> tree;
+		/** Current logical time, incremented on each sampled access. **/
+		size_t now;
+		/** A segment is sampled if its hash modulo UMMAP_MRC_MODULUS is lower, read without lock by access(). **/
+		std::atomic<uint32_t> threshold;
+		/** Maximal number of tracked segments. **/
+		size_t maxKeys;
+		/** Memory covered by a bucket of the histogram. **/
+		size_t bucketSize;
+		/** Estimated accesses by memory needed to hit, in buckets of bucketSize. **/
+		std::vector<double> histogram;
+		/** Estimated accesses needing more memory than the histogram covers. **/
+		double far;
+		/** Estimated accesses to segments seen for the first time. **/
+		double cold;
+		/** Protect the state as the faults are handled by several threads. **/
+		std::mutex mutex;
+};
+
+}
+
+#endif //UMMAP_MISS_RATIO_CURVE_HPP
@@ -8,6 +8,7 @@
 //std
 #include <mutex>
 #include <cassert>
+#include <cstring>
 //internal
 #include "../common/Debug.hpp"
 //local
@@ -31,6 +32,11 @@ Policy::Policy(size_t staticMaxMemory, bool local)
 	this->local = local;
 	this->policyQuota = NULL;
 	this->mutexPtr = &this->localMutex;
+	this->registeredSegmentsMemory = 0;
+	this->pinnedMemory = 0;
+	this->maxPinnedMemory = staticMaxMemory / UMMAP_POLICY_PIN_RATIO;
+	this->missRatioCurve = NULL;
+	this->memorySnapshot.store(0);
 }
 
 /*******************  FUNCTION  *********************/
@@ -43,6 +49,10 @@ Policy::~Policy(void)
 		policyQuota->unregisterPolicy(this);
 		policyQuota = NULL;
 	}
+	if (missRatioCurve != NULL) {
+		delete missRatioCurve;
+		missRatioCurve = NULL;
+	}
 }
 
 /*******************  FUNCTION  *********************/
@@ -79,6 +89,7 @@ void Policy::registerMapping(Mapping * mapping, void * storage, size_t elementCo
 		elementCount,
 		elementSize,
 		extraInfos,
+		0,
 	};
 
 	//check
@@ -90,7 +101,19 @@ void Policy::registerMapping(Mapping * mapping, void * storage, size_t elementCo
 	//register, CRITICAL SECTION
 	{
 		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
-		this->storageRegistry.push_back(entry);
+
+		//assign an ID
+		if (this->freeMappingIds.empty()) {
+			entry.id = this->mappingIds.size();
+			this->mappingIds.push_back(mapping);
+		} else {
+			entry.id = this->freeMappingIds.back();
+			this->freeMappingIds.pop_back();
+			this->mappingIds[entry.id] = mapping;
+		}
+
+		this->storageRegistry[mapping] = entry;
+		this->registeredSegmentsMemory += mapping->getSegmentSize();
 		assume(checkHasEnoughMem(), "You registry too many mappings to the same policy, "
 			"it does not allow to have at least one segment per mapping, this can crash the node !");
 	}
@@ -102,15 +125,7 @@ void Policy::registerMapping(Mapping * mapping, void * storage, size_t elementCo
 **/
 bool Policy::checkHasEnoughMem(void)
 {
-	//var
-	size_t sum = 0;
-
-	//loop
-	for (auto & it : this->storageRegistry)
-		sum += it.mapping->getSegmentSize();
-
-	//check
-	return (sum <= this->dynamicMaxMemory);
+	return (this->registeredSegmentsMemory <= this->dynamicMaxMemory);
 }
 
 /*******************  FUNCTION  *********************/
@@ -138,9 +153,9 @@ PolicyStorage Policy::getStorageInfo(void * entry)
 	std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
 	//loop to search
-	for (auto it : this->storageRegistry) {
-		if (contains(it, entry)) {
-			res = it;
+	for (auto & it : this->storageRegistry) {
+		if (contains(it.second, entry)) {
+			res = it.second;
 			break;
 		}
 	}
@@ -167,20 +182,17 @@ PolicyStorage Policy::getStorageInfo(Mapping * mapping)
 
 	if (local) {
 		assume(this->storageRegistry.size() == 1, "Invalid local list with multiple mapping registered !");
-		PolicyStorage res = this->storageRegistry.front();
+		PolicyStorage res = this->storageRegistry.begin()->second;
 		assert(res.mapping == mapping);
 		return res;
 	} else {
 		//start CRITICAL SECTION
 		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
-		//loop to search
-		for (auto it : this->storageRegistry) {
-			if (it.mapping == mapping) {
-				res = it;
-				break;
-			}
-		}
+		//search
+		auto it = this->storageRegistry.find(mapping);
+		if (it != this->storageRegistry.end())
+			res = it->second;
 	}
 
 	//not found
@@ -201,16 +213,58 @@ void Policy::unregisterMapping(Mapping * mapping)
 	//start CRITICAL SECTION
 	std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
-	//loop
-	for (auto it = storageRegistry.begin() ; it != storageRegistry.end() ; ++it) {
-		if (it->mapping == mapping) {
-			auto tmp = it;
-			++it;
-			storageRegistry.erase(tmp);
-		};
+	//search
+	auto it = this->storageRegistry.find(mapping);
+	if (it != this->storageRegistry.end()) {
+		//release ID
+		this->mappingIds[it->second.id] = NULL;
+		this->freeMappingIds.push_back(it->second.id);
+
+		//remove
+		this->registeredSegmentsMemory -= mapping->getSegmentSize();
+		this->storageRegistry.erase(it);
 	}
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Update the number of segments of a mapping resized by Mapping::remap(). The
+ * removed segments must have been evicted before so they are no more in the
+ * lists. The policies keeping no per segment elements do not need to override it.
+ * @param mapping The resized mapping.
+ * @param segmentCount The new number of segments in the mapping.
+**/
+void Policy::resizeElementStorage(Mapping * mapping, size_t segmentCount)
+{
+	//check
+	assumeArg(segmentCount <= UINT32_MAX, "Too many segments to be handled by the policy : %1").arg(segmentCount).end();
+
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
+
+		//search
+		auto it = this->storageRegistry.find(mapping);
+		assume(it != this->storageRegistry.end(), "Fail to found policy of given mapping !");
+		assume(it->second.elements == NULL, "Policy storing per segment elements should override resizeElementStorage() !");
+
+		//update
+		it->second.elementCount = segmentCount;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the mapping registered with the given compact ID.
+ * @param id The compact ID of the mapping (see PolicyStorage::id).
+**/
+Mapping * Policy::getMappingFromId(uint32_t id)
+{
+	assert(id < this->mappingIds.size());
+	assert(this->mappingIds[id] != NULL);
+	return this->mappingIds[id];
+}
+
 /*******************  FUNCTION  *********************/
 /**
  * Associate the URI used to build the policy to keep track and report it to htopml.
@@ -262,3 +316,225 @@ size_t Policy::getStaticMaxMemory(void)
 {
 	return this->staticMaxMemory;
 }
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the maximum memory currently allowed by the quota.
+**/
+size_t Policy::getDynamicMaxMemory(void)
+{
+	return this->dynamicMaxMemory;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the memory last published by the policy. It can be read without any
+ * lock by the quota background thread, it is only refreshed when the policy
+ * grows or shrinks so it can be a bit higher than the current memory.
+**/
+size_t Policy::getMemorySnapshot(void) const
+{
+	return this->memorySnapshot.load(std::memory_order_relaxed);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Publish the current memory for the quota (see getMemorySnapshot()). The
+ * caller must hold the policy lock.
+**/
+void Policy::publishMemory(void)
+{
+	this->memorySnapshot.store(this->getCurrentMemory(), std::memory_order_relaxed);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the memory which can still be used before the policy starts to evict.
+ * It is read without lock so it is only a hint for the speculative loads.
+**/
+size_t Policy::getFreeMemory(void)
+{
+	size_t current = this->getCurrentMemory();
+	if (current < this->dynamicMaxMemory)
+		return this->dynamicMaxMemory - current;
+	else
+		return 0;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Pin all the not yet pinned segments of the given range with a single update
+ * of the policy. The segments are locked by the caller.
+ * @param mapping The mapping of the segments.
+ * @param firstId First segment of the range.
+ * @param endId Segment after the last one of the range.
+ * @return False if the range does not fit in the pin budget, nothing is pinned.
+**/
+bool Policy::notifyPinRange(Mapping * mapping, size_t firstId, size_t endId)
+{
+	//take lock
+	std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
+
+	//count
+	size_t count = 0;
+	for (size_t id = firstId ; id < endId ; id++)
+		if (mapping->isPinned(id) == false)
+			count++;
+
+	//check budget
+	if (this->pinnedMemory + count * mapping->getSegmentSize() > this->maxPinnedMemory)
+		return false;
+
+	//pin
+	for (size_t id = firstId ; id < endId ; id++) {
+		if (mapping->isPinned(id) == false) {
+			bool status = this->notifyPin(mapping, id);
+			assume(status, "Fail to pin a segment after checking the budget !");
+		}
+	}
+
+	//ok
+	return true;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Revert notifyPinRange() when the other policy failed to pin the range. The
+ * pinned flag of the segments is not yet set by the mapping.
+ * @param mapping The mapping of the segments.
+ * @param firstId First segment of the range.
+ * @param endId Segment after the last one of the range.
+**/
+void Policy::notifyUnpinRange(Mapping * mapping, size_t firstId, size_t endId)
+{
+	//take lock
+	std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
+
+	//unpin
+	for (size_t id = firstId ; id < endId ; id++)
+		if (mapping->isPinned(id) == false)
+			this->notifyUnpin(mapping, id);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Define the maximum memory which can be pinned in the policy. It does not
+ * unpin the already pinned segments if lower than the current pinned memory.
+ * @param maxPinnedMemory The budget in bytes.
+**/
+void Policy::setMaxPinnedMemory(size_t maxPinnedMemory)
+{
+	std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
+	this->maxPinnedMemory = maxPinnedMemory;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the memory currently pinned in the policy.
+**/
+size_t Policy::getPinnedMemory(void) const
+{
+	return this->pinnedMemory;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Charge a segment being pinned if it fits in the pin budget. The caller must
+ * hold the policy mutex.
+ * @param size Size of the segment.
+ * @return False if over the budget.
+**/
+bool Policy::reservePinnedMemory(size_t size)
+{
+	if (this->pinnedMemory + size > this->maxPinnedMemory)
+		return false;
+	this->pinnedMemory += size;
+	return true;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release the charge of a segment being unpinned or evicted. The caller must
+ * hold the policy mutex.
+ * @param size Size of the segment.
+**/
+void Policy::releasePinnedMemory(size_t size)
+{
+	assert(this->pinnedMemory >= size);
+	this->pinnedMemory -= size;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Sum the counters of all the mappings handled by the policy.
+ * @param stats The struct to fill.
+**/
+void Policy::getStats(ummap_stats_t & stats)
+{
+	//reset
+	memset(&stats, 0, sizeof(stats));
+
+	//CRITICAL SECTION
+	{
+		//take lock
+		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
+
+		//sum
+		for (auto & it : this->storageRegistry) {
+			ummap_stats_t mappingStats;
+			it.second.mapping->getStats(mappingStats);
+			stats.read_faults += mappingStats.read_faults;
+			stats.write_faults += mappingStats.write_faults;
+			stats.refaults += mappingStats.refaults;
+			stats.read_bytes += mappingStats.read_bytes;
+			stats.written_bytes += mappingStats.written_bytes;
+			stats.clean_evictions += mappingStats.clean_evictions;
+			stats.dirty_evictions += mappingStats.dirty_evictions;
+			stats.flushes += mappingStats.flushes;
+			stats.fault_around += mappingStats.fault_around;
+			stats.cache_hits += mappingStats.cache_hits;
+			stats.resident_bytes += mappingStats.resident_bytes;
+			stats.dirty_bytes += mappingStats.dirty_bytes;
+			stats.pinned_bytes += mappingStats.pinned_bytes;
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Enable the estimation of the miss-ratio curve of the policy from the faults
+ * (see MissRatioCurve). If already enabled the estimation is reset. It should
+ * be called before attaching the mappings as the faults read the pointer without
+ * taking the lock.
+ * @param sampling Sampling period, 1 segment over sampling is tracked.
+**/
+void Policy::enableMissRatioCurve(unsigned int sampling)
+{
+	std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
+	if (this->missRatioCurve == NULL)
+		this->missRatioCurve = new MissRatioCurve(this->staticMaxMemory, sampling);
+	else
+		this->missRatioCurve->reset();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Register a fault loading a segment in the miss-ratio curve estimator if
+ * enabled. It is called by the mapping after notifyTouch().
+ * @param mapping The mapping of the segment.
+ * @param index Index of the segment in the mapping.
+**/
+void Policy::notifyMiss(Mapping * mapping, size_t index)
+{
+	if (this->missRatioCurve != NULL)
+		this->missRatioCurve->access(mapping, index, mapping->getSegmentSize());
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the miss-ratio curve estimator, NULL if not enabled.
+**/
+MissRatioCurve * Policy::getMissRatioCurve(void)
+{
+	return this->missRatioCurve;
+}
@@ -10,16 +10,25 @@
 /********************  HEADERS  *********************/
 //std
 #include <cstdlib>
-#include <list>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 #include <string>
 #include <mutex>
+#include <atomic>
 //internal
 #include "PolicyQuota.hpp"
+#include "MissRatioCurve.hpp"
+#include "public-api/ummap.h"
 
 /********************  NAMESPACE  *******************/
 namespace ummapio
 {
 
+/*********************  DEFINES  ********************/
+/** By default 1/UMMAP_POLICY_PIN_RATIO of the policy memory can be pinned. **/
+#define UMMAP_POLICY_PIN_RATIO 2
+
 /*********************  CLASS  **********************/
 class Mapping;
 
@@ -49,6 +58,11 @@ struct PolicyStorage
 	 * Optional extra infos to be used by the policy implementation.
 	**/
 	void * extraInfos;
+	/**
+	 * Compact ID of the mapping in the policy, used to reference it from the
+	 * segment lists (see getMappingFromId()).
+	**/
+	uint32_t id;
 };
 
 /*********************  CLASS  **********************/
@@ -77,8 +91,10 @@ class Policy
 		 * @param isWrite True if we are handling a write memory access
 		 * @param mapped If already mapped or a new mapping.
 		 * @param dirty If the segment was dirty.
+		 * @param speculative If the segment has been loaded in advance without being accessed
+		 * (fault-around) so it should be handled with low priority.
 		**/
-		virtual void notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty) = 0;
+		virtual void notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty, bool speculative) = 0;
 		/**
 		 * Notify an eviction from the mapping to update lists. This can append when
 		 * the other (local or global) policy generate an eviction.
@@ -86,11 +102,38 @@ class Policy
 		 * @param index Define the index of the segment to evict.
 		**/
 		virtual void notifyEvict(Mapping * mapping, size_t index) = 0;
+		/**
+		 * Notify a segment being pinned (see Mapping::pin()) to take it out of the eviction
+		 * lists. It stays charged to the policy memory. The segment is mapped and locked by
+		 * the caller.
+		 * @param mapping The mapping of the segment.
+		 * @param index Index of the segment in the mapping.
+		 * @return False if it exceeds the pin budget of the policy (see setMaxPinnedMemory()).
+		**/
+		virtual bool notifyPin(Mapping * mapping, size_t index) = 0;
+		/**
+		 * Notify a pinned segment being unpinned to insert it back in the eviction lists
+		 * if it is mapped, otherwise only its charge is released.
+		 * The caller has to call shrinkMemory() after unlocking the segment.
+		 * @param mapping The mapping of the segment.
+		 * @param index Index of the segment in the mapping.
+		**/
+		virtual void notifyUnpin(Mapping * mapping, size_t index) = 0;
+		/**
+		 * Notify a segment shared with other mappings (see SegmentCache) being charged
+		 * to the mapping because the mapping charged for it unmapped it. It is inserted
+		 * in the eviction lists if not already there but nothing is evicted as it is
+		 * called with the cache lock held, the policy shrinks on its next touch.
+		 * @param mapping The mapping of the segment.
+		 * @param index Index of the segment in the mapping.
+		**/
+		virtual void notifyCharge(Mapping * mapping, size_t index) = 0;
 		/**
 		 * Cleanup the element storage linked to the given memory mapping.
 		 * @param mapping The mapping we want to untrack.
 		**/
 		virtual void freeElementStorage(Mapping * mapping) = 0;
+		virtual void resizeElementStorage(Mapping * mapping, size_t segmentCount);
 		/**
 		 * Shrink the memory by evicting pages when the quota controller request it.
 		**/
@@ -106,12 +149,27 @@ class Policy
 		void setQuota(PolicyQuota * quota);
 		void setDynamicMaxMemory(size_t dyanmicMaxMemory);
 		size_t getStaticMaxMemory(void);
+		size_t getDynamicMaxMemory(void);
+		size_t getMemorySnapshot(void) const;
+		size_t getFreeMemory(void);
+		bool notifyPinRange(Mapping * mapping, size_t firstId, size_t endId);
+		void notifyUnpinRange(Mapping * mapping, size_t firstId, size_t endId);
+		void setMaxPinnedMemory(size_t maxPinnedMemory);
+		size_t getPinnedMemory(void) const;
+		void getStats(ummap_stats_t & stats);
+		void enableMissRatioCurve(unsigned int sampling = UMMAP_MRC_DEFAULT_SAMPLING);
+		MissRatioCurve * getMissRatioCurve(void);
+		void notifyMiss(Mapping * mapping, size_t index);
 	protected:
 		void registerMapping(Mapping * mapping, void * storage, size_t elementCount, size_t elementSize, void * extraInfos = NULL);
 		void unregisterMapping(Mapping * mapping);
 		bool checkHasEnoughMem(void);
+		void publishMemory(void);
+		bool reservePinnedMemory(size_t size);
+		void releasePinnedMemory(size_t size);
 		PolicyStorage getStorageInfo(void * entry);
 		PolicyStorage getStorageInfo(Mapping * mapping);
+		Mapping * getMappingFromId(uint32_t id);
 		static bool contains(PolicyStorage & storage, void * entry);
 	protected:
 		/** Define if the policy is a local of global policy shared between multiple mappings. **/
@@ -123,8 +181,21 @@ class Policy
 		 * value can be modified by the quota and be max to staticMaxMemory. 
 		**/
 		size_t dynamicMaxMemory;
-		/** Keep track of state storage attached to each handle mappings. **/
-		std::list<PolicyStorage> storageRegistry;
+		/** Memory of the pinned segments, they are charged to the policy but not in its lists. **/
+		size_t pinnedMemory;
+		/** Maximum memory which can be pinned. **/
+		size_t maxPinnedMemory;
+		/**
+		 * Keep track of state storage attached to each handle mappings. It is a hash table so
+		 * the lookups done on each touch stay constant with many mappings.
+		**/
+		std::unordered_map<Mapping *, PolicyStorage> storageRegistry;
+		/** Sum of the segment size of the registered mappings (see checkHasEnoughMem()). **/
+		size_t registeredSegmentsMemory;
+		/** Mappings indexed by their compact ID (NULL for free IDs). **/
+		std::vector<Mapping *> mappingIds;
+		/** List of the released compact IDs to be reused. **/
+		std::vector<uint32_t> freeMappingIds;
 		/** 
 		 * Shared mutex to protect the access to the local states. It is a pointer so
 		 * we can share the mutex between the local and global policy if both are used.
@@ -139,6 +210,10 @@ class Policy
 		std::string uri;
 		/** Keep track of eventual policy quota **/
 		PolicyQuota * policyQuota;
+		/** Estimator of the miss-ratio curve (NULL if not enabled, see enableMissRatioCurve()). **/
+		MissRatioCurve * missRatioCurve;
+		/** Memory used by the policy published for the asynchronous quota (see publishMemory()). **/
+		std::atomic<size_t> memorySnapshot;
 };
 
 }
@@ -7,6 +7,7 @@
 /********************  HEADERS  *********************/
 //std
 #include <mutex>
+#include <chrono>
 #include <cassert>
 //internal
 #include "../common/Debug.hpp"
@@ -23,8 +24,13 @@ using namespace ummapio;
  * allow on the policies.
 **/
 PolicyQuota::PolicyQuota(size_t staticMaxMemory)
+	:async(false)
+	,postedEpoch(0)
+	,forcedChange(false)
 {
 	this->staticMaxMemory = staticMaxMemory;
+	this->handledEpoch = 0;
+	this->asyncStop = false;
 }
 
 /*******************  FUNCTION  *********************/
@@ -33,6 +39,9 @@ PolicyQuota::PolicyQuota(size_t staticMaxMemory)
 **/
 PolicyQuota::~PolicyQuota(void)
 {
+	//the derived classes must already have stopped it as it calls their update()
+	this->stopAsync();
+
 	//start CRITICAL SECTION
 	std::lock_guard<std::mutex> lockGuard(this->mutex);
 
@@ -40,6 +49,161 @@ PolicyQuota::~PolicyQuota(void)
 	assume(this->policies.empty(), "Try to delete a policy quota which still have policies registered to it !");
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Notify evictions made by a policy at its limit. The memory does not grow so
+ * update() is not called, but a quota balancing the memory on the policy
+ * behavior can use it to trigger a new distribution. Nothing is done by default.
+ * It is called out of the policy lock.
+ * @param count Number of evicted segments.
+**/
+void PolicyQuota::notifyEvictions(size_t count)
+{
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Called by the policies when their memory grows. In synchronous mode the
+ * quota is updated immediately, otherwise only a change is posted to the
+ * background thread so the fault path does not pay for the update.
+**/
+void PolicyQuota::notifyGrowth(void)
+{
+	if (this->async.load(std::memory_order_relaxed))
+		this->postChange();
+	else
+		this->update();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Post a change to the background thread. It does nothing else than
+ * incrementing the epoch so it is cheap to call from the fault path.
+ * @param force If true the background thread calls update() even if the
+ * snapshot of the policy memory fits in the quota (ie. the quota itself changed).
+ * @param wakeUp Wake up the background thread. Must be false when called from
+ * a signal handler, the change is then handled within UMMAP_QUOTA_ASYNC_PERIOD_MS.
+**/
+void PolicyQuota::postChange(bool force, bool wakeUp)
+{
+	if (force)
+		this->forcedChange.store(true, std::memory_order_relaxed);
+	this->postedEpoch.fetch_add(1, std::memory_order_release);
+	if (wakeUp)
+		this->asyncCond.notify_one();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Enable or disable the asynchronous mode. In this mode the memory used by the
+ * policies can exceed the quota until the background thread handles the change.
+ * @param enabled True to start the background thread, false to stop it.
+**/
+void PolicyQuota::setAsync(bool enabled)
+{
+	//stop
+	if (enabled == false) {
+		this->stopAsync();
+		return;
+	}
+
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::mutex> lockGuard(this->asyncMutex);
+
+		//already running
+		if (this->asyncThread.joinable())
+			return;
+
+		//start
+		this->asyncStop = false;
+		this->handledEpoch = this->postedEpoch.load();
+		this->asyncThread = std::thread(&PolicyQuota::runAsync, this);
+		this->async.store(true);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return true if the quota is updated by the background thread.
+**/
+bool PolicyQuota::isAsync(void) const
+{
+	return this->async.load(std::memory_order_relaxed);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Stop the background thread if running and come back to synchronous updates.
+ * The derived classes have to call it in their destructor.
+**/
+void PolicyQuota::stopAsync(void)
+{
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::mutex> lockGuard(this->asyncMutex);
+		if (this->asyncThread.joinable() == false)
+			return;
+		this->async.store(false);
+		this->asyncStop = true;
+	}
+
+	//wait
+	this->asyncCond.notify_one();
+	this->asyncThread.join();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Main loop of the background thread, it handles the changes posted since
+ * its last update.
+**/
+void PolicyQuota::runAsync(void)
+{
+	std::unique_lock<std::mutex> lock(this->asyncMutex);
+	while (this->asyncStop == false) {
+		//wait a change, the timeout catches the ones posted without waking up the thread
+		uint64_t epoch = this->postedEpoch.load(std::memory_order_acquire);
+		if (epoch == this->handledEpoch) {
+			this->asyncCond.wait_for(lock, std::chrono::milliseconds(UMMAP_QUOTA_ASYNC_PERIOD_MS));
+			continue;
+		}
+
+		//handle out of the lock not to block the posting threads
+		this->handledEpoch = epoch;
+		bool forced = this->forcedChange.exchange(false);
+		lock.unlock();
+		this->asyncUpdate(forced);
+		lock.lock();
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Sum the memory snapshots published by the policies (see Policy::getMemorySnapshot()).
+**/
+size_t PolicyQuota::getSnapshotMemory(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	size_t total = 0;
+	for (auto & it : this->policies)
+		total += it->getMemorySnapshot();
+	return total;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Called by the background thread for the changes posted since the last call.
+ * By default it calls update() only if the snapshot of the policy memory
+ * exceeds the quota so the quota lock is not taken for nothing.
+ * @param forced True if a posted change requires to call update() anyway.
+**/
+void PolicyQuota::asyncUpdate(bool forced)
+{
+	if (forced || this->getSnapshotMemory() > this->staticMaxMemory)
+		this->update();
+}
+
 /*******************  FUNCTION  *********************/
 /**
  * Register a new policy to the policy quota.
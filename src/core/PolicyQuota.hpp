@@ -10,14 +10,25 @@
 /********************  HEADERS  *********************/
 //std
 #include <cstdlib>
+#include <cstdint>
 #include <list>
 #include <string>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
 
 /********************  NAMESPACE  *******************/
 namespace ummapio
 {
 
+/*********************  DEFINES  ********************/
+/**
+ * Maximal delay (in ms) for the background thread to handle a change posted
+ * without waking it up (from a signal handler, see postChange()).
+**/
+#define UMMAP_QUOTA_ASYNC_PERIOD_MS 10
+
 /*********************  CLASS  **********************/
 class Policy;
 
@@ -26,6 +37,10 @@ class Policy;
  * Define a quota to be able to balance memory usage over several policies in
  * a balanced way opposite to the uncontrolled approach offerd by the policy
  * groups.
+ *
+ * By default the quota is updated by the faulting thread when a policy grows.
+ * In asynchronous mode (see setAsync()) the fault path only posts a change and
+ * a background thread does the update from a snapshot of the policy memory.
 **/
 class PolicyQuota
 {
@@ -33,11 +48,21 @@ class PolicyQuota
 		PolicyQuota(size_t staticMaxMemory);
 		virtual ~PolicyQuota(void);
 		virtual void update(void) = 0;
+		virtual void notifyEvictions(size_t count);
+		void notifyGrowth(void);
+		void postChange(bool force = false, bool wakeUp = true);
+		void setAsync(bool enabled);
+		bool isAsync(void) const;
 		void registerPolicy(Policy * policy);
-		void unregisterPolicy(Policy * policy);
+		virtual void unregisterPolicy(Policy * policy);
 		size_t getStaticMaxMemory(void) const {return this->staticMaxMemory;};
+	protected:
+		virtual void asyncUpdate(bool forced);
+		void stopAsync(void);
 	private:
 		void updateNotifyLimit(void);
+		void runAsync(void);
+		size_t getSnapshotMemory(void);
 	protected:
 		/** Keep track of maximum amount of memory to attach to this quota component. **/
 		size_t staticMaxMemory;
@@ -45,6 +70,23 @@ class PolicyQuota
 		std::mutex mutex;
 		/** Keep track of the policies between each to balance. **/
 		std::list<Policy *> policies;
+	private:
+		/** If true the updates are made by the background thread (see setAsync()). **/
+		std::atomic<bool> async;
+		/** Incremented each time a change is posted to the background thread. **/
+		std::atomic<uint64_t> postedEpoch;
+		/** Last epoch handled by the background thread. **/
+		uint64_t handledEpoch;
+		/** Set if one of the changes posted since the last update must be handled unconditionally. **/
+		std::atomic<bool> forcedChange;
+		/** Background thread running the updates. **/
+		std::thread asyncThread;
+		/** Protect the state of the background thread. **/
+		std::mutex asyncMutex;
+		/** Used to wake up the background thread. **/
+		std::condition_variable asyncCond;
+		/** Request the background thread to exit. **/
+		bool asyncStop;
 };
 
 }
@@ -34,7 +34,16 @@ static __thread bool gblPolicyQuotaInterProcHasPendingSignal = false;
 
 /*******************  FUNCTION  *********************/
 static void sigHandler(int signum){
-	if (gblPolicyQuotaInterProc != NULL)
+	//nothing to do
+	if (gblPolicyQuotaInterProc == NULL)
+		return;
+
+	//only post to the background thread, or defer if handling a fault
+	if (gblPolicyQuotaInterProc->isAsync())
+		gblPolicyQuotaInterProc->postChange(true, false);
+	else if (gblPolicyQuotaInterProcAllowSignal == false)
+		gblPolicyQuotaInterProcHasPendingSignal = true;
+	else
 		gblPolicyQuotaInterProc->update();
 }
 
@@ -92,6 +101,9 @@ PolicyQuotaInterProc::PolicyQuotaInterProc(const std::string & name,size_t stati
 /*******************  FUNCTION  *********************/
 PolicyQuotaInterProc::~PolicyQuotaInterProc(void)
 {
+	//stop the updates
+	this->stopAsync();
+
 	//CRITICAL SECTION
 	{
 		//take lock
@@ -28,6 +28,15 @@ PolicyQuotaLocal::PolicyQuotaLocal(size_t staticMaxMemory)
 {
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the local process policy quota.
+**/
+PolicyQuotaLocal::~PolicyQuotaLocal(void)
+{
+	this->stopAsync();
+}
+
 /*******************  FUNCTION  *********************/
 size_t PolicyQuotaLocal::getUsedMemory(void) const
 {
@@ -28,6 +28,7 @@ class PolicyQuotaLocal : public PolicyQuota
 {
 	public:
 		PolicyQuotaLocal(size_t staticMaxMemory);
+		virtual ~PolicyQuotaLocal(void);
 		virtual void update(void) override;
 	private:
 		size_t getUsedMemory(void) const;
@@ -0,0 +1,400 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <set>
+#include <mutex>
+#include <cassert>
+#include <algorithm>
+//internal
+#include "../common/Debug.hpp"
+//local
+#include "Policy.hpp"
+#include "PolicyQuotaUtility.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the utility quota.
+ * @param staticMaxMemory Memory to distribute between the policies.
+**/
+PolicyQuotaUtility::PolicyQuotaUtility(size_t staticMaxMemory)
+	:PolicyQuota(staticMaxMemory)
+	,evictions(0)
+{
+	this->lastPolicyCount = 0;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the utility quota.
+**/
+PolicyQuotaUtility::~PolicyQuotaUtility(void)
+{
+	this->stopAsync();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Called when a policy grows or when the policy list changes. As the
+ * distributed memory fits in the quota only a change of the policy list
+ * needs a new distribution.
+**/
+void PolicyQuotaUtility::update(void)
+{
+	//CRITICAL SECTION
+	std::vector<Policy *> toShrink;
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+		//check if need to distribute
+		size_t usedMemory = 0;
+		for (auto & it : this->policies)
+			usedMemory += it->getCurrentMemory();
+		if (this->policies.size() != this->lastPolicyCount || usedMemory > this->staticMaxMemory)
+			this->distribute(toShrink);
+	}
+
+	//apply
+	this->shrinkPolicies(toShrink);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Count the evictions of the policies at their limit and distribute the memory
+ * again every UMMAP_QUOTA_UTILITY_PERIOD of them to follow the behavior changes.
+ * @param count Number of evicted segments.
+**/
+void PolicyQuotaUtility::notifyEvictions(size_t count)
+{
+	//not yet
+	if (this->evictions.fetch_add(count) + count < UMMAP_QUOTA_UTILITY_PERIOD)
+		return;
+
+	//let the background thread do it
+	if (this->isAsync()) {
+		this->postChange(true);
+		return;
+	}
+
+	//skip if another thread is already doing it
+	std::vector<Policy *> toShrink;
+	{
+		std::unique_lock<std::mutex> lock(this->mutex, std::try_to_lock);
+		if (lock.owns_lock())
+			this->distribute(toShrink);
+	}
+
+	//apply
+	this->shrinkPolicies(toShrink);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Called by the background thread, the forced changes come from notifyEvictions().
+ * @param forced True if the eviction period has been reached.
+**/
+void PolicyQuotaUtility::asyncUpdate(bool forced)
+{
+	if (forced)
+		this->rebalance();
+	else
+		PolicyQuota::asyncUpdate(false);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Force a new distribution of the memory.
+**/
+void PolicyQuotaUtility::rebalance(void)
+{
+	//CRITICAL SECTION
+	std::vector<Policy *> toShrink;
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+		this->distribute(toShrink);
+	}
+
+	//apply
+	this->shrinkPolicies(toShrink);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Define the weight and the guaranteed memory of a registered policy.
+ * @param policy The policy to configure.
+ * @param weight Multiplier applied to the utility of the policy (1 by default).
+ * @param minMemory Memory always given to the policy (0 by default). If the sum
+ * of the guarantees exceeds the quota they are reduced proportionally.
+**/
+void PolicyQuotaUtility::setPolicyShare(Policy * policy, double weight, size_t minMemory)
+{
+	//check
+	assume(weight >= 0.0, "Invalid negative weight for the policy quota !");
+
+	//CRITICAL SECTION
+	std::vector<Policy *> toShrink;
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+		//check
+		assume(std::find(this->policies.begin(), this->policies.end(), policy) != this->policies.end(), "Try to configure a policy not registered to the quota !");
+
+		//set
+		PolicyQuotaUtilityShare & share = this->getShare(policy);
+		share.weight = weight;
+		share.minMemory = minMemory;
+
+		//distribute
+		this->distribute(toShrink);
+	}
+
+	//apply
+	this->shrinkPolicies(toShrink);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Unregister a policy, waiting first for the other threads still shrinking it
+ * out of the lock as it is destroyed just after.
+ * @param policy The policy to remove.
+**/
+void PolicyQuotaUtility::unregisterPolicy(Policy * policy)
+{
+	//CRITICAL SECTION
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->shrunk.wait(lock, [this, policy]{return this->shrinking.find(policy) == this->shrinking.end();});
+	}
+
+	//remove, it cannot be selected again for shrinking meanwhile as we are in its destructor
+	PolicyQuota::unregisterPolicy(policy);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the state of a policy, create it with the default values if not yet
+ * there. The caller must hold the lock.
+**/
+PolicyQuotaUtilityShare & PolicyQuotaUtility::getShare(Policy * policy)
+{
+	auto it = this->shares.find(policy);
+	if (it == this->shares.end()) {
+		PolicyQuotaUtilityShare share = {1.0, 0, 0.0, 0.0, 0};
+		it = this->shares.insert(std::make_pair(policy, share)).first;
+	}
+	return it->second;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Update the miss rate of a policy since the last distribution. It is smoothed
+ * to keep the memory of a policy which stopped to miss thanks to it.
+ * @param policy The policy to measure.
+ * @param share State of the policy.
+**/
+void PolicyQuotaUtility::measure(Policy * policy, PolicyQuotaUtilityShare & share)
+{
+	//get counter
+	double counter = 0.0;
+	MissRatioCurve * curve = policy->getMissRatioCurve();
+	if (curve != NULL) {
+		counter = curve->getAccesses();
+	} else {
+		ummap_stats_t stats;
+		policy->getStats(stats);
+		counter = stats.refaults;
+	}
+
+	//first time, only start the measure
+	if (share.measuredMemory == 0) {
+		share.lastCounter = counter;
+		share.measuredMemory = std::max(policy->getDynamicMaxMemory(), (size_t)UMMAP_PAGE_SIZE);
+		return;
+	}
+
+	//update
+	double delta = std::max(counter - share.lastCounter, 0.0);
+	share.missRate = (share.missRate + delta) / 2.0;
+	share.lastCounter = counter;
+	share.measuredMemory = std::max(policy->getDynamicMaxMemory(), (size_t)UMMAP_PAGE_SIZE);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Estimate the misses of a policy between two distributions with the given memory.
+ * @param policy The policy.
+ * @param share State of the policy.
+ * @param memory The memory to evaluate (not null).
+**/
+double PolicyQuotaUtility::getMisses(Policy * policy, const PolicyQuotaUtilityShare & share, size_t memory)
+{
+	//check
+	assert(memory > 0);
+
+	//from the curve
+	MissRatioCurve * curve = policy->getMissRatioCurve();
+	if (curve != NULL)
+		return share.missRate * curve->getMissRatio(memory);
+
+	//refaults inversely proportional to the memory
+	return share.missRate * (double)share.measuredMemory / (double)memory;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Shrink the policies selected by distribute() to their new limit. It must be
+ * called out of the lock as the policies evict segments by taking the locks
+ * of the mappings, which can be held by a thread waiting for the quota lock.
+ * @param toShrink Policies to shrink, each one counted in the shrinking map.
+**/
+void PolicyQuotaUtility::shrinkPolicies(const std::vector<Policy *> & toShrink)
+{
+	for (auto policy : toShrink) {
+		//shrink
+		policy->shrinkMemory();
+
+		//CRITICAL SECTION
+		{
+			std::lock_guard<std::mutex> lockGuard(this->mutex);
+			auto it = this->shrinking.find(policy);
+			assert(it != this->shrinking.end());
+			if (--it->second == 0) {
+				this->shrinking.erase(it);
+				this->shrunk.notify_all();
+			}
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Compute the distribution of the memory and set the new limits. The caller
+ * must hold the lock and call shrinkPolicies() once released.
+ * @param toShrink Filled with the policies using more than their new limit.
+**/
+void PolicyQuotaUtility::distribute(std::vector<Policy *> & toShrink)
+{
+	//reset trigger
+	this->evictions = 0;
+	this->lastPolicyCount = this->policies.size();
+
+	//forget the unregistered policies
+	std::set<Policy *> registered(this->policies.begin(), this->policies.end());
+	for (auto it = this->shares.begin() ; it != this->shares.end() ; ) {
+		if (registered.find(it->first) == registered.end())
+			it = this->shares.erase(it);
+		else
+			++it;
+	}
+
+	//nothing to do
+	const size_t cnt = this->policies.size();
+	if (cnt == 0)
+		return;
+
+	//split in chunks, at least one per policy so the floors fit in the quota
+	size_t chunk = this->staticMaxMemory / std::max((size_t)UMMAP_QUOTA_UTILITY_CHUNKS, cnt);
+	chunk -= chunk % UMMAP_PAGE_SIZE;
+	if (chunk < UMMAP_PAGE_SIZE)
+		chunk = UMMAP_PAGE_SIZE;
+	const size_t totalChunks = this->staticMaxMemory / chunk;
+
+	//measure and compute the bounds in chunks
+	std::vector<Policy *> pols(this->policies.begin(), this->policies.end());
+	std::vector<PolicyQuotaUtilityShare *> infos(cnt);
+	std::vector<size_t> alloc(cnt);
+	std::vector<size_t> cap(cnt);
+	size_t sumFloor = 0;
+	for (size_t i = 0 ; i < cnt ; i++) {
+		infos[i] = &this->getShare(pols[i]);
+		this->measure(pols[i], *infos[i]);
+		alloc[i] = std::max((infos[i]->minMemory + chunk - 1) / chunk, (size_t)1);
+		cap[i] = std::max(std::min(pols[i]->getStaticMaxMemory() / chunk, totalChunks), alloc[i]);
+		sumFloor += alloc[i];
+	}
+
+	//reduce the guarantees if they do not fit, keeping one chunk per policy as long
+	//as possible (not the case only if the quota is smaller than a page per policy)
+	if (sumFloor > totalChunks) {
+		size_t newSum = 0;
+		for (size_t i = 0 ; i < cnt ; i++) {
+			alloc[i] = alloc[i] * totalChunks / sumFloor;
+			newSum += alloc[i];
+		}
+		for (size_t i = 0 ; i < cnt && newSum < totalChunks ; i++) {
+			if (alloc[i] == 0) {
+				alloc[i] = 1;
+				newSum++;
+			}
+		}
+		sumFloor = newSum;
+	}
+	assert(sumFloor <= totalChunks);
+	size_t remaining = (totalChunks > sumFloor) ? totalChunks - sumFloor : 0;
+
+	//estimate the misses for each possible allocation
+	std::vector<std::vector<double> > misses(cnt);
+	for (size_t i = 0 ; i < cnt ; i++) {
+		misses[i].resize(cap[i] + 1, 0.0);
+		for (size_t k = std::max(alloc[i], (size_t)1) ; k <= cap[i] ; k++)
+			misses[i][k] = this->getMisses(pols[i], *infos[i], k * chunk);
+	}
+
+	//give the chunks by marginal utility, looking ahead over several chunks
+	while (remaining > 0) {
+		double bestGain = 0.0;
+		size_t bestPolicy = cnt;
+		size_t bestChunks = 0;
+		for (size_t i = 0 ; i < cnt ; i++) {
+			size_t maxChunks = std::min(remaining, cap[i] - alloc[i]);
+			for (size_t k = 1 ; k <= maxChunks ; k++) {
+				double gain = infos[i]->weight * (misses[i][alloc[i]] - misses[i][alloc[i] + k]) / k;
+				if (gain > bestGain) {
+					bestGain = gain;
+					bestPolicy = i;
+					bestChunks = k;
+				}
+			}
+		}
+		if (bestPolicy == cnt)
+			break;
+		alloc[bestPolicy] += bestChunks;
+		remaining -= bestChunks;
+	}
+
+	//spread the memory useful to nobody by weight
+	while (remaining > 0) {
+		size_t target = cnt;
+		double targetLoad = 0.0;
+		for (size_t i = 0 ; i < cnt ; i++) {
+			if (alloc[i] >= cap[i])
+				continue;
+			double load = alloc[i] / std::max(infos[i]->weight, 1e-9);
+			if (target == cnt || load < targetLoad) {
+				target = i;
+				targetLoad = load;
+			}
+		}
+		if (target == cnt)
+			break;
+		alloc[target]++;
+		remaining--;
+	}
+
+	//set the limits, the shrink is done by the caller out of the lock
+	for (size_t i = 0 ; i < cnt ; i++) {
+		size_t memory = std::min(alloc[i] * chunk, pols[i]->getStaticMaxMemory());
+		pols[i]->setDynamicMaxMemory(memory);
+		if (pols[i]->getCurrentMemory() > memory) {
+			toShrink.push_back(pols[i]);
+			this->shrinking[pols[i]]++;
+		}
+	}
+}
@@ -0,0 +1,100 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_POLICY_QUOTA_UTILITY_HPP
+#define UMMAP_POLICY_QUOTA_UTILITY_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <map>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
+//internal
+#include "../portability/OS.hpp"
+#include "PolicyQuota.hpp"
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  DEFINES  ********************/
+/** Number of chunks in which the quota memory is split to be distributed (at least one per policy). **/
+#define UMMAP_QUOTA_UTILITY_CHUNKS 64
+/** Number of evictions between two distributions when the policies are at their limit. **/
+#define UMMAP_QUOTA_UTILITY_PERIOD 64
+
+/*********************  STRUCT  *********************/
+/**
+ * State of a policy attached to a utility quota.
+**/
+struct PolicyQuotaUtilityShare
+{
+	/** Weight applied to the utility of the policy. **/
+	double weight;
+	/** Memory guaranteed to the policy. **/
+	size_t minMemory;
+	/** Value of the counter (refaults or sampled accesses) at the last distribution. **/
+	double lastCounter;
+	/** Smoothed number of misses between two distributions. **/
+	double missRate;
+	/** Memory allowed to the policy when measuring the miss rate. **/
+	size_t measuredMemory;
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Distribute the quota memory between the policies by marginal utility: the
+ * memory is split in chunks and each chunk goes to the policy whose misses
+ * decrease the most with it, multiplied by its weight (lookahead over several
+ * chunks so the policies needing a large chunk before benefiting are not
+ * ignored). The misses of a policy for a given memory are estimated from
+ * its miss-ratio curve if enabled (see Policy::enableMissRatioCurve()),
+ * otherwise from its refault rate assuming the refaults are inversely
+ * proportional to its memory. A streaming policy never refaults so it does
+ * not gain memory against a policy reusing its segments.
+ *
+ * Each policy first gets its guaranteed memory, and the memory not useful to
+ * any policy is spread by weight. The distribution is recomputed when the set
+ * of policies changes and periodically when the policies evict at their limit.
+ * The new limits are set under the quota lock but the policies are shrunk
+ * after releasing it as the evictions take the locks of the mappings.
+**/
+class PolicyQuotaUtility : public PolicyQuota
+{
+	public:
+		PolicyQuotaUtility(size_t staticMaxMemory);
+		virtual ~PolicyQuotaUtility(void);
+		virtual void update(void) override;
+		virtual void notifyEvictions(size_t count) override;
+		void rebalance(void);
+		void setPolicyShare(Policy * policy, double weight, size_t minMemory);
+		virtual void unregisterPolicy(Policy * policy) override;
+	protected:
+		virtual void asyncUpdate(bool forced) override;
+	private:
+		void distribute(std::vector<Policy *> & toShrink);
+		void shrinkPolicies(const std::vector<Policy *> & toShrink);
+		void measure(Policy * policy, PolicyQuotaUtilityShare & share);
+		double getMisses(Policy * policy, const PolicyQuotaUtilityShare & share, size_t memory);
+		PolicyQuotaUtilityShare & getShare(Policy * policy);
+	private:
+		/** Weights and measures of the policies. **/
+		std::map<Policy *, PolicyQuotaUtilityShare> shares;
+		/** Number of policies at the last distribution. **/
+		size_t lastPolicyCount;
+		/** Evictions since the last distribution. **/
+		std::atomic<size_t> evictions;
+		/** Number of pending shrinks of each policy out of the lock (see shrinkPolicies()). **/
+		std::map<Policy *, size_t> shrinking;
+		/** Used to wait the pending shrinks of a policy before unregistering it. **/
+		std::condition_variable shrunk;
+};
+
+}
+
+#endif //UMMAP_POLICY_QUOTA_UTILITY_HPP
@@ -0,0 +1,424 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cassert>
+#include <algorithm>
+//unix
+#include <unistd.h>
+//internal
+#include "../common/Debug.hpp"
+#include "../portability/OS.hpp"
+//local
+#include "SegmentCache.hpp"
+#include "Mapping.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the cache.
+ * @param fd Memory file in which to hold the segments, it is closed by the destructor.
+ * @param segmentSize Size of the segments.
+**/
+SegmentCache::SegmentCache(int fd, size_t segmentSize)
+{
+	//check
+	assert(fd >= 0);
+	assert(segmentSize % UMMAP_PAGE_SIZE == 0);
+
+	//set
+	this->fd = fd;
+	this->fileSize = 0;
+	this->segmentSize = segmentSize;
+	this->users = 0;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the cache. All the segments must have been released.
+**/
+SegmentCache::~SegmentCache(void)
+{
+	assert(this->entries.empty());
+	close(this->fd);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Map a segment of the object at the given address, replacing the PROT_NONE
+ * segment of the caller atomically. If another mapping already holds the
+ * segment its pages are shared, otherwise the segment is read from the storage.
+ * The caller must hold its segment lock and call release() when unmapping it.
+ * @param addr Address of the segment in the caller mapping.
+ * @param storageOffset Offset of the segment in the storage (aligned on segment size).
+ * @param readSize Size of the data to read from the storage (smaller than the
+ * segment size for the last segment of the caller).
+ * @param skipRead Do not read the storage if the segment is not yet held, it is
+ * filled with zeroes.
+ * @param write Open the segment in write mode.
+ * @param exec Open the segment in exec mode.
+ * @param driver Driver to read the storage.
+ * @param holder Mapping holding the segment, it is charged for it if it is the first one.
+ * @param readBytes Return the number of bytes read from the storage.
+ * @return True if the segment was already held by another mapping, so it is
+ * not charged to the policies of the caller.
+**/
+bool SegmentCache::map(void * addr, size_t storageOffset, size_t readSize, bool skipRead, bool write, bool exec, Driver * driver, Mapping * holder, size_t & readBytes)
+{
+	//check
+	assert(storageOffset % this->segmentSize == 0);
+	assert(readSize <= this->segmentSize);
+
+	//vars
+	bool hit = false;
+	size_t from = 0;
+	size_t to = 0;
+	readBytes = 0;
+
+	//CRITICAL SECTION
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		//take a reference before waiting so it is not released meanwhile
+		SegmentCacheEntry & entry = this->entries[storageOffset];
+		entry.holders.push_back(holder);
+		this->loaded.wait(lock, [&entry]{return entry.loading == false;});
+		hit = (entry.holders.front() != holder);
+
+		//compute the part to read, a larger mapping might need more than the previous ones
+		if (hit == false && skipRead) {
+			entry.loadedSize = this->segmentSize;
+		} else if (skipRead == false && readSize > entry.loadedSize) {
+			from = entry.loadedSize;
+			to = readSize;
+			entry.loading = true;
+		}
+
+		//grow the file
+		if (storageOffset + this->segmentSize > this->fileSize) {
+			int status = ftruncate(this->fd, storageOffset + this->segmentSize);
+			assumeArg(status == 0, "Fail to resize the segment cache file : %1").argStrErrno().end();
+			this->fileSize = storageOffset + this->segmentSize;
+		}
+	}
+
+	//read out of the lock
+	if (to > from) {
+		this->readSegment(storageOffset, from, to, driver);
+		readBytes = to - from;
+
+		//CRITICAL SECTION
+		{
+			std::lock_guard<std::mutex> lockGuard(this->mutex);
+			SegmentCacheEntry & entry = this->entries[storageOffset];
+			entry.loadedSize = to;
+			entry.loading = false;
+		}
+		this->loaded.notify_all();
+	}
+
+	//map over the PROT_NONE segment
+	OS::mmapFd(addr, this->segmentSize, this->fd, storageOffset, true, write, exec);
+
+	//ok
+	return hit;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Read a part of a segment from the storage into the memory file.
+ * @param storageOffset Offset of the segment in the storage.
+ * @param from Begin of the part in the segment.
+ * @param to End of the part in the segment.
+ * @param driver Driver to read the storage.
+**/
+void SegmentCache::readSegment(size_t storageOffset, size_t from, size_t to, Driver * driver)
+{
+	//map the segment of the file in a temp buffer
+	char * ptr = (char*)OS::mmapFd(NULL, this->segmentSize, this->fd, storageOffset, true, true, false);
+
+	//read
+	ssize_t res = driver->pread(ptr + from, to - from, storageOffset + from);
+	assumeArg(res >= 0, "Fail to read all data, got %1 instead of %2 !")
+		.arg(res)
+		.arg(to - from)
+		.end();
+
+	//unmap
+	OS::munmap(ptr, this->segmentSize);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release the segments of the given range unmapped by a mapping. The pages
+ * of the segments not held anymore are freed. The segments charged to the
+ * caller and still held by other mappings are charged to the next one not
+ * being destroyed. Nothing can be evicted with the cache lock held so the
+ * new holders are returned to the caller which must shrink their policies
+ * out of its own locks then call endCharge() for each of them.
+ * @param storageOffset Offset of the range in the storage (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+ * @param holder The mapping unmapping the segments.
+ * @param charged Filled with the new holder of each moved charge.
+**/
+void SegmentCache::release(size_t storageOffset, size_t size, Mapping * holder, std::vector<Mapping *> & charged)
+{
+	//check
+	assert(storageOffset % this->segmentSize == 0);
+	assert(size % this->segmentSize == 0);
+
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+		//loop on segments
+		for (size_t offset = storageOffset ; offset < storageOffset + size ; offset += this->segmentSize) {
+			auto it = this->entries.find(offset);
+			assumeArg(it != this->entries.end(), "Try to release a segment not in the cache : %1").arg(offset).end();
+
+			//remove the holder
+			std::vector<Mapping *> & holders = it->second.holders;
+			auto pos = std::find(holders.begin(), holders.end(), holder);
+			assumeArg(pos != holders.end(), "Try to release a segment not held by the mapping : %1").arg(offset).end();
+			const bool wasCharged = (pos == holders.begin());
+			holders.erase(pos);
+
+			//free it
+			if (holders.empty()) {
+				this->entries.erase(it);
+				OS::punchHole(this->fd, offset, this->segmentSize);
+				continue;
+			}
+
+			//move the charge to the first holder not being destroyed, the mappings are alive
+			//as long as they hold the segment and cannot release it meanwhile as we have the lock
+			if (wasCharged) {
+				auto next = holders.begin();
+				while (next != holders.end() && this->leaving.count(*next) > 0)
+					++next;
+				if (next != holders.end()) {
+					std::iter_swap(holders.begin(), next);
+					holders.front()->chargeCachedSegment(offset);
+					this->charging[holders.front()]++;
+					charged.push_back(holders.front());
+				}
+			}
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Mark the policies of a mapping which received a charge in release() as
+ * shrunk.
+ * @param holder The mapping returned by release().
+**/
+void SegmentCache::endCharge(Mapping * holder)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	auto it = this->charging.find(holder);
+	assert(it != this->charging.end());
+	if (--it->second == 0) {
+		this->charging.erase(it);
+		this->charged.notify_all();
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Called by a mapping being destroyed before releasing its segments. No
+ * charge is moved to it anymore and it waits the shrinking of its policies
+ * still pending in other mappings as they could evict its segments.
+ * @param holder The mapping being destroyed.
+**/
+void SegmentCache::leave(Mapping * holder)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->leaving.insert(holder);
+	this->charged.wait(lock, [this, holder]{return this->charging.count(holder) == 0;});
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Called by a mapping being destroyed once it released all its segments so
+ * its address can be reused by a new mapping (see leave()).
+ * @param holder The mapping being destroyed.
+**/
+void SegmentCache::forget(Mapping * holder)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	this->leaving.erase(holder);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Check if a segment is charged to the policies of the given mapping, which
+ * is the case for the first mapping holding it.
+ * @param storageOffset Offset of the segment in the storage (aligned on segment size).
+ * @param holder The mapping to check.
+ * @return False if the segment is charged to another mapping or not held.
+**/
+bool SegmentCache::isCharged(size_t storageOffset, Mapping * holder)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	auto it = this->entries.find(storageOffset);
+	return it != this->entries.end() && it->second.holders.front() == holder;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Reset the content of the given range to zeroes for all the mappings
+ * (see Mapping::discard()).
+ * @param storageOffset Offset of the range in the storage (aligned on segment size).
+ * @param size Size of the range (aligned on segment size).
+**/
+void SegmentCache::discard(size_t storageOffset, size_t size)
+{
+	//check
+	assert(storageOffset % this->segmentSize == 0);
+	assert(size % this->segmentSize == 0);
+
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+		//nothing in the file
+		if (storageOffset >= this->fileSize)
+			return;
+		if (storageOffset + size > this->fileSize)
+			size = this->fileSize - storageOffset;
+
+		//free the pages
+		OS::punchHole(this->fd, storageOffset, size);
+
+		//the held segments must not be read again
+		for (size_t offset = storageOffset ; offset < storageOffset + size ; offset += this->segmentSize) {
+			auto it = this->entries.find(offset);
+			if (it != this->entries.end())
+				it->second.loadedSize = this->segmentSize;
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the segment size used by the mappings sharing the cache.
+**/
+size_t SegmentCache::getSegmentSize(void) const
+{
+	return this->segmentSize;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of segments currently held by at least one mapping.
+**/
+size_t SegmentCache::getCachedSegments(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	return this->entries.size();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the registry.
+**/
+SegmentCacheRegistry::SegmentCacheRegistry(void)
+{
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the registry. All the caches must have been released.
+**/
+SegmentCacheRegistry::~SegmentCacheRegistry(void)
+{
+	assert(this->caches.empty());
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Get the cache of the object accessed by the given driver, create it if
+ * this is the first mapping of the object.
+ * @param driver Driver of the mapping.
+ * @param storageOffset Offset of the mapping in the storage, it must be aligned
+ * on the segment size to share the segments with the other mappings.
+ * @param segmentSize Segment size of the mapping, it must be the one of the other
+ * mappings of the object.
+ * @return The cache to be released by release() or NULL if the mapping cannot
+ * share its segments. The mapping then holds them privately.
+**/
+SegmentCache * SegmentCacheRegistry::acquire(Driver * driver, size_t storageOffset, size_t segmentSize)
+{
+	//check
+	assert(driver != NULL);
+
+	//the segments of the mappings must match
+	if (storageOffset % segmentSize != 0)
+		return NULL;
+
+	//get key
+	std::string key = driver->getObjectKey();
+
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+		//already there
+		auto it = this->caches.find(key);
+		if (it != this->caches.end()) {
+			if (it->second->getSegmentSize() != segmentSize)
+				return NULL;
+			it->second->users++;
+			return it->second;
+		}
+
+		//create the memory file
+		int fd = OS::memfdCreate("ummap-segment-cache");
+		if (fd < 0)
+			return NULL;
+
+		//register
+		SegmentCache * cache = new SegmentCache(fd, segmentSize);
+		cache->objectKey = key;
+		cache->users = 1;
+		this->caches[key] = cache;
+		return cache;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release a cache obtained by acquire(), it is destroyed with its last user.
+ * @param cache The cache to release.
+**/
+void SegmentCacheRegistry::release(SegmentCache * cache)
+{
+	//check
+	assert(cache != NULL);
+
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+		if (--cache->users == 0) {
+			this->caches.erase(cache->objectKey);
+			delete cache;
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of active caches.
+**/
+size_t SegmentCacheRegistry::getCacheCount(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	return this->caches.size();
+}
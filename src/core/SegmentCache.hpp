@@ -0,0 +1,128 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_SEGMENT_CACHE_HPP
+#define UMMAP_SEGMENT_CACHE_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <string>
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+//internal
+#include "Driver.hpp"
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  CLASS  **********************/
+class Mapping;
+
+/*********************  STRUCT  *********************/
+/**
+ * State of a segment of the object held by at least one mapping.
+**/
+struct SegmentCacheEntry
+{
+	/**
+	 * Mappings having the segment mapped. The first one is the one charged for
+	 * it in its policies, the others share it for free.
+	**/
+	std::vector<Mapping *> holders;
+	/** Size of the data already read from the storage. **/
+	size_t loadedSize;
+	/** True while a mapping reads the segment, the others wait for it. **/
+	bool loading;
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Cache of the segments of a storage object shared by all the mappings of this
+ * object using UMMAP_SHARED_CACHE. The segments are held in a memory file at
+ * their storage offset and mapped in shared mode by the mappings so they share
+ * the same physical pages and a segment loaded by a mapping is mapped by the
+ * others without reading the storage again. The writes are seen by all the
+ * mappings. A segment is released from the memory file when the last mapping
+ * holding it unmaps it.
+ *
+ * A segment is charged to the policies of the mapping which loaded it only.
+ * When this mapping unmaps it, the charge is moved to the next mapping still
+ * holding it (see Mapping::chargeCachedSegment()). The policies of the new
+ * holder are shrunk by the releasing mapping once out of its locks (see
+ * endCharge()).
+**/
+class SegmentCache
+{
+	public:
+		SegmentCache(int fd, size_t segmentSize);
+		~SegmentCache(void);
+		bool map(void * addr, size_t storageOffset, size_t readSize, bool skipRead, bool write, bool exec, Driver * driver, Mapping * holder, size_t & readBytes);
+		void release(size_t storageOffset, size_t size, Mapping * holder, std::vector<Mapping *> & charged);
+		void endCharge(Mapping * holder);
+		void leave(Mapping * holder);
+		void forget(Mapping * holder);
+		bool isCharged(size_t storageOffset, Mapping * holder);
+		void discard(size_t storageOffset, size_t size);
+		size_t getSegmentSize(void) const;
+		size_t getCachedSegments(void);
+	private:
+		void readSegment(size_t storageOffset, size_t from, size_t to, Driver * driver);
+	private:
+		/** Memory file holding the segments at their storage offset. **/
+		int fd;
+		/** Current size of the memory file. **/
+		size_t fileSize;
+		/** Size of the segments, all the mappings sharing the cache must use the same. **/
+		size_t segmentSize;
+		/** Segments held by the mappings indexed by their storage offset. **/
+		std::unordered_map<size_t, SegmentCacheEntry> entries;
+		/** Protect the entries and the file size. **/
+		std::mutex mutex;
+		/** Used to wait a segment being loaded by another mapping. **/
+		std::condition_variable loaded;
+		/** Number of charges moved to each mapping whose policies are not shrunk yet. **/
+		std::unordered_map<Mapping *, size_t> charging;
+		/** Mappings being destroyed, no charge is moved to them anymore (see leave()). **/
+		std::unordered_set<Mapping *> leaving;
+		/** Used to wait the pending charges of a mapping being destroyed. **/
+		std::condition_variable charged;
+		/** Number of mappings using the cache (see SegmentCacheRegistry). **/
+		size_t users;
+		/** Key of the object in the registry. **/
+		std::string objectKey;
+		friend class SegmentCacheRegistry;
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Registry of the segment caches indexed by the key of their storage object
+ * (see Driver::getObjectKey()). A cache is created by the first mapping of the
+ * object and destroyed with the last one.
+**/
+class SegmentCacheRegistry
+{
+	public:
+		SegmentCacheRegistry(void);
+		~SegmentCacheRegistry(void);
+		SegmentCache * acquire(Driver * driver, size_t storageOffset, size_t segmentSize);
+		void release(SegmentCache * cache);
+		size_t getCacheCount(void);
+	private:
+		/** Caches indexed by object key. **/
+		std::map<std::string, SegmentCache *> caches;
+		/** Protect the map. **/
+		std::mutex mutex;
+};
+
+}
+
+#endif //UMMAP_SEGMENT_CACHE_HPP
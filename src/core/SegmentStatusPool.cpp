@@ -0,0 +1,132 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cassert>
+//internal
+#include "../common/Debug.hpp"
+//local
+#include "SegmentStatusPool.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the pool. Only the chunk pointers of the shared table are
+ * allocated, the chunks are allocated when the windows are touched.
+ * @param segments Total number of segments which can be handed out.
+**/
+SegmentStatusPool::SegmentStatusPool(size_t segments)
+	:table(segments)
+{
+	this->next = 0;
+	this->used = 0;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the pool. All the windows must have been released.
+**/
+SegmentStatusPool::~SegmentStatusPool(void)
+{
+	assert(this->used == 0);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the size class of the given number of segments (log2 of the
+ * next power of 2).
+ * @param segments Number of segments.
+**/
+int SegmentStatusPool::getSizeClass(size_t segments)
+{
+	int sizeClass = 0;
+	while ((1UL << sizeClass) < segments)
+		sizeClass++;
+	return sizeClass;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Get a window of the given size over the shared table.
+ * @param segments Number of segments of the mapping.
+ * @return The window to be released by release() or NULL if the mapping is
+ * too large to be handled by the pool or if the pool is full. The caller
+ * must then fallback on its own table.
+**/
+SegmentStatusTable * SegmentStatusPool::acquire(size_t segments)
+{
+	//check
+	assert(segments > 0);
+	if (segments > UMMAP_SEGMENT_STATUS_CHUNK)
+		return NULL;
+
+	//compute
+	int sizeClass = getSizeClass(segments);
+	size_t rangeSize = 1UL << sizeClass;
+	size_t first;
+
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+		//reuse or take a new one, aligned on its size
+		std::vector<size_t> & freeList = this->freeRanges[sizeClass];
+		if (freeList.empty() == false) {
+			first = freeList.back();
+			freeList.pop_back();
+		} else {
+			first = (this->next + rangeSize - 1) & ~(rangeSize - 1);
+			if (first + rangeSize > this->table.getSegments())
+				return NULL;
+			this->next = first + rangeSize;
+		}
+
+		//account
+		this->used += rangeSize;
+	}
+
+	//build the window
+	return new SegmentStatusTable(this->table, first, segments);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release a window obtained by acquire(). Its segments are reset to the
+ * default state to be reused by the next mappings.
+ * @param window The window to release.
+**/
+void SegmentStatusPool::release(SegmentStatusTable * window)
+{
+	//check
+	assert(window != NULL);
+
+	//extract before destroying
+	size_t first = window->getFirst();
+	int sizeClass = getSizeClass(window->getSegments());
+
+	//reset the range
+	delete window;
+
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+		this->freeRanges[sizeClass].push_back(first);
+		this->used -= 1UL << sizeClass;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of segments currently handed out (including the
+ * rounding to the size classes).
+**/
+size_t SegmentStatusPool::getUsedSegments(void) const
+{
+	return this->used;
+}
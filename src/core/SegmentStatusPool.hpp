@@ -0,0 +1,61 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_SEGMENT_STATUS_POOL_HPP
+#define UMMAP_SEGMENT_STATUS_POOL_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <vector>
+#include <mutex>
+//local
+#include "SegmentStatusTable.hpp"
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  DEFINES  ********************/
+/** Number of segments which can be handed out by the pool. **/
+#define UMMAP_SEGMENT_STATUS_POOL_SEGMENTS (1UL << 30)
+/** Number of size classes of the pool (powers of 2 up to UMMAP_SEGMENT_STATUS_CHUNK). **/
+#define UMMAP_SEGMENT_STATUS_POOL_CLASSES 17
+
+/*********************  CLASS  **********************/
+/**
+ * Pool of segment status shared by the lightweight mappings (see UMMAP_LIGHTWEIGHT).
+ * Instead of allocating its own table, and a full chunk on first touch, each
+ * mapping gets a window over a range of a large shared table. The ranges are
+ * rounded to a power of 2 and aligned on their size so they never cross a chunk,
+ * the released ones are kept in a free list per size to be reused.
+**/
+class SegmentStatusPool
+{
+	public:
+		SegmentStatusPool(size_t segments = UMMAP_SEGMENT_STATUS_POOL_SEGMENTS);
+		~SegmentStatusPool(void);
+		SegmentStatusTable * acquire(size_t segments);
+		void release(SegmentStatusTable * window);
+		size_t getUsedSegments(void) const;
+	private:
+		static int getSizeClass(size_t segments);
+	private:
+		/** Table holding the status of all the windows. **/
+		SegmentStatusTable table;
+		/** Protect the range allocator. **/
+		std::mutex mutex;
+		/** Next never used segment of the table. **/
+		size_t next;
+		/** Number of segments currently handed out. **/
+		size_t used;
+		/** Released ranges per size class. **/
+		std::vector<size_t> freeRanges[UMMAP_SEGMENT_STATUS_POOL_CLASSES];
+};
+
+}
+
+#endif //UMMAP_SEGMENT_STATUS_POOL_HPP
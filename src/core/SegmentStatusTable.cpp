@@ -0,0 +1,1302 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cstring>
+#include <cassert>
+#include <new>
+//internal
+#include "../common/Debug.hpp"
+#include "../portability/OS.hpp"
+//local
+#include "SegmentStatusTable.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*********************  CONSTS  *********************/
+/** Returned by nextInChunkIndex() if there is no more bits. **/
+static const size_t SEGMENT_INDEX_NONE = UMMAP_SEGMENT_STATUS_CHUNK;
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the table. Only the chunk pointers are allocated.
+ * @param segments Number of segments to track.
+**/
+SegmentStatusTable::SegmentStatusTable(size_t segments)
+{
+	//setup
+	this->segments = segments;
+	this->first = 0;
+	this->ownChunks = true;
+	this->skipRead = false;
+	this->chunksCnt = (segments + UMMAP_SEGMENT_STATUS_CHUNK - 1) / UMMAP_SEGMENT_STATUS_CHUNK;
+	this->lockedFirst.store(0);
+	this->lockedEnd.store(0);
+	this->lockedEpoch.store(0);
+
+	//allocate chunk pointers
+	this->chunks = new std::atomic<SegmentStatusChunk*>[this->chunksCnt];
+	this->discarded = new std::atomic<bool>[this->chunksCnt];
+	this->advice = new std::atomic<unsigned char>[this->chunksCnt];
+	for (size_t i = 0 ; i < this->chunksCnt ; i++) {
+		this->chunks[i].store(NULL, std::memory_order_relaxed);
+		this->discarded[i].store(false, std::memory_order_relaxed);
+		this->advice[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of a window over a range of segments of another table. The
+ * window shares the chunks of the parent which must outlive it.
+ * @param parent The table owning the chunks.
+ * @param first First segment of the window in the parent table.
+ * @param segments Number of segments of the window.
+**/
+SegmentStatusTable::SegmentStatusTable(SegmentStatusTable & parent, size_t first, size_t segments)
+{
+	//check
+	assert(parent.ownChunks);
+	assumeArg(first + segments <= parent.segments, "Invalid status table window, %1 + %2 is larger than %3")
+		.arg(first)
+		.arg(segments)
+		.arg(parent.segments)
+		.end();
+
+	//setup
+	this->chunks = parent.chunks;
+	this->chunksCnt = parent.chunksCnt;
+	this->segments = segments;
+	this->first = first;
+	this->ownChunks = false;
+	this->skipRead = false;
+	this->discarded = NULL;
+	this->advice = NULL;
+	this->lockedFirst.store(0);
+	this->lockedEnd.store(0);
+	this->lockedEpoch.store(0);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the table, free the allocated chunks or reset the range of
+ * the window so it can be reused.
+**/
+SegmentStatusTable::~SegmentStatusTable(void)
+{
+	//window
+	if (this->ownChunks == false) {
+		this->clearRange(this->first, this->first + this->segments);
+		return;
+	}
+
+	//free
+	for (size_t i = 0 ; i < this->chunksCnt ; i++)
+		free(this->chunks[i].load(std::memory_order_relaxed));
+	delete [] this->chunks;
+	delete [] this->discarded;
+	delete [] this->advice;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Reset the given segments to the default state and remove them from the
+ * indexes.
+ * @param first Absolute ID of the first segment (including the window offset).
+ * @param end Absolute ID of the segment after the last one.
+**/
+void SegmentStatusTable::clearRange(size_t first, size_t end)
+{
+	for (size_t id = first ; id < end ; id++) {
+		//skip not allocated chunks
+		SegmentStatusChunk * ptr = this->getChunk(id);
+		if (ptr == NULL) {
+			id = (id / UMMAP_SEGMENT_STATUS_CHUNK + 1) * UMMAP_SEGMENT_STATUS_CHUNK - 1;
+			continue;
+		}
+
+		//reset
+		size_t local = id % UMMAP_SEGMENT_STATUS_CHUNK;
+		memset(static_cast<void*>(ptr->status + local), 0, sizeof(SegmentStatus));
+		setInIndex(ptr->resident, local, false);
+		setInIndex(ptr->dirty, local, false);
+		setBit(ptr->writeIntent, local, false);
+		setBit(ptr->pinned, local, false);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the chunk containing the given segment.
+ * @param id Absolute ID of the segment (including the window offset).
+ * @return The chunk or NULL if not allocated.
+**/
+SegmentStatusChunk * SegmentStatusTable::getChunk(size_t id) const
+{
+	return this->chunks[id / UMMAP_SEGMENT_STATUS_CHUNK].load(std::memory_order_acquire);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return true if the given not allocated chunk has been discarded (see discardRange()).
+ * @param chunk ID of the chunk.
+**/
+bool SegmentStatusTable::isDiscardedChunk(size_t chunk) const
+{
+	return this->discarded != NULL && this->discarded[chunk].load(std::memory_order_acquire);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the access hint of the given not allocated chunk (see adviseRange()).
+ * @param chunk ID of the chunk.
+**/
+unsigned char SegmentStatusTable::getChunkAdvice(size_t chunk) const
+{
+	return (this->advice == NULL) ? 0 : this->advice[chunk].load(std::memory_order_acquire);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the memory used by a chunk of the given capacity with its arrays.
+ * @param capacity Number of segments of the chunk, multiple of 64.
+**/
+size_t SegmentStatusTable::getChunkMemory(size_t capacity)
+{
+	//number of words of the arrays
+	const size_t words = capacity / 64;
+	const size_t summaryWords = (words + 63) / 64;
+	const size_t lockWords = capacity / 32;
+	const size_t waiterWords = (lockWords + 63) / 64;
+
+	//header, 64 bits arrays, lock words then status
+	size_t memory = (sizeof(SegmentStatusChunk) + 7) & ~7UL;
+	memory += (4 * words + 2 * summaryWords + waiterWords) * sizeof(uint64_t);
+	memory += lockWords * sizeof(uint32_t);
+	memory += capacity * sizeof(SegmentStatus);
+	return memory;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Allocate a chunk and its arrays in a single zeroed block, all zero is the
+ * default state. It must be freed with free().
+ * @param capacity Number of segments of the chunk, multiple of 64.
+**/
+SegmentStatusChunk * SegmentStatusTable::createChunk(size_t capacity)
+{
+	//check
+	assert(capacity > 0 && capacity <= UMMAP_SEGMENT_STATUS_CHUNK && capacity % 64 == 0);
+
+	//number of words of the arrays
+	const size_t words = capacity / 64;
+	const size_t summaryWords = (words + 63) / 64;
+	const size_t lockWords = capacity / 32;
+	const size_t waiterWords = (lockWords + 63) / 64;
+
+	//allocate
+	char * mem = (char*)calloc(1, getChunkMemory(capacity));
+	assumeArg(mem != NULL, "Fail to allocate a segment status chunk of %1 segments !").arg(capacity).end();
+	SegmentStatusChunk * ptr = new (mem) SegmentStatusChunk;
+	ptr->capacity = capacity;
+	ptr->resident.words = words;
+	ptr->resident.count.store(0, std::memory_order_relaxed);
+	ptr->dirty.words = words;
+	ptr->dirty.count.store(0, std::memory_order_relaxed);
+
+	//place the arrays, larger alignment first
+	char * cursor = mem + ((sizeof(SegmentStatusChunk) + 7) & ~7UL);
+	std::atomic<uint64_t> * words64 = reinterpret_cast<std::atomic<uint64_t>*>(cursor);
+	ptr->resident.bits = words64;
+	ptr->dirty.bits = ptr->resident.bits + words;
+	ptr->writeIntent = ptr->dirty.bits + words;
+	ptr->pinned = ptr->writeIntent + words;
+	ptr->resident.summary = ptr->pinned + words;
+	ptr->dirty.summary = ptr->resident.summary + summaryWords;
+	ptr->lockWaiters = ptr->dirty.summary + summaryWords;
+	ptr->locks = reinterpret_cast<std::atomic<uint32_t>*>(ptr->lockWaiters + waiterWords);
+	ptr->status = reinterpret_cast<SegmentStatus*>(ptr->locks + lockWords);
+
+	//ok
+	return ptr;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Copy the content of a chunk in a larger one, used when growing the table.
+ * The caller must ensure no other thread access the chunks.
+ * @param dest The chunk to fill, freshly created.
+ * @param source The chunk to copy.
+**/
+void SegmentStatusTable::copyChunk(SegmentStatusChunk * dest, const SegmentStatusChunk * source)
+{
+	//check
+	assert(dest->capacity >= source->capacity);
+
+	//number of words of the source arrays
+	const size_t words = source->capacity / 64;
+	const size_t summaryWords = (words + 63) / 64;
+	const size_t lockWords = source->capacity / 32;
+	const size_t waiterWords = (lockWords + 63) / 64;
+
+	//copy
+	memcpy(static_cast<void*>(dest->status), source->status, source->capacity * sizeof(SegmentStatus));
+	memcpy(static_cast<void*>(dest->resident.bits), source->resident.bits, words * sizeof(uint64_t));
+	memcpy(static_cast<void*>(dest->resident.summary), source->resident.summary, summaryWords * sizeof(uint64_t));
+	memcpy(static_cast<void*>(dest->dirty.bits), source->dirty.bits, words * sizeof(uint64_t));
+	memcpy(static_cast<void*>(dest->dirty.summary), source->dirty.summary, summaryWords * sizeof(uint64_t));
+	memcpy(static_cast<void*>(dest->writeIntent), source->writeIntent, words * sizeof(uint64_t));
+	memcpy(static_cast<void*>(dest->pinned), source->pinned, words * sizeof(uint64_t));
+	memcpy(static_cast<void*>(dest->locks), source->locks, lockWords * sizeof(uint32_t));
+	memcpy(static_cast<void*>(dest->lockWaiters), source->lockWaiters, waiterWords * sizeof(uint64_t));
+	dest->resident.count.store(source->resident.count.load());
+	dest->dirty.count.store(source->dirty.count.load());
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of segments to allocate for the given chunk. The last
+ * chunk of an owned table only covers the remaining segments, the windows
+ * use full chunks as they do not know the size of the parent table.
+ * @param chunk ID of the chunk.
+**/
+size_t SegmentStatusTable::getChunkCapacity(size_t chunk) const
+{
+	//full chunk
+	const size_t remaining = this->segments - chunk * UMMAP_SEGMENT_STATUS_CHUNK;
+	if (this->ownChunks == false || remaining >= UMMAP_SEGMENT_STATUS_CHUNK)
+		return UMMAP_SEGMENT_STATUS_CHUNK;
+
+	//last one, rounded to full index words
+	return (remaining + 63) & ~63UL;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Allocate the given chunk if not already done by another thread.
+ * @param chunk ID of the chunk.
+ * @return Pointer to the chunk.
+**/
+SegmentStatusChunk * SegmentStatusTable::allocateChunk(size_t chunk)
+{
+	//allocate, all zero is the default state
+	SegmentStatusChunk * ptr = createChunk(this->getChunkCapacity(chunk));
+	bool discarded = this->isDiscardedChunk(chunk);
+	unsigned char advice = this->getChunkAdvice(chunk);
+	if (this->skipRead || discarded || advice != 0) {
+		for (size_t i = 0 ; i < ptr->capacity ; i++) {
+			ptr->status[i].skipRead = this->skipRead || discarded;
+			ptr->status[i].changed = discarded;
+			ptr->status[i].advice = advice;
+		}
+	}
+
+	//register, we might race with another thread locking another segment, sequentially
+	//consistent so lockRange() sees the chunk or the thread locking in it sees the range
+	SegmentStatusChunk * expected = NULL;
+	if (this->chunks[chunk].compare_exchange_strong(expected, ptr)) {
+		if (discarded)
+			this->discarded[chunk].store(false, std::memory_order_release);
+		if (advice != 0)
+			this->advice[chunk].store(0, std::memory_order_release);
+		return ptr;
+	} else {
+		free(ptr);
+		return expected;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the status of the given segment and allocate its chunk if needed.
+ * @param id ID of the segment.
+**/
+SegmentStatus & SegmentStatusTable::get(size_t id)
+{
+	//check
+	assert(id < this->segments);
+	id += this->first;
+
+	//get chunk
+	size_t chunk = id / UMMAP_SEGMENT_STATUS_CHUNK;
+	SegmentStatusChunk * ptr = this->chunks[chunk].load(std::memory_order_acquire);
+	if (ptr == NULL)
+		ptr = this->allocateChunk(chunk);
+
+	//ok
+	return ptr->status[id % UMMAP_SEGMENT_STATUS_CHUNK];
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the status of the given segment without allocating its chunk.
+ * @param id ID of the segment.
+ * @return The status or NULL if never touched.
+**/
+SegmentStatus * SegmentStatusTable::find(size_t id)
+{
+	//check
+	assert(id < this->segments);
+	id += this->first;
+
+	//get chunk
+	SegmentStatusChunk * ptr = this->chunks[id / UMMAP_SEGMENT_STATUS_CHUNK].load(std::memory_order_acquire);
+	if (ptr == NULL)
+		return NULL;
+	else
+		return ptr->status + (id % UMMAP_SEGMENT_STATUS_CHUNK);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return a copy of the status of the given segment without allocating its chunk.
+ * @param id ID of the segment.
+**/
+SegmentStatus SegmentStatusTable::peek(size_t id) const
+{
+	//check
+	assert(id < this->segments);
+	id += this->first;
+
+	//get chunk
+	const SegmentStatusChunk * ptr = this->chunks[id / UMMAP_SEGMENT_STATUS_CHUNK].load(std::memory_order_acquire);
+	if (ptr != NULL)
+		return ptr->status[id % UMMAP_SEGMENT_STATUS_CHUNK];
+
+	//default
+	SegmentStatus status;
+	memset(&status, 0, sizeof(status));
+	status.skipRead = this->skipRead;
+	status.advice = this->getChunkAdvice(id / UMMAP_SEGMENT_STATUS_CHUNK);
+
+	//discarded without being allocated
+	if (this->isDiscardedChunk(id / UMMAP_SEGMENT_STATUS_CHUNK)) {
+		status.skipRead = true;
+		status.changed = true;
+	}
+	return status;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return a copy of the status of the given segment read atomically so it can
+ * be called without holding the segment lock. The status can be changed just
+ * after by the lock owner so it must only be used for hints (like checking if
+ * a fault has already been handled by another thread).
+ * @param id ID of the segment.
+**/
+SegmentStatus SegmentStatusTable::load(size_t id) const
+{
+	//check
+	assert(id < this->segments);
+
+	//get chunk
+	const SegmentStatusChunk * ptr = this->getChunk(id + this->first);
+	if (ptr == NULL)
+		return this->peek(id);
+	id += this->first;
+
+	//load
+	SegmentStatus status;
+	__atomic_load(ptr->status + (id % UMMAP_SEGMENT_STATUS_CHUNK), &status, __ATOMIC_ACQUIRE);
+	return status;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the chunk of a segment to access its lock bit, allocate it if needed.
+ * @param id Absolute ID of the segment (including the window offset).
+**/
+SegmentStatusChunk * SegmentStatusTable::getLockChunk(size_t id)
+{
+	size_t chunk = id / UMMAP_SEGMENT_STATUS_CHUNK;
+	SegmentStatusChunk * ptr = this->chunks[chunk].load(std::memory_order_acquire);
+	if (ptr == NULL)
+		ptr = this->allocateChunk(chunk);
+	return ptr;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Sleep until the given lock word changes. The waiter bit of the word is set
+ * first so the unlock only calls the kernel if someone sleeps on this word.
+ * @param ptr The chunk.
+ * @param wordId Index of the word in the lock words of the chunk.
+ * @param mask Bits we wait for, we do not sleep if none is set anymore.
+**/
+void SegmentStatusTable::waitLockWord(SegmentStatusChunk * ptr, size_t wordId, uint32_t mask)
+{
+	std::atomic<uint32_t> & word = ptr->locks[wordId];
+	ptr->lockWaiters[wordId / 64].fetch_or(1UL << (wordId % 64));
+	uint32_t value = word.load();
+	if (value & mask)
+		OS::futexWait(reinterpret_cast<volatile uint32_t*>(&word), value);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Check if the given segment is in the range locked by lockRange().
+ * @param id ID of the segment (relative to the window).
+**/
+bool SegmentStatusTable::isRangeLocked(size_t id) const
+{
+	//read the end first, it is set last by lockRange()
+	size_t end = this->lockedEnd.load();
+	return id < end && id >= this->lockedFirst.load();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Sleep until the range locked by lockRange() does not contain the given segment.
+ * @param id ID of the segment (relative to the window).
+**/
+void SegmentStatusTable::waitRangeUnlocked(size_t id)
+{
+	for (;;) {
+		uint32_t epoch = this->lockedEpoch.load();
+		if (this->isRangeLocked(id) == false)
+			return;
+		OS::futexWait(reinterpret_cast<volatile uint32_t*>(&this->lockedEpoch), epoch);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Take the lock bit of the given segment, its chunk is allocated if needed.
+ * Without contention it costs one atomic operation, otherwise the thread
+ * sleeps on the lock word with a futex. If the segment is in the range
+ * locked by lockRange() the bit is released and we wait the end of it.
+ * @param id ID of the segment.
+**/
+void SegmentStatusTable::lock(size_t id)
+{
+	//check
+	assert(id < this->segments);
+
+	//get word
+	size_t abs = id + this->first;
+	SegmentStatusChunk * ptr = this->getLockChunk(abs);
+	size_t local = abs % UMMAP_SEGMENT_STATUS_CHUNK;
+	std::atomic<uint32_t> & word = ptr->locks[local / 32];
+	uint32_t bit = 1U << (local % 32);
+
+	//loop until we get it
+	for (;;) {
+		//taken by another segment access
+		if (word.fetch_or(bit) & bit) {
+			this->waitLockWord(ptr, local / 32, bit);
+			continue;
+		}
+
+		//got it, check after taking it so lockRange() sees us or we see it
+		if (this->isRangeLocked(id) == false)
+			return;
+
+		//range locked, wait the end of it
+		this->unlock(id);
+		this->waitRangeUnlocked(id);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Try to take the lock bit of the given segment without waiting. Used to lock
+ * extra segments while already holding one without risking a dead lock.
+ * @param id ID of the segment.
+ * @return True if the lock has been taken, false if already locked or in
+ * the range locked by lockRange().
+**/
+bool SegmentStatusTable::tryLock(size_t id)
+{
+	//check
+	assert(id < this->segments);
+
+	//get word
+	size_t abs = id + this->first;
+	SegmentStatusChunk * ptr = this->getLockChunk(abs);
+	size_t local = abs % UMMAP_SEGMENT_STATUS_CHUNK;
+	std::atomic<uint32_t> & word = ptr->locks[local / 32];
+	uint32_t bit = 1U << (local % 32);
+
+	//try once
+	if (word.fetch_or(bit) & bit)
+		return false;
+
+	//range locked
+	if (this->isRangeLocked(id)) {
+		this->unlock(id);
+		return false;
+	}
+
+	//ok
+	return true;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release the lock bit of the given segment and wake up the threads waiting
+ * on its lock word if any.
+ * @param id ID of the segment.
+**/
+void SegmentStatusTable::unlock(size_t id)
+{
+	//check
+	assert(id < this->segments);
+	id += this->first;
+
+	//get chunk, allocated by lock()
+	SegmentStatusChunk * ptr = this->chunks[id / UMMAP_SEGMENT_STATUS_CHUNK].load(std::memory_order_acquire);
+	assert(ptr != NULL);
+
+	//get word
+	size_t local = id % UMMAP_SEGMENT_STATUS_CHUNK;
+	size_t wordId = local / 32;
+	std::atomic<uint32_t> & word = ptr->locks[wordId];
+	uint32_t bit = 1U << (local % 32);
+
+	//release
+	word.fetch_and(~bit);
+
+	//wake up, they will check again their own bit and set the waiter bit back if still waiting
+	std::atomic<uint64_t> & waiters = ptr->lockWaiters[wordId / 64];
+	uint64_t waiterBit = 1UL << (wordId % 64);
+	if ((waiters.load() & waiterBit) && (waiters.fetch_and(~waiterBit) & waiterBit))
+		OS::futexWake(reinterpret_cast<volatile uint32_t*>(&word));
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Lock all the segments of the given range in ascending order. If one of them
+ * is in the range locked by lockRange() all the ones already taken are
+ * released before waiting so the range lock owner can get them.
+ * @param id First segment to lock.
+ * @param end Segment after the last one to lock.
+**/
+void SegmentStatusTable::lockSegments(size_t id, size_t end)
+{
+	size_t cur = id;
+	while (cur < end) {
+		//lock next
+		if (this->tryLock(cur)) {
+			cur++;
+			continue;
+		}
+
+		//release ours and wait the range lock
+		if (this->isRangeLocked(cur)) {
+			this->unlockSegments(id, cur);
+			this->waitRangeUnlocked(cur);
+			cur = id;
+			continue;
+		}
+
+		//held by another segment access
+		size_t abs = cur + this->first;
+		size_t local = abs % UMMAP_SEGMENT_STATUS_CHUNK;
+		this->waitLockWord(this->getLockChunk(abs), local / 32, 1U << (local % 32));
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Unlock the segments locked by lockSegments().
+ * @param id First segment to unlock.
+ * @param end Segment after the last one to unlock.
+**/
+void SegmentStatusTable::unlockSegments(size_t id, size_t end)
+{
+	for (size_t cur = id ; cur < end ; cur++)
+		this->unlock(cur);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Exclude the accesses to the segments of the given range through lock() until
+ * unlockRange() is called, without taking their lock bit one by one: the range
+ * is published then we wait for the bits already taken in the allocated chunks
+ * to be released. The not allocated chunks have no bit taken and the threads
+ * allocating them see the range once their bit is set. Only one range can be
+ * locked at a time, the caller must serialize the calls. It must not hold a
+ * segment lock.
+ * @param id First segment of the range.
+ * @param end Segment after the last one.
+**/
+void SegmentStatusTable::lockRange(size_t id, size_t end)
+{
+	//check
+	assert(id <= end && end <= this->segments);
+	assert(this->lockedEnd.load() == 0);
+
+	//publish, the end last as it is read first by isRangeLocked()
+	this->lockedFirst.store(id);
+	this->lockedEnd.store(end);
+
+	//wait the bits already taken
+	for (size_t cur = id ; cur < end ; ) {
+		//skip not allocated chunks (see allocateChunk())
+		size_t abs = cur + this->first;
+		SegmentStatusChunk * ptr = this->chunks[abs / UMMAP_SEGMENT_STATUS_CHUNK].load();
+		if (ptr == NULL) {
+			cur += UMMAP_SEGMENT_STATUS_CHUNK - abs % UMMAP_SEGMENT_STATUS_CHUNK;
+			continue;
+		}
+
+		//mask of the range in the word
+		size_t local = abs % UMMAP_SEGMENT_STATUS_CHUNK;
+		size_t bits = 32 - local % 32;
+		if (bits > end - cur)
+			bits = end - cur;
+		uint32_t mask = (bits == 32) ? ~0U : ((1U << bits) - 1) << (local % 32);
+
+		//wait
+		while (ptr->locks[local / 32].load() & mask)
+			this->waitLockWord(ptr, local / 32, mask);
+
+		//move
+		cur += bits;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release the range locked by lockRange() and wake up the threads waiting it.
+**/
+void SegmentStatusTable::unlockRange(void)
+{
+	this->lockedEnd.store(0);
+	this->lockedFirst.store(0);
+	this->lockedEpoch.fetch_add(1);
+	OS::futexWake(reinterpret_cast<volatile uint32_t*>(&this->lockedEpoch));
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Remember if the segment was dirty when evicted so it can be reloaded directly
+ * in write mode. The bit is kept while the segment is not mapped. The caller
+ * must hold the segment lock.
+ * @param id ID of the segment.
+ * @param value Value of the bit.
+**/
+void SegmentStatusTable::setWriteIntent(size_t id, bool value)
+{
+	//check
+	assert(id < this->segments);
+	id += this->first;
+
+	//get chunk, allocated when the segment has been mapped
+	SegmentStatusChunk * ptr = this->getChunk(id);
+	assert(ptr != NULL);
+
+	//apply
+	setBit(ptr->writeIntent, id % UMMAP_SEGMENT_STATUS_CHUNK, value);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Check if the segment was dirty on its last eviction.
+ * @param id ID of the segment.
+**/
+bool SegmentStatusTable::hasWriteIntent(size_t id) const
+{
+	//check
+	assert(id < this->segments);
+	id += this->first;
+
+	//not allocated
+	SegmentStatusChunk * ptr = this->getChunk(id);
+	if (ptr == NULL)
+		return false;
+
+	//read
+	return getBit(ptr->writeIntent, id % UMMAP_SEGMENT_STATUS_CHUNK);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Mark the segment as pinned so the policies do not evict it (see Mapping::pin()).
+ * The caller must hold the segment lock.
+ * @param id ID of the segment.
+ * @param value Value of the bit.
+**/
+void SegmentStatusTable::setPinned(size_t id, bool value)
+{
+	//check
+	assert(id < this->segments);
+	id += this->first;
+
+	//get chunk, allocated when the segment has been mapped
+	SegmentStatusChunk * ptr = this->getChunk(id);
+	assert(ptr != NULL);
+
+	//apply
+	setBit(ptr->pinned, id % UMMAP_SEGMENT_STATUS_CHUNK, value);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Check if the segment is pinned.
+ * @param id ID of the segment.
+**/
+bool SegmentStatusTable::isPinned(size_t id) const
+{
+	//check
+	assert(id < this->segments);
+	id += this->first;
+
+	//not allocated
+	SegmentStatusChunk * ptr = this->getChunk(id);
+	if (ptr == NULL)
+		return false;
+
+	//read
+	return getBit(ptr->pinned, id % UMMAP_SEGMENT_STATUS_CHUNK);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Set or clear a bit in one of the per segment bitmaps of a chunk. The other
+ * segments of the word are protected by other locks so it is atomic.
+ * @param bits The bitmap.
+ * @param local ID of the segment in the chunk.
+ * @param value Value of the bit.
+**/
+void SegmentStatusTable::setBit(std::atomic<uint64_t> * bits, size_t local, bool value)
+{
+	uint64_t bit = 1UL << (local % 64);
+	if (value)
+		bits[local / 64].fetch_or(bit);
+	else
+		bits[local / 64].fetch_and(~bit);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Read a bit from one of the per segment bitmaps of a chunk.
+ * @param bits The bitmap.
+ * @param local ID of the segment in the chunk.
+**/
+bool SegmentStatusTable::getBit(const std::atomic<uint64_t> * bits, size_t local)
+{
+	return (bits[local / 64].load() >> (local % 64)) & 1;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Set or clear a bit in the given index. The summary bit might be transiently
+ * cleared while another thread set a bit in the same word so it is checked
+ * again after clearing it.
+ * @param index The index to update.
+ * @param local ID of the segment in the chunk.
+ * @param value Value of the bit.
+**/
+void SegmentStatusTable::setInIndex(SegmentStatusIndex & index, size_t local, bool value)
+{
+	//compute
+	size_t word = local / 64;
+	uint64_t bit = 1UL << (local % 64);
+	uint64_t summaryBit = 1UL << (word % 64);
+	std::atomic<uint64_t> & summary = index.summary[word / 64];
+
+	//apply
+	if (value) {
+		uint64_t old = index.bits[word].fetch_or(bit);
+		if ((old & bit) == 0) {
+			index.count.fetch_add(1);
+			if (old == 0)
+				summary.fetch_or(summaryBit);
+		}
+	} else {
+		uint64_t old = index.bits[word].fetch_and(~bit);
+		if (old & bit) {
+			index.count.fetch_sub(1);
+			if (old == bit) {
+				summary.fetch_and(~summaryBit);
+				if (index.bits[word].load() != 0)
+					summary.fetch_or(summaryBit);
+			}
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Update the resident and dirty indexes from the status of the given segment.
+ * It must be called with the segment lock after changing the mapped, dirty or
+ * inFlight fields.
+ * @param id ID of the segment.
+**/
+void SegmentStatusTable::updateIndex(size_t id)
+{
+	//check
+	assert(id < this->segments);
+	id += this->first;
+
+	//get chunk, it has been allocated when changing the status
+	SegmentStatusChunk * ptr = this->chunks[id / UMMAP_SEGMENT_STATUS_CHUNK].load(std::memory_order_acquire);
+	assert(ptr != NULL);
+
+	//update
+	size_t local = id % UMMAP_SEGMENT_STATUS_CHUNK;
+	const SegmentStatus & status = ptr->status[local];
+	setInIndex(ptr->resident, local, status.mapped);
+	setInIndex(ptr->dirty, local, status.mapped && (status.dirty || status.inFlight));
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Search the first bit set in the chunk index starting from the given segment.
+ * @param index The index to search in.
+ * @param local ID of the segment in the chunk to start from.
+ * @return The ID in the chunk or SEGMENT_INDEX_NONE if not found.
+**/
+size_t SegmentStatusTable::nextInChunkIndex(const SegmentStatusIndex & index, size_t local)
+{
+	//check in the current word
+	size_t word = local / 64;
+	uint64_t bits = index.bits[word].load(std::memory_order_relaxed) & (~0UL << (local % 64));
+	if (bits != 0)
+		return word * 64 + __builtin_ctzl(bits);
+
+	//search next word with the summary
+	word++;
+	while (word < index.words) {
+		uint64_t summary = index.summary[word / 64].load(std::memory_order_relaxed) & (~0UL << (word % 64));
+		if (summary == 0) {
+			word = (word / 64 + 1) * 64;
+			continue;
+		}
+		word = (word / 64) * 64 + __builtin_ctzl(summary);
+		bits = index.bits[word].load(std::memory_order_relaxed);
+		if (bits != 0)
+			return word * 64 + __builtin_ctzl(bits);
+		word++;
+	}
+
+	//not found
+	return SEGMENT_INDEX_NONE;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Search the first segment set in the resident or dirty index.
+ * @param id ID of the segment to start from.
+ * @param end ID of the segment to stop at.
+ * @param dirty Search in the dirty index if true, resident otherwise.
+ * @return The ID of the segment or end if none.
+**/
+size_t SegmentStatusTable::nextInIndex(size_t id, size_t end, bool dirty) const
+{
+	//to absolute IDs
+	id += this->first;
+	end += this->first;
+
+	//loop on chunks
+	while (id < end) {
+		//get chunk
+		size_t chunk = id / UMMAP_SEGMENT_STATUS_CHUNK;
+		const SegmentStatusChunk * ptr = this->chunks[chunk].load(std::memory_order_acquire);
+		size_t chunkStart = chunk * UMMAP_SEGMENT_STATUS_CHUNK;
+
+		//search in chunk if not empty
+		if (ptr != NULL) {
+			const SegmentStatusIndex & index = dirty ? ptr->dirty : ptr->resident;
+			if (index.count.load(std::memory_order_relaxed) > 0) {
+				size_t local = nextInChunkIndex(index, id - chunkStart);
+				if (local != SEGMENT_INDEX_NONE)
+					return ((chunkStart + local < end) ? chunkStart + local : end) - this->first;
+			}
+		}
+
+		//move to next chunk
+		id = chunkStart + UMMAP_SEGMENT_STATUS_CHUNK;
+	}
+
+	//not found
+	return end - this->first;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the first segment starting from id which is in an allocated chunk.
+ * It is used to skip the never touched regions when looping on the segments.
+ * @param id ID of the segment to start from.
+ * @param end ID of the segment to stop at.
+ * @return The ID of the segment or end if none.
+**/
+size_t SegmentStatusTable::nextTouched(size_t id, size_t end) const
+{
+	//to absolute IDs
+	id += this->first;
+	end += this->first;
+
+	//loop on chunks
+	while (id < end) {
+		//is allocated or discarded
+		size_t chunk = id / UMMAP_SEGMENT_STATUS_CHUNK;
+		if (this->chunks[chunk].load(std::memory_order_acquire) != NULL || this->isDiscardedChunk(chunk))
+			return id - this->first;
+
+		//move to next chunk
+		id = (chunk + 1) * UMMAP_SEGMENT_STATUS_CHUNK;
+	}
+
+	//not found
+	return end - this->first;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the first mapped segment starting from id.
+ * @param id ID of the segment to start from.
+ * @param end ID of the segment to stop at.
+ * @return The ID of the segment or end if none.
+**/
+size_t SegmentStatusTable::nextResident(size_t id, size_t end) const
+{
+	return this->nextInIndex(id, end, false);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the first mapped segment which is dirty or in-flight starting from id.
+ * @param id ID of the segment to start from.
+ * @param end ID of the segment to stop at.
+ * @return The ID of the segment or end if none.
+**/
+size_t SegmentStatusTable::nextDirty(size_t id, size_t end) const
+{
+	return this->nextInIndex(id, end, true);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Sum the counters of the resident or dirty index of all the chunks.
+ * @param dirty Use the dirty index if true, resident otherwise.
+**/
+size_t SegmentStatusTable::countIndex(bool dirty) const
+{
+	//vars
+	size_t count = 0;
+
+	//sum the chunk counters
+	if (this->ownChunks) {
+		for (size_t i = 0 ; i < this->chunksCnt ; i++) {
+			const SegmentStatusChunk * ptr = this->chunks[i].load(std::memory_order_acquire);
+			if (ptr != NULL)
+				count += (dirty ? ptr->dirty : ptr->resident).count.load(std::memory_order_relaxed);
+		}
+		return count;
+	}
+
+	//window, count the bits of its range
+	const size_t end = this->first + this->segments;
+	for (size_t id = this->first ; id < end ; ) {
+		//bits until the end of the word
+		size_t local = id % UMMAP_SEGMENT_STATUS_CHUNK;
+		size_t bits = 64 - local % 64;
+		if (bits > end - id)
+			bits = end - id;
+
+		//count
+		const SegmentStatusChunk * ptr = this->getChunk(id);
+		if (ptr != NULL) {
+			uint64_t word = (dirty ? ptr->dirty : ptr->resident).bits[local / 64].load(std::memory_order_relaxed) >> (local % 64);
+			if (bits < 64)
+				word &= (1UL << bits) - 1;
+			count += __builtin_popcountl(word);
+		}
+
+		//move
+		id += bits;
+	}
+
+	//ok
+	return count;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of mapped segments.
+**/
+size_t SegmentStatusTable::getResidentCount(void) const
+{
+	return this->countIndex(false);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of mapped segments which are dirty or in-flight.
+**/
+size_t SegmentStatusTable::getDirtyCount(void) const
+{
+	return this->countIndex(true);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Mark all the segments to be filled by zeroes on first access instead of
+ * being read. It must be called before the mapping is used.
+**/
+void SegmentStatusTable::setSkipRead(void)
+{
+	//window, do not change the default of the shared chunks
+	if (this->ownChunks == false) {
+		for (size_t id = 0 ; id < this->segments ; id++)
+			this->get(id).skipRead = true;
+		return;
+	}
+
+	//for the next chunks
+	this->skipRead = true;
+
+	//for the already allocated ones
+	for (size_t id = this->nextTouched(0, this->segments) ; id < this->segments ; id = this->nextTouched(id + 1, this->segments)) {
+		SegmentStatus * status = this->find(id);
+		if (status != NULL)
+			status->skipRead = true;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Reset the given segments so they are not mapped, not dirty, read back as
+ * zeroes and are considered as changed for the next checkpoint (see
+ * Mapping::discard()). The not yet allocated chunks fully covered by the range
+ * are only marked as discarded, the others are allocated if needed. The caller
+ * must ensure no other thread access the range.
+ * @param id ID of the first segment.
+ * @param end ID of the segment after the last one.
+**/
+void SegmentStatusTable::discardRange(size_t id, size_t end)
+{
+	//check
+	assert(id <= end && end <= this->segments);
+
+	//to absolute IDs
+	id += this->first;
+	end += this->first;
+
+	//loop on chunks
+	while (id < end) {
+		//range in the chunk
+		size_t chunk = id / UMMAP_SEGMENT_STATUS_CHUNK;
+		size_t chunkEnd = (chunk + 1) * UMMAP_SEGMENT_STATUS_CHUNK;
+		if (chunkEnd > end)
+			chunkEnd = end;
+
+		//fully covered and never touched, only mark it
+		SegmentStatusChunk * ptr = this->getChunk(id);
+		bool full = (id % UMMAP_SEGMENT_STATUS_CHUNK == 0 && (chunkEnd % UMMAP_SEGMENT_STATUS_CHUNK == 0 || chunkEnd == this->segments));
+		if (ptr == NULL && full && this->discarded != NULL) {
+			this->discarded[chunk].store(true, std::memory_order_release);
+			id = chunkEnd;
+			continue;
+		}
+
+		//reset the segments
+		if (ptr == NULL)
+			ptr = this->allocateChunk(chunk);
+		for ( ; id < chunkEnd ; id++) {
+			size_t local = id % UMMAP_SEGMENT_STATUS_CHUNK;
+			SegmentStatus & status = ptr->status[local];
+			status.mapped = false;
+			status.dirty = false;
+			status.inFlight = false;
+			status.evicted = false;
+			status.skipRead = true;
+			status.changed = true;
+			setInIndex(ptr->resident, local, false);
+			setInIndex(ptr->dirty, local, false);
+			setBit(ptr->writeIntent, local, false);
+		}
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Set the access hint of the given segments (see Mapping::advise()). The not
+ * yet allocated chunks fully covered by the range only keep the hint for the
+ * time they are allocated, the partially covered ones are allocated only if
+ * the hint differs from their current one. The caller must ensure no other
+ * thread access the range.
+ * @param id ID of the first segment.
+ * @param end ID of the segment after the last one.
+ * @param advice The hint to apply (UMMAP_ADV_NORMAL, UMMAP_ADV_SEQUENTIAL,
+ * UMMAP_ADV_RANDOM or UMMAP_ADV_NOREUSE).
+**/
+void SegmentStatusTable::adviseRange(size_t id, size_t end, unsigned char advice)
+{
+	//check
+	assert(id <= end && end <= this->segments);
+
+	//to absolute IDs
+	id += this->first;
+	end += this->first;
+
+	//loop on chunks
+	while (id < end) {
+		//range in the chunk
+		size_t chunk = id / UMMAP_SEGMENT_STATUS_CHUNK;
+		size_t chunkEnd = (chunk + 1) * UMMAP_SEGMENT_STATUS_CHUNK;
+		if (chunkEnd > end)
+			chunkEnd = end;
+
+		//never touched, only mark it if fully covered
+		SegmentStatusChunk * ptr = this->getChunk(id);
+		if (ptr == NULL && this->getChunkAdvice(chunk) == advice) {
+			id = chunkEnd;
+			continue;
+		}
+		bool full = (id % UMMAP_SEGMENT_STATUS_CHUNK == 0 && (chunkEnd % UMMAP_SEGMENT_STATUS_CHUNK == 0 || chunkEnd == this->segments));
+		if (ptr == NULL && full && this->advice != NULL) {
+			this->advice[chunk].store(advice, std::memory_order_release);
+			id = chunkEnd;
+			continue;
+		}
+
+		//set the segments
+		if (ptr == NULL)
+			ptr = this->allocateChunk(chunk);
+		for ( ; id < chunkEnd ; id++)
+			ptr->status[id % UMMAP_SEGMENT_STATUS_CHUNK].advice = advice;
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Change the number of segments of the table. The removed segments are reset
+ * to the default state and their chunks freed, the added ones are in the
+ * default state. The caller must ensure no other thread access the table
+ * during the call as the chunk pointers are reallocated.
+ * @param segments The new number of segments.
+**/
+void SegmentStatusTable::resize(size_t segments)
+{
+	//check
+	assume(this->ownChunks, "Cannot resize a status table window !");
+
+	//reset the removed segments, they must be in default state if grown again
+	if (segments < this->segments) {
+		size_t lastChunk = segments / UMMAP_SEGMENT_STATUS_CHUNK;
+		if (segments % UMMAP_SEGMENT_STATUS_CHUNK != 0 && this->getChunk(segments) == NULL && (this->isDiscardedChunk(lastChunk) || this->getChunkAdvice(lastChunk) != 0))
+			this->allocateChunk(lastChunk);
+		this->clearRange(segments, this->segments);
+		if (this->skipRead)
+			for (size_t id = this->nextTouched(segments, this->segments) ; id < this->segments ; id = this->nextTouched(id + 1, this->segments)) {
+				SegmentStatus * status = this->find(id);
+				if (status != NULL)
+					status->skipRead = true;
+			}
+	}
+
+	//reallocate the chunk pointers
+	size_t chunksCnt = (segments + UMMAP_SEGMENT_STATUS_CHUNK - 1) / UMMAP_SEGMENT_STATUS_CHUNK;
+	if (chunksCnt != this->chunksCnt) {
+		//copy the kept ones
+		std::atomic<SegmentStatusChunk*> * chunks = new std::atomic<SegmentStatusChunk*>[chunksCnt];
+		std::atomic<bool> * discarded = new std::atomic<bool>[chunksCnt];
+		std::atomic<unsigned char> * advice = new std::atomic<unsigned char>[chunksCnt];
+		for (size_t i = 0 ; i < chunksCnt ; i++) {
+			chunks[i].store((i < this->chunksCnt) ? this->chunks[i].load(std::memory_order_relaxed) : NULL, std::memory_order_relaxed);
+			discarded[i].store((i < this->chunksCnt) ? this->discarded[i].load(std::memory_order_relaxed) : false, std::memory_order_relaxed);
+			advice[i].store((i < this->chunksCnt) ? this->advice[i].load(std::memory_order_relaxed) : 0, std::memory_order_relaxed);
+		}
+
+		//free the removed ones
+		for (size_t i = chunksCnt ; i < this->chunksCnt ; i++)
+			free(this->chunks[i].load(std::memory_order_relaxed));
+
+		//replace
+		delete [] this->chunks;
+		delete [] this->discarded;
+		delete [] this->advice;
+		this->chunks = chunks;
+		this->discarded = discarded;
+		this->advice = advice;
+		this->chunksCnt = chunksCnt;
+	}
+
+	//grow the last chunk if it was sized to the previous end
+	size_t lastChunk = (this->segments > 0) ? (this->segments - 1) / UMMAP_SEGMENT_STATUS_CHUNK : 0;
+	SegmentStatusChunk * last = (segments > this->segments && this->segments > 0) ? this->chunks[lastChunk].load(std::memory_order_relaxed) : NULL;
+
+	//set
+	this->segments = segments;
+
+	//replace the last chunk by a larger one
+	if (last != NULL && last->capacity < this->getChunkCapacity(lastChunk)) {
+		SegmentStatusChunk * ptr = createChunk(this->getChunkCapacity(lastChunk));
+		copyChunk(ptr, last);
+		this->chunks[lastChunk].store(ptr, std::memory_order_release);
+		free(last);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Copy the state of the segments of the given table, used to move from a
+ * window to an owned table. Only the segments fitting in the current table are
+ * copied. The caller must hold the locks protecting both tables.
+ * @param source The table to copy.
+**/
+void SegmentStatusTable::copyFrom(const SegmentStatusTable & source)
+{
+	//default for the not copied segments
+	this->skipRead = source.skipRead;
+
+	//copy the touched ones
+	const size_t end = (source.segments < this->segments) ? source.segments : this->segments;
+	for (size_t id = source.nextTouched(0, end) ; id < end ; id = source.nextTouched(id + 1, end)) {
+		this->get(id) = source.peek(id);
+		this->updateIndex(id);
+		this->setWriteIntent(id, source.hasWriteIntent(id));
+		this->setPinned(id, source.isPinned(id));
+	}
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the memory used by the table.
+**/
+size_t SegmentStatusTable::getMemory(void) const
+{
+	//window, account its share of the chunks
+	if (this->ownChunks == false)
+		return this->segments * getChunkMemory(UMMAP_SEGMENT_STATUS_CHUNK) / UMMAP_SEGMENT_STATUS_CHUNK;
+
+	//pointers
+	size_t memory = this->chunksCnt * sizeof(std::atomic<SegmentStatusChunk*>);
+
+	//chunks
+	for (size_t i = 0 ; i < this->chunksCnt ; i++) {
+		const SegmentStatusChunk * ptr = this->chunks[i].load(std::memory_order_relaxed);
+		if (ptr != NULL)
+			memory += getChunkMemory(ptr->capacity);
+	}
+
+	//ok
+	return memory;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the first segment of the window in the parent table (0 if not a window).
+**/
+size_t SegmentStatusTable::getFirst(void) const
+{
+	return this->first;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of segments in the table.
+**/
+size_t SegmentStatusTable::getSegments(void) const
+{
+	return this->segments;
+}
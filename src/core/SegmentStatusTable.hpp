@@ -0,0 +1,237 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_SEGMENT_STATUS_TABLE_HPP
+#define UMMAP_SEGMENT_STATUS_TABLE_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  DEFINES  ********************/
+/** Number of segment status allocated at once by SegmentStatusTable. **/
+#define UMMAP_SEGMENT_STATUS_CHUNK (64UL*1024UL)
+
+/*********************  STRUCT  *********************/
+/**
+ * Struct defining the status variable to track the stage of each segment of a mapping.
+ * All the fields are packed in a single byte, avoid using int based bitfields which
+ * would enlarge it to 4 bytes. A status filled with zeroes is the state of a segment
+ * never touched so the status table can be allocated lazily with zeroed memory.
+**/
+struct SegmentStatus
+{
+	/** Last write access. **/
+	//size_t time:56;
+	/** True if the segment has been evicted, used to count the re-faults. **/
+	bool evicted:1;
+	/**
+	 * Access hint given by ummap_advise() (UMMAP_ADV_NORMAL, UMMAP_ADV_SEQUENTIAL,
+	 * UMMAP_ADV_RANDOM or UMMAP_ADV_NOREUSE).
+	**/
+	unsigned char advice:2;
+	/**
+	 * True if the segment has been modified since the last checkpoint (see
+	 * Mapping::checkpoint()).
+	**/
+	bool changed:1;
+	/**
+	 * True if the segment content is waiting to be written by an asynchronous
+	 * flush. The segment stays write protected until it is written.
+	**/
+	bool inFlight:1;
+	/** True if the segment is mapped **/
+	bool mapped:1;
+	/**
+	 * True if the segment has been touched by a write access and is out of
+	 * sync with the storage.
+	**/
+	bool dirty:1;
+	/**
+	 * If true the segment will be filled by zeroes on the first access. If not it will
+	 * be read from the storage on the first read access.
+	**/
+	bool skipRead:1;
+};
+static_assert(sizeof(SegmentStatus) == 1, "SegmentStatus should stay packed on one byte");
+
+/*********************  STRUCT  *********************/
+/**
+ * Two levels bitmap used to quickly find the segments of a chunk matching
+ * a state (resident or dirty). Each bit of the summary tells if the related
+ * word of the bitmap is not empty so a scan skips 4096 segments per summary
+ * word. The words are updated with atomic operations as the segments of a
+ * same word are protected by different segment locks.
+**/
+struct SegmentStatusIndex
+{
+	/** One bit per segment. **/
+	std::atomic<uint64_t> * bits;
+	/** One bit per word of bits. **/
+	std::atomic<uint64_t> * summary;
+	/** Number of words in bits. **/
+	size_t words;
+	/** Number of bits set in the index. **/
+	std::atomic<size_t> count;
+};
+
+/*********************  STRUCT  *********************/
+/**
+ * Chunk of the status table with the indexes of its resident and dirty segments
+ * and the lock bits of its segments. The arrays are allocated in the same block
+ * than the chunk and sized for its capacity so the last chunk of a small table
+ * does not take the memory of UMMAP_SEGMENT_STATUS_CHUNK segments (see
+ * SegmentStatusTable::createChunk()).
+**/
+struct SegmentStatusChunk
+{
+	/** Status of the segments of the chunk. **/
+	SegmentStatus * status;
+	/** Index of the mapped segments. **/
+	SegmentStatusIndex resident;
+	/** Index of the dirty or in-flight segments. **/
+	SegmentStatusIndex dirty;
+	/** One bit per segment telling it was dirty when evicted (see setWriteIntent()). **/
+	std::atomic<uint64_t> * writeIntent;
+	/** One bit per segment telling it is pinned (see setPinned()). **/
+	std::atomic<uint64_t> * pinned;
+	/** One lock bit per segment, the words are used as futex. **/
+	std::atomic<uint32_t> * locks;
+	/** One bit per lock word telling a thread might sleep on it. **/
+	std::atomic<uint64_t> * lockWaiters;
+	/** Number of segments the chunk can hold, multiple of 64. **/
+	size_t capacity;
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Table of the segment status of a mapping. The status are allocated by chunks
+ * of UMMAP_SEGMENT_STATUS_CHUNK segments on the first access so a large sparse
+ * mapping only consumes memory (and creation/destruction time) for the touched
+ * regions. The last chunk of a table is sized to the segments it covers so a
+ * small mapping only pays for its own segments. The segments of a not yet
+ * allocated chunk are in the default state.
+ *
+ * The table also indexes the resident and dirty segments so the operations on
+ * a range (flush, drop...) run in O(resident) or O(dirty) instead of O(size).
+ * The caller must call updateIndex() after changing the mapped, dirty or inFlight
+ * fields of a status.
+ *
+ * A write intent and a pinned bit are also kept per segment out of the status
+ * byte, the write intent surviving the evictions.
+ *
+ * Each segment also has a lock bit (see lock()) used by the mapping to protect
+ * the access to its status. A whole range can also be locked at once without
+ * taking its bits (see lockRange()). Allocating a chunk is thread safe.
+ *
+ * A table can also be built as a window over a range of a larger table (see
+ * SegmentStatusPool) so many small mappings share the same chunks instead of
+ * allocating one each. The IDs given to a window are relative to its first
+ * segment and the range is reset to the default state when it is destroyed.
+ *
+ * A table owning its chunks can be resized (see resize()) but a window cannot,
+ * its content has to be copied in a new table (see copyFrom()).
+ *
+ * Discarding a range (see discardRange()) or giving it an access hint (see
+ * adviseRange()) only marks the not yet allocated chunks it fully covers so a
+ * large never touched range stays unallocated.
+**/
+class SegmentStatusTable
+{
+	public:
+		SegmentStatusTable(size_t segments);
+		SegmentStatusTable(SegmentStatusTable & parent, size_t first, size_t segments);
+		~SegmentStatusTable(void);
+		SegmentStatus & get(size_t id);
+		SegmentStatus * find(size_t id);
+		SegmentStatus peek(size_t id) const;
+		SegmentStatus load(size_t id) const;
+		void lock(size_t id);
+		bool tryLock(size_t id);
+		void unlock(size_t id);
+		void lockSegments(size_t id, size_t end);
+		void unlockSegments(size_t id, size_t end);
+		void lockRange(size_t id, size_t end);
+		void unlockRange(void);
+		void updateIndex(size_t id);
+		void setWriteIntent(size_t id, bool value);
+		bool hasWriteIntent(size_t id) const;
+		void setPinned(size_t id, bool value);
+		bool isPinned(size_t id) const;
+		size_t nextTouched(size_t id, size_t end) const;
+		size_t nextResident(size_t id, size_t end) const;
+		size_t nextDirty(size_t id, size_t end) const;
+		size_t getResidentCount(void) const;
+		size_t getDirtyCount(void) const;
+		void setSkipRead(void);
+		void discardRange(size_t id, size_t end);
+		void adviseRange(size_t id, size_t end, unsigned char advice);
+		void resize(size_t segments);
+		void copyFrom(const SegmentStatusTable & source);
+		size_t getMemory(void) const;
+		size_t getFirst(void) const;
+		size_t getSegments(void) const;
+		static size_t getChunkMemory(size_t capacity);
+	private:
+		static SegmentStatusChunk * createChunk(size_t capacity);
+		static void copyChunk(SegmentStatusChunk * dest, const SegmentStatusChunk * source);
+		size_t getChunkCapacity(size_t chunk) const;
+		SegmentStatusChunk * allocateChunk(size_t chunk);
+		SegmentStatusChunk * getChunk(size_t id) const;
+		SegmentStatusChunk * getLockChunk(size_t id);
+		void waitLockWord(SegmentStatusChunk * ptr, size_t wordId, uint32_t mask);
+		bool isRangeLocked(size_t id) const;
+		void waitRangeUnlocked(size_t id);
+		bool isDiscardedChunk(size_t chunk) const;
+		unsigned char getChunkAdvice(size_t chunk) const;
+		void clearRange(size_t first, size_t end);
+		size_t nextInIndex(size_t id, size_t end, bool dirty) const;
+		size_t countIndex(bool dirty) const;
+		static void setInIndex(SegmentStatusIndex & index, size_t local, bool value);
+		static size_t nextInChunkIndex(const SegmentStatusIndex & index, size_t local);
+		static void setBit(std::atomic<uint64_t> * bits, size_t local, bool value);
+		static bool getBit(const std::atomic<uint64_t> * bits, size_t local);
+	private:
+		/** Pointers to the chunks, NULL if not yet allocated. **/
+		std::atomic<SegmentStatusChunk*> * chunks;
+		/** Number of chunks covering the mapping. **/
+		size_t chunksCnt;
+		/** Number of segments in the table. **/
+		size_t segments;
+		/** First segment of the window in the chunks (0 if not a window). **/
+		size_t first;
+		/** True if the table owns the chunks, false for a window. **/
+		bool ownChunks;
+		/** Default value of the skipRead flag for the not yet allocated chunks. **/
+		bool skipRead;
+		/**
+		 * One flag per chunk telling it has been discarded without being allocated
+		 * (see discardRange()), its segments are then in the discarded state instead
+		 * of the default one. NULL for a window.
+		**/
+		std::atomic<bool> * discarded;
+		/**
+		 * Access hint of the segments of each not yet allocated chunk (see
+		 * adviseRange()), applied to its segments when allocated. NULL for a window.
+		**/
+		std::atomic<unsigned char> * advice;
+		/** First segment of the range locked by lockRange(). **/
+		std::atomic<size_t> lockedFirst;
+		/** Segment after the last one of the range locked by lockRange(), 0 if none. **/
+		std::atomic<size_t> lockedEnd;
+		/** Incremented by unlockRange() to wake up the threads waiting the range, used as futex. **/
+		std::atomic<uint32_t> lockedEpoch;
+};
+
+}
+
+#endif //UMMAP_SEGMENT_STATUS_TABLE_HPP
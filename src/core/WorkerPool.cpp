@@ -0,0 +1,167 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//std
+#include <cassert>
+//internal
+#include "../portability/OS.hpp"
+//local
+#include "WorkerPool.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+/**
+ * Constructor of the pool, no thread is started before the first batch.
+**/
+WorkerPool::WorkerPool(void)
+{
+	this->idle = 0;
+	this->stop = false;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Destructor of the pool, join the threads once they ran the posted tasks.
+ * No batch must be running.
+**/
+WorkerPool::~WorkerPool(void)
+{
+	//notify
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+		this->stop = true;
+	}
+	this->cond.notify_all();
+
+	//join
+	for (auto & worker : this->workers)
+		worker.join();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Run a batch of tasks and wait for all of them. The last task is run by
+ * the calling thread while the others are given to the threads of the pool
+ * which is grown if it has less idle threads than the queued tasks.
+ * @param tasks The tasks to run.
+**/
+void WorkerPool::run(std::vector<std::function<void()>> & tasks)
+{
+	//nothing to do
+	if (tasks.empty())
+		return;
+
+	//counter of the batch, protected by the pool mutex
+	size_t remaining = tasks.size() - 1;
+
+	//CRITICAL SECTION
+	if (remaining > 0) {
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+		//grow so each queued task has an idle thread, the posted ones might
+		//block on locks held by the caller until the batch is done
+		size_t available = (this->idle > this->tasks.size()) ? this->idle - this->tasks.size() : 0;
+		for ( ; available < remaining ; available++)
+			this->startThread();
+
+		//queue
+		for (size_t i = 0 ; i < remaining ; i++) {
+			WorkerPoolTask task = {tasks[i], &remaining};
+			this->tasks.push_back(task);
+		}
+	}
+
+	//wake up the threads
+	if (remaining == 1)
+		this->cond.notify_one();
+	else if (remaining > 1)
+		this->cond.notify_all();
+
+	//run the last one
+	tasks.back()();
+
+	//wait the others
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->done.wait(lock, [&remaining]{return remaining == 0;});
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Queue a task to be run by a thread of the pool without waiting for it. A
+ * thread is started if none is idle, in the limit of the number of CPUs.
+ * @param task The task to run.
+**/
+void WorkerPool::post(std::function<void()> task)
+{
+	//CRITICAL SECTION
+	{
+		std::lock_guard<std::mutex> lockGuard(this->mutex);
+
+		//grow if all the threads are busy
+		if (this->workers.empty() || (this->idle <= this->tasks.size() && this->workers.size() < (size_t)OS::cpuNumber()))
+			this->startThread();
+
+		//queue
+		WorkerPoolTask entry = {task, NULL};
+		this->tasks.push_back(entry);
+	}
+
+	//wake up a thread
+	this->cond.notify_one();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Return the number of threads currently started.
+**/
+size_t WorkerPool::getThreads(void)
+{
+	std::lock_guard<std::mutex> lockGuard(this->mutex);
+	return this->workers.size();
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Start a new thread, counted as idle until it takes a task. The caller must
+ * hold the mutex.
+**/
+void WorkerPool::startThread(void)
+{
+	this->workers.emplace_back(&WorkerPool::main, this);
+	this->idle++;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Main function of the threads, run the queued tasks until the destructor
+ * asks to stop.
+**/
+void WorkerPool::main(void)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while (true) {
+		//wait a task, the thread is counted as idle since its creation
+		this->cond.wait(lock, [this]{return this->stop || this->tasks.empty() == false;});
+		if (this->tasks.empty())
+			return;
+		WorkerPoolTask task = this->tasks.front();
+		this->tasks.pop_front();
+		this->idle--;
+
+		//run out of the lock
+		lock.unlock();
+		task.function();
+		lock.lock();
+		this->idle++;
+
+		//notify the end of the batch
+		if (task.remaining != NULL && --(*task.remaining) == 0)
+			this->done.notify_all();
+	}
+}
@@ -0,0 +1,80 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_WORKER_POOL_HPP
+#define UMMAP_WORKER_POOL_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  STRUCT  *********************/
+/**
+ * Task queued in the worker pool with the counter of its batch.
+**/
+struct WorkerPoolTask
+{
+	/** Function to run. **/
+	std::function<void()> function;
+	/**
+	 * Number of tasks of the batch not yet finished, owned by the caller of WorkerPool::run().
+	 * NULL for a task given to WorkerPool::post().
+	**/
+	size_t * remaining;
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Pool of persistent threads used to split an operation (like the parallel
+ * flush, see Mapping::flushParallel()) without paying the thread creation on
+ * each call. The threads are started on demand, the pool grows so each task
+ * of a batch gets a thread even if the others are busy, and the threads are
+ * kept until its destruction.
+ *
+ * Tasks can also be posted without waiting for them (see post()), for the
+ * asynchronous requests. The destructor runs the posted tasks not yet started.
+**/
+class WorkerPool
+{
+	public:
+		WorkerPool(void);
+		~WorkerPool(void);
+		void run(std::vector<std::function<void()>> & tasks);
+		void post(std::function<void()> task);
+		size_t getThreads(void);
+	private:
+		void startThread(void);
+		void main(void);
+	private:
+		/** Tasks waiting for a thread. **/
+		std::deque<WorkerPoolTask> tasks;
+		/** Threads of the pool. **/
+		std::vector<std::thread> workers;
+		/** Number of threads not running a task. **/
+		size_t idle;
+		/** Become true when the destructor asks the threads to exit. **/
+		bool stop;
+		/** Protect the queue and the batch counters. **/
+		std::mutex mutex;
+		/** Wake up the threads when a task is queued. **/
+		std::condition_variable cond;
+		/** Wake up the callers of run() when a batch is finished. **/
+		std::condition_variable done;
+};
+
+}
+
+#endif //UMMAP_WORKER_POOL_HPP
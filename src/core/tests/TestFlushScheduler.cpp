@@ -0,0 +1,83 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include "portability/OS.hpp"
+#include "drivers/GMockDriver.hpp"
+#include "../FlushScheduler.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+using namespace testing;
+
+/*******************  FUNCTION  *********************/
+TEST(TestFlushScheduler, merge_across_mappings)
+{
+	//setup
+	size_t size = 4 * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping1(NULL, size, UMMAP_PAGE_SIZE, size, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, &driver, NULL, NULL);
+	Mapping mapping2(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, &driver, NULL, NULL);
+
+	//touch all
+	for (size_t i = 0 ; i < 4 ; i++) {
+		mapping1.onSegmentationFault((char*)mapping1.getAddress() + i * UMMAP_PAGE_SIZE, true);
+		mapping2.onSegmentationFault((char*)mapping2.getAddress() + i * UMMAP_PAGE_SIZE, true);
+	}
+
+	//expect a single write starting by mapping2 (the two mappings can be contiguous in memory)
+	EXPECT_CALL(driver, pwritev(_, _, 0)).Times(1).WillOnce(Invoke([&](const struct iovec * iov, int iovcnt, size_t) {
+		EXPECT_EQ(mapping2.getAddress(), iov[0].iov_base);
+		size_t total = 0;
+		for (int i = 0 ; i < iovcnt ; i++)
+			total += iov[i].iov_len;
+		EXPECT_EQ(2 * size, total);
+		return (ssize_t)total;
+	}));
+	EXPECT_CALL(driver, sync(_, 0, size)).Times(2);
+
+	//flush
+	FlushScheduler scheduler;
+	scheduler.addMapping(&mapping1);
+	scheduler.addMapping(&mapping2);
+	scheduler.run(true);
+
+	//check
+	for (size_t i = 0 ; i < 4 ; i++) {
+		ASSERT_FALSE(mapping1.getSegmentStatus(i * UMMAP_PAGE_SIZE).dirty);
+		ASSERT_FALSE(mapping2.getSegmentStatus(i * UMMAP_PAGE_SIZE).dirty);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestFlushScheduler, ordered_with_holes)
+{
+	//setup
+	size_t size = 4 * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping1(NULL, size, UMMAP_PAGE_SIZE, 2 * size, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, &driver, NULL, NULL);
+	Mapping mapping2(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, &driver, NULL, NULL);
+
+	//touch some
+	mapping1.onSegmentationFault((char*)mapping1.getAddress(), true);
+	mapping2.onSegmentationFault((char*)mapping2.getAddress() + 3 * UMMAP_PAGE_SIZE, true);
+	mapping2.onSegmentationFault((char*)mapping2.getAddress() + 1 * UMMAP_PAGE_SIZE, true);
+
+	//expect ordered writes
+	{
+		InSequence seq;
+		EXPECT_CALL(driver, pwritev(_, 1, 1 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+		EXPECT_CALL(driver, pwritev(_, 1, 3 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+		EXPECT_CALL(driver, pwritev(_, 1, 2 * size)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	}
+
+	//flush
+	FlushScheduler scheduler;
+	scheduler.addMapping(&mapping1);
+	scheduler.addMapping(&mapping2);
+	scheduler.run(false);
+}
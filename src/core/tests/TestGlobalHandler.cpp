@@ -233,6 +233,46 @@ TEST(TestGlobalHandler, mmap_and_policy)
 }
 
 
+
+
+/*******************  FUNCTION  *********************/
+TEST(TestGlobalHandler, ummapBatch)
+{
+	//setup global
+	GlobalHandler * handler = new GlobalHandler();
+	setGlobalHandler(handler);
+	setupSegfaultHandler();
+	handler->registerPolicy("global", new FifoPolicy(64*UMMAP_PAGE_SIZE, false));
+
+	//build
+	const size_t count = 16;
+	ummap_batch_entry_t entries[count];
+	for (size_t i = 0 ; i < count ; i++) {
+		entries[i].size = (1 + i % 3) * UMMAP_PAGE_SIZE;
+		entries[i].storage_offset = 0;
+		entries[i].driver = (ummap_driver_t*)new DummyDriver(i);
+		entries[i].local_policy = NULL;
+		entries[i].addr = NULL;
+	}
+
+	//map
+	handler->ummapBatch(entries, count, UMMAP_PAGE_SIZE, PROT_READ|PROT_WRITE, UMMAP_LIGHTWEIGHT, "global");
+
+	//check
+	for (size_t i = 0 ; i < count ; i++) {
+		ASSERT_NE((void*)NULL, entries[i].addr);
+		ASSERT_EQ(entries[i].size, handler->getMapping(entries[i].addr)->getSize());
+		ASSERT_EQ((char)i, ((char*)entries[i].addr)[entries[i].size - 1]);
+	}
+
+	//unmap
+	for (size_t i = 0 ; i < count ; i++)
+		ASSERT_EQ(0, handler->uunmap(entries[i].addr, false));
+
+	//clean
+	unsetSegfaultHandler();
+	clearGlobalHandler();
+}
 /*******************  FUNCTION  *********************/
 TEST(TestGlobalHandler, deleteAllMappings)
 {
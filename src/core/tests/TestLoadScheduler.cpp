@@ -0,0 +1,84 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include <atomic>
+#include "portability/OS.hpp"
+#include "drivers/DummyDriver.hpp"
+#include "policies/FifoPolicy.hpp"
+#include "../LoadScheduler.hpp"
+#include "../Mapping.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+static void countLoaded(void * addr, size_t size, void * userData)
+{
+	std::atomic<size_t> * loaded = (std::atomic<size_t>*)userData;
+	*loaded += size;
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestLoadScheduler, constructor_destructor)
+{
+	WorkerPool pool;
+	LoadScheduler scheduler(pool);
+	ASSERT_EQ(0u, scheduler.getPendingRequests());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestLoadScheduler, load)
+{
+	//setup
+	size_t size = 8 * UMMAP_PAGE_SIZE;
+	DummyDriver driver(1);
+	Mapping mapping1(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, 0, &driver, NULL, NULL);
+	Mapping mapping2(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, 0, &driver, NULL, NULL);
+	std::atomic<size_t> loaded(0);
+	WorkerPool pool;
+
+	//load, the destructor finishes the pending requests
+	{
+		LoadScheduler scheduler(pool);
+		scheduler.push(&mapping1, 0, 2 * UMMAP_PAGE_SIZE, countLoaded, &loaded);
+		scheduler.push(&mapping1, 4 * UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, countLoaded, &loaded);
+		scheduler.push(&mapping2, 0, size, countLoaded, &loaded);
+		scheduler.push(&mapping2, 0, size, NULL, NULL);
+	}
+
+	//check
+	ASSERT_EQ(11 * UMMAP_PAGE_SIZE, loaded.load());
+	for (size_t i = 0 ; i < 8 ; i++) {
+		ASSERT_EQ(i < 2 || i == 4, mapping1.getSegmentStatus(i * UMMAP_PAGE_SIZE).mapped);
+		ASSERT_TRUE(mapping2.getSegmentStatus(i * UMMAP_PAGE_SIZE).mapped);
+		ASSERT_FALSE(mapping2.getSegmentStatus(i * UMMAP_PAGE_SIZE).dirty);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestLoadScheduler, load_partial)
+{
+	//setup
+	size_t size = 8 * UMMAP_PAGE_SIZE;
+	DummyDriver driver(1);
+	FifoPolicy * localPolicy = new FifoPolicy(2 * UMMAP_PAGE_SIZE, true);
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, 0, &driver, localPolicy, NULL);
+	std::atomic<size_t> loaded(0);
+	WorkerPool pool;
+
+	//load more than the policy allows
+	{
+		LoadScheduler scheduler(pool);
+		scheduler.push(&mapping, 0, size, countLoaded, &loaded);
+	}
+
+	//check, only what fits is reported
+	ASSERT_EQ(2 * UMMAP_PAGE_SIZE, loaded.load());
+	for (size_t i = 0 ; i < 8 ; i++)
+		ASSERT_EQ(i < 2, mapping.getSegmentStatus(i * UMMAP_PAGE_SIZE).mapped);
+}
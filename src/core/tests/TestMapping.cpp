@@ -6,12 +6,15 @@
 
 /********************  HEADERS  *********************/
 #include <gtest/gtest.h>
+#include <atomic>
 #include "portability/OS.hpp"
 #include "drivers/DummyDriver.hpp"
 #include "drivers/GMockDriver.hpp"
+#include "drivers/MemoryDriver.hpp"
 #include "policies/GMockPolicy.hpp"
 #include "policies/FifoPolicy.hpp"
 #include "../Mapping.hpp"
+#include "../FlushRequest.hpp"
 
 /***************** USING NAMESPACE ******************/
 using namespace ummapio;
@@ -32,7 +35,7 @@ TEST(TestMapping, constructor_destructor)
 		//ASSERT_EQ(0, status.time);
 		ASSERT_FALSE(status.dirty);
 		ASSERT_FALSE(status.mapped);
-		ASSERT_TRUE(status.needRead);
+		ASSERT_FALSE(status.skipRead);
 	}
 }
 
@@ -71,14 +74,14 @@ TEST(TestMapping, first_touch_read_first)
 	//ASSERT_EQ(0, status0.time);
 	ASSERT_FALSE(status0.dirty);
 	ASSERT_TRUE(status0.mapped);
-	ASSERT_TRUE(status0.needRead);
+	ASSERT_FALSE(status0.skipRead);
 
 	//check status
 	SegmentStatus status1 = mapping.getSegmentStatus(UMMAP_PAGE_SIZE);
 	//ASSERT_EQ(0, status1.time);
 	ASSERT_FALSE(status1.dirty);
 	ASSERT_FALSE(status1.mapped);
-	ASSERT_TRUE(status1.needRead);
+	ASSERT_FALSE(status1.skipRead);
 }
 
 /*******************  FUNCTION  *********************/
@@ -103,14 +106,14 @@ TEST(TestMapping, first_touch_write_first)
 	//ASSERT_NE(0, status0.time);
 	ASSERT_TRUE(status0.dirty);
 	ASSERT_TRUE(status0.mapped);
-	ASSERT_TRUE(status0.needRead);
+	ASSERT_FALSE(status0.skipRead);
 
 	//check status
 	SegmentStatus status1 = mapping.getSegmentStatus(UMMAP_PAGE_SIZE);
 	//ASSERT_EQ(0, status1.time);
 	ASSERT_FALSE(status1.dirty);
 	ASSERT_FALSE(status1.mapped);
-	ASSERT_TRUE(status1.needRead);
+	ASSERT_FALSE(status1.skipRead);
 }
 
 /*******************  FUNCTION  *********************/
@@ -161,6 +164,40 @@ TEST(TestMapping, dropClean)
 	mapping.onSegmentationFault(ptr+UMMAP_PAGE_SIZE, false);
 }
 
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, dropClean_markCleanAsDirty_runs)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	DummyDriver driver(32);
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//access 6 segments, the middle one for write
+	for (size_t i = 0 ; i < 6 ; i++)
+		mapping.onSegmentationFault(ptr + i * UMMAP_PAGE_SIZE, i == 3);
+
+	//drop, the dirty one split the runs
+	mapping.dropClean();
+	for (size_t i = 0 ; i < segments ; i++)
+		ASSERT_EQ(i == 3, mapping.getSegmentStatus(i * UMMAP_PAGE_SIZE).mapped) << i;
+	ptr[3 * UMMAP_PAGE_SIZE] = 1;
+
+	//reload and mark dirty
+	for (size_t i = 0 ; i < 3 ; i++)
+		mapping.onSegmentationFault(ptr + i * UMMAP_PAGE_SIZE, false);
+	mapping.markCleanAsDirty();
+	for (size_t i = 0 ; i < segments ; i++)
+		ASSERT_EQ(i <= 3, mapping.getSegmentStatus(i * UMMAP_PAGE_SIZE).dirty) << i;
+
+	//can write without fault
+	for (size_t i = 0 ; i < 3 ; i++)
+		ptr[i * UMMAP_PAGE_SIZE] = 1;
+}
+
 /*******************  FUNCTION  *********************/
 TEST(TestMapping, storage_offset_and_non_full)
 {
@@ -267,6 +304,850 @@ TEST(TestMapping, sync)
 	ASSERT_DEATH(ptr[UMMAP_PAGE_SIZE] = 10, "");
 }
 
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, flushParallel)
+{
+	//setup
+	size_t segments = 128;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//touch to map
+	for (size_t i = 0 ; i < segments ; i++)
+		mapping.onSegmentationFault(ptr + i * UMMAP_PAGE_SIZE, true);
+
+	//we should see one coalesced write per thread
+	EXPECT_CALL(driver, pwrite(_, 32 * UMMAP_PAGE_SIZE, _)).Times(4).WillRepeatedly(Return(32 * UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, sync(ptr, 0, size)).Times(1);
+
+	//flush
+	WorkerPool pool;
+	mapping.flushParallel(0, size, UMMAP_FLUSH_SYNC, 4, pool);
+
+	//check status
+	for (size_t i = 0 ; i < segments ; i++) {
+		SegmentStatus status = mapping.getSegmentStatus(i * UMMAP_PAGE_SIZE);
+		ASSERT_TRUE(status.mapped);
+		ASSERT_FALSE(status.dirty);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, flushParallel_sparse_unmap)
+{
+	//setup
+	size_t segments = 256;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//touch one over two segment
+	for (size_t i = 0 ; i < segments ; i += 2)
+		mapping.onSegmentationFault(ptr + i * UMMAP_PAGE_SIZE, true);
+
+	//we should see one write per segment
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, _)).Times(segments / 2).WillRepeatedly(Return(UMMAP_PAGE_SIZE));
+
+	//flush
+	WorkerPool pool;
+	mapping.flushParallel(0, size, UMMAP_FLUSH_UNMAP, 4, pool);
+
+	//check status
+	for (size_t i = 0 ; i < segments ; i++) {
+		SegmentStatus status = mapping.getSegmentStatus(i * UMMAP_PAGE_SIZE);
+		ASSERT_FALSE(status.mapped);
+		ASSERT_FALSE(status.dirty);
+	}
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, flushAsync)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//we should see two read
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+
+	//touch to map
+	mapping.onSegmentationFault(ptr + 0 * UMMAP_PAGE_SIZE, true);
+	mapping.onSegmentationFault(ptr + 1 * UMMAP_PAGE_SIZE, true);
+
+	//we should see one write for the run and a sync
+	EXPECT_CALL(driver, pwrite(_, 2 * UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(2 * UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, sync(ptr, 0, size)).Times(1);
+
+	//flush
+	WorkerPool pool;
+	FlushRequest * request = mapping.flushAsync(0, size, UMMAP_FLUSH_SYNC, pool);
+	request->wait();
+	ASSERT_TRUE(request->test());
+	delete request;
+
+	//check status
+	SegmentStatus status = mapping.getSegmentStatus(0);
+	ASSERT_TRUE(status.mapped);
+	ASSERT_FALSE(status.dirty);
+	ASSERT_FALSE(status.inFlight);
+
+	//write again does not need a read
+	mapping.onSegmentationFault(ptr, true);
+	ASSERT_TRUE(mapping.getSegmentStatus(0).dirty);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, flushAsync_write_in_flight)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//we should see two read
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+
+	//touch to map, not neighbours so they are written separately
+	mapping.onSegmentationFault(ptr + 0 * UMMAP_PAGE_SIZE, true);
+	mapping.onSegmentationFault(ptr + 2 * UMMAP_PAGE_SIZE, true);
+
+	//block the flush thread on the first segment
+	std::atomic<bool> release(false);
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Invoke([&release](const void *, size_t size, size_t) {
+		while (release.load() == false) {};
+		return (ssize_t)size;
+	}));
+
+	//the second one should be written only once by the fault handler
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+
+	//flush
+	WorkerPool pool;
+	FlushRequest * request = mapping.flushAsync(0, size, UMMAP_FLUSH_DEFAULT, pool);
+	ASSERT_TRUE(mapping.getSegmentStatus(2 * UMMAP_PAGE_SIZE).inFlight);
+
+	//write on the in-flight segment
+	mapping.onSegmentationFault(ptr + 2 * UMMAP_PAGE_SIZE, true);
+	SegmentStatus status = mapping.getSegmentStatus(2 * UMMAP_PAGE_SIZE);
+	ASSERT_FALSE(status.inFlight);
+	ASSERT_TRUE(status.dirty);
+	ASSERT_FALSE(request->test());
+
+	//release
+	release.store(true);
+	request->wait();
+	delete request;
+
+	//check
+	ASSERT_FALSE(mapping.getSegmentStatus(0).inFlight);
+	ASSERT_TRUE(mapping.getSegmentStatus(2 * UMMAP_PAGE_SIZE).dirty);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, getStats)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//touch one for read and one for write
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(2).WillRepeatedly(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 0 * UMMAP_PAGE_SIZE, false);
+	mapping.onSegmentationFault(ptr + 1 * UMMAP_PAGE_SIZE, true);
+
+	//check
+	ummap_stats_t stats;
+	mapping.getStats(stats);
+	EXPECT_EQ(1u, stats.read_faults);
+	EXPECT_EQ(1u, stats.write_faults);
+	EXPECT_EQ(0u, stats.refaults);
+	EXPECT_EQ(2 * UMMAP_PAGE_SIZE, stats.read_bytes);
+	EXPECT_EQ(2 * UMMAP_PAGE_SIZE, stats.resident_bytes);
+	EXPECT_EQ(UMMAP_PAGE_SIZE, stats.dirty_bytes);
+
+	//evict all
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(0, size, UMMAP_FLUSH_UNMAP);
+
+	//touch again
+	mapping.onSegmentationFault(ptr + 0 * UMMAP_PAGE_SIZE, false);
+
+	//check
+	mapping.getStats(stats);
+	EXPECT_EQ(2u, stats.read_faults);
+	EXPECT_EQ(1u, stats.refaults);
+	EXPECT_EQ(UMMAP_PAGE_SIZE, stats.written_bytes);
+	EXPECT_EQ(1u, stats.clean_evictions);
+	EXPECT_EQ(1u, stats.dirty_evictions);
+	EXPECT_EQ(1u, stats.flushes);
+	EXPECT_EQ(UMMAP_PAGE_SIZE, stats.resident_bytes);
+	EXPECT_EQ(0u, stats.dirty_bytes);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, advise_willneed)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//we should see one read for the run
+	EXPECT_CALL(driver, pread(_, 2 * UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(2 * UMMAP_PAGE_SIZE));
+
+	//prefetch
+	mapping.advise(2 * UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE, UMMAP_ADV_WILLNEED);
+
+	//check status
+	ASSERT_FALSE(mapping.getSegmentStatus(1 * UMMAP_PAGE_SIZE).mapped);
+	ASSERT_TRUE(mapping.getSegmentStatus(2 * UMMAP_PAGE_SIZE).mapped);
+	ASSERT_TRUE(mapping.getSegmentStatus(3 * UMMAP_PAGE_SIZE).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(3 * UMMAP_PAGE_SIZE).dirty);
+
+	//second time does nothing
+	mapping.advise(2 * UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE, UMMAP_ADV_WILLNEED);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, advise_dontneed)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//touch to map one clean and one dirty
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 0 * UMMAP_PAGE_SIZE, false);
+	mapping.onSegmentationFault(ptr + 1 * UMMAP_PAGE_SIZE, true);
+
+	//only the dirty one is written
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.advise(0, size, UMMAP_ADV_DONTNEED);
+
+	//check status
+	ASSERT_FALSE(mapping.getSegmentStatus(0).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(UMMAP_PAGE_SIZE).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(UMMAP_PAGE_SIZE).dirty);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, advise_sequential)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//advise
+	mapping.advise(0, size, UMMAP_ADV_SEQUENTIAL);
+
+	//fault on first load the next ones in one run
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_ADVISE_READ_AHEAD * UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_ADVISE_READ_AHEAD * UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr, false);
+
+	//check
+	ASSERT_TRUE(mapping.getSegmentStatus(UMMAP_ADVISE_READ_AHEAD * UMMAP_PAGE_SIZE).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus((UMMAP_ADVISE_READ_AHEAD + 1) * UMMAP_PAGE_SIZE).mapped);
+
+	//random disable the read ahead
+	mapping.advise(0, size, UMMAP_ADV_RANDOM);
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, (UMMAP_ADVISE_READ_AHEAD + 1) * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + (UMMAP_ADVISE_READ_AHEAD + 1) * UMMAP_PAGE_SIZE, false);
+	ASSERT_FALSE(mapping.getSegmentStatus((UMMAP_ADVISE_READ_AHEAD + 2) * UMMAP_PAGE_SIZE).mapped);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, fault_around)
+{
+	//setup
+	size_t segments = 16;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+	mapping.setFaultAround(4 * UMMAP_PAGE_SIZE);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//fault load the whole window with one request
+	EXPECT_CALL(driver, pread(_, 4 * UMMAP_PAGE_SIZE, 4 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(4 * UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 5 * UMMAP_PAGE_SIZE, true);
+
+	//check
+	ASSERT_FALSE(mapping.getSegmentStatus(3 * UMMAP_PAGE_SIZE).mapped);
+	for (size_t i = 4 ; i < 8 ; i++)
+		ASSERT_TRUE(mapping.getSegmentStatus(i * UMMAP_PAGE_SIZE).mapped) << "Index: " << i;
+	ASSERT_TRUE(mapping.getSegmentStatus(5 * UMMAP_PAGE_SIZE).dirty);
+	ASSERT_FALSE(mapping.getSegmentStatus(6 * UMMAP_PAGE_SIZE).dirty);
+	ASSERT_FALSE(mapping.getSegmentStatus(8 * UMMAP_PAGE_SIZE).mapped);
+
+	//already loaded neighbour does not read
+	mapping.onSegmentationFault(ptr + 6 * UMMAP_PAGE_SIZE, false);
+
+	//disabled
+	mapping.setFaultAround(0);
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 9 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 9 * UMMAP_PAGE_SIZE, false);
+
+	//load only the missing ones of the window
+	mapping.setFaultAround(4 * UMMAP_PAGE_SIZE);
+	EXPECT_CALL(driver, pread(_, 2 * UMMAP_PAGE_SIZE, 10 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(2 * UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 10 * UMMAP_PAGE_SIZE, false);
+	ASSERT_FALSE(mapping.getSegmentStatus(8 * UMMAP_PAGE_SIZE).mapped);
+
+	//random access disable it
+	mapping.advise(12 * UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, UMMAP_ADV_RANDOM);
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 12 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 12 * UMMAP_PAGE_SIZE, false);
+	ASSERT_FALSE(mapping.getSegmentStatus(13 * UMMAP_PAGE_SIZE).mapped);
+
+	//check
+	ummap_stats_t stats;
+	mapping.getStats(stats);
+	EXPECT_EQ(3u, stats.read_faults);
+	EXPECT_EQ(1u, stats.write_faults);
+	EXPECT_EQ(4u, stats.fault_around);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, fault_around_policy)
+{
+	//setup
+	size_t segments = 16;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	FifoPolicy * localPolicy = new FifoPolicy(4*UMMAP_PAGE_SIZE, true);
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, localPolicy, NULL);
+	mapping.setFaultAround(8 * UMMAP_PAGE_SIZE);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//only load what the policy can afford
+	EXPECT_CALL(driver, pread(_, 4 * UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(4 * UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + UMMAP_PAGE_SIZE, false);
+	ASSERT_FALSE(mapping.getSegmentStatus(0).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(5 * UMMAP_PAGE_SIZE).mapped);
+
+	//policy is full, no neighbour, evict a speculative one instead of the faulting one
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 10 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 10 * UMMAP_PAGE_SIZE, false);
+	ASSERT_TRUE(mapping.getSegmentStatus(UMMAP_PAGE_SIZE).mapped);
+	ASSERT_TRUE(mapping.getSegmentStatus(10 * UMMAP_PAGE_SIZE).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(11 * UMMAP_PAGE_SIZE).mapped);
+	ASSERT_EQ(4 * UMMAP_PAGE_SIZE, localPolicy->getCurrentMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, predict_write)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_PREDICT_WRITE, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//read then write on the first load
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(2).WillRepeatedly(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(2).WillRepeatedly(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr, false);
+	mapping.onSegmentationFault(ptr, true);
+	mapping.onSegmentationFault(ptr + UMMAP_PAGE_SIZE, false);
+
+	//evict
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(2).WillRepeatedly(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(0, size, UMMAP_FLUSH_UNMAP);
+	ASSERT_FALSE(mapping.getSegmentStatus(0).mapped);
+
+	//reload the dirty one in write mode and keep it dirty
+	mapping.onSegmentationFault(ptr, false);
+	ASSERT_TRUE(mapping.getSegmentStatus(0).mapped);
+	ASSERT_TRUE(mapping.getSegmentStatus(0).dirty);
+	ptr[0] = 'a';
+	mapping.onSegmentationFault(ptr + UMMAP_PAGE_SIZE, false);
+	ASSERT_FALSE(mapping.getSegmentStatus(UMMAP_PAGE_SIZE).dirty);
+
+	//check, no second write fault
+	ummap_stats_t stats;
+	mapping.getStats(stats);
+	EXPECT_EQ(1u, stats.write_faults);
+
+	//it is written back on eviction
+	mapping.flush(0, size, UMMAP_FLUSH_UNMAP);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, pin)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//pin load the segments
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	ASSERT_TRUE(mapping.pin(0, 2 * UMMAP_PAGE_SIZE));
+	ASSERT_TRUE(mapping.getSegmentStatus(UMMAP_PAGE_SIZE).mapped);
+
+	//a flush with eviction write them but keep them
+	mapping.onSegmentationFault(ptr, true);
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(0, size, UMMAP_FLUSH_UNMAP);
+	ASSERT_TRUE(mapping.getSegmentStatus(0).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(0).dirty);
+
+	//check
+	ummap_stats_t stats;
+	mapping.getStats(stats);
+	EXPECT_EQ(2 * UMMAP_PAGE_SIZE, stats.pinned_bytes);
+	EXPECT_EQ(0u, stats.dirty_evictions);
+
+	//drop unpin
+	mapping.advise(0, UMMAP_PAGE_SIZE, UMMAP_ADV_DONTNEED);
+	ASSERT_FALSE(mapping.isPinned(0));
+	ASSERT_FALSE(mapping.getSegmentStatus(0).mapped);
+
+	//unpin
+	mapping.unpin(0, size);
+	ASSERT_FALSE(mapping.isPinned(1));
+	mapping.getStats(stats);
+	EXPECT_EQ(0u, stats.pinned_bytes);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, acquire)
+{
+	//setup, the policy can pin 4 segments
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	FifoPolicy * localPolicy = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, localPolicy, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//load the range with one request
+	EXPECT_CALL(driver, pread(_, 3 * UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(3 * UMMAP_PAGE_SIZE));
+	ASSERT_TRUE(mapping.acquire(0, 3 * UMMAP_PAGE_SIZE, PROT_READ));
+	ASSERT_TRUE(mapping.getSegmentStatus(2 * UMMAP_PAGE_SIZE).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(2 * UMMAP_PAGE_SIZE).dirty);
+	ASSERT_TRUE(mapping.isPinned(2));
+
+	//write mode on a loaded and a new one, can be written without fault
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 3 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	ASSERT_TRUE(mapping.acquire(2 * UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE, PROT_READ|PROT_WRITE));
+	ASSERT_TRUE(mapping.getSegmentStatus(2 * UMMAP_PAGE_SIZE).dirty);
+	ASSERT_TRUE(mapping.getSegmentStatus(3 * UMMAP_PAGE_SIZE).dirty);
+	ptr[2 * UMMAP_PAGE_SIZE] = 'a';
+	ptr[3 * UMMAP_PAGE_SIZE] = 'b';
+
+	//over the pin budget
+	ASSERT_FALSE(mapping.acquire(4 * UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, PROT_READ));
+	ASSERT_FALSE(mapping.getSegmentStatus(4 * UMMAP_PAGE_SIZE).mapped);
+
+	//check
+	ummap_stats_t stats;
+	mapping.getStats(stats);
+	EXPECT_EQ(0u, stats.read_faults);
+	EXPECT_EQ(0u, stats.write_faults);
+	EXPECT_EQ(4 * UMMAP_PAGE_SIZE, stats.pinned_bytes);
+	EXPECT_EQ(0u, localPolicy->getCurrentMemory() - localPolicy->getPinnedMemory());
+
+	//release make them evictable
+	mapping.release(0, size);
+	ASSERT_FALSE(mapping.isPinned(0));
+	EXPECT_EQ(0u, localPolicy->getPinnedMemory());
+	EXPECT_EQ(4 * UMMAP_PAGE_SIZE, localPolicy->getCurrentMemory());
+
+	//write at exit
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 3 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(0, size, UMMAP_FLUSH_DEFAULT);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, acquire_full_policy)
+{
+	//setup, more segments to evict than a policy eviction batch
+	size_t segments = 1024;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	MemoryDriver driver(size, 'a');
+	FifoPolicy * localPolicy = new FifoPolicy(512*UMMAP_PAGE_SIZE, true);
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, localPolicy, NULL);
+	char * ptr = (char*)mapping.getAddress();
+
+	//fill the policy
+	for (size_t i = 0 ; i < 512 ; i++)
+		mapping.onSegmentationFault(ptr + i * UMMAP_PAGE_SIZE, false);
+	ASSERT_EQ(512 * UMMAP_PAGE_SIZE, localPolicy->getCurrentMemory());
+
+	//acquire evict to make room
+	ASSERT_TRUE(mapping.acquire(512 * UMMAP_PAGE_SIZE, 200 * UMMAP_PAGE_SIZE, PROT_READ));
+	EXPECT_EQ(512 * UMMAP_PAGE_SIZE, localPolicy->getCurrentMemory());
+	EXPECT_EQ(200 * UMMAP_PAGE_SIZE, localPolicy->getPinnedMemory());
+	EXPECT_FALSE(mapping.getSegmentStatus(199 * UMMAP_PAGE_SIZE).mapped);
+	EXPECT_TRUE(mapping.getSegmentStatus(200 * UMMAP_PAGE_SIZE).mapped);
+
+	//next fault only evict one
+	mapping.onSegmentationFault(ptr + 800 * UMMAP_PAGE_SIZE, false);
+	EXPECT_EQ(512 * UMMAP_PAGE_SIZE, localPolicy->getCurrentMemory());
+	EXPECT_FALSE(mapping.getSegmentStatus(200 * UMMAP_PAGE_SIZE).mapped);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, discard)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//make dirty
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 3 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + UMMAP_PAGE_SIZE, true);
+	mapping.onSegmentationFault(ptr + 2 * UMMAP_PAGE_SIZE, true);
+	ptr[UMMAP_PAGE_SIZE] = 'a';
+
+	//discard without write back
+	EXPECT_CALL(driver, discard(2 * UMMAP_PAGE_SIZE, 3 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(true));
+	mapping.discard(UMMAP_PAGE_SIZE, 3 * UMMAP_PAGE_SIZE);
+	ASSERT_FALSE(mapping.getSegmentStatus(UMMAP_PAGE_SIZE).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(UMMAP_PAGE_SIZE).dirty);
+
+	//read back as zero without read
+	mapping.onSegmentationFault(ptr + UMMAP_PAGE_SIZE, false);
+	mapping.onSegmentationFault(ptr + 3 * UMMAP_PAGE_SIZE, false);
+	ASSERT_EQ(0, ptr[UMMAP_PAGE_SIZE]);
+
+	//nothing to write
+	mapping.flush(0, size, UMMAP_FLUSH_DEFAULT);
+	ummap_stats_t stats;
+	mapping.getStats(stats);
+	EXPECT_EQ(0u, stats.written_bytes);
+	EXPECT_EQ(0u, stats.dirty_bytes);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, shared_cache)
+{
+	//setup two mappings of the same object, the second one starts one segment after
+	size_t size = 4 * UMMAP_PAGE_SIZE;
+	MemoryDriver driver(8 * UMMAP_PAGE_SIZE, 'a');
+	SegmentCacheRegistry registry;
+	Mapping mapping1(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_SHARED_CACHE, &driver, NULL, NULL, NULL, &registry);
+	Mapping mapping2(NULL, size, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, PROT_READ|PROT_WRITE, UMMAP_SHARED_CACHE, &driver, NULL, NULL, NULL, &registry);
+	char * ptr1 = (char*)mapping1.getAddress();
+	char * ptr2 = (char*)mapping2.getAddress();
+
+	//load from the first one, shared with the second one without reading
+	mapping1.onSegmentationFault(ptr1 + UMMAP_PAGE_SIZE, true);
+	mapping2.onSegmentationFault(ptr2, false);
+	ptr1[UMMAP_PAGE_SIZE] = 'b';
+	ASSERT_EQ('b', ptr2[0]);
+
+	//check stats
+	ummap_stats_t stats;
+	mapping2.getStats(stats);
+	EXPECT_EQ(0u, stats.read_bytes);
+	EXPECT_EQ(1u, stats.cache_hits);
+
+	//evict from the first one, the second one keep it
+	mapping1.flush(0, size, UMMAP_FLUSH_UNMAP);
+	ASSERT_EQ('b', driver.getBuffer()[UMMAP_PAGE_SIZE]);
+	ASSERT_EQ('b', ptr2[0]);
+
+	//the second one write it, the first one see it on the next load
+	mapping2.onSegmentationFault(ptr2, true);
+	ptr2[0] = 'c';
+	mapping1.onSegmentationFault(ptr1 + UMMAP_PAGE_SIZE, false);
+	ASSERT_EQ('c', ptr1[UMMAP_PAGE_SIZE]);
+	mapping1.getStats(stats);
+	EXPECT_EQ(UMMAP_PAGE_SIZE, stats.read_bytes);
+	EXPECT_EQ(1u, stats.cache_hits);
+
+	//other segment size is not shared, it reads the storage without the last write
+	Mapping mapping3(NULL, size, 2 * UMMAP_PAGE_SIZE, 0, PROT_READ, UMMAP_SHARED_CACHE, &driver, NULL, NULL, NULL, &registry);
+	mapping3.onSegmentationFault(mapping3.getAddress(), false);
+	ASSERT_EQ('b', ((char*)mapping3.getAddress())[UMMAP_PAGE_SIZE]);
+	mapping3.getStats(stats);
+	EXPECT_EQ(0u, stats.cache_hits);
+	EXPECT_EQ(1u, registry.getCacheCount());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, shared_cache_charge)
+{
+	//setup two mappings of the same object with their own policy
+	size_t size = 4 * UMMAP_PAGE_SIZE;
+	MemoryDriver driver(size, 'a');
+	SegmentCacheRegistry registry;
+	FifoPolicy * policy1 = new FifoPolicy(size, true);
+	FifoPolicy * policy2 = new FifoPolicy(size, true);
+	Mapping mapping1(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_SHARED_CACHE, &driver, policy1, NULL, NULL, &registry);
+	Mapping mapping2(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_SHARED_CACHE, &driver, policy2, NULL, NULL, &registry);
+	char * ptr1 = (char*)mapping1.getAddress();
+	char * ptr2 = (char*)mapping2.getAddress();
+
+	//charged to the one loading it only
+	mapping1.onSegmentationFault(ptr1, false);
+	mapping1.onSegmentationFault(ptr1 + UMMAP_PAGE_SIZE, false);
+	mapping2.onSegmentationFault(ptr2, false);
+	mapping2.onSegmentationFault(ptr2 + 2 * UMMAP_PAGE_SIZE, false);
+	EXPECT_EQ(2 * UMMAP_PAGE_SIZE, policy1->getCurrentMemory());
+	EXPECT_EQ(UMMAP_PAGE_SIZE, policy2->getCurrentMemory());
+
+	//writing the shared one does not charge it
+	mapping2.onSegmentationFault(ptr2, true);
+	EXPECT_EQ(UMMAP_PAGE_SIZE, policy2->getCurrentMemory());
+
+	//moved to the other one when unmapped
+	mapping1.advise(0, UMMAP_PAGE_SIZE, UMMAP_ADV_DONTNEED);
+	EXPECT_EQ(UMMAP_PAGE_SIZE, policy1->getCurrentMemory());
+	EXPECT_EQ(2 * UMMAP_PAGE_SIZE, policy2->getCurrentMemory());
+
+	//and released with the last one
+	mapping2.advise(0, UMMAP_PAGE_SIZE, UMMAP_ADV_DONTNEED);
+	EXPECT_EQ(UMMAP_PAGE_SIZE, policy2->getCurrentMemory());
+	mapping2.advise(0, size, UMMAP_ADV_DONTNEED);
+	EXPECT_EQ(0u, policy2->getCurrentMemory());
+	EXPECT_EQ(UMMAP_PAGE_SIZE, policy1->getCurrentMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, shared_cache_charge_unmap)
+{
+	//setup two mappings of the same object with their own small policy
+	size_t size = 4 * UMMAP_PAGE_SIZE;
+	MemoryDriver driver(size, 'a');
+	SegmentCacheRegistry registry;
+	FifoPolicy * policy1 = new FifoPolicy(2 * UMMAP_PAGE_SIZE, true);
+	FifoPolicy * policy2 = new FifoPolicy(2 * UMMAP_PAGE_SIZE, true);
+	Mapping * mapping1 = new Mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_SHARED_CACHE, &driver, policy1, NULL, NULL, &registry);
+	Mapping mapping2(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_SHARED_CACHE, &driver, policy2, NULL, NULL, &registry);
+	char * ptr1 = (char*)mapping1->getAddress();
+	char * ptr2 = (char*)mapping2.getAddress();
+
+	//both full, the first two segments are shared and charged to the first one
+	mapping1->onSegmentationFault(ptr1, false);
+	mapping1->onSegmentationFault(ptr1 + UMMAP_PAGE_SIZE, false);
+	for (int i = 0 ; i < 4 ; i++)
+		mapping2.onSegmentationFault(ptr2 + i * UMMAP_PAGE_SIZE, false);
+	EXPECT_EQ(2 * UMMAP_PAGE_SIZE, policy1->getCurrentMemory());
+	EXPECT_EQ(2 * UMMAP_PAGE_SIZE, policy2->getCurrentMemory());
+
+	//unmap the first one, the charge is moved but the second stays in its limit
+	delete mapping1;
+	EXPECT_EQ(2 * UMMAP_PAGE_SIZE, policy2->getCurrentMemory());
+
+	//still usable
+	mapping2.advise(0, size, UMMAP_ADV_DONTNEED);
+	EXPECT_EQ(0u, policy2->getCurrentMemory());
+	for (int i = 0 ; i < 4 ; i++)
+		mapping2.onSegmentationFault(ptr2 + i * UMMAP_PAGE_SIZE, false);
+	EXPECT_EQ(2 * UMMAP_PAGE_SIZE, policy2->getCurrentMemory());
+	EXPECT_EQ('a', ptr2[3 * UMMAP_PAGE_SIZE]);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, remap)
+{
+	//setup, the last segment is partial
+	size_t size = 3 * UMMAP_PAGE_SIZE + 100;
+	GMockDriver driver;
+	FifoPolicy * localPolicy = new FifoPolicy(16*UMMAP_PAGE_SIZE, true);
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, localPolicy, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//touch
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, 100, 3 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(100));
+	mapping.onSegmentationFault(ptr, true);
+	mapping.onSegmentationFault(ptr + UMMAP_PAGE_SIZE, false);
+	mapping.onSegmentationFault(ptr + 3 * UMMAP_PAGE_SIZE, false);
+	ptr[10] = 'a';
+
+	//grow, the partial one is evicted to load the new data
+	ptr = (char*)mapping.remap(8 * UMMAP_PAGE_SIZE, UMMAP_REMAP_MAYMOVE);
+	ASSERT_NE((char*)NULL, ptr);
+	ASSERT_EQ(ptr, mapping.getAddress());
+	ASSERT_EQ(8 * UMMAP_PAGE_SIZE, mapping.getAlignedSize());
+	ASSERT_EQ('a', ptr[10]);
+	ASSERT_TRUE(mapping.getSegmentStatus(0).dirty);
+	ASSERT_TRUE(mapping.getSegmentStatus(UMMAP_PAGE_SIZE).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(3 * UMMAP_PAGE_SIZE).mapped);
+	ASSERT_EQ(2 * UMMAP_PAGE_SIZE, localPolicy->getCurrentMemory());
+
+	//use the new part
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 3 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 7 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 3 * UMMAP_PAGE_SIZE, false);
+	mapping.onSegmentationFault(ptr + 7 * UMMAP_PAGE_SIZE, false);
+	ASSERT_EQ(4 * UMMAP_PAGE_SIZE, localPolicy->getCurrentMemory());
+
+	//move to a given address and shrink
+	char * target = (char*)OS::mmapProtNone(NULL, UMMAP_PAGE_SIZE, false);
+	ptr = (char*)mapping.remap(UMMAP_PAGE_SIZE, UMMAP_REMAP_FIXED, target);
+	ASSERT_EQ(target, ptr);
+	ASSERT_EQ(UMMAP_PAGE_SIZE, mapping.getSize());
+	ASSERT_EQ('a', ptr[10]);
+	ASSERT_EQ(UMMAP_PAGE_SIZE, localPolicy->getCurrentMemory());
+
+	//write at exit
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(0, UMMAP_PAGE_SIZE, UMMAP_FLUSH_DEFAULT);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, remap_lightweight)
+{
+	//setup with a status table taken from the pool
+	SegmentStatusPool pool(1024);
+	GMockDriver driver;
+	Mapping mapping(NULL, 4 * UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_LIGHTWEIGHT, &driver, NULL, NULL, &pool);
+	ASSERT_EQ(4u, pool.getUsedSegments());
+
+	//touch
+	char * ptr = (char*)mapping.getAddress();
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 2 * UMMAP_PAGE_SIZE, true);
+
+	//grow, the state move out of the pool
+	ptr = (char*)mapping.remap(64 * UMMAP_PAGE_SIZE, UMMAP_REMAP_MAYMOVE);
+	ASSERT_NE((char*)NULL, ptr);
+	ASSERT_EQ(0u, pool.getUsedSegments());
+	ASSERT_TRUE(mapping.getSegmentStatus(2 * UMMAP_PAGE_SIZE).dirty);
+
+	//write at exit
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(0, 64 * UMMAP_PAGE_SIZE, UMMAP_FLUSH_DEFAULT);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, residency)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//touch two segments
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 5 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 2 * UMMAP_PAGE_SIZE, false);
+	mapping.onSegmentationFault(ptr + 5 * UMMAP_PAGE_SIZE, true);
+
+	//residency
+	unsigned char vec[6];
+	ASSERT_EQ(2u, mapping.getResidency(UMMAP_PAGE_SIZE, 6 * UMMAP_PAGE_SIZE, vec));
+	unsigned char expected[6] = {0, UMMAP_RESIDENT, 0, 0, UMMAP_RESIDENT | UMMAP_RESIDENT_DIRTY, 0};
+	for (size_t i = 0 ; i < 6 ; i++)
+		EXPECT_EQ(expected[i], vec[i]) << "segment " << i + 1;
+
+	//order
+	std::vector<size_t> order;
+	ASSERT_EQ(2u, mapping.getResidentFirstOrder(UMMAP_PAGE_SIZE, 6 * UMMAP_PAGE_SIZE, order));
+	size_t expectedOrder[6] = {2, 5, 1, 3, 4, 6};
+	ASSERT_EQ(6u, order.size());
+	for (size_t i = 0 ; i < 6 ; i++)
+		EXPECT_EQ(expectedOrder[i] * UMMAP_PAGE_SIZE, order[i]);
+
+	//write at exit
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 5 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(0, size, UMMAP_FLUSH_DEFAULT);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, large_sparse)
+{
+	//setup a 64 GB mapping, the segment status must only be allocated on touch
+	size_t size = 64UL * 1024UL * 1024UL * 1024UL;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+	size_t offset = size / 2;
+
+	//untouched
+	ASSERT_FALSE(mapping.getSegmentStatus(offset).mapped);
+	ASSERT_FALSE(mapping.getSegmentStatus(offset).skipRead);
+
+	//touch one in the middle
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, offset)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + offset, true);
+	ASSERT_TRUE(mapping.getSegmentStatus(offset).dirty);
+
+	//flush the whole mapping, only the touched one is written
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, offset)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(0, size, UMMAP_FLUSH_DEFAULT);
+
+	//drop clean
+	mapping.dropClean();
+	ASSERT_FALSE(mapping.getSegmentStatus(offset).mapped);
+
+	//stats
+	ummap_stats_t stats;
+	mapping.getStats(stats);
+	ASSERT_EQ(0u, stats.resident_bytes);
+}
+
 TEST(TestMapping, policy)
 {
 	//setup
@@ -287,13 +1168,13 @@ TEST(TestMapping, policy)
 	char * ptr = (char*)mapping.getAddress();
 
 	//touch read
-	EXPECT_CALL(*localPolicy, notifyTouch(&mapping, 1, false, false, false));
-	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, 1, false, false, false));
+	EXPECT_CALL(*localPolicy, notifyTouch(&mapping, 1, false, false, false, false));
+	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, 1, false, false, false, false));
 	mapping.onSegmentationFault(ptr+UMMAP_PAGE_SIZE, false);
 	
 	//touch write
-	EXPECT_CALL(*localPolicy, notifyTouch(&mapping, 1, true, true, false));
-	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, 1, true, true, false));
+	EXPECT_CALL(*localPolicy, notifyTouch(&mapping, 1, true, true, false, false));
+	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, 1, true, true, false, false));
 	mapping.onSegmentationFault(ptr+UMMAP_PAGE_SIZE, true);
 
 	//check not again
@@ -327,15 +1208,15 @@ TEST(TestMapping, globalPolicy)
 	char * ptr2 = (char*)mapping2.getAddress();
 
 	//touch read first segment
-	EXPECT_CALL(*localPolicy1, notifyTouch(&mapping1, 1, false, false, false));
+	EXPECT_CALL(*localPolicy1, notifyTouch(&mapping1, 1, false, false, false, false));
 	mapping1.onSegmentationFault(ptr1+UMMAP_PAGE_SIZE, false);
 
 	//touch read first segment
-	EXPECT_CALL(*localPolicy2, notifyTouch(&mapping2, 1, false, false, false));
+	EXPECT_CALL(*localPolicy2, notifyTouch(&mapping2, 1, false, false, false, false));
 	mapping2.onSegmentationFault(ptr2+UMMAP_PAGE_SIZE, false);
 
 	//touch another which might generate flish
-	EXPECT_CALL(*localPolicy2, notifyTouch(&mapping2, 2, false, false, false));
+	EXPECT_CALL(*localPolicy2, notifyTouch(&mapping2, 2, false, false, false, false));
 	EXPECT_CALL(*localPolicy1, notifyEvict(_,1));
 	mapping2.onSegmentationFault(ptr2+2*UMMAP_PAGE_SIZE, false);
 
@@ -436,6 +1317,113 @@ TEST(TestMapping, copyToDriver_not_aligned)
 	mapping.copyToDriver(&newDriver, 8*UMMAP_PAGE_SIZE);
 }
 
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, checkpoint_incremental)
+{
+	//setup
+	size_t segments = 8;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//get
+	char * ptr = (char*)mapping.getAddress();
+
+	//write two segments
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 0 * UMMAP_PAGE_SIZE, true);
+	mapping.onSegmentationFault(ptr + 1 * UMMAP_PAGE_SIZE, true);
+	ASSERT_TRUE(mapping.getSegmentStatus(0).changed);
+
+	//first checkpoint clone the original storage and write the two segments
+	GMockDriver * target1 = new GMockDriver;
+	EXPECT_CALL(driver, cloneTo(target1, 0, size)).Times(1).WillOnce(Return(true));
+	EXPECT_CALL(*target1, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(*target1, pwrite(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	ASSERT_EQ(1u, mapping.checkpoint(target1));
+	ASSERT_TRUE(mapping.getSegmentStatus(0).changed);
+	ASSERT_FALSE(mapping.getSegmentStatus(3 * UMMAP_PAGE_SIZE).changed);
+
+	//flush and write a third segment
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(false);
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr + 2 * UMMAP_PAGE_SIZE, true);
+
+	//second checkpoint clone the first one and write the third segment and the
+	//two first ones which were still dirty (so writable) at the first checkpoint
+	GMockDriver * target2 = new GMockDriver;
+	EXPECT_CALL(*target1, cloneTo(target2, 0, size)).Times(1).WillOnce(Return(true));
+	EXPECT_CALL(*target2, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(*target2, pwrite(_, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(*target2, pwrite(_, UMMAP_PAGE_SIZE, 2 * UMMAP_PAGE_SIZE)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	ASSERT_EQ(2u, mapping.checkpoint(target2));
+	ASSERT_EQ(2u, mapping.getCheckpointEpoch());
+	ASSERT_FALSE(mapping.getSegmentStatus(0).changed);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, checkpoint_write_after_checkpoint)
+{
+	//setup
+	size_t segments = 4;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+	char * ptr = (char*)mapping.getAddress();
+
+	//write
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(ptr, true);
+	ptr[0] = 1;
+
+	//checkpoint
+	GMockDriver * target1 = new GMockDriver;
+	EXPECT_CALL(driver, cloneTo(target1, 0, size)).Times(1).WillOnce(Return(true));
+	EXPECT_CALL(*target1, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	ASSERT_EQ(1u, mapping.checkpoint(target1));
+
+	//write again without fault and flush
+	ptr[0] = 2;
+	EXPECT_CALL(driver, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.flush(false);
+	ASSERT_FALSE(mapping.getSegmentStatus(0).dirty);
+
+	//the second checkpoint must contain the last write
+	char content = 0;
+	GMockDriver * target2 = new GMockDriver;
+	EXPECT_CALL(*target1, cloneTo(target2, 0, size)).Times(1).WillOnce(Return(true));
+	EXPECT_CALL(*target2, pwrite(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Invoke([&content](const void * buffer, size_t size, size_t) {
+		content = ((const char*)buffer)[0];
+		return size;
+	}));
+	ASSERT_EQ(2u, mapping.checkpoint(target2));
+	EXPECT_EQ(2, content);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMapping, checkpoint_no_clone)
+{
+	//setup
+	size_t segments = 4;
+	size_t size = segments * UMMAP_PAGE_SIZE;
+	GMockDriver driver;
+	Mapping mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//write one segment
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, 0)).Times(1).WillOnce(Return(UMMAP_PAGE_SIZE));
+	mapping.onSegmentationFault(mapping.getAddress(), true);
+
+	//copy the unchanged segments from the origin
+	GMockDriver * target = new GMockDriver;
+	EXPECT_CALL(driver, cloneTo(target, 0, size)).Times(1).WillOnce(Return(false));
+	EXPECT_CALL(driver, pread(_, UMMAP_PAGE_SIZE, _)).Times(3).WillRepeatedly(Return(UMMAP_PAGE_SIZE));
+	EXPECT_CALL(*target, pwrite(_, UMMAP_PAGE_SIZE, _)).Times(4).WillRepeatedly(Return(UMMAP_PAGE_SIZE));
+	ASSERT_EQ(1u, mapping.checkpoint(target));
+}
+
 TEST(TestMapping, getMaxMemory_no_policy)
 {
 	//setup
@@ -49,3 +49,37 @@ TEST(TestRegistry, reg)
 	registry.unregisterMapping(&mapping);
 	ASSERT_EQ(NULL, registry.getMapping(base));
 }
+
+/*******************  FUNCTION  *********************/
+TEST(TestRegistry, many)
+{
+	//deps
+	const size_t count = 1000;
+	std::vector<Mapping *> mappings(count);
+	for (size_t i = 0 ; i < count ; i++)
+		mappings[i] = new Mapping(NULL, 2*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, new DummyDriver);
+
+	//fill
+	MappingRegistry registry;
+	registry.registerMappings(mappings.data(), count);
+
+	//check
+	for (size_t i = 0 ; i < count ; i++) {
+		char * base = (char*)mappings[i]->getAddress();
+		ASSERT_EQ(mappings[i], registry.getMapping(base));
+		ASSERT_EQ(mappings[i], registry.getMapping(base + 2*UMMAP_PAGE_SIZE - 1));
+	}
+
+	//unregister half
+	for (size_t i = 0 ; i < count ; i += 2) {
+		registry.unregisterMapping(mappings[i]);
+		ASSERT_EQ(NULL, registry.getMapping(mappings[i]->getAddress()));
+		delete mappings[i];
+	}
+
+	//check others
+	for (size_t i = 1 ; i < count ; i += 2)
+		ASSERT_EQ(mappings[i], registry.getMapping(mappings[i]->getAddress()));
+
+	//the registry destroy the remaining ones
+}
@@ -0,0 +1,57 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "portability/OS.hpp"
+#include "../MappingStats.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+TEST(TestMappingStats, constructor_destructor)
+{
+	//only the slot pointers are allocated
+	MappingStats stats;
+	ASSERT_EQ(0u, stats.get(STATS_READ_FAULTS));
+	ASSERT_EQ(OS::cpuNumber() * sizeof(void*), stats.getMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMappingStats, inc)
+{
+	//one thread allocates a single slot
+	MappingStats stats;
+	stats.inc(STATS_READ_FAULTS);
+	stats.inc(STATS_READ_BYTES, 4096);
+	ASSERT_EQ(1u, stats.get(STATS_READ_FAULTS));
+	ASSERT_EQ(4096u, stats.get(STATS_READ_BYTES));
+	ASSERT_EQ(0u, stats.get(STATS_FLUSHES));
+	const size_t pointers = OS::cpuNumber() * sizeof(void*);
+	ASSERT_GT(stats.getMemory(), pointers);
+	ASSERT_LE(stats.getMemory(), pointers + STATS_COUNTERS * sizeof(size_t) + 64);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMappingStats, threads)
+{
+	//update from several threads
+	MappingStats stats;
+	std::vector<std::thread> threads;
+	for (int t = 0 ; t < 8 ; t++)
+		threads.emplace_back([&stats]{
+			for (int i = 0 ; i < 1000 ; i++)
+				stats.inc(STATS_WRITE_FAULTS);
+		});
+	for (auto & thread : threads)
+		thread.join();
+
+	//check
+	ASSERT_EQ(8000u, stats.get(STATS_WRITE_FAULTS));
+}
@@ -0,0 +1,104 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include "portability/OS.hpp"
+#include "../MissRatioCurve.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/********************  GLOBALS  *********************/
+/** Fixed owner so the sampled segments do not depend on the stack address. **/
+static const void * const owner = (const void*)0x100000;
+
+/*******************  FUNCTION  *********************/
+TEST(TestMissRatioCurve, constructor_destructor)
+{
+	MissRatioCurve curve(1024*1024);
+	ASSERT_EQ(0.0, curve.getAccesses());
+	ASSERT_EQ(0.0, curve.getMissRatio(4096));
+	ASSERT_DOUBLE_EQ(1.0 / UMMAP_MRC_DEFAULT_SAMPLING, curve.getSamplingRate());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMissRatioCurve, cyclic)
+{
+	//track all, the histogram buckets are 25600 bytes
+	MissRatioCurve curve(200 * UMMAP_PAGE_SIZE, 1);
+
+	//loop 10 times on 100 segments
+	for (size_t pass = 0 ; pass < 10 ; pass++)
+		for (size_t i = 0 ; i < 100 ; i++)
+			curve.access(owner, i, UMMAP_PAGE_SIZE);
+
+	//check, all the segments need to be resident to hit
+	ASSERT_DOUBLE_EQ(1000.0, curve.getAccesses());
+	ASSERT_EQ(100u, curve.getTrackedSegments());
+	ASSERT_DOUBLE_EQ(1.0, curve.getMissRatio(0));
+	ASSERT_DOUBLE_EQ(1.0, curve.getMissRatio(15 * 25600));
+	ASSERT_DOUBLE_EQ(0.1, curve.getMissRatio(100 * UMMAP_PAGE_SIZE));
+	ASSERT_DOUBLE_EQ(0.1, curve.getMissRatio(400 * UMMAP_PAGE_SIZE));
+
+	//curve
+	ummap_mrc_point_t points[16];
+	ASSERT_EQ(16u, curve.getCurve(points, 16));
+	ASSERT_EQ(4 * 25600u, points[0].memory);
+	ASSERT_DOUBLE_EQ(1.0, points[0].miss_ratio);
+	ASSERT_EQ(16 * 25600u, points[3].memory);
+	ASSERT_DOUBLE_EQ(0.1, points[3].miss_ratio);
+	ASSERT_EQ(400 * UMMAP_PAGE_SIZE, points[15].memory);
+
+	//reset
+	curve.reset();
+	ASSERT_EQ(0.0, curve.getAccesses());
+	ASSERT_EQ(0u, curve.getTrackedSegments());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMissRatioCurve, compact)
+{
+	//many accesses on few segments to renumber the times
+	MissRatioCurve curve(200 * UMMAP_PAGE_SIZE, 1);
+	for (size_t pass = 0 ; pass < 1000 ; pass++)
+		for (size_t i = 0 ; i < 10 ; i++)
+			curve.access(owner, i, UMMAP_PAGE_SIZE);
+
+	//check
+	ASSERT_DOUBLE_EQ(1.0, curve.getMissRatio(25600));
+	ASSERT_DOUBLE_EQ(0.001, curve.getMissRatio(2 * 25600));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMissRatioCurve, sampling)
+{
+	//sample 1/8 of the segments
+	MissRatioCurve curve(8192 * UMMAP_PAGE_SIZE, 8);
+	for (size_t pass = 0 ; pass < 10 ; pass++)
+		for (size_t i = 0 ; i < 4096 ; i++)
+			curve.access(owner, i, UMMAP_PAGE_SIZE);
+
+	//check the estimation
+	EXPECT_NEAR(40960.0, curve.getAccesses(), 4096.0);
+	EXPECT_LT(curve.getTrackedSegments(), 1024u);
+	EXPECT_GT(curve.getMissRatio(3500 * UMMAP_PAGE_SIZE), 0.9);
+	EXPECT_NEAR(0.1, curve.getMissRatio(4700 * UMMAP_PAGE_SIZE), 0.01);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestMissRatioCurve, max_keys)
+{
+	//lower the rate when tracking too many segments
+	MissRatioCurve curve(1024 * UMMAP_PAGE_SIZE, 1, 16);
+	for (size_t i = 0 ; i < 1000 ; i++)
+		curve.access(owner, i, UMMAP_PAGE_SIZE);
+
+	//check
+	EXPECT_LE(curve.getTrackedSegments(), 16u);
+	EXPECT_LT(curve.getSamplingRate(), 1.0 / 16);
+	EXPECT_NEAR(1000.0, curve.getAccesses(), 500.0);
+}
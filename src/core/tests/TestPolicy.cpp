@@ -22,8 +22,11 @@ class PublicPolicy: public Policy
 	public:
 		PublicPolicy(void) : Policy(4096, false) {};
 		virtual void allocateElementStorage(Mapping * mapping, size_t segmentCount) override {};
-		virtual void notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty) override {};
+		virtual void notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty, bool speculative) override {};
 		virtual void notifyEvict(Mapping * mapping, size_t index) override {};
+		virtual bool notifyPin(Mapping * mapping, size_t index) override {return true;};
+		virtual void notifyUnpin(Mapping * mapping, size_t index) override {};
+		virtual void notifyCharge(Mapping * mapping, size_t index) override {};
 		virtual void freeElementStorage(Mapping * mapping) override {};
 		void registerMapping(Mapping * mapping, void * storage, size_t elementCount, size_t elementSize) {Policy::registerMapping(mapping, storage, elementCount, elementSize);};
 		void unregisterMapping(Mapping * mapping) {Policy::unregisterMapping(mapping);};
@@ -7,6 +7,8 @@
 /********************  HEADERS  *********************/
 //gtest
 #include <gtest/gtest.h>
+//unix
+#include <unistd.h>
 //local
 #include "../Mapping.hpp"
 #include "../Policy.hpp"
@@ -234,3 +236,45 @@ TEST(TestPolicyQuotaLocal, quota_reach_two_unbalanced_fifo_window)
 	EXPECT_EQ(1*UMMAP_PAGE_SIZE, policy1->getCurrentMemory());
 	EXPECT_EQ(3*UMMAP_PAGE_SIZE, policy2->getCurrentMemory());
 }
+
+/*******************  FUNCTION  *********************/
+TEST(TestPolicyQuotaLocal, async)
+{
+	size_t size = 8*UMMAP_PAGE_SIZE;
+	PolicyQuotaLocal quota(4*UMMAP_PAGE_SIZE);
+	quota.setAsync(true);
+	EXPECT_TRUE(quota.isAsync());
+
+	//mapping
+	DummyDriver driver1(0);
+	FifoPolicy * policy1 = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping mapping1(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver1, policy1, NULL);
+
+	//mapping
+	DummyDriver driver2(0);
+	FifoPolicy * policy2 = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping mapping2(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver2, policy2, NULL);
+
+	//register
+	quota.registerPolicy(policy1);
+	quota.registerPolicy(policy2);
+
+	//touch, the fault path does not shrink
+	char * ptr1 = (char*)mapping1.getAddress();
+	char * ptr2 = (char*)mapping2.getAddress();
+	for (int i = 0 ; i < 4 ; i++) {
+		mapping1.onSegmentationFault(ptr1 + i * UMMAP_PAGE_SIZE, true);
+		mapping2.onSegmentationFault(ptr2 + i * UMMAP_PAGE_SIZE, true);
+	}
+
+	//wait the background thread
+	for (int i = 0 ; i < 1000 && policy1->getCurrentMemory() + policy2->getCurrentMemory() > 4*UMMAP_PAGE_SIZE ; i++)
+		usleep(1000);
+	EXPECT_EQ(2*UMMAP_PAGE_SIZE, policy1->getCurrentMemory());
+	EXPECT_EQ(2*UMMAP_PAGE_SIZE, policy2->getCurrentMemory());
+	EXPECT_EQ(2*UMMAP_PAGE_SIZE, policy1->getMemorySnapshot());
+
+	//back to sync
+	quota.setAsync(false);
+	EXPECT_FALSE(quota.isAsync());
+}
@@ -0,0 +1,234 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+//gtest
+#include <gtest/gtest.h>
+//local
+#include "../Mapping.hpp"
+#include "../Policy.hpp"
+#include "../PolicyQuotaUtility.hpp"
+#include "../../policies/FifoPolicy.hpp"
+#include "../../drivers/DummyDriver.hpp"
+#include "../../portability/OS.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+TEST(TestPolicyQuotaUtility, register)
+{
+	PolicyQuotaUtility quota(8*UMMAP_PAGE_SIZE);
+	size_t size = 16*UMMAP_PAGE_SIZE;
+
+	//mappings
+	DummyDriver driver(0);
+	FifoPolicy * policy1 = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping mapping1(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, policy1, NULL);
+	FifoPolicy * policy2 = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping mapping2(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, policy2, NULL);
+
+	//one policy gets all
+	quota.registerPolicy(policy1);
+	EXPECT_EQ(8*UMMAP_PAGE_SIZE, policy1->getDynamicMaxMemory());
+
+	//split without any measure
+	quota.registerPolicy(policy2);
+	EXPECT_EQ(4*UMMAP_PAGE_SIZE, policy1->getDynamicMaxMemory());
+	EXPECT_EQ(4*UMMAP_PAGE_SIZE, policy2->getDynamicMaxMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestPolicyQuotaUtility, weight_and_min)
+{
+	PolicyQuotaUtility quota(8*UMMAP_PAGE_SIZE);
+	size_t size = 16*UMMAP_PAGE_SIZE;
+
+	//mappings
+	DummyDriver driver(0);
+	FifoPolicy * policy1 = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping mapping1(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, policy1, NULL);
+	FifoPolicy * policy2 = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping mapping2(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, policy2, NULL);
+	quota.registerPolicy(policy1);
+	quota.registerPolicy(policy2);
+
+	//fill
+	char * ptr1 = (char*)mapping1.getAddress();
+	for (size_t i = 0 ; i < 4 ; i++)
+		mapping1.onSegmentationFault(ptr1 + i * UMMAP_PAGE_SIZE, false);
+	EXPECT_EQ(4*UMMAP_PAGE_SIZE, policy1->getCurrentMemory());
+
+	//weight
+	quota.setPolicyShare(policy2, 3.0, 0);
+	EXPECT_EQ(2*UMMAP_PAGE_SIZE, policy1->getDynamicMaxMemory());
+	EXPECT_EQ(6*UMMAP_PAGE_SIZE, policy2->getDynamicMaxMemory());
+	EXPECT_EQ(2*UMMAP_PAGE_SIZE, policy1->getCurrentMemory());
+
+	//guarantee
+	quota.setPolicyShare(policy1, 1.0, 5*UMMAP_PAGE_SIZE);
+	EXPECT_EQ(5*UMMAP_PAGE_SIZE, policy1->getDynamicMaxMemory());
+	EXPECT_EQ(3*UMMAP_PAGE_SIZE, policy2->getDynamicMaxMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestPolicyQuotaUtility, many_policies)
+{
+	PolicyQuotaUtility quota(128*UMMAP_PAGE_SIZE);
+	size_t size = 4*UMMAP_PAGE_SIZE;
+
+	//more policies than chunks
+	DummyDriver driver(0);
+	std::vector<Mapping *> mappings;
+	std::vector<FifoPolicy *> policies;
+	for (size_t i = 0 ; i < 100 ; i++) {
+		FifoPolicy * policy = new FifoPolicy(4*UMMAP_PAGE_SIZE, true);
+		mappings.push_back(new Mapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, policy, NULL));
+		policies.push_back(policy);
+		quota.registerPolicy(policy);
+	}
+
+	//each one gets at least a page and the sum fits in the quota
+	size_t total = 0;
+	for (auto policy : policies) {
+		EXPECT_GE(policy->getDynamicMaxMemory(), UMMAP_PAGE_SIZE);
+		total += policy->getDynamicMaxMemory();
+	}
+	EXPECT_LE(total, 128*UMMAP_PAGE_SIZE);
+
+	//clean
+	for (auto mapping : mappings)
+		delete mapping;
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestPolicyQuotaUtility, hot_wins_over_streaming)
+{
+	PolicyQuotaUtility quota(8*UMMAP_PAGE_SIZE);
+	size_t size = 64*UMMAP_PAGE_SIZE;
+
+	//mappings
+	DummyDriver driver(0);
+	FifoPolicy * streamPolicy = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping streamMapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, streamPolicy, NULL);
+	FifoPolicy * hotPolicy = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping hotMapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, hotPolicy, NULL);
+	quota.registerPolicy(streamPolicy);
+	quota.registerPolicy(hotPolicy);
+
+	//stream once on the first and loop on 6 segments on the second
+	char * streamPtr = (char*)streamMapping.getAddress();
+	char * hotPtr = (char*)hotMapping.getAddress();
+	for (size_t i = 0 ; i < 64 ; i++) {
+		streamMapping.onSegmentationFault(streamPtr + i * UMMAP_PAGE_SIZE, false);
+		hotMapping.onSegmentationFault(hotPtr + (i % 6) * UMMAP_PAGE_SIZE, false);
+	}
+
+	//check
+	quota.rebalance();
+	EXPECT_EQ(1*UMMAP_PAGE_SIZE, streamPolicy->getDynamicMaxMemory());
+	EXPECT_EQ(7*UMMAP_PAGE_SIZE, hotPolicy->getDynamicMaxMemory());
+	EXPECT_EQ(1*UMMAP_PAGE_SIZE, streamPolicy->getCurrentMemory());
+
+	//no more refaults, the hot one keeps its memory
+	for (size_t i = 0 ; i < 6 ; i++)
+		hotMapping.onSegmentationFault(hotPtr + i * UMMAP_PAGE_SIZE, false);
+	quota.rebalance();
+	EXPECT_EQ(7*UMMAP_PAGE_SIZE, hotPolicy->getDynamicMaxMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestPolicyQuotaUtility, miss_ratio_curve)
+{
+	PolicyQuotaUtility quota(8*UMMAP_PAGE_SIZE);
+	size_t size = 64*UMMAP_PAGE_SIZE;
+
+	//mappings
+	DummyDriver driver(0);
+	FifoPolicy * streamPolicy = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	streamPolicy->enableMissRatioCurve(1);
+	Mapping streamMapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, streamPolicy, NULL);
+	FifoPolicy * hotPolicy = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	hotPolicy->enableMissRatioCurve(1);
+	Mapping hotMapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, hotPolicy, NULL);
+	quota.registerPolicy(streamPolicy);
+	quota.registerPolicy(hotPolicy);
+
+	//stream once on the first and loop on 6 segments on the second
+	char * streamPtr = (char*)streamMapping.getAddress();
+	char * hotPtr = (char*)hotMapping.getAddress();
+	for (size_t i = 0 ; i < 64 ; i++) {
+		streamMapping.onSegmentationFault(streamPtr + i * UMMAP_PAGE_SIZE, false);
+		hotMapping.onSegmentationFault(hotPtr + (i % 6) * UMMAP_PAGE_SIZE, false);
+	}
+
+	//the curve tells the hot one needs exactly 6 segments, the rest is spread
+	quota.rebalance();
+	EXPECT_EQ(6*UMMAP_PAGE_SIZE, hotPolicy->getDynamicMaxMemory());
+	EXPECT_EQ(2*UMMAP_PAGE_SIZE, streamPolicy->getDynamicMaxMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestPolicyQuotaUtility, triggered_by_evictions)
+{
+	PolicyQuotaUtility quota(8*UMMAP_PAGE_SIZE);
+	size_t size = 256*UMMAP_PAGE_SIZE;
+
+	//mappings
+	DummyDriver driver(0);
+	FifoPolicy * streamPolicy = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping streamMapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, streamPolicy, NULL);
+	FifoPolicy * hotPolicy = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping hotMapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, hotPolicy, NULL);
+	quota.registerPolicy(streamPolicy);
+	quota.registerPolicy(hotPolicy);
+
+	//loop until the evictions trigger the distributions
+	char * streamPtr = (char*)streamMapping.getAddress();
+	char * hotPtr = (char*)hotMapping.getAddress();
+	for (size_t i = 0 ; i < 256 ; i++) {
+		streamMapping.onSegmentationFault(streamPtr + i * UMMAP_PAGE_SIZE, false);
+		hotMapping.onSegmentationFault(hotPtr + (i % 6) * UMMAP_PAGE_SIZE, false);
+	}
+
+	//check
+	EXPECT_GE(hotPolicy->getDynamicMaxMemory(), 6*UMMAP_PAGE_SIZE);
+	EXPECT_LE(streamPolicy->getDynamicMaxMemory(), 2*UMMAP_PAGE_SIZE);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestPolicyQuotaUtility, async)
+{
+	PolicyQuotaUtility quota(8*UMMAP_PAGE_SIZE);
+	quota.setAsync(true);
+	size_t size = 256*UMMAP_PAGE_SIZE;
+
+	//mappings
+	DummyDriver driver(0);
+	FifoPolicy * streamPolicy = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping streamMapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, streamPolicy, NULL);
+	FifoPolicy * hotPolicy = new FifoPolicy(8*UMMAP_PAGE_SIZE, true);
+	Mapping hotMapping(NULL, size, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, hotPolicy, NULL);
+	quota.registerPolicy(streamPolicy);
+	quota.registerPolicy(hotPolicy);
+
+	//the evictions are posted to the background thread
+	char * streamPtr = (char*)streamMapping.getAddress();
+	char * hotPtr = (char*)hotMapping.getAddress();
+	for (size_t i = 0 ; i < 256 ; i++) {
+		streamMapping.onSegmentationFault(streamPtr + i * UMMAP_PAGE_SIZE, false);
+		hotMapping.onSegmentationFault(hotPtr + (i % 6) * UMMAP_PAGE_SIZE, false);
+		if (i % 64 == 63)
+			usleep(50000);
+	}
+
+	//check
+	EXPECT_GE(hotPolicy->getDynamicMaxMemory(), 6*UMMAP_PAGE_SIZE);
+	EXPECT_LE(streamPolicy->getDynamicMaxMemory(), 2*UMMAP_PAGE_SIZE);
+
+	//stop before the policies are destroyed
+	quota.setAsync(false);
+}
@@ -0,0 +1,187 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include "portability/OS.hpp"
+#include "drivers/MemoryDriver.hpp"
+#include "../SegmentCache.hpp"
+#include "../Mapping.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentCache, registry)
+{
+	//setup
+	SegmentCacheRegistry registry;
+	MemoryDriver driver1(8*UMMAP_PAGE_SIZE);
+	MemoryDriver driver2(8*UMMAP_PAGE_SIZE);
+
+	//same object
+	SegmentCache * cache1 = registry.acquire(&driver1, 0, UMMAP_PAGE_SIZE);
+	SegmentCache * cache2 = registry.acquire(&driver1, 2*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE);
+	ASSERT_NE((SegmentCache*)NULL, cache1);
+	ASSERT_EQ(cache1, cache2);
+	ASSERT_EQ(1u, registry.getCacheCount());
+
+	//segments not matching
+	ASSERT_EQ(NULL, registry.acquire(&driver1, 0, 2*UMMAP_PAGE_SIZE));
+	ASSERT_EQ(NULL, registry.acquire(&driver1, 100, UMMAP_PAGE_SIZE));
+
+	//other object
+	SegmentCache * cache3 = registry.acquire(&driver2, 0, UMMAP_PAGE_SIZE);
+	ASSERT_NE(cache1, cache3);
+	ASSERT_EQ(2u, registry.getCacheCount());
+
+	//release
+	registry.release(cache1);
+	registry.release(cache2);
+	registry.release(cache3);
+	ASSERT_EQ(0u, registry.getCacheCount());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentCache, map_release)
+{
+	//setup
+	SegmentCacheRegistry registry;
+	MemoryDriver driver(8*UMMAP_PAGE_SIZE, 'a');
+	SegmentCache * cache = registry.acquire(&driver, 0, UMMAP_PAGE_SIZE);
+	char * view1 = (char*)OS::mmapProtNone(NULL, 2*UMMAP_PAGE_SIZE, false);
+	char * view2 = (char*)OS::mmapProtNone(NULL, 2*UMMAP_PAGE_SIZE, false);
+	Mapping holder1(NULL, 4*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ, UMMAP_DEFAULT, &driver, NULL, NULL);
+	Mapping holder2(NULL, 4*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//first one read the storage
+	size_t readBytes = 0;
+	ASSERT_FALSE(cache->map(view1, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, false, true, false, &driver, &holder1, readBytes));
+	ASSERT_EQ(UMMAP_PAGE_SIZE, readBytes);
+	ASSERT_EQ('a', view1[0]);
+
+	//second share it
+	ASSERT_TRUE(cache->map(view2, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, false, false, false, &driver, &holder2, readBytes));
+	ASSERT_EQ(0u, readBytes);
+	view1[0] = 'b';
+	ASSERT_EQ('b', view2[0]);
+	ASSERT_EQ(1u, cache->getCachedSegments());
+
+	//a larger view read the missing part only
+	ASSERT_FALSE(cache->map(view1 + UMMAP_PAGE_SIZE, 2*UMMAP_PAGE_SIZE, 100, false, false, false, &driver, &holder1, readBytes));
+	ASSERT_EQ(100u, readBytes);
+	ASSERT_TRUE(cache->map(view2 + UMMAP_PAGE_SIZE, 2*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, false, false, false, &driver, &holder2, readBytes));
+	ASSERT_EQ(UMMAP_PAGE_SIZE - 100, readBytes);
+	ASSERT_EQ('a', view2[UMMAP_PAGE_SIZE + UMMAP_PAGE_SIZE - 1]);
+
+	//charged to the first one only
+	ASSERT_TRUE(cache->isCharged(UMMAP_PAGE_SIZE, &holder1));
+	ASSERT_FALSE(cache->isCharged(UMMAP_PAGE_SIZE, &holder2));
+
+	//released with the last view, the charge goes to the remaining one
+	std::vector<Mapping *> charged;
+	cache->release(UMMAP_PAGE_SIZE, 2*UMMAP_PAGE_SIZE, &holder1, charged);
+	ASSERT_EQ(2u, charged.size());
+	ASSERT_EQ(&holder2, charged[0]);
+	ASSERT_EQ(&holder2, charged[1]);
+	cache->endCharge(&holder2);
+	cache->endCharge(&holder2);
+	ASSERT_EQ(2u, cache->getCachedSegments());
+	ASSERT_EQ('b', view2[0]);
+	ASSERT_FALSE(cache->isCharged(UMMAP_PAGE_SIZE, &holder1));
+	ASSERT_TRUE(cache->isCharged(UMMAP_PAGE_SIZE, &holder2));
+	ASSERT_TRUE(cache->isCharged(2*UMMAP_PAGE_SIZE, &holder2));
+	charged.clear();
+	cache->release(UMMAP_PAGE_SIZE, 2*UMMAP_PAGE_SIZE, &holder2, charged);
+	ASSERT_TRUE(charged.empty());
+	ASSERT_EQ(0u, cache->getCachedSegments());
+	ASSERT_FALSE(cache->isCharged(UMMAP_PAGE_SIZE, &holder2));
+
+	//clean
+	OS::munmap(view1, 2*UMMAP_PAGE_SIZE);
+	OS::munmap(view2, 2*UMMAP_PAGE_SIZE);
+	registry.release(cache);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentCache, skip_read_discard)
+{
+	//setup
+	SegmentCacheRegistry registry;
+	MemoryDriver driver(8*UMMAP_PAGE_SIZE, 'a');
+	SegmentCache * cache = registry.acquire(&driver, 0, UMMAP_PAGE_SIZE);
+	char * view1 = (char*)OS::mmapProtNone(NULL, UMMAP_PAGE_SIZE, false);
+	char * view2 = (char*)OS::mmapProtNone(NULL, UMMAP_PAGE_SIZE, false);
+	Mapping holder1(NULL, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ, UMMAP_DEFAULT, &driver, NULL, NULL);
+	Mapping holder2(NULL, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ, UMMAP_DEFAULT, &driver, NULL, NULL);
+
+	//not read
+	size_t readBytes = 0;
+	ASSERT_FALSE(cache->map(view1, 0, UMMAP_PAGE_SIZE, true, true, false, &driver, &holder1, readBytes));
+	ASSERT_EQ(0u, readBytes);
+	ASSERT_EQ(0, view1[0]);
+	view1[0] = 'b';
+
+	//the content of the first view is kept
+	ASSERT_TRUE(cache->map(view2, 0, UMMAP_PAGE_SIZE, false, true, false, &driver, &holder2, readBytes));
+	ASSERT_EQ(0u, readBytes);
+	ASSERT_EQ('b', view2[0]);
+
+	//discard for all
+	cache->discard(0, UMMAP_PAGE_SIZE);
+	ASSERT_EQ(0, view1[0]);
+	ASSERT_EQ(0, view2[0]);
+
+	//clean
+	std::vector<Mapping *> charged;
+	cache->release(0, UMMAP_PAGE_SIZE, &holder2, charged);
+	cache->release(0, UMMAP_PAGE_SIZE, &holder1, charged);
+	ASSERT_TRUE(charged.empty());
+	OS::munmap(view1, UMMAP_PAGE_SIZE);
+	OS::munmap(view2, UMMAP_PAGE_SIZE);
+	registry.release(cache);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentCache, leave)
+{
+	//setup
+	SegmentCacheRegistry registry;
+	MemoryDriver driver(8*UMMAP_PAGE_SIZE, 'a');
+	SegmentCache * cache = registry.acquire(&driver, 0, UMMAP_PAGE_SIZE);
+	char * views[3];
+	Mapping holder1(NULL, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ, UMMAP_DEFAULT, &driver, NULL, NULL);
+	Mapping holder2(NULL, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ, UMMAP_DEFAULT, &driver, NULL, NULL);
+	Mapping holder3(NULL, UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ, UMMAP_DEFAULT, &driver, NULL, NULL);
+	Mapping * holders[3] = {&holder1, &holder2, &holder3};
+	size_t readBytes = 0;
+	for (int i = 0 ; i < 3 ; i++) {
+		views[i] = (char*)OS::mmapProtNone(NULL, UMMAP_PAGE_SIZE, false);
+		cache->map(views[i], 0, UMMAP_PAGE_SIZE, false, false, false, &driver, holders[i], readBytes);
+	}
+
+	//the charge skips the mapping being destroyed
+	std::vector<Mapping *> charged;
+	cache->leave(&holder2);
+	cache->release(0, UMMAP_PAGE_SIZE, &holder1, charged);
+	ASSERT_EQ(1u, charged.size());
+	ASSERT_EQ(&holder3, charged[0]);
+	ASSERT_TRUE(cache->isCharged(0, &holder3));
+	cache->endCharge(&holder3);
+
+	//nothing to move to it once gone
+	charged.clear();
+	cache->release(0, UMMAP_PAGE_SIZE, &holder2, charged);
+	cache->forget(&holder2);
+	ASSERT_TRUE(charged.empty());
+	cache->release(0, UMMAP_PAGE_SIZE, &holder3, charged);
+	ASSERT_TRUE(charged.empty());
+
+	//clean
+	for (int i = 0 ; i < 3 ; i++)
+		OS::munmap(views[i], UMMAP_PAGE_SIZE);
+	registry.release(cache);
+}
@@ -0,0 +1,95 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include "../SegmentStatusPool.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusPool, constructor)
+{
+	SegmentStatusPool pool(1024);
+	ASSERT_EQ(0u, pool.getUsedSegments());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusPool, acquire_release)
+{
+	//setup
+	SegmentStatusPool pool(1024);
+
+	//acquire, rounded and aligned on power of 2
+	SegmentStatusTable * window1 = pool.acquire(3);
+	SegmentStatusTable * window2 = pool.acquire(5);
+	ASSERT_EQ(0u, window1->getFirst());
+	ASSERT_EQ(3u, window1->getSegments());
+	ASSERT_EQ(8u, window2->getFirst());
+	ASSERT_EQ(5u, window2->getSegments());
+	ASSERT_EQ(12u, pool.getUsedSegments());
+
+	//release & reuse
+	pool.release(window1);
+	ASSERT_EQ(8u, pool.getUsedSegments());
+	SegmentStatusTable * window3 = pool.acquire(4);
+	ASSERT_EQ(0u, window3->getFirst());
+
+	//clean
+	pool.release(window2);
+	pool.release(window3);
+	ASSERT_EQ(0u, pool.getUsedSegments());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusPool, too_large)
+{
+	SegmentStatusPool pool(4 * UMMAP_SEGMENT_STATUS_CHUNK);
+	ASSERT_EQ(NULL, pool.acquire(UMMAP_SEGMENT_STATUS_CHUNK + 1));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusPool, full)
+{
+	//setup
+	SegmentStatusPool pool(16);
+
+	//fill
+	SegmentStatusTable * window = pool.acquire(16);
+	ASSERT_NE((SegmentStatusTable*)NULL, window);
+	ASSERT_EQ(NULL, pool.acquire(1));
+
+	//clean
+	pool.release(window);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusPool, reset_on_release)
+{
+	//setup
+	SegmentStatusPool pool(1024);
+
+	//use a window
+	SegmentStatusTable * window = pool.acquire(4);
+	window->get(1).mapped = true;
+	window->get(1).dirty = true;
+	window->get(2).advice = 2;
+	window->updateIndex(1);
+	ASSERT_EQ(1u, window->getResidentCount());
+	pool.release(window);
+
+	//get it back, must be clean
+	window = pool.acquire(4);
+	ASSERT_EQ(0u, window->getFirst());
+	ASSERT_FALSE(window->peek(1).mapped);
+	ASSERT_FALSE(window->peek(1).dirty);
+	ASSERT_EQ(0, window->peek(2).advice);
+	ASSERT_EQ(0u, window->getResidentCount());
+	ASSERT_EQ(0u, window->getDirtyCount());
+	ASSERT_EQ(4u, window->nextResident(0, 4));
+	pool.release(window);
+}
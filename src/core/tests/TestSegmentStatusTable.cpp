@@ -0,0 +1,524 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "public-api/ummap.h"
+#include "../SegmentStatusTable.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, constructor)
+{
+	SegmentStatusTable table(10 * UMMAP_SEGMENT_STATUS_CHUNK);
+	ASSERT_EQ(10 * sizeof(void*), table.getMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, peek_default)
+{
+	//setup
+	SegmentStatusTable table(10 * UMMAP_SEGMENT_STATUS_CHUNK);
+
+	//check
+	SegmentStatus status = table.peek(5 * UMMAP_SEGMENT_STATUS_CHUNK);
+	ASSERT_FALSE(status.mapped);
+	ASSERT_FALSE(status.dirty);
+	ASSERT_FALSE(status.skipRead);
+	ASSERT_EQ(NULL, table.find(5 * UMMAP_SEGMENT_STATUS_CHUNK));
+	ASSERT_EQ(10 * sizeof(void*), table.getMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, get)
+{
+	//setup
+	SegmentStatusTable table(10 * UMMAP_SEGMENT_STATUS_CHUNK);
+
+	//allocate one chunk
+	table.get(5 * UMMAP_SEGMENT_STATUS_CHUNK + 3).dirty = true;
+	ASSERT_EQ(10 * sizeof(void*) + SegmentStatusTable::getChunkMemory(UMMAP_SEGMENT_STATUS_CHUNK), table.getMemory());
+
+	//check
+	ASSERT_TRUE(table.peek(5 * UMMAP_SEGMENT_STATUS_CHUNK + 3).dirty);
+	ASSERT_FALSE(table.peek(5 * UMMAP_SEGMENT_STATUS_CHUNK + 4).dirty);
+	ASSERT_NE((SegmentStatus*)NULL, table.find(5 * UMMAP_SEGMENT_STATUS_CHUNK));
+	ASSERT_EQ(NULL, table.find(4 * UMMAP_SEGMENT_STATUS_CHUNK));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, nextTouched)
+{
+	//setup
+	const size_t segments = 10 * UMMAP_SEGMENT_STATUS_CHUNK;
+	SegmentStatusTable table(segments);
+
+	//empty
+	ASSERT_EQ(segments, table.nextTouched(0, segments));
+
+	//touch
+	table.get(3 * UMMAP_SEGMENT_STATUS_CHUNK + 10);
+	table.get(7 * UMMAP_SEGMENT_STATUS_CHUNK);
+
+	//check
+	ASSERT_EQ(3 * UMMAP_SEGMENT_STATUS_CHUNK, table.nextTouched(0, segments));
+	ASSERT_EQ(3 * UMMAP_SEGMENT_STATUS_CHUNK + 5, table.nextTouched(3 * UMMAP_SEGMENT_STATUS_CHUNK + 5, segments));
+	ASSERT_EQ(7 * UMMAP_SEGMENT_STATUS_CHUNK, table.nextTouched(4 * UMMAP_SEGMENT_STATUS_CHUNK, segments));
+	ASSERT_EQ(5 * UMMAP_SEGMENT_STATUS_CHUNK, table.nextTouched(4 * UMMAP_SEGMENT_STATUS_CHUNK, 5 * UMMAP_SEGMENT_STATUS_CHUNK));
+	ASSERT_EQ(segments, table.nextTouched(8 * UMMAP_SEGMENT_STATUS_CHUNK, segments));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, setSkipRead)
+{
+	//setup
+	SegmentStatusTable table(10 * UMMAP_SEGMENT_STATUS_CHUNK);
+	table.get(0);
+
+	//apply
+	table.setSkipRead();
+
+	//check already allocated, not allocated and allocated after
+	ASSERT_TRUE(table.peek(0).skipRead);
+	ASSERT_TRUE(table.peek(5 * UMMAP_SEGMENT_STATUS_CHUNK).skipRead);
+	ASSERT_TRUE(table.get(5 * UMMAP_SEGMENT_STATUS_CHUNK).skipRead);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, not_multiple_of_chunk)
+{
+	//setup
+	const size_t segments = UMMAP_SEGMENT_STATUS_CHUNK + 10;
+	SegmentStatusTable table(segments);
+
+	//touch last
+	table.get(segments - 1).mapped = true;
+
+	//check
+	ASSERT_TRUE(table.peek(segments - 1).mapped);
+	ASSERT_EQ(UMMAP_SEGMENT_STATUS_CHUNK, table.nextTouched(0, segments));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, updateIndex)
+{
+	//setup
+	const size_t segments = 10 * UMMAP_SEGMENT_STATUS_CHUNK;
+	SegmentStatusTable table(segments);
+
+	//empty
+	ASSERT_EQ(segments, table.nextResident(0, segments));
+	ASSERT_EQ(segments, table.nextDirty(0, segments));
+
+	//mark some
+	table.get(10).mapped = true;
+	table.updateIndex(10);
+	table.get(5000).mapped = true;
+	table.get(5000).dirty = true;
+	table.updateIndex(5000);
+	table.get(7 * UMMAP_SEGMENT_STATUS_CHUNK + 64).mapped = true;
+	table.get(7 * UMMAP_SEGMENT_STATUS_CHUNK + 64).inFlight = true;
+	table.updateIndex(7 * UMMAP_SEGMENT_STATUS_CHUNK + 64);
+
+	//check resident
+	ASSERT_EQ(3u, table.getResidentCount());
+	ASSERT_EQ(10u, table.nextResident(0, segments));
+	ASSERT_EQ(5000u, table.nextResident(11, segments));
+	ASSERT_EQ(7 * UMMAP_SEGMENT_STATUS_CHUNK + 64, table.nextResident(5001, segments));
+	ASSERT_EQ(segments, table.nextResident(7 * UMMAP_SEGMENT_STATUS_CHUNK + 65, segments));
+	ASSERT_EQ(4000u, table.nextResident(11, 4000));
+
+	//check dirty
+	ASSERT_EQ(2u, table.getDirtyCount());
+	ASSERT_EQ(5000u, table.nextDirty(0, segments));
+	ASSERT_EQ(7 * UMMAP_SEGMENT_STATUS_CHUNK + 64, table.nextDirty(5001, segments));
+
+	//clear
+	table.get(5000).dirty = false;
+	table.updateIndex(5000);
+	table.get(10).mapped = false;
+	table.updateIndex(10);
+	ASSERT_EQ(2u, table.getResidentCount());
+	ASSERT_EQ(1u, table.getDirtyCount());
+	ASSERT_EQ(5000u, table.nextResident(0, segments));
+	ASSERT_EQ(7 * UMMAP_SEGMENT_STATUS_CHUNK + 64, table.nextDirty(0, segments));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, updateIndex_all)
+{
+	//setup
+	const size_t segments = UMMAP_SEGMENT_STATUS_CHUNK;
+	SegmentStatusTable table(segments);
+
+	//mark all
+	for (size_t i = 0 ; i < segments ; i++) {
+		table.get(i).mapped = true;
+		table.updateIndex(i);
+	}
+
+	//check
+	ASSERT_EQ(segments, table.getResidentCount());
+	for (size_t i = 0 ; i < segments ; i++)
+		ASSERT_EQ(i, table.nextResident(i, segments));
+
+	//clear one every two
+	for (size_t i = 0 ; i < segments ; i += 2) {
+		table.get(i).mapped = false;
+		table.updateIndex(i);
+	}
+
+	//check
+	ASSERT_EQ(segments / 2, table.getResidentCount());
+	for (size_t i = 0 ; i < segments ; i += 2)
+		ASSERT_EQ(i + 1, table.nextResident(i, segments));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, lock)
+{
+	//setup
+	SegmentStatusTable table(10 * UMMAP_SEGMENT_STATUS_CHUNK);
+	size_t counter = 0;
+
+	//lock allocate the chunk
+	table.lock(3 * UMMAP_SEGMENT_STATUS_CHUNK + 1);
+	ASSERT_NE((SegmentStatus*)NULL, table.find(3 * UMMAP_SEGMENT_STATUS_CHUNK));
+	table.unlock(3 * UMMAP_SEGMENT_STATUS_CHUNK + 1);
+
+	//concurrent access on the same segment and its neighbour in the same word
+	std::thread threads[4];
+	for (int t = 0 ; t < 4 ; t++) {
+		threads[t] = std::thread([&table, &counter, t]() {
+			for (int i = 0 ; i < 10000 ; i++) {
+				table.lock(64);
+				table.lock(65 + t % 2);
+				counter++;
+				table.unlock(65 + t % 2);
+				table.unlock(64);
+			}
+		});
+	}
+	for (int t = 0 ; t < 4 ; t++)
+		threads[t].join();
+
+	//check
+	ASSERT_EQ(40000u, counter);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, lockRange)
+{
+	//setup
+	SegmentStatusTable table(4 * UMMAP_SEGMENT_STATUS_CHUNK);
+	const size_t end = 3 * UMMAP_SEGMENT_STATUS_CHUNK;
+	std::atomic<int> step(0);
+
+	//wait the segments already locked
+	table.lock(10);
+	std::thread ranger([&table, &step, end]() {
+		table.lockRange(0, end);
+		step = 1;
+	});
+	usleep(50000);
+	ASSERT_EQ(0, step);
+	table.unlock(10);
+	ranger.join();
+	ASSERT_EQ(1, step);
+
+	//the range is excluded, even in the not allocated chunks, not the rest
+	ASSERT_FALSE(table.tryLock(10));
+	ASSERT_TRUE(table.tryLock(end));
+	table.unlock(end);
+	ASSERT_EQ(NULL, table.find(2 * UMMAP_SEGMENT_STATUS_CHUNK));
+	std::thread locker([&table, &step]() {
+		table.lock(2 * UMMAP_SEGMENT_STATUS_CHUNK + 5);
+		table.unlock(2 * UMMAP_SEGMENT_STATUS_CHUNK + 5);
+		table.lockSegments(20, 40);
+		step = 2;
+	});
+	usleep(50000);
+	ASSERT_EQ(1, step);
+
+	//release
+	table.unlockRange();
+	locker.join();
+	ASSERT_EQ(2, step);
+	ASSERT_FALSE(table.tryLock(30));
+	table.unlockSegments(20, 40);
+	ASSERT_TRUE(table.tryLock(30));
+	table.unlock(30);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, window)
+{
+	//setup, the window cross a chunk boundary
+	SegmentStatusTable parent(2 * UMMAP_SEGMENT_STATUS_CHUNK);
+	SegmentStatusTable * window = new SegmentStatusTable(parent, UMMAP_SEGMENT_STATUS_CHUNK - 2, 4);
+
+	//untouched
+	ASSERT_EQ(4u, window->nextTouched(0, 4));
+	ASSERT_EQ(NULL, window->find(3));
+
+	//set in window
+	window->get(1).mapped = true;
+	window->updateIndex(1);
+	window->get(3).mapped = true;
+	window->get(3).dirty = true;
+	window->updateIndex(3);
+
+	//check relative IDs
+	ASSERT_EQ(1u, window->nextResident(0, 4));
+	ASSERT_EQ(3u, window->nextResident(2, 4));
+	ASSERT_EQ(3u, window->nextDirty(0, 4));
+	ASSERT_EQ(2u, window->getResidentCount());
+	ASSERT_EQ(1u, window->getDirtyCount());
+
+	//check parent
+	ASSERT_TRUE(parent.peek(UMMAP_SEGMENT_STATUS_CHUNK - 1).mapped);
+	ASSERT_TRUE(parent.peek(UMMAP_SEGMENT_STATUS_CHUNK + 1).dirty);
+	ASSERT_EQ(2u, parent.getResidentCount());
+
+	//skip read only on the window
+	window->setSkipRead();
+	ASSERT_TRUE(parent.peek(UMMAP_SEGMENT_STATUS_CHUNK).skipRead);
+	ASSERT_FALSE(parent.peek(UMMAP_SEGMENT_STATUS_CHUNK + 2).skipRead);
+
+	//destroy reset the range
+	delete window;
+	ASSERT_FALSE(parent.peek(UMMAP_SEGMENT_STATUS_CHUNK - 1).mapped);
+	ASSERT_FALSE(parent.peek(UMMAP_SEGMENT_STATUS_CHUNK).skipRead);
+	ASSERT_EQ(0u, parent.getResidentCount());
+	ASSERT_EQ(0u, parent.getDirtyCount());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, tryLock)
+{
+	//setup
+	SegmentStatusTable table(10 * UMMAP_SEGMENT_STATUS_CHUNK);
+
+	//take
+	ASSERT_TRUE(table.tryLock(5 * UMMAP_SEGMENT_STATUS_CHUNK + 2));
+	ASSERT_FALSE(table.tryLock(5 * UMMAP_SEGMENT_STATUS_CHUNK + 2));
+	ASSERT_TRUE(table.tryLock(5 * UMMAP_SEGMENT_STATUS_CHUNK + 3));
+
+	//release
+	table.unlock(5 * UMMAP_SEGMENT_STATUS_CHUNK + 2);
+	ASSERT_TRUE(table.tryLock(5 * UMMAP_SEGMENT_STATUS_CHUNK + 2));
+	table.unlock(5 * UMMAP_SEGMENT_STATUS_CHUNK + 2);
+	table.unlock(5 * UMMAP_SEGMENT_STATUS_CHUNK + 3);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, writeIntent)
+{
+	//setup
+	SegmentStatusTable parent(2 * UMMAP_SEGMENT_STATUS_CHUNK);
+	SegmentStatusTable * window = new SegmentStatusTable(parent, 10, 4);
+
+	//not allocated
+	ASSERT_FALSE(window->hasWriteIntent(1));
+
+	//set
+	window->get(1);
+	window->setWriteIntent(1, true);
+	ASSERT_TRUE(window->hasWriteIntent(1));
+	ASSERT_FALSE(window->hasWriteIntent(2));
+	ASSERT_TRUE(parent.hasWriteIntent(11));
+
+	//clear
+	window->setWriteIntent(1, false);
+	ASSERT_FALSE(window->hasWriteIntent(1));
+
+	//destroy reset the range
+	window->setWriteIntent(2, true);
+	delete window;
+	ASSERT_FALSE(parent.hasWriteIntent(12));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, pinned)
+{
+	//setup
+	SegmentStatusTable table(10 * UMMAP_SEGMENT_STATUS_CHUNK);
+
+	//not allocated
+	ASSERT_FALSE(table.isPinned(3 * UMMAP_SEGMENT_STATUS_CHUNK + 1));
+
+	//set
+	table.get(3 * UMMAP_SEGMENT_STATUS_CHUNK + 1);
+	table.setPinned(3 * UMMAP_SEGMENT_STATUS_CHUNK + 1, true);
+	ASSERT_TRUE(table.isPinned(3 * UMMAP_SEGMENT_STATUS_CHUNK + 1));
+	ASSERT_FALSE(table.isPinned(3 * UMMAP_SEGMENT_STATUS_CHUNK + 2));
+	ASSERT_FALSE(table.hasWriteIntent(3 * UMMAP_SEGMENT_STATUS_CHUNK + 1));
+
+	//clear
+	table.setPinned(3 * UMMAP_SEGMENT_STATUS_CHUNK + 1, false);
+	ASSERT_FALSE(table.isPinned(3 * UMMAP_SEGMENT_STATUS_CHUNK + 1));
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, discardRange)
+{
+	//setup
+	const size_t chunk = UMMAP_SEGMENT_STATUS_CHUNK;
+	SegmentStatusTable table(10 * chunk);
+	table.get(2 * chunk + 5).dirty = true;
+	table.updateIndex(2 * chunk + 5);
+
+	//discard from the touched chunk to the middle of another one
+	table.discardRange(2 * chunk + 4, 6 * chunk + 10);
+
+	//only the touched chunk and the partially covered one are allocated
+	ASSERT_EQ(10 * sizeof(void*) + 2 * SegmentStatusTable::getChunkMemory(UMMAP_SEGMENT_STATUS_CHUNK), table.getMemory());
+	ASSERT_EQ(NULL, table.find(4 * chunk));
+
+	//check
+	ASSERT_FALSE(table.peek(2 * chunk + 3).skipRead);
+	ASSERT_FALSE(table.peek(2 * chunk + 5).dirty);
+	ASSERT_EQ(0u, table.getDirtyCount());
+	for (size_t id : {2 * chunk + 4, 4 * chunk, 6 * chunk + 9}) {
+		ASSERT_TRUE(table.peek(id).skipRead) << id;
+		ASSERT_TRUE(table.peek(id).changed) << id;
+	}
+	ASSERT_FALSE(table.peek(6 * chunk + 10).skipRead);
+	ASSERT_FALSE(table.peek(7 * chunk).skipRead);
+
+	//the marked chunks are seen as touched
+	ASSERT_EQ(3 * chunk, table.nextTouched(3 * chunk, 10 * chunk));
+	ASSERT_EQ(10 * chunk, table.nextTouched(7 * chunk, 10 * chunk));
+
+	//allocating a marked chunk keeps the state
+	table.get(4 * chunk + 1).changed = false;
+	ASSERT_TRUE(table.peek(4 * chunk).skipRead);
+	ASSERT_TRUE(table.peek(4 * chunk).changed);
+	ASSERT_FALSE(table.peek(4 * chunk + 1).changed);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, adviseRange)
+{
+	//setup
+	const size_t chunk = UMMAP_SEGMENT_STATUS_CHUNK;
+	SegmentStatusTable table(10 * chunk);
+	table.get(2 * chunk + 5).mapped = true;
+
+	//advise from the touched chunk to the middle of another one
+	table.adviseRange(2 * chunk + 4, 6 * chunk + 10, UMMAP_ADV_SEQUENTIAL);
+
+	//only the touched chunk and the partially covered one are allocated
+	ASSERT_EQ(10 * sizeof(void*) + 2 * SegmentStatusTable::getChunkMemory(UMMAP_SEGMENT_STATUS_CHUNK), table.getMemory());
+	ASSERT_EQ(NULL, table.find(4 * chunk));
+
+	//check
+	ASSERT_EQ(UMMAP_ADV_NORMAL, table.peek(2 * chunk + 3).advice);
+	ASSERT_TRUE(table.peek(2 * chunk + 5).mapped);
+	for (size_t id : {2 * chunk + 4, 2 * chunk + 5, 4 * chunk, 6 * chunk + 9})
+		ASSERT_EQ(UMMAP_ADV_SEQUENTIAL, table.peek(id).advice) << id;
+	ASSERT_EQ(UMMAP_ADV_NORMAL, table.peek(6 * chunk + 10).advice);
+	ASSERT_EQ(UMMAP_ADV_NORMAL, table.peek(7 * chunk).advice);
+
+	//the marked chunks are not seen as touched
+	ASSERT_EQ(6 * chunk, table.nextTouched(3 * chunk, 10 * chunk));
+
+	//allocating a marked chunk keeps the hint
+	table.get(4 * chunk + 1).advice = UMMAP_ADV_RANDOM;
+	ASSERT_EQ(UMMAP_ADV_SEQUENTIAL, table.peek(4 * chunk).advice);
+	ASSERT_EQ(UMMAP_ADV_RANDOM, table.peek(4 * chunk + 1).advice);
+
+	//back to normal does not allocate the never touched chunks
+	table.adviseRange(7 * chunk + 1, 8 * chunk, UMMAP_ADV_NORMAL);
+	table.adviseRange(3 * chunk + 1, 3 * chunk + 2, UMMAP_ADV_SEQUENTIAL);
+	ASSERT_EQ(10 * sizeof(void*) + 3 * SegmentStatusTable::getChunkMemory(UMMAP_SEGMENT_STATUS_CHUNK), table.getMemory());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, small_table)
+{
+	//the only chunk is sized to the segments, rounded to 64
+	SegmentStatusTable table(100);
+	table.get(99).mapped = true;
+	table.updateIndex(99);
+	table.lock(99);
+	ASSERT_EQ(sizeof(void*) + SegmentStatusTable::getChunkMemory(128), table.getMemory());
+	ASSERT_LT(table.getMemory(), SegmentStatusTable::getChunkMemory(UMMAP_SEGMENT_STATUS_CHUNK) / 100);
+
+	//growing reallocates it and keeps the state
+	table.unlock(99);
+	table.resize(5000);
+	ASSERT_EQ(sizeof(void*) + SegmentStatusTable::getChunkMemory(5056), table.getMemory());
+	ASSERT_TRUE(table.peek(99).mapped);
+	ASSERT_EQ(99u, table.nextResident(0, 5000));
+	table.get(4999).mapped = true;
+	table.updateIndex(4999);
+	ASSERT_EQ(4999u, table.nextResident(100, 5000));
+	ASSERT_EQ(2u, table.getResidentCount());
+	ASSERT_TRUE(table.tryLock(4999));
+	table.unlock(4999);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, resize)
+{
+	//setup
+	SegmentStatusTable table(UMMAP_SEGMENT_STATUS_CHUNK + 10);
+	table.get(5).mapped = true;
+	table.updateIndex(5);
+	table.get(UMMAP_SEGMENT_STATUS_CHUNK + 2).mapped = true;
+	table.updateIndex(UMMAP_SEGMENT_STATUS_CHUNK + 2);
+	table.get(8).dirty = true;
+	table.setPinned(8, true);
+
+	//grow keep the state
+	table.resize(3 * UMMAP_SEGMENT_STATUS_CHUNK);
+	ASSERT_EQ(3 * UMMAP_SEGMENT_STATUS_CHUNK, table.getSegments());
+	ASSERT_TRUE(table.peek(5).mapped);
+	ASSERT_TRUE(table.peek(UMMAP_SEGMENT_STATUS_CHUNK + 2).mapped);
+	ASSERT_TRUE(table.isPinned(8));
+	ASSERT_EQ(2u, table.getResidentCount());
+	ASSERT_FALSE(table.peek(2 * UMMAP_SEGMENT_STATUS_CHUNK + 1).mapped);
+
+	//shrink reset the removed ones
+	table.resize(7);
+	ASSERT_EQ(1u, table.getResidentCount());
+	ASSERT_EQ(7u, table.nextResident(6, 7));
+
+	//grow again in default state
+	table.resize(10);
+	ASSERT_FALSE(table.peek(8).dirty);
+	ASSERT_FALSE(table.isPinned(8));
+	ASSERT_EQ(1u, table.getResidentCount());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestSegmentStatusTable, copyFrom)
+{
+	//setup
+	SegmentStatusTable parent(UMMAP_SEGMENT_STATUS_CHUNK);
+	SegmentStatusTable window(parent, 16, 8);
+	window.get(2).mapped = true;
+	window.get(2).dirty = true;
+	window.updateIndex(2);
+	window.setPinned(2, true);
+	window.get(7).skipRead = true;
+
+	//copy in a larger table
+	SegmentStatusTable table(32);
+	table.copyFrom(window);
+	ASSERT_TRUE(table.peek(2).dirty);
+	ASSERT_TRUE(table.isPinned(2));
+	ASSERT_TRUE(table.peek(7).skipRead);
+	ASSERT_FALSE(table.peek(20).skipRead);
+	ASSERT_EQ(2u, table.nextDirty(0, 32));
+	ASSERT_EQ(1u, table.getResidentCount());
+}
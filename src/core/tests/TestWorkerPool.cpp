@@ -0,0 +1,123 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include <atomic>
+#include "../WorkerPool.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*******************  FUNCTION  *********************/
+TEST(TestWorkerPool, constructor_destructor)
+{
+	WorkerPool pool;
+	ASSERT_EQ(0u, pool.getThreads());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestWorkerPool, run)
+{
+	//setup
+	WorkerPool pool;
+	std::atomic<int> done[8];
+	std::vector<std::function<void()>> tasks;
+	for (int i = 0 ; i < 8 ; i++) {
+		done[i] = 0;
+		tasks.push_back([&done, i]{done[i]++;});
+	}
+
+	//run
+	pool.run(tasks);
+
+	//check, the last one is run by the caller
+	for (int i = 0 ; i < 8 ; i++)
+		EXPECT_EQ(1, done[i]);
+	EXPECT_EQ(7u, pool.getThreads());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestWorkerPool, run_empty)
+{
+	WorkerPool pool;
+	std::vector<std::function<void()>> tasks;
+	pool.run(tasks);
+	ASSERT_EQ(0u, pool.getThreads());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestWorkerPool, reuse_threads)
+{
+	//setup
+	WorkerPool pool;
+	std::atomic<int> cnt(0);
+
+	//single task run by the caller
+	std::vector<std::function<void()>> tasks(1, [&cnt]{cnt++;});
+	pool.run(tasks);
+	ASSERT_EQ(1, cnt);
+	ASSERT_EQ(0u, pool.getThreads());
+
+	//grow
+	tasks.resize(4, [&cnt]{cnt++;});
+	pool.run(tasks);
+	ASSERT_EQ(5, cnt);
+	ASSERT_EQ(3u, pool.getThreads());
+
+	//threads are kept between the batches
+	for (int i = 0 ; i < 100 ; i++)
+		pool.run(tasks);
+	ASSERT_EQ(405, cnt);
+	ASSERT_EQ(3u, pool.getThreads());
+
+	//smaller batch does not shrink the pool
+	tasks.resize(2);
+	pool.run(tasks);
+	ASSERT_EQ(407, cnt);
+	ASSERT_EQ(3u, pool.getThreads());
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestWorkerPool, post)
+{
+	//setup
+	std::atomic<int> cnt(0);
+
+	//posted tasks are run by the workers, the destructor runs the remaining ones
+	{
+		WorkerPool pool;
+		for (int i = 0 ; i < 100 ; i++)
+			pool.post([&cnt]{cnt++;});
+		ASSERT_GE(pool.getThreads(), 1u);
+	}
+
+	//check
+	ASSERT_EQ(100, cnt);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestWorkerPool, run_with_busy_threads)
+{
+	//setup
+	WorkerPool pool;
+	std::atomic<bool> release(false);
+	std::atomic<bool> started(false);
+
+	//a posted task blocked until the batch is done
+	pool.post([&release, &started]{started = true; while (release.load() == false) {};});
+	while (started.load() == false) {};
+
+	//the batch gets its own thread
+	std::atomic<int> cnt(0);
+	std::vector<std::function<void()>> tasks(2, [&cnt]{cnt++;});
+	pool.run(tasks);
+	ASSERT_EQ(2, cnt);
+	ASSERT_EQ(2u, pool.getThreads());
+
+	//release
+	release.store(true);
+}
@@ -7,6 +7,7 @@
 /********************  HEADERS  *********************/
 //std
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 #include <cerrno>
 //unix
@@ -87,6 +88,61 @@ void FDDriver::sync(void * ptr, size_t offset, size_t size)
 	::fdatasync(fd);
 }
 
+/*******************  FUNCTION  *********************/
+ssize_t FDDriver::pwritev(const struct iovec * iov, int iovcnt, size_t offset)
+{
+	//checks
+	assert(iov != NULL);
+	assert(iovcnt > 0);
+
+	//apply
+	return ::pwritev(fd, iov, iovcnt, offset);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Identify the file by its device and inode so the mappings opening
+ * the same file via different descriptors are grouped together.
+**/
+std::string FDDriver::getObjectKey(void)
+{
+	//get infos
+	struct stat st;
+	int status = fstat(fd, &st);
+	assumeArg(status == 0, "Fail to fstat the file descriptor : %1").argStrErrno().end();
+
+	//build
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "file:%lu:%lu", (unsigned long)st.st_dev, (unsigned long)st.st_ino);
+	return buffer;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Clone the given range with FICLONERANGE if the target is also a file.
+**/
+bool FDDriver::cloneTo(Driver * target, size_t offset, size_t size)
+{
+	//check type
+	FDDriver * fdTarget = dynamic_cast<FDDriver*>(target);
+	if (fdTarget == NULL)
+		return false;
+
+	//clone
+	return this->cloneRange(fdTarget->getFd(), offset, size);
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Punch a hole in the file so the range does not consume storage anymore and
+ * read back as zeroes. The file size is kept.
+**/
+bool FDDriver::discard(size_t offset, size_t size)
+{
+	int status = fallocate(this->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, size);
+	return status == 0;
+}
+
 /*******************  FUNCTION  *********************/
 bool FDDriver::cloneRange(int targetFd, size_t offset, size_t size)
 {
@@ -26,6 +26,10 @@ class FDDriver : public Driver
 		virtual ssize_t pwrite(const void * buffer, size_t size, size_t offset) override;
 		virtual ssize_t pread(void * buffer, size_t size, size_t offset) override;
 		virtual void sync(void * ptr, size_t offset, size_t size) override;
+		virtual ssize_t pwritev(const struct iovec * iov, int iovcnt, size_t offset) override;
+		virtual std::string getObjectKey(void) override;
+		virtual bool cloneTo(Driver * target, size_t offset, size_t size) override;
+		virtual bool discard(size_t offset, size_t size) override;
 		void setFd(int fd);
 		int getFd(void) {return fd;};
 		bool cloneRange(int targetFd, size_t offset, size_t size);
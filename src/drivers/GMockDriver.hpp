@@ -29,6 +29,9 @@ class GMockDriver : public Driver
 		MOCK_METHOD(ssize_t, pwrite,(const void * buffer, size_t size, size_t offset), (override));
 		MOCK_METHOD(ssize_t, pread,(void * buffer, size_t size, size_t offset), (override));
 		MOCK_METHOD(void, sync,(void * ptr, size_t offset, size_t size), (override));
+		MOCK_METHOD(ssize_t, pwritev,(const struct iovec * iov, int iovcnt, size_t offset), (override));
+		MOCK_METHOD(bool, cloneTo,(Driver * target, size_t offset, size_t size), (override));
+		MOCK_METHOD(bool, discard,(size_t offset, size_t size), (override));
 };
 
 }
@@ -121,6 +121,26 @@ void MemoryDriver::sync(void * ptr, size_t offset, size_t size)
 	//assert(size + offset <= this->size);
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Reset the range to zeroes as the memory space cannot be partially freed.
+**/
+bool MemoryDriver::discard(size_t offset, size_t size)
+{
+	//check
+	assumeArg(size + offset <= this->size, "Invalid position, overpass memory limit: size=%1, offset=%2, mem=%3")
+		.arg(size)
+		.arg(offset)
+		.arg(this->size)
+		.end();
+
+	//reset
+	memset(this->buffer + offset, 0, size);
+
+	//ok
+	return true;
+}
+
 /*******************  FUNCTION  *********************/
 char * MemoryDriver::getBuffer(void)
 {
@@ -31,6 +31,7 @@ class MemoryDriver : public Driver
 		virtual ssize_t pwrite(const void * buffer, size_t size, size_t offset) override;
 		virtual ssize_t pread(void * buffer, size_t size, size_t offset) override;
 		virtual void sync(void * ptr, size_t offset, size_t size) override;
+		virtual bool discard(size_t offset, size_t size) override;
 		char * getBuffer(void);
 		size_t getSize(void) const;
 	private:
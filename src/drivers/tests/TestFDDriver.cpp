@@ -52,3 +52,28 @@ TEST(TestFDDriver, pwrite_pread)
 	for (size_t i = 0 ; i < sizeof(buffer2) ; i++)
 		ASSERT_EQ(10, buffer2[i]) << "Index : " << i;
 }
+
+/*******************  FUNCTION  *********************/
+TEST(TestFDDriver, discard)
+{
+	std::string fname = "/tmp/ummap-io-v2-test-fd-driver-discard.txt";
+	int fd = open(fname.c_str(), O_RDWR|O_CREAT, S_IRWXU);
+	OS::removeFile(fname);
+	ASSERT_GT(fd, 0);
+	FDDriver driver(fd);
+	close(fd);
+
+	//fill
+	char buffer[2*4096];
+	memset(buffer, 10, sizeof(buffer));
+	ASSERT_EQ(sizeof(buffer), driver.pwrite(buffer, sizeof(buffer), 0));
+
+	//punch the first page
+	if (driver.discard(0, 4096) == false)
+		GTEST_SKIP() << "Hole punching not supported by the filesystem";
+
+	//check
+	ASSERT_EQ(sizeof(buffer), driver.pread(buffer, sizeof(buffer), 0));
+	for (size_t i = 0 ; i < sizeof(buffer) ; i++)
+		ASSERT_EQ(i < 4096 ? 0 : 10, buffer[i]) << "Index : " << i;
+}
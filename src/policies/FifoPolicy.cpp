@@ -41,8 +41,8 @@ FifoPolicy::~FifoPolicy(void)
 /*******************  FUNCTION  *********************/
 void FifoPolicy::allocateElementStorage(Mapping * mapping, size_t segmentCount)
 {
-	ListElement * elts = new ListElement[segmentCount];
-	this->registerMapping(mapping, elts, segmentCount, sizeof(ListElement));
+	assumeArg(segmentCount <= UINT32_MAX, "Too many segments to be handled by the policy : %1").arg(segmentCount).end();
+	this->registerMapping(mapping, NULL, segmentCount, 0);
 }
 
 /*******************  FUNCTION  *********************/
@@ -58,24 +58,16 @@ void FifoPolicy::freeElementStorage(Mapping * mapping)
 		PolicyStorage storage = this->getStorageInfo(mapping);
 
 		//remove all from list
-		ListElement * elements = static_cast<ListElement*>(storage.elements);
-		for (size_t i = 0 ; i < storage.elementCount ; i++) {
-			ListElement & cur = elements[i];
-			if (cur.isInList())
-				this->currentMemory -= mapping->getSegmentSize();
-			cur.removeFromList();
-		}
+		size_t removed = this->list.removeOwner(0, storage.id, storage.elementCount);
+		this->currentMemory -= removed * mapping->getSegmentSize();
 
 		//unregister
 		this->unregisterMapping(mapping);
-
-		//free
-		delete [] elements;
 	}
 }
 
 /*******************  FUNCTION  *********************/
-void FifoPolicy::notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty)
+void FifoPolicy::notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty, bool speculative)
 {
 	//vars
 	const int maxIdsToEvict = 128;
@@ -90,53 +82,60 @@ void FifoPolicy::notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool
 		//take lock
 		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
+		//pinned segments stay out of the list
+		if (mapping->isPinned(index))
+			return;
+
 		//keep track of memory change
 		memOrig = this->getCurrentMemory();
 
 		//get storage
 		PolicyStorage storage = this->getStorageInfo(mapping);
 
-		//get element
-		ListElement * elements = static_cast<ListElement*>(storage.elements);
-		ListElement & cur = elements[index];
-
-		//check if is new touch
-		isFirstAccess = cur.isAlone();
-
-		//remove from list
-		cur.removeFromList();
+		//remove from list and check if is new touch
+		isFirstAccess = !this->list.remove(storage.id, index);
 	
-		//insert in list
-		root.insertAfter(cur);
+		//insert in list, the low priority segments are inserted on the eviction
+		//side after evicting the others not to evict themselves
+		bool lowPriority = speculative || mapping->isLowPriority(index);
+		if (lowPriority == false)
+			this->list.pushFront(0, storage.id, index);
 
 		//increment memorr
 		if (isFirstAccess)
 			this->currentMemory += mapping->getSegmentSize();
 
-		//if too large, evict one
-		while (this->currentMemory > this->dynamicMaxMemory) {
-			ListElement * toEvict = this->root.popPrev();
-			if (toEvict != NULL) {
-				//get infos related to segment
-				PolicyStorage evictInfos = getStorageInfo(toEvict);
+		//if too large, evict by batches of maxIdsToEvict
+		while (cntIdsToEvict < maxIdsToEvict && this->currentMemory + this->pinnedMemory > this->dynamicMaxMemory) {
+			uint32_t ownerId;
+			uint32_t segmentId;
+			if (this->list.popBack(0, ownerId, segmentId)) {
+				//get the related mapping
+				Mapping * evictMapping = this->getMappingFromId(ownerId);
 
-				//calc id
-				idsToEvict[cntIdsToEvict] = toEvict - (ListElement*)evictInfos.elements;
+				//keep track of the id
+				idsToEvict[cntIdsToEvict] = segmentId;
 
 				//keep track of the mapping
-				mappings[cntIdsToEvict] = evictInfos.mapping;
+				mappings[cntIdsToEvict] = evictMapping;
 
 				//inc counter
 				cntIdsToEvict++;
 
-				//this can append only if sharing policy over segments with different
-				//segment size.
-				assume(cntIdsToEvict < maxIdsToEvict, "Reach maximum pages to evict due to optimization, cannot continue !");
-
 				//update status
-				this->currentMemory -= evictInfos.mapping->getSegmentSize();
+				this->currentMemory -= evictMapping->getSegmentSize();
+			} else {
+				//only pinned segments
+				break;
 			}
 		}
+
+		//insert low priority
+		if (lowPriority)
+			this->list.pushBack(0, storage.id, index);
+
+		//publish for the asynchronous quota
+		this->publishMemory();
 	}
 
 	//really do the evict out of the critical section to keep multi-threading
@@ -144,10 +143,16 @@ void FifoPolicy::notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool
 	for (int i = 0 ; i < cntIdsToEvict; i++)
 		mappings[i]->evict(this, idsToEvict[i]);
 
+	//more than one batch to evict (eg. after pinning a large range)
+	if (cntIdsToEvict == maxIdsToEvict)
+		this->shrinkMemory();
+
 	//notif quota to redistribute if needed
 	ssize_t memDelta = this->getCurrentMemory() - memOrig;
 	if (isFirstAccess && this->policyQuota != NULL && memDelta > 0)
-		this->policyQuota->update();
+		this->policyQuota->notifyGrowth();
+	else if (cntIdsToEvict > 0 && this->policyQuota != NULL)
+		this->policyQuota->notifyEvictions(cntIdsToEvict);
 }
 
 /*******************  FUNCTION  *********************/
@@ -162,70 +167,142 @@ void FifoPolicy::notifyEvict(Mapping * mapping, size_t index)
 		//get storage infos
 		PolicyStorage storage = getStorageInfo(mapping);
 
-		//get element
-		ListElement * elements = static_cast<ListElement*>(storage.elements);
-		ListElement & cur = elements[index];
+		//pinned segments are not in the list
+		if (mapping->isPinned(index)) {
+			this->releasePinnedMemory(mapping->getSegmentSize());
+			return;
+		}
 
-		//check
-		assert(cur.isInList());
+		//remove from list
+		bool inList = this->list.remove(storage.id, index);
+		assert(inList);
 
 		//decrease memory
-		this->currentMemory -= mapping->getSegmentSize();
-		assert(this->currentMemory >= 0);
-
-		//remove from list
-		cur.removeFromList();
+		if (inList)
+			this->currentMemory -= mapping->getSegmentSize();
 	}
 }
 
 /*******************  FUNCTION  *********************/
-void FifoPolicy::shrinkMemory(void)
+bool FifoPolicy::notifyPin(Mapping * mapping, size_t index)
 {
-	//vars
-	const int maxIdsToEvict = 128;
-	size_t idsToEvict[maxIdsToEvict];
-	Mapping * mappings[maxIdsToEvict];
-	int cntIdsToEvict = 0;
+	//CRITICAL SECTION
+	{
+		//take lock
+		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
+
+		//check budget
+		if (this->reservePinnedMemory(mapping->getSegmentSize()) == false)
+			return false;
 
+		//remove from list, it might not be there if its touch is not yet notified
+		PolicyStorage storage = this->getStorageInfo(mapping);
+		if (this->list.remove(storage.id, index))
+			this->currentMemory -= mapping->getSegmentSize();
+	}
+
+	//ok
+	return true;
+}
+
+/*******************  FUNCTION  *********************/
+void FifoPolicy::notifyUnpin(Mapping * mapping, size_t index)
+{
 	//CRITICAL SECTION
 	{
 		//take lock
 		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
-		//if too large, evict one
-		while (this->currentMemory > this->dynamicMaxMemory) {
-			ListElement * toEvict = this->root.popPrev();
-			if (toEvict != NULL) {
-				//get infos related to segment
-				PolicyStorage evictInfos = getStorageInfo(toEvict);
+		//move back in list
+		PolicyStorage storage = this->getStorageInfo(mapping);
+		this->releasePinnedMemory(mapping->getSegmentSize());
+		if (mapping->getSegmentStatus(index * mapping->getSegmentSize()).mapped) {
+			this->list.pushFront(0, storage.id, index);
+			this->currentMemory += mapping->getSegmentSize();
+		}
+	}
+}
 
-				//calc id
-				idsToEvict[cntIdsToEvict] = toEvict - (ListElement*)evictInfos.elements;
+/*******************  FUNCTION  *********************/
+void FifoPolicy::notifyCharge(Mapping * mapping, size_t index)
+{
+	//CRITICAL SECTION
+	{
+		//take lock
+		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
-				//keep track of the mapping
-				mappings[cntIdsToEvict] = evictInfos.mapping;
+		//pinned segments are already charged to the pin budget
+		if (mapping->isPinned(index))
+			return;
 
-				//inc counter
-				cntIdsToEvict++;
+		//insert if not yet there
+		PolicyStorage storage = this->getStorageInfo(mapping);
+		if (this->list.getList(storage.id, index) == -1) {
+			this->list.pushFront(0, storage.id, index);
+			this->currentMemory += mapping->getSegmentSize();
+		}
 
-				//this can append only if sharing policy over segments with different
-				//segment size.
-				assume(cntIdsToEvict < maxIdsToEvict, "Reach maximum pages to evict due to optimization, cannot continue !");
+		//publish for the asynchronous quota
+		this->publishMemory();
+	}
+}
 
-				//update status
-				this->currentMemory -= evictInfos.mapping->getSegmentSize();
+/*******************  FUNCTION  *********************/
+void FifoPolicy::shrinkMemory(void)
+{
+	//vars
+	const int maxIdsToEvict = 128;
+	size_t idsToEvict[maxIdsToEvict];
+	Mapping * mappings[maxIdsToEvict];
+	int cntIdsToEvict = maxIdsToEvict;
+
+	//loop until a batch is not full
+	while (cntIdsToEvict == maxIdsToEvict) {
+		cntIdsToEvict = 0;
+
+		//CRITICAL SECTION
+		{
+			//take lock
+			std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
+
+			//if too large, evict by batches of maxIdsToEvict
+			while (cntIdsToEvict < maxIdsToEvict && this->currentMemory + this->pinnedMemory > this->dynamicMaxMemory) {
+				uint32_t ownerId;
+				uint32_t segmentId;
+				if (this->list.popBack(0, ownerId, segmentId)) {
+					//get the related mapping
+					Mapping * evictMapping = this->getMappingFromId(ownerId);
+
+					//keep track of the id
+					idsToEvict[cntIdsToEvict] = segmentId;
+
+					//keep track of the mapping
+					mappings[cntIdsToEvict] = evictMapping;
+
+					//inc counter
+					cntIdsToEvict++;
+
+					//update status
+					this->currentMemory -= evictMapping->getSegmentSize();
+				} else {
+					//only pinned segments
+					break;
+				}
 			}
+
+			//publish for the asynchronous quota
+			this->publishMemory();
 		}
-	}
 
-	//really do the evict out of the critical section to keep multi-threading
-	//to write data
-	for (int i = 0 ; i < cntIdsToEvict; i++)
-		mappings[i]->evict(this, idsToEvict[i]);
+		//really do the evict out of the critical section to keep multi-threading
+		//to write data
+		for (int i = 0 ; i < cntIdsToEvict; i++)
+			mappings[i]->evict(this, idsToEvict[i]);
+	}
 }
 
 /*******************  FUNCTION  *********************/
 size_t FifoPolicy::getCurrentMemory(void)
 {
-	return this->currentMemory;
+	return this->currentMemory + this->pinnedMemory;
 }
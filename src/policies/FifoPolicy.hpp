@@ -13,7 +13,7 @@
 #include <mutex>
 #include <list>
 //local
-#include "common/ListElement.hpp"
+#include "common/SegmentList.hpp"
 #include "core/Policy.hpp"
 
 /********************  NAMESPACE  *******************/
@@ -33,15 +33,18 @@ class FifoPolicy : public Policy
 		FifoPolicy(size_t maxMemory, bool local);
 		virtual ~FifoPolicy(void);
 		virtual void allocateElementStorage(Mapping * mapping, size_t segmentCount) override;
-		virtual void notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty) override;
+		virtual void notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty, bool speculative) override;
 		virtual void notifyEvict(Mapping * mapping, size_t index) override;
+		virtual bool notifyPin(Mapping * mapping, size_t index) override;
+		virtual void notifyUnpin(Mapping * mapping, size_t index) override;
+		virtual void notifyCharge(Mapping * mapping, size_t index) override;
 		virtual void freeElementStorage(Mapping * mapping) override;
 		virtual size_t getCurrentMemory(void) override;
 		virtual void shrinkMemory(void) override;
 	protected:
-		/** Root element of the linked list of segments to track.**/
-		ListElement root;
-		/** Keep track of the current memory usage.**/
+		/** Linked list of segments to track (only one list with ID 0).**/
+		SegmentList list;
+		/** Keep track of the current memory usage of the segments in the list (not the pinned ones).**/
 		size_t currentMemory;
 };
 
@@ -28,6 +28,7 @@ using namespace ummapio;
 **/
 FifoWindowPolicy::FifoWindowPolicy(size_t maxMemory, size_t maxSlidingMemory, bool local = false)
 	:Policy(maxMemory, local)
+	,list(2)
 {
 	this->currentFixedMemory = 0;
 	this->currentSlidingWindowMemory = 0;
@@ -44,15 +45,8 @@ FifoWindowPolicy::~FifoWindowPolicy(void)
 /*******************  FUNCTION  *********************/
 void FifoWindowPolicy::allocateElementStorage(Mapping * mapping, size_t segmentCount)
 {
-	//allocate
-	ListElement * elements = new ListElement[segmentCount];
-	bool * extraInfos = new bool[segmentCount];
-
-	//set default
-	memset(extraInfos, 0, sizeof(bool) * segmentCount);
-
-	//register
-	this->registerMapping(mapping, elements, segmentCount, sizeof(ListElement), extraInfos);
+	assumeArg(segmentCount <= UINT32_MAX, "Too many segments to be handled by the policy : %1").arg(segmentCount).end();
+	this->registerMapping(mapping, NULL, segmentCount, 0);
 }
 
 /*******************  FUNCTION  *********************/
@@ -67,33 +61,17 @@ void FifoWindowPolicy::freeElementStorage(Mapping * mapping)
 		//@TODO get & unregister
 		PolicyStorage storage = this->getStorageInfo(mapping);
 
-		//extract
-		ListElement * elements = static_cast<ListElement*>(storage.elements);
-		bool * isFixedMemory = static_cast<bool*>(storage.extraInfos);
-
-		//remove all from list
-		for (size_t i = 0 ; i < storage.elementCount ; i++) {
-			ListElement & cur = elements[i];
-			if (cur.isInList()) {
-				if (isFixedMemory[i])
-					this->currentFixedMemory -= mapping->getSegmentSize();
-				else
-					this->currentSlidingWindowMemory -= mapping->getSegmentSize();
-			}
-			cur.removeFromList();
-		}
+		//remove all from lists
+		this->currentFixedMemory -= this->list.removeOwner(FIFO_WINDOW_FIXED, storage.id, storage.elementCount) * mapping->getSegmentSize();
+		this->currentSlidingWindowMemory -= this->list.removeOwner(FIFO_WINDOW_SLIDING, storage.id, storage.elementCount) * mapping->getSegmentSize();
 
 		//unregister
 		this->unregisterMapping(mapping);
-
-		//free
-		delete [] isFixedMemory;
-		delete [] elements;
 	}
 }
 
 /*******************  FUNCTION  *********************/
-void FifoWindowPolicy::notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty)
+void FifoWindowPolicy::notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty, bool speculative)
 {
 	//vars
 	const int maxIdsToEvict = 128;
@@ -108,26 +86,26 @@ void FifoWindowPolicy::notifyTouch(Mapping * mapping, size_t index, bool isWrite
 		//take lock
 		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
+		//pinned segments stay out of the lists
+		if (mapping->isPinned(index))
+			return;
+
 		//keep track of memory change
 		memOrig = this->getCurrentMemory();
 
 		//get storage
 		PolicyStorage storage = this->getStorageInfo(mapping);
 
-		//get element
-		bool * isFixedMemory = static_cast<bool*>(storage.extraInfos);
-		ListElement * elements = static_cast<ListElement*>(storage.elements);
-		ListElement & cur = elements[index];
-
 		//check if is new touch
-		isFirstAccess = cur.isAlone();
+		int oldList = this->list.getList(storage.id, index);
+		isFirstAccess = (oldList == -1);
 
 		//remove from list
-		cur.removeFromList();
+		this->list.remove(storage.id, index);
 
 		//impact counters
 		if (!isFirstAccess) {
-			if (isFixedMemory[index]) {
+			if (oldList == FIFO_WINDOW_FIXED) {
 				this->currentFixedMemory -= mapping->getSegmentSize();
 				assert(this->currentFixedMemory >= 0);
 			} else {
@@ -136,43 +114,53 @@ void FifoWindowPolicy::notifyTouch(Mapping * mapping, size_t index, bool isWrite
 			}
 		}
 
-		//select mode
-		bool isFixed = (this->currentFixedMemory < this->maxFixedMemory);
-		isFixedMemory[index] = isFixed;
+		//select mode, low priority segments never go in the fixed window
+		bool lowPriority = speculative || mapping->isLowPriority(index);
+		bool isFixed = (this->currentFixedMemory < this->maxFixedMemory) && !lowPriority;
 	
-		//insert in list
+		//insert in list, the low priority segments are inserted on the eviction
+		//side after evicting the others not to evict themselves
 		if (isFixed) {
-			rootFixedWindow.insertAfter(cur);
+			this->list.pushFront(FIFO_WINDOW_FIXED, storage.id, index);
 			this->currentFixedMemory += mapping->getSegmentSize();
 		} else {
-			rootSlidingWindow.insertAfter(cur);
+			if (lowPriority == false)
+				this->list.pushFront(FIFO_WINDOW_SLIDING, storage.id, index);
 			this->currentSlidingWindowMemory += mapping->getSegmentSize();
 		}
 
-		//if too large, evict one
-		while (this->currentSlidingWindowMemory > this->maxSlidingMemory ) {
-			ListElement * toEvict = this->rootSlidingWindow.popPrev();
-			if (toEvict != NULL) {
-				//get infos related to segment
-				PolicyStorage evictInfos = getStorageInfo(toEvict);
+		//if too large, evict by batches of maxIdsToEvict, the pinned segments
+		//take their room from the sliding window as they cannot be evicted
+		while (cntIdsToEvict < maxIdsToEvict && (this->currentSlidingWindowMemory > this->maxSlidingMemory || this->getCurrentMemory() > this->maxFixedMemory + this->maxSlidingMemory)) {
+			uint32_t ownerId;
+			uint32_t segmentId;
+			if (this->list.popBack(FIFO_WINDOW_SLIDING, ownerId, segmentId)) {
+				//get the related mapping
+				Mapping * evictMapping = this->getMappingFromId(ownerId);
 
-				//calc id
-				idsToEvict[cntIdsToEvict] = toEvict - (ListElement*)evictInfos.elements;
+				//keep track of the id
+				idsToEvict[cntIdsToEvict] = segmentId;
 
 				//keep track of the mapping
-				mappings[cntIdsToEvict] = evictInfos.mapping;
+				mappings[cntIdsToEvict] = evictMapping;
 
 				//inc counter
 				cntIdsToEvict++;
 
-				//this can append only if sharing policy over segments with different
-				//segment size.
-				assume(cntIdsToEvict < maxIdsToEvict, "Reach maximum pages to evict due to optimization, cannot continue !");
-
 				//update status
-				this->currentSlidingWindowMemory -= evictInfos.mapping->getSegmentSize();
+				this->currentSlidingWindowMemory -= evictMapping->getSegmentSize();
+			} else {
+				//nothing left in the sliding window (low priority segment being inserted)
+				break;
 			}
 		}
+
+		//insert low priority
+		if (lowPriority && !isFixed)
+			this->list.pushBack(FIFO_WINDOW_SLIDING, storage.id, index);
+
+		//publish for the asynchronous quota
+		this->publishMemory();
 	}
 
 	//really do the evict out of the critical section to keep multi-threading
@@ -180,10 +168,16 @@ void FifoWindowPolicy::notifyTouch(Mapping * mapping, size_t index, bool isWrite
 	for (int i = 0 ; i < cntIdsToEvict; i++)
 		mappings[i]->evict(this, idsToEvict[i]);
 
+	//more than one batch to evict (eg. after pinning a large range)
+	if (cntIdsToEvict == maxIdsToEvict)
+		this->shrinkMemory();
+
 	//notif quota to redistribute if needed
 	ssize_t memDelta = this->getCurrentMemory() - memOrig;
 	if (isFirstAccess && this->policyQuota != NULL && memDelta > 0)
-		this->policyQuota->update();
+		this->policyQuota->notifyGrowth();
+	else if (cntIdsToEvict > 0 && this->policyQuota != NULL)
+		this->policyQuota->notifyEvictions(cntIdsToEvict);
 }
 
 /*******************  FUNCTION  *********************/
@@ -198,76 +192,154 @@ void FifoWindowPolicy::notifyEvict(Mapping * mapping, size_t index)
 		//get storage infos
 		PolicyStorage storage = getStorageInfo(mapping);
 
-		//get element
-		bool * isFixedMemory = static_cast<bool*>(storage.extraInfos);
-		ListElement * elements = static_cast<ListElement*>(storage.elements);
-		ListElement & cur = elements[index];
+		//pinned segments are not in the lists
+		if (mapping->isPinned(index)) {
+			this->releasePinnedMemory(mapping->getSegmentSize());
+			return;
+		}
 
-		//check
-		assert(cur.isInList());
+		//get list
+		int oldList = this->list.getList(storage.id, index);
+		assert(oldList != -1);
 
 		//impact counters
-		if (isFixedMemory[index]) {
+		if (oldList == FIFO_WINDOW_FIXED) {
 			this->currentFixedMemory -= mapping->getSegmentSize();
 			assert(this->currentFixedMemory >= 0);
-		} else {
+		} else if (oldList == FIFO_WINDOW_SLIDING) {
 			this->currentSlidingWindowMemory -= mapping->getSegmentSize();
 			assert(this->currentSlidingWindowMemory >= 0);
 		}
 
 		//remove from list
-		cur.removeFromList();
+		this->list.remove(storage.id, index);
 	}
 }
 
 /*******************  FUNCTION  *********************/
-void FifoWindowPolicy::shrinkMemory(void)
+bool FifoWindowPolicy::notifyPin(Mapping * mapping, size_t index)
 {
-	//vars
-	const int maxIdsToEvict = 128;
-	size_t idsToEvict[maxIdsToEvict];
-	Mapping * mappings[maxIdsToEvict];
-	int cntIdsToEvict = 0;
+	//CRITICAL SECTION
+	{
+		//take lock
+		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
+		//check budget
+		if (this->reservePinnedMemory(mapping->getSegmentSize()) == false)
+			return false;
+
+		//remove from its list, it might not be there if its touch is not yet notified
+		PolicyStorage storage = this->getStorageInfo(mapping);
+		int oldList = this->list.getList(storage.id, index);
+		if (oldList == FIFO_WINDOW_FIXED)
+			this->currentFixedMemory -= mapping->getSegmentSize();
+		else if (oldList == FIFO_WINDOW_SLIDING)
+			this->currentSlidingWindowMemory -= mapping->getSegmentSize();
+		this->list.remove(storage.id, index);
+	}
+
+	//ok
+	return true;
+}
+
+/*******************  FUNCTION  *********************/
+void FifoWindowPolicy::notifyUnpin(Mapping * mapping, size_t index)
+{
 	//CRITICAL SECTION
 	{
 		//take lock
 		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
-		//if too large, evict one
-		while (this->currentSlidingWindowMemory > this->maxSlidingMemory ) {
-			ListElement * toEvict = this->rootSlidingWindow.popPrev();
-			if (toEvict != NULL) {
-				//get infos related to segment
-				PolicyStorage evictInfos = getStorageInfo(toEvict);
+		//move back in the sliding window, shrinkMemory() evicts if needed
+		PolicyStorage storage = this->getStorageInfo(mapping);
+		this->releasePinnedMemory(mapping->getSegmentSize());
+		if (mapping->getSegmentStatus(index * mapping->getSegmentSize()).mapped) {
+			this->list.pushFront(FIFO_WINDOW_SLIDING, storage.id, index);
+			this->currentSlidingWindowMemory += mapping->getSegmentSize();
+		}
+	}
+}
 
-				//calc id
-				idsToEvict[cntIdsToEvict] = toEvict - (ListElement*)evictInfos.elements;
+/*******************  FUNCTION  *********************/
+void FifoWindowPolicy::notifyCharge(Mapping * mapping, size_t index)
+{
+	//CRITICAL SECTION
+	{
+		//take lock
+		std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
 
-				//keep track of the mapping
-				mappings[cntIdsToEvict] = evictInfos.mapping;
+		//pinned segments are already charged to the pin budget
+		if (mapping->isPinned(index))
+			return;
 
-				//inc counter
-				cntIdsToEvict++;
+		//insert if not yet there
+		PolicyStorage storage = this->getStorageInfo(mapping);
+		if (this->list.getList(storage.id, index) == -1) {
+			this->list.pushFront(FIFO_WINDOW_SLIDING, storage.id, index);
+			this->currentSlidingWindowMemory += mapping->getSegmentSize();
+		}
 
-				//this can append only if sharing policy over segments with different
-				//segment size.
-				assume(cntIdsToEvict < maxIdsToEvict, "Reach maximum pages to evict due to optimization, cannot continue !");
+		//publish for the asynchronous quota
+		this->publishMemory();
+	}
+}
 
-				//update status
-				this->currentSlidingWindowMemory -= evictInfos.mapping->getSegmentSize();
+/*******************  FUNCTION  *********************/
+void FifoWindowPolicy::shrinkMemory(void)
+{
+	//vars
+	const int maxIdsToEvict = 128;
+	size_t idsToEvict[maxIdsToEvict];
+	Mapping * mappings[maxIdsToEvict];
+	int cntIdsToEvict = maxIdsToEvict;
+
+	//loop until a batch is not full
+	while (cntIdsToEvict == maxIdsToEvict) {
+		cntIdsToEvict = 0;
+
+		//CRITICAL SECTION
+		{
+			//take lock
+			std::lock_guard<std::recursive_mutex> lockGuard(*this->mutexPtr);
+
+			//if too large, evict by batches of maxIdsToEvict (pinned included)
+			while (cntIdsToEvict < maxIdsToEvict && (this->currentSlidingWindowMemory > this->maxSlidingMemory || this->getCurrentMemory() > this->maxFixedMemory + this->maxSlidingMemory)) {
+				uint32_t ownerId;
+				uint32_t segmentId;
+				if (this->list.popBack(FIFO_WINDOW_SLIDING, ownerId, segmentId)) {
+					//get the related mapping
+					Mapping * evictMapping = this->getMappingFromId(ownerId);
+
+					//keep track of the id
+					idsToEvict[cntIdsToEvict] = segmentId;
+
+					//keep track of the mapping
+					mappings[cntIdsToEvict] = evictMapping;
+
+					//inc counter
+					cntIdsToEvict++;
+
+					//update status
+					this->currentSlidingWindowMemory -= evictMapping->getSegmentSize();
+				} else {
+					//nothing left in the sliding window (low priority segment being inserted)
+					break;
+				}
 			}
+
+			//publish for the asynchronous quota
+			this->publishMemory();
 		}
-	}
 
-	//really do the evict out of the critical section to keep multi-threading
-	//to write data
-	for (int i = 0 ; i < cntIdsToEvict; i++)
-		mappings[i]->evict(this, idsToEvict[i]);
+		//really do the evict out of the critical section to keep multi-threading
+		//to write data
+		for (int i = 0 ; i < cntIdsToEvict; i++)
+			mappings[i]->evict(this, idsToEvict[i]);
+	}
 }
 
 /*******************  FUNCTION  *********************/
 size_t FifoWindowPolicy::getCurrentMemory(void)
 {
-	return this->currentSlidingWindowMemory  + this->currentFixedMemory;
+	return this->currentSlidingWindowMemory  + this->currentFixedMemory + this->pinnedMemory;
 }
@@ -13,7 +13,7 @@
 #include <mutex>
 #include <list>
 //local
-#include "common/ListElement.hpp"
+#include "common/SegmentList.hpp"
 #include "core/Policy.hpp"
 
 /********************  NAMESPACE  *******************/
@@ -23,6 +23,18 @@ namespace ummapio
 /*********************  CLASS  **********************/
 class Mapping;
 
+/*********************  ENUM  ***********************/
+/**
+ * IDs of the lists used in the segment list of the FIFO window policy.
+**/
+enum FifoWindowList
+{
+	/** Fixed window list. **/
+	FIFO_WINDOW_FIXED = 0,
+	/** Sliding window list. **/
+	FIFO_WINDOW_SLIDING = 1,
+};
+
 /*********************  CLASS  **********************/
 /**
  * Implement a FIFO policy with a sliding window. We first fill the fixed window and when it
@@ -34,16 +46,20 @@ class FifoWindowPolicy : public Policy
 		FifoWindowPolicy(size_t maxMemory, size_t maxSlidingMemory, bool local);
 		virtual ~FifoWindowPolicy(void);
 		virtual void allocateElementStorage(Mapping * mapping, size_t segmentCount) override;
-		virtual void notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty) override;
+		virtual void notifyTouch(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty, bool speculative) override;
 		virtual void notifyEvict(Mapping * mapping, size_t index) override;
+		virtual bool notifyPin(Mapping * mapping, size_t index) override;
+		virtual void notifyUnpin(Mapping * mapping, size_t index) override;
+		virtual void notifyCharge(Mapping * mapping, size_t index) override;
 		virtual void freeElementStorage(Mapping * mapping) override;
 		virtual size_t getCurrentMemory(void) override;
 		virtual void shrinkMemory(void) override;
 	protected:
-		/** Root element of the fixed window **/
-		ListElement rootFixedWindow;
-		/** Root element of the sliding window when the fixed one if full. **/
-		ListElement rootSlidingWindow;
+		/**
+		 * Lists of segments, the fixed window (FIFO_WINDOW_FIXED) and the sliding
+		 * window used when the fixed one if full (FIFO_WINDOW_SLIDING).
+		**/
+		SegmentList list;
 		/** 
 		 * Keep track of the memory used by the fixed window. When full we 
 		 * register to the sliding window.
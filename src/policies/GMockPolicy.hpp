@@ -27,9 +27,13 @@ class GMockPolicy : public Policy
 		GMockPolicy(void): Policy(64*4096, true) {};
 		virtual ~GMockPolicy(void) {};
 		MOCK_METHOD(void, allocateElementStorage,(Mapping * mapping, size_t segmentCount), (override));
-		MOCK_METHOD(void, notifyTouch,(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty), (override));
+		MOCK_METHOD(void, notifyTouch,(Mapping * mapping, size_t index, bool isWrite, bool mapped, bool dirty, bool speculative), (override));
 		MOCK_METHOD(void, notifyEvict,(Mapping * mapping, size_t index), (override));
+		MOCK_METHOD(bool, notifyPin,(Mapping * mapping, size_t index), (override));
+		MOCK_METHOD(void, notifyUnpin,(Mapping * mapping, size_t index), (override));
+		MOCK_METHOD(void, notifyCharge,(Mapping * mapping, size_t index), (override));
 		MOCK_METHOD(void, freeElementStorage,(Mapping * mapping), (override));
+		MOCK_METHOD(void, resizeElementStorage,(Mapping * mapping, size_t segmentCount), (override));
 		MOCK_METHOD(size_t, getCurrentMemory,(), (override));
 		MOCK_METHOD(void, shrinkMemory,(), (override));
 };
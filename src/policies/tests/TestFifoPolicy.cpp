@@ -86,7 +86,7 @@ TEST(TestFifoPolicy, evict_notify_other)
 	char * ptr = (char*)mapping.getAddress();
 
 	//touch no effect
-	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, _, true, false, false)).Times(3);
+	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, _, true, false, false, false)).Times(3);
 	mapping.onSegmentationFault(ptr+0*UMMAP_PAGE_SIZE, true);
 	mapping.onSegmentationFault(ptr+1*UMMAP_PAGE_SIZE, true);
 
@@ -122,3 +122,82 @@ TEST(TestFifoPolicy, freeElementStorage)
 	//check
 	ASSERT_EQ(0, policy.getCurrentMemory());
 }
+
+/*******************  FUNCTION  *********************/
+TEST(TestFifoPolicy, evict_low_priority_first)
+{
+	//set
+	FifoPolicy * policy = new FifoPolicy(2*UMMAP_PAGE_SIZE, true);
+	DummyDriver driver;
+	GMockMapping mapping(NULL, 8*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, policy, NULL);
+	char * ptr = (char*)mapping.getAddress();
+
+	//advise
+	mapping.advise(1*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, UMMAP_ADV_NOREUSE);
+
+	//touch no effect
+	mapping.onSegmentationFault(ptr+0*UMMAP_PAGE_SIZE, true);
+	mapping.onSegmentationFault(ptr+1*UMMAP_PAGE_SIZE, true);
+
+	//touch evict 1 before 0
+	EXPECT_CALL(mapping, evict(policy, 1));
+	mapping.onSegmentationFault(ptr+2*UMMAP_PAGE_SIZE, true);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestFifoPolicy, pin)
+{
+	//set
+	FifoPolicy * policy = new FifoPolicy(4*UMMAP_PAGE_SIZE, true);
+	DummyDriver driver;
+	GMockMapping mapping(NULL, 8*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, policy, NULL);
+	char * ptr = (char*)mapping.getAddress();
+
+	//pin within the budget (half of the memory by default)
+	ASSERT_TRUE(mapping.pin(0, 2*UMMAP_PAGE_SIZE));
+	ASSERT_FALSE(mapping.pin(2*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE));
+	ASSERT_TRUE(mapping.isPinned(0));
+	ASSERT_FALSE(mapping.isPinned(2));
+	ASSERT_EQ(2*UMMAP_PAGE_SIZE, policy->getPinnedMemory());
+	ASSERT_EQ(3*UMMAP_PAGE_SIZE, policy->getCurrentMemory());
+
+	//touching a pinned segment has no effect
+	mapping.onSegmentationFault(ptr+0*UMMAP_PAGE_SIZE, true);
+	ASSERT_EQ(3*UMMAP_PAGE_SIZE, policy->getCurrentMemory());
+
+	//pinned segments are charged but never evicted
+	mapping.onSegmentationFault(ptr+3*UMMAP_PAGE_SIZE, true);
+	EXPECT_CALL(mapping, evict(policy, 2));
+	mapping.onSegmentationFault(ptr+4*UMMAP_PAGE_SIZE, true);
+
+	//unpin go back in the list as a new one
+	mapping.unpin(0, UMMAP_PAGE_SIZE);
+	ASSERT_FALSE(mapping.isPinned(0));
+	ASSERT_EQ(UMMAP_PAGE_SIZE, policy->getPinnedMemory());
+	EXPECT_CALL(mapping, evict(policy, 3));
+	mapping.onSegmentationFault(ptr+5*UMMAP_PAGE_SIZE, true);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestFifoPolicy, charge)
+{
+	//set
+	FifoPolicy * policy = new FifoPolicy(2*UMMAP_PAGE_SIZE, true);
+	DummyDriver driver;
+	GMockMapping mapping(NULL, 8*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, policy, NULL);
+	char * ptr = (char*)mapping.getAddress();
+
+	//charged once without evicting
+	mapping.onSegmentationFault(ptr+0*UMMAP_PAGE_SIZE, false);
+	policy->notifyCharge(&mapping, 0);
+	ASSERT_EQ(UMMAP_PAGE_SIZE, policy->getCurrentMemory());
+	mapping.onSegmentationFault(ptr+1*UMMAP_PAGE_SIZE, false);
+	policy->notifyCharge(&mapping, 2);
+	ASSERT_EQ(3*UMMAP_PAGE_SIZE, policy->getCurrentMemory());
+
+	//evicted on the next touch
+	EXPECT_CALL(mapping, evict(policy, 0));
+	EXPECT_CALL(mapping, evict(policy, 1));
+	mapping.onSegmentationFault(ptr+3*UMMAP_PAGE_SIZE, false);
+	ASSERT_EQ(2*UMMAP_PAGE_SIZE, policy->getCurrentMemory());
+}
@@ -101,7 +101,7 @@ TEST(TestFifoWindowPolicy, evict_notify_other)
 	char * ptr = (char*)mapping.getAddress();
 
 	//touch no effect
-	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, _, true, false, false)).Times(3);
+	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, _, true, false, false, false)).Times(3);
 	mapping.onSegmentationFault(ptr+0*UMMAP_PAGE_SIZE, true);
 	mapping.onSegmentationFault(ptr+1*UMMAP_PAGE_SIZE, true);
 
@@ -141,3 +141,60 @@ TEST(TestFifoPolicy, freeElementStorage)
 	EXPECT_EQ(0, policy.getCurrentFixedMemory());
 	EXPECT_EQ(0, policy.getCurrentSlidingWindowMemory());
 }
+
+/*******************  FUNCTION  *********************/
+TEST(TestFifoWindowPolicy, low_priority_empty_window)
+{
+	//set
+	MockFifoWindowPolicy policy(2*UMMAP_PAGE_SIZE, 0, true);
+	DummyDriver driver;
+	GMockMapping mapping(NULL, 8*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, NULL, NULL);
+	policy.allocateElementStorage(&mapping, 8);
+
+	//speculative touch must not spin on the empty sliding window
+	policy.notifyTouch(&mapping, 0, false, false, false, true);
+	EXPECT_EQ(UMMAP_PAGE_SIZE, policy.getCurrentSlidingWindowMemory());
+
+	//evicted on next one
+	EXPECT_CALL(mapping, evict(&policy, 0));
+	policy.notifyTouch(&mapping, 1, false, false, false, true);
+	EXPECT_EQ(UMMAP_PAGE_SIZE, policy.getCurrentSlidingWindowMemory());
+
+	//or when shrinking
+	EXPECT_CALL(mapping, evict(&policy, 1));
+	policy.shrinkMemory();
+	EXPECT_EQ(0u, policy.getCurrentSlidingWindowMemory());
+
+	//free
+	policy.freeElementStorage(&mapping);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestFifoWindowPolicy, pin)
+{
+	//set
+	FifoWindowPolicy * policy = new FifoWindowPolicy(8*UMMAP_PAGE_SIZE, 4*UMMAP_PAGE_SIZE, true);
+	DummyDriver driver;
+	GMockMapping mapping(NULL, 16*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE, 0, PROT_READ|PROT_WRITE, UMMAP_DEFAULT, &driver, policy, NULL);
+	char * ptr = (char*)mapping.getAddress();
+
+	//fill the fixed window and half of the sliding one
+	for (int i = 0 ; i < 6 ; i++)
+		mapping.onSegmentationFault(ptr+i*UMMAP_PAGE_SIZE, true);
+	ASSERT_EQ(6*UMMAP_PAGE_SIZE, policy->getCurrentMemory());
+
+	//pinned segments leave the lists but are still charged
+	ASSERT_TRUE(mapping.pin(6*UMMAP_PAGE_SIZE, 2*UMMAP_PAGE_SIZE));
+	ASSERT_EQ(2*UMMAP_PAGE_SIZE, policy->getPinnedMemory());
+	ASSERT_EQ(8*UMMAP_PAGE_SIZE, policy->getCurrentMemory());
+
+	//the sliding window is not full but the pinned ones take its room
+	EXPECT_CALL(mapping, evict(policy, 4));
+	mapping.onSegmentationFault(ptr+8*UMMAP_PAGE_SIZE, true);
+	ASSERT_EQ(8*UMMAP_PAGE_SIZE, policy->getCurrentMemory());
+
+	//same
+	EXPECT_CALL(mapping, evict(policy, 5));
+	mapping.onSegmentationFault(ptr+9*UMMAP_PAGE_SIZE, true);
+	ASSERT_EQ(8*UMMAP_PAGE_SIZE, policy->getCurrentMemory());
+}
@@ -86,7 +86,7 @@ TEST(TestLifoPolicy, evict_notify_other)
 	char * ptr = (char*)mapping.getAddress();
 
 	//touch no effect
-	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, _, true, false, false)).Times(3);
+	EXPECT_CALL(globalPolicy, notifyTouch(&mapping, _, true, false, false, false)).Times(3);
 	mapping.onSegmentationFault(ptr+0*UMMAP_PAGE_SIZE, true);
 	mapping.onSegmentationFault(ptr+1*UMMAP_PAGE_SIZE, true);
 
@@ -0,0 +1,83 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_RW_LOCK_HPP
+#define UMMAP_RW_LOCK_HPP
+
+/********************  HEADERS  *********************/
+#include <pthread.h>
+
+/*******************  NAMESPACE  ********************/
+namespace ummapio
+{
+
+/*********************  CLASS  **********************/
+/**
+ * Read/write lock based on pthread (std::shared_mutex requires C++17).
+ * When available, the writers are preferred so a range operation is not
+ * starved by a continuous flow of segment accesses.
+**/
+class RWLock
+{
+	public:
+		RWLock(void);
+		~RWLock(void);
+		void lock(void);
+		void unlock(void);
+		void lockShared(void);
+		void unlockShared(void);
+	private:
+		RWLock(const RWLock & orig);
+		RWLock & operator=(const RWLock & orig);
+	private:
+		pthread_rwlock_t rwlock;
+};
+
+/*******************  FUNCTION  *********************/
+inline RWLock::RWLock(void)
+{
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init(&attr);
+	#ifdef __GLIBC__
+		pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	#endif
+	pthread_rwlock_init(&rwlock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+}
+
+/*******************  FUNCTION  *********************/
+inline RWLock::~RWLock(void)
+{
+	pthread_rwlock_destroy(&rwlock);
+}
+
+/*******************  FUNCTION  *********************/
+inline void RWLock::lock(void)
+{
+	pthread_rwlock_wrlock(&rwlock);
+}
+
+/*******************  FUNCTION  *********************/
+inline void RWLock::unlock(void)
+{
+	pthread_rwlock_unlock(&rwlock);
+}
+
+/*******************  FUNCTION  *********************/
+inline void RWLock::lockShared(void)
+{
+	pthread_rwlock_rdlock(&rwlock);
+}
+
+/*******************  FUNCTION  *********************/
+inline void RWLock::unlockShared(void)
+{
+	pthread_rwlock_unlock(&rwlock);
+}
+
+}
+
+#endif //UMMAP_RW_LOCK_HPP
@@ -13,6 +13,12 @@
 //unix
 #include <sys/mman.h>
 #include <unistd.h>
+#include <sched.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 //internal
 #include "../common/Debug.hpp"
 //local
@@ -161,12 +167,112 @@ int UnixOS::cpuNumber(void)
 	return gblCpu;
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Sleep until the given word is woken up by futexWake() if it still contains
+ * the given value. It can return spuriously so the caller must check again
+ * its condition. Without futex support it only yields the CPU.
+ * @param addr Address of the word to wait on.
+ * @param value Expected value of the word.
+**/
+void UnixOS::futexWait(volatile uint32_t * addr, uint32_t value)
+{
+	#ifdef __linux__
+		syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+	#else
+		sched_yield();
+	#endif
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Wake up all the threads waiting on the given word with futexWait().
+ * @param addr Address of the word.
+**/
+void UnixOS::futexWake(volatile uint32_t * addr)
+{
+	#ifdef __linux__
+		syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+	#endif
+}
+
 /*******************  FUNCTION  *********************/
 void UnixOS::madviseDontNeed(void * ptr, size_t size)
 {
 	madvise(ptr, size, MADV_DONTNEED);
 }
 
+/*******************  FUNCTION  *********************/
+/**
+ * Create an anonymous memory file which can be mapped several times to share
+ * its pages.
+ * @param name Name of the file for debugging purpose.
+ * @return The file descriptor or -1 if not supported.
+**/
+int UnixOS::memfdCreate(const std::string & name)
+{
+	#if defined(__linux__) && defined(SYS_memfd_create)
+		return syscall(SYS_memfd_create, name.c_str(), 0);
+	#else
+		return -1;
+	#endif
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Map a range of a file in shared mode.
+ * @param addr Address where to map the range, replacing the existing mapping, or
+ * NULL to let the OS choose.
+ * @param size Size of the range.
+ * @param fd File descriptor of the file.
+ * @param offset Offset of the range in the file (aligned on page size).
+**/
+void * UnixOS::mmapFd(void * addr, size_t size, int fd, size_t offset, bool read, bool write, bool exec)
+{
+	//check
+	assert(size % UMMAP_PAGE_SIZE == 0);
+	assert(offset % UMMAP_PAGE_SIZE == 0);
+	assert(size > 0);
+
+	//prot
+	int prot = 0;
+	if (read)
+		prot |= PROT_READ;
+	if (write)
+		prot |= PROT_WRITE;
+	if (exec)
+		prot |= PROT_EXEC;
+
+	//flags
+	int flags = MAP_SHARED;
+	if (addr != NULL)
+		flags |= MAP_FIXED;
+
+	//call
+	void * ptr = ::mmap(addr, size, prot, flags, fd, offset);
+
+	//post check
+	assumeArg(ptr != MAP_FAILED, "Fail to call mmap on fd=%1 with size=%2 : %3").arg(fd).arg(size).argStrErrno().end();
+
+	//ok
+	return ptr;
+}
+
+/*******************  FUNCTION  *********************/
+/**
+ * Release the pages of the given range of a file, it reads back as zeroes.
+ * @param fd File descriptor of the file.
+ * @param offset Offset of the range.
+ * @param size Size of the range.
+**/
+void UnixOS::punchHole(int fd, size_t offset, size_t size)
+{
+	#ifdef __linux__
+		int status = fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, size);
+		assumeArg(status == 0, "Fail to punch hole in fd=%1 : %2").arg(fd).argStrErrno().end();
+	#endif
+}
+
 /*******************  FUNCTION  *********************/
 void UnixOS::removeFile(const std::string & path)
 {
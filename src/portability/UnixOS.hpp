@@ -9,6 +9,7 @@
 
 /********************  HEADERS  *********************/
 #include <string>
+#include <cstdint>
 
 /********************  NAMESPACE  *******************/
 namespace ummapio
@@ -25,7 +26,12 @@ struct UnixOS
 	static void mremapForced(void * oldPtr, size_t size, void * newPtr);
 	static void mprotect(void * ptr, size_t size, bool read, bool write, bool exec);
 	static void madviseDontNeed(void * ptr, size_t size);
+	static int memfdCreate(const std::string & name);
+	static void * mmapFd(void * addr, size_t size, int fd, size_t offset, bool read, bool write, bool exec);
+	static void punchHole(int fd, size_t offset, size_t size);
 	static int cpuNumber(void);
+	static void futexWait(volatile uint32_t * addr, uint32_t value);
+	static void futexWake(volatile uint32_t * addr);
 	static void removeFile(const std::string & path);
 };
 
@@ -6,6 +6,8 @@
 
 /*******************  FUNCTION  *********************/
 #include <gtest/gtest.h>
+#include <thread>
+#include <unistd.h>
 #include "../OS.hpp"
 
 /***************** USING NAMESPACE ******************/
@@ -98,3 +100,47 @@ TEST(TestOS, cpuNumber)
 	int status = OS::cpuNumber();
 	ASSERT_GT(status, 0);
 }
+
+/*******************  FUNCTION  *********************/
+TEST(TestOS, futex)
+{
+	//value differs so it does not wait
+	volatile uint32_t word = 1;
+	OS::futexWait(&word, 0);
+
+	//wait and wake
+	std::thread waiter([&word](){
+		while (__atomic_load_n(&word, __ATOMIC_ACQUIRE) == 1)
+			OS::futexWait(&word, 1);
+	});
+	__atomic_store_n(&word, 2, __ATOMIC_RELEASE);
+	OS::futexWake(&word);
+	waiter.join();
+	ASSERT_EQ(2u, word);
+}
+
+/*******************  FUNCTION  *********************/
+TEST(TestOS, memfd)
+{
+	//create
+	int fd = OS::memfdCreate("test");
+	ASSERT_GE(fd, 0);
+	ASSERT_EQ(0, ftruncate(fd, 4*UMMAP_PAGE_SIZE));
+
+	//map twice
+	char * ptr1 = (char*)OS::mmapFd(NULL, 2*UMMAP_PAGE_SIZE, fd, UMMAP_PAGE_SIZE, true, true, false);
+	char * ptr2 = (char*)OS::mmapFd(NULL, UMMAP_PAGE_SIZE, fd, 2*UMMAP_PAGE_SIZE, true, false, false);
+
+	//share the pages
+	ptr1[UMMAP_PAGE_SIZE] = 'a';
+	ASSERT_EQ('a', ptr2[0]);
+
+	//drop
+	OS::punchHole(fd, 2*UMMAP_PAGE_SIZE, UMMAP_PAGE_SIZE);
+	ASSERT_EQ(0, ptr2[0]);
+
+	//clean
+	OS::munmap(ptr1, 2*UMMAP_PAGE_SIZE);
+	OS::munmap(ptr2, UMMAP_PAGE_SIZE);
+	close(fd);
+}
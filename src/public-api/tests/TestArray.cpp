@@ -0,0 +1,191 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include <numeric>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "../ummap.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*********************  CLASS  **********************/
+class TestArray : public testing::Test
+{
+	public:
+		virtual void SetUp(void);
+		virtual void TearDown(void);
+};
+
+/*******************  FUNCTION  *********************/
+void TestArray::SetUp(void)
+{
+	ummap_init();
+}
+
+/*******************  FUNCTION  *********************/
+void TestArray::TearDown(void)
+{
+	ummap_finalize();
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestArray, constructor_destructor)
+{
+	array<int> values(1000, ummap_driver_create_dummy(0));
+	ASSERT_EQ(1000u, values.size());
+	ASSERT_EQ(4000u, values.size_bytes());
+	ASSERT_FALSE(values.empty());
+	ASSERT_NE((int*)NULL, values.data());
+	ASSERT_EQ(4096u, (array<int>::segment_size()));
+	ASSERT_EQ(8192u, (array<int, 8192>::segment_size()));
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestArray, access)
+{
+	//setup
+	array<int> values(10000, ummap_driver_create_dummy(0));
+
+	//fill
+	for (size_t i = 0 ; i < values.size() ; i++)
+		values[i] = i;
+
+	//check
+	ASSERT_EQ(5, values.at(5));
+	ASSERT_THROW(values.at(10000), std::out_of_range);
+	ASSERT_THROW(values.range(9000, 1001), std::out_of_range);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestArray, iterators)
+{
+	//setup
+	array<int> values(10000, ummap_driver_create_dummy(0));
+	values.set_read_ahead(4);
+
+	//fill
+	std::iota(values.begin(), values.end(), 0);
+
+	//check
+	const array<int> & cvalues = values;
+	ASSERT_EQ(10000 * 9999 / 2, std::accumulate(cvalues.begin(), cvalues.end(), 0));
+	ASSERT_EQ(10000, values.end() - values.begin());
+	ASSERT_EQ(20, *(values.begin() + 20));
+	array<int>::const_iterator it = values.begin();
+	ASSERT_EQ(0, *it);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestArray, iterators_read_ahead)
+{
+	//setup
+	array<int> values(10000, ummap_driver_create_dummy(0));
+	values.set_read_ahead(4);
+
+	//copies and jumps do not load anything
+	array<int>::const_iterator it = values.cbegin();
+	array<int>::const_iterator it2 = it + 2000;
+	it += 10;
+	ASSERT_EQ(0u, values.stats().resident_bytes);
+
+	//moving forward loads the next window in background
+	++it;
+	for (int i = 0 ; i < 5000 && values.stats().resident_bytes < 4 * 4096 ; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	ASSERT_GE(values.stats().resident_bytes, 4 * 4096u);
+	ASSERT_EQ(0u, values.stats().read_faults);
+	ASSERT_EQ(2000, it2 - values.cbegin());
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestArray, ranges)
+{
+	//setup
+	array<char> values(16*4096, ummap_driver_create_memory(16*4096));
+
+	//prefetch
+	span<char> range = values.range(4*4096, 4*4096);
+	ASSERT_EQ(4*4096u, range.size());
+	values.prefetch(range);
+	ummap_stats_t stats = values.stats();
+	EXPECT_EQ(4*4096u, stats.resident_bytes);
+
+	//write & flush
+	std::fill(range.begin(), range.end(), 'a');
+	values.flush(range);
+	stats = values.stats();
+	EXPECT_EQ(4*4096u, stats.written_bytes);
+	EXPECT_EQ(0u, stats.dirty_bytes);
+
+	//evict
+	values.advise(range, UMMAP_ADV_DONTNEED);
+	stats = values.stats();
+	EXPECT_EQ(0u, stats.resident_bytes);
+	ASSERT_EQ('a', values[4*4096]);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestArray, move_resize)
+{
+	//setup
+	array<int> values(1000, ummap_driver_create_memory(16*4096));
+	std::iota(values.begin(), values.end(), 0);
+
+	//move
+	array<int> moved(std::move(values));
+	ASSERT_TRUE(values.empty());
+	ASSERT_EQ(1000u, moved.size());
+	ASSERT_EQ(999, moved[999]);
+
+	//resize
+	moved.resize(4000);
+	ASSERT_EQ(4000u, moved.size());
+	ASSERT_EQ(999, moved[999]);
+	moved[3999] = 10;
+
+	//assign
+	values = std::move(moved);
+	ASSERT_EQ(10, values[3999]);
+
+	//close
+	values.close();
+	ASSERT_TRUE(values.empty());
+}
+
+/*******************  FUNCTION  *********************/
+static void loadAsyncCallback(void * addr, size_t size, void * userData)
+{
+	std::atomic<size_t> * loaded = (std::atomic<size_t>*)userData;
+	*loaded = size;
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestArray, load_async)
+{
+	//setup
+	array<int> values(10000, ummap_driver_create_dummy(0));
+
+	//load
+	std::atomic<size_t> loaded(0);
+	values.load_async(1024, 2048, loadAsyncCallback, &loaded);
+	while (loaded == 0)
+		std::this_thread::yield();
+
+	//check
+	ASSERT_EQ(2*4096u, loaded.load());
+	ASSERT_EQ(2*4096u, values.stats().resident_bytes);
+	ASSERT_EQ(0, values[1024]);
+	ASSERT_EQ(0u, values.stats().read_faults);
+
+	//empty range is completed immediately
+	loaded = 1;
+	values.load_async(0, 0, loadAsyncCallback, &loaded);
+	ASSERT_EQ(0u, loaded.load());
+}
@@ -0,0 +1,94 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+/********************  HEADERS  *********************/
+#include <gtest/gtest.h>
+#include <numeric>
+#include <atomic>
+#include <thread>
+#include "../ummap.hpp"
+
+/***************** USING NAMESPACE ******************/
+using namespace ummapio;
+
+/*********************  STRUCT  *********************/
+/**
+ * Minimal coroutine type running until its end without being awaited.
+**/
+struct DetachedTask
+{
+	struct promise_type
+	{
+		DetachedTask get_return_object(void) {return DetachedTask();};
+		std::suspend_never initial_suspend(void) noexcept {return std::suspend_never();};
+		std::suspend_never final_suspend(void) noexcept {return std::suspend_never();};
+		void return_void(void) {};
+		void unhandled_exception(void) {std::terminate();};
+	};
+};
+
+/*********************  CLASS  **********************/
+class TestArrayCoroutine : public testing::Test
+{
+	public:
+		virtual void SetUp(void);
+		virtual void TearDown(void);
+};
+
+/*******************  FUNCTION  *********************/
+void TestArrayCoroutine::SetUp(void)
+{
+	ummap_init();
+}
+
+/*******************  FUNCTION  *********************/
+void TestArrayCoroutine::TearDown(void)
+{
+	ummap_finalize();
+}
+
+/*******************  FUNCTION  *********************/
+static DetachedTask sumRange(const array<int> & values, size_t first, size_t count, std::atomic<long> & sum, std::atomic<bool> & done)
+{
+	co_await values.load_async(first, count);
+	span<const int> range = values.range(first, count);
+	sum = std::accumulate(range.begin(), range.end(), 0L);
+	done = true;
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestArrayCoroutine, load_async)
+{
+	//setup
+	array<int> values(10000, ummap_driver_create_memory(10000 * sizeof(int)));
+	//no background read ahead landing after the flush
+	values.set_read_ahead(0);
+	std::iota(values.begin(), values.end(), 0);
+	values.flush(true);
+	ASSERT_EQ(0u, values.stats().resident_bytes);
+
+	//run
+	std::atomic<long> sum(0);
+	std::atomic<bool> done(false);
+	sumRange(values, 1024, 2048, sum, done);
+	while (done == false)
+		std::this_thread::yield();
+
+	//check
+	ASSERT_EQ(2048L * (1024 + 3071) / 2, sum.load());
+	ASSERT_EQ(2*4096u, values.stats().resident_bytes);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestArrayCoroutine, load_async_empty)
+{
+	array<int> values(100, ummap_driver_create_dummy(0));
+	std::atomic<long> sum(-1);
+	std::atomic<bool> done(false);
+	sumRange(values, 10, 0, sum, done);
+	ASSERT_TRUE(done.load());
+	ASSERT_EQ(0, sum.load());
+}
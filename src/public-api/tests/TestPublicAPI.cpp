@@ -7,6 +7,8 @@
 /********************  HEADERS  *********************/
 #include <gtest/gtest.h>
 #include <sys/mman.h>
+#include <mutex>
+#include <condition_variable>
 #include "../ummap.h"
 #include "../../policies/FifoPolicy.hpp"
 #include "../../policies/LifoPolicy.hpp"
@@ -74,6 +76,32 @@ TEST_F(TestPublicAPI, map_unmap_multi)
 	umunmap(ptr2, 0);
 }
 
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, map_unmap_batch)
+{
+	//build
+	ummap_batch_entry_t entries[4];
+	for (int i = 0 ; i < 4 ; i++) {
+		entries[i].size = 8*4096;
+		entries[i].storage_offset = 0;
+		entries[i].driver = ummap_driver_create_dummy(16);
+		entries[i].local_policy = NULL;
+	}
+
+	//map
+	ASSERT_EQ(0, ummap_batch(entries, 4, 4096, PROT_READ|PROT_WRITE, UMMAP_LIGHTWEIGHT, NULL));
+
+	//touch
+	for (int i = 0 ; i < 4 ; i++) {
+		ASSERT_EQ(16, ((char*)entries[i].addr)[0]);
+		memset(entries[i].addr, 10, 8*4096);
+	}
+
+	//unmap
+	for (int i = 0 ; i < 4 ; i++)
+		umunmap(entries[i].addr, 0);
+}
+
 /*******************  FUNCTION  *********************/
 TEST_F(TestPublicAPI, map_driver_fopen)
 {
@@ -218,6 +246,687 @@ TEST_F(TestPublicAPI, map_driver_fd_flush)
 	unlink(fname);
 }
 
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, map_driver_fd_flush_parallel)
+{
+	//def
+	const char * fname = "/tmp/test-ummap-fopen-driver-parallel.txt";
+	const size_t size = 256*4096;
+
+	//open
+	FILE * fp = fopen(fname, "w+");
+	ASSERT_NE(nullptr, fp);
+	int fd = fileno(fp);
+	ASSERT_EQ(0, truncate(fname, size));
+
+	//map
+	ummap_set_flush_threads(4);
+	char * ptr1 = (char*)ummap(NULL, size, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_fd(fd), NULL, "none");
+	fclose(fp);
+
+	//we just write, no read pre-existing content
+	ummap_skip_first_read(ptr1);
+
+	//setup
+	for (size_t i = 0 ; i < size ; i++)
+		ptr1[i] = i % 256;
+
+	//unmap with sync
+	umunmap(ptr1, true);
+
+	//check
+	fp = fopen(fname, "r");
+	ASSERT_NE(nullptr, fp);
+	char * buffer = new char[size];
+	ssize_t res = fread(buffer, 1, size, fp);
+	ASSERT_EQ(size, res);
+	for (size_t i = 0 ; i < size ; i++)
+		ASSERT_EQ((char)(i % 256), buffer[i]) << "Index: " << i;
+	delete [] buffer;
+	fclose(fp);
+	
+	//clear
+	unlink(fname);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, map_driver_fd_flush_async)
+{
+	//def
+	const char * fname = "/tmp/test-ummap-fopen-driver-async.txt";
+
+	//open
+	FILE * fp = fopen(fname, "w+");
+	ASSERT_NE(nullptr, fp);
+	int fd = fileno(fp);
+	ASSERT_EQ(0, truncate(fname, 8*4096));
+
+	//map
+	void * ptr1 = ummap(NULL, 8*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_fd(fd), NULL, "none");
+	fclose(fp);
+
+	//we just write, no read pre-existing content
+	ummap_skip_first_read(ptr1);
+
+	//setup
+	memset(ptr1, 'a', 8*4096);
+
+	//flush and continue to write on the first segment
+	ummap_request_t * request = ummap_flush_async(ptr1, 0, UMMAP_FLUSH_ASYNC_SYNC);
+	memset(ptr1, 'b', 4096);
+	ummap_wait(request);
+
+	//unmap without sync
+	umunmap(ptr1, false);
+
+	//check
+	fp = fopen(fname, "r");
+	ASSERT_NE(nullptr, fp);
+	char buffer[8*4096];
+	ssize_t res = fread(buffer, 1, 8*4096, fp);
+	ASSERT_EQ(8*4096, res);
+	for (int i = 0 ; i < 8*4096 ; i++)
+		ASSERT_EQ('a', buffer[i]) << "Index: " << i;
+	fclose(fp);
+	
+	//clear
+	unlink(fname);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, sync_group)
+{
+	//def
+	const char * fname = "/tmp/test-ummap-sync-group.txt";
+
+	//open
+	FILE * fp = fopen(fname, "w+");
+	ASSERT_NE(nullptr, fp);
+	int fd = fileno(fp);
+	ASSERT_EQ(0, truncate(fname, 8*4096));
+
+	//policy
+	ummap_policy_group_register("group", ummap_policy_create_fifo(16*4096, false));
+
+	//map two windows on the file
+	char * ptr1 = (char*)ummap(NULL, 4*4096, 4096, 4*4096, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, ummap_driver_create_fd(fd), NULL, "group");
+	char * ptr2 = (char*)ummap(NULL, 4*4096, 4096, 0, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, ummap_driver_create_fd(fd), NULL, "group");
+	fclose(fp);
+
+	//setup
+	memset(ptr1, 'a', 4*4096);
+	memset(ptr2, 'b', 4*4096);
+
+	//sync
+	ummap_sync_group("group");
+
+	//check
+	fp = fopen(fname, "r");
+	ASSERT_NE(nullptr, fp);
+	char buffer[8*4096];
+	ssize_t res = fread(buffer, 1, 8*4096, fp);
+	ASSERT_EQ(8*4096, res);
+	for (int i = 0 ; i < 8*4096 ; i++)
+		ASSERT_EQ(i < 4*4096 ? 'b' : 'a', buffer[i]) << "Index: " << i;
+	fclose(fp);
+
+	//unmap
+	umunmap(ptr1, false);
+	umunmap(ptr2, false);
+	ummap_policy_group_destroy("group");
+	
+	//clear
+	unlink(fname);
+}
+
+/*******************  FUNCTION  *********************/
+static void checkFileContent(const char * fname, size_t size, char value)
+{
+	FILE * fp = fopen(fname, "r");
+	ASSERT_NE(nullptr, fp);
+	char * buffer = new char[size];
+	ssize_t res = fread(buffer, 1, size, fp);
+	ASSERT_EQ(size, res);
+	for (size_t i = 0 ; i < size ; i++)
+		ASSERT_EQ(value, buffer[i]) << "Index: " << i;
+	delete [] buffer;
+	fclose(fp);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, checkpoint)
+{
+	//def
+	const char * fname = "/tmp/test-ummap-checkpoint-orig.raw";
+	const char * ckpt1 = "/tmp/test-ummap-checkpoint-1.raw";
+	const char * ckpt2 = "/tmp/test-ummap-checkpoint-2.raw";
+
+	//open
+	FILE * fp = fopen(fname, "w+");
+	ASSERT_NE(nullptr, fp);
+	int fd = fileno(fp);
+	ASSERT_EQ(0, truncate(fname, 8*4096));
+
+	//map
+	char * ptr = (char*)ummap(NULL, 8*4096, 4096, 0, PROT_READ|PROT_WRITE, UMMAP_NO_FIRST_READ, ummap_driver_create_fd(fd), NULL, "none");
+	fclose(fp);
+	unlink(ckpt1);
+	unlink(ckpt2);
+
+	//first step
+	memset(ptr, 'a', 8*4096);
+	ASSERT_EQ(1u, ummap_checkpoint(ptr, "file:///tmp/test-ummap-checkpoint-1.raw"));
+	checkFileContent(ckpt1, 8*4096, 'a');
+
+	//second step, change half
+	umsync(ptr, 0, true);
+	memset(ptr, 'b', 4*4096);
+	ASSERT_EQ(2u, ummap_checkpoint(ptr, "file:///tmp/test-ummap-checkpoint-2.raw"));
+	checkFileContent(ckpt1, 8*4096, 'a');
+	char expected[8*4096];
+	memset(expected, 'b', 4*4096);
+	memset(expected + 4*4096, 'a', 4*4096);
+	fp = fopen(ckpt2, "r");
+	ASSERT_NE(nullptr, fp);
+	char buffer[8*4096];
+	ASSERT_EQ(8*4096, fread(buffer, 1, 8*4096, fp));
+	fclose(fp);
+	ASSERT_EQ(0, memcmp(expected, buffer, 8*4096));
+
+	//unmap
+	umunmap(ptr, false);
+	
+	//clear
+	unlink(fname);
+	unlink(ckpt1);
+	unlink(ckpt2);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, advise)
+{
+	//def
+	const char * fname = "/tmp/test-ummap-advise.raw";
+
+	//open
+	FILE * fp = fopen(fname, "w+");
+	ASSERT_NE(nullptr, fp);
+	int fd = fileno(fp);
+	ASSERT_EQ(0, truncate(fname, 8*4096));
+
+	//map
+	char * ptr = (char*)ummap(NULL, 8*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_fd(fd), NULL, "none");
+	fclose(fp);
+
+	//load all and write
+	ummap_advise(ptr, 0, UMMAP_ADV_SEQUENTIAL);
+	ummap_advise(ptr, 0, UMMAP_ADV_WILLNEED);
+	memset(ptr, 'a', 8*4096);
+
+	//drop must write the data
+	ummap_advise(ptr, 0, UMMAP_ADV_DONTNEED);
+	checkFileContent(fname, 8*4096, 'a');
+
+	//access again reload the content
+	ummap_advise(ptr, 0, UMMAP_ADV_NORMAL);
+	for (int i = 0 ; i < 8*4096 ; i++)
+		ASSERT_EQ('a', ptr[i]) << "Index: " << i;
+
+	//unmap
+	umunmap(ptr, false);
+
+	//clear
+	unlink(fname);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, stats)
+{
+	//policy
+	ummap_policy_t * policy = ummap_policy_create_fifo(4*4096, false);
+	ummap_policy_group_register("test-stats", policy);
+
+	//map
+	char * ptr1 = (char*)ummap(NULL, 8*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(0), NULL, "test-stats");
+	char * ptr2 = (char*)ummap(NULL, 8*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(0), NULL, "test-stats");
+
+	//write all, we need to evict
+	memset(ptr1, 'a', 8*4096);
+	memset(ptr2, 'a', 2*4096);
+
+	//check mapping
+	ummap_stats_t stats;
+	ummap_get_stats(ptr1, &stats);
+	EXPECT_EQ(8u, stats.write_faults);
+	EXPECT_EQ(0u, stats.read_faults);
+	EXPECT_EQ(6u, stats.dirty_evictions);
+	EXPECT_EQ(2*4096u, stats.resident_bytes);
+
+	//check policy
+	ummap_policy_get_stats(policy, &stats);
+	EXPECT_EQ(10u, stats.write_faults);
+	EXPECT_EQ(6u, stats.dirty_evictions);
+	EXPECT_EQ(4*4096u, stats.resident_bytes);
+	EXPECT_EQ(4*4096u, stats.dirty_bytes);
+
+	//unmap
+	umunmap(ptr1, false);
+	umunmap(ptr2, false);
+	ummap_policy_group_destroy("test-stats");
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, fault_around)
+{
+	//policy
+	ummap_policy_t * policy = ummap_policy_create_fifo(4*4096, false);
+	ummap_policy_group_register("test-fault-around", policy);
+
+	//map
+	char * ptr = (char*)ummap(NULL, 16*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(0), NULL, "test-fault-around");
+	ummap_set_fault_around(ptr, 8*4096);
+
+	//read load the affordable neighbours
+	ASSERT_EQ(0, ptr[5*4096]);
+	ASSERT_EQ(0, ptr[4*4096]);
+	ASSERT_EQ(0, ptr[7*4096]);
+
+	//check
+	ummap_stats_t stats;
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(1u, stats.read_faults);
+	EXPECT_EQ(3u, stats.fault_around);
+	EXPECT_EQ(4*4096u, stats.resident_bytes);
+
+	//unmap
+	umunmap(ptr, false);
+	ummap_policy_group_destroy("test-fault-around");
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, pin)
+{
+	//policy
+	ummap_policy_t * policy = ummap_policy_create_fifo(4*4096, false);
+	ummap_policy_set_max_pinned(policy, 2*4096);
+	ummap_policy_group_register("test-pin", policy);
+
+	//map
+	char * ptr = (char*)ummap(NULL, 16*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(0), NULL, "test-pin");
+
+	//pin over the budget
+	ASSERT_EQ(-1, ummap_pin(ptr, 3*4096));
+
+	//pin the header and go through all the rest
+	ASSERT_EQ(0, ummap_pin(ptr, 2*4096));
+	memset(ptr + 2*4096, 'a', 14*4096);
+
+	//check header still there
+	ummap_stats_t stats;
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(2*4096u, stats.pinned_bytes);
+	EXPECT_EQ(4*4096u, stats.resident_bytes);
+	ASSERT_EQ(0, ptr[0] + ptr[4096]);
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(0u, stats.read_faults);
+
+	//unpin
+	ummap_unpin(ptr, 0);
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(0u, stats.pinned_bytes);
+	EXPECT_EQ(4*4096u, ummap_policy_get_memory(policy));
+
+	//unmap
+	umunmap(ptr, false);
+	ummap_policy_group_destroy("test-pin");
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, acquire)
+{
+	//policy
+	ummap_policy_t * policy = ummap_policy_create_fifo(8*4096, false);
+	ummap_policy_group_register("test-acquire", policy);
+
+	//map
+	char * ptr = (char*)ummap(NULL, 16*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(0), NULL, "test-acquire");
+
+	//over the pin budget
+	ASSERT_EQ(-1, ummap_acquire(ptr, 8*4096, PROT_READ));
+
+	//acquire and use without fault
+	ASSERT_EQ(0, ummap_acquire(ptr + 4*4096, 4*4096, PROT_READ|PROT_WRITE));
+	memset(ptr + 4*4096, 'a', 4*4096);
+	ummap_stats_t stats;
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(0u, stats.read_faults);
+	EXPECT_EQ(0u, stats.write_faults);
+	EXPECT_EQ(4*4096u, stats.pinned_bytes);
+
+	//release
+	ummap_release(ptr + 4*4096, 4*4096);
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(0u, stats.pinned_bytes);
+	EXPECT_EQ(4*4096u, ummap_policy_get_memory(policy));
+
+	//unmap
+	umunmap(ptr, false);
+	ummap_policy_group_destroy("test-acquire");
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, discard_unaligned)
+{
+	//map
+	char * ptr = (char*)ummap(NULL, 4*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_memory(4*4096), NULL, "none");
+	memset(ptr, 'a', 4*4096);
+
+	//only the second segment is fully covered
+	ummap_discard(ptr + 100, 2*4096);
+	EXPECT_EQ('a', ptr[0]);
+	EXPECT_EQ('a', ptr[100]);
+	EXPECT_EQ(0, ptr[4096]);
+	EXPECT_EQ('a', ptr[2*4096]);
+	EXPECT_EQ('a', ptr[2*4096+100]);
+
+	//no segment covered
+	ummap_discard(ptr + 3*4096 + 100, 0);
+	EXPECT_EQ('a', ptr[3*4096+100]);
+
+	//up to the end covers the last one
+	ummap_discard(ptr + 3*4096, 0);
+	EXPECT_EQ(0, ptr[3*4096+100]);
+
+	//unmap
+	umunmap(ptr, false);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, discard_to_end)
+{
+	//map, the last segment is partial
+	size_t size = 3*4096 + 100;
+	char * ptr = (char*)ummap(NULL, size, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_memory(size), NULL, "none");
+	memset(ptr, 'a', size);
+
+	//from an unaligned address, the first segment is kept and the partial one discarded
+	ummap_discard(ptr + 100, 0);
+	EXPECT_EQ('a', ptr[0]);
+	EXPECT_EQ('a', ptr[4095]);
+	EXPECT_EQ(0, ptr[4096]);
+	EXPECT_EQ(0, ptr[2*4096]);
+	EXPECT_EQ(0, ptr[3*4096 + 99]);
+
+	//from the base address
+	ummap_discard(ptr, 0);
+	EXPECT_EQ(0, ptr[0]);
+
+	//unmap
+	umunmap(ptr, false);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, remap)
+{
+	//map
+	char * ptr = (char*)ummap(NULL, 4*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_memory(16*4096), NULL, "none");
+	memset(ptr, 'a', 4*4096);
+
+	//grow
+	ptr = (char*)ummap_remap(ptr, 16*4096, UMMAP_REMAP_MAYMOVE, NULL);
+	ASSERT_NE((char*)NULL, ptr);
+	ummap_stats_t stats;
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(4*4096u, stats.resident_bytes);
+	for (size_t i = 0 ; i < 4*4096 ; i++)
+		ASSERT_EQ('a', ptr[i]) << "Index " << i;
+
+	//use the new part
+	memset(ptr + 4*4096, 'b', 12*4096);
+	ASSERT_EQ('b', ptr[16*4096 - 1]);
+
+	//shrink
+	ASSERT_EQ(ptr, ummap_remap(ptr, 2*4096, 0, NULL));
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(2*4096u, stats.resident_bytes);
+	ASSERT_EQ('a', ptr[0]);
+
+	//unmap
+	umunmap(ptr, false);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, shared_cache)
+{
+	//def
+	const char * fname = "/tmp/test-ummap-shared-cache.txt";
+
+	//create
+	FILE * fp = fopen(fname, "w+");
+	ASSERT_NE(nullptr, fp);
+	int fd = fileno(fp);
+	char buffer[8*4096];
+	memset(buffer, 'a', sizeof(buffer));
+	ASSERT_EQ(sizeof(buffer), fwrite(buffer, 1, sizeof(buffer), fp));
+	fflush(fp);
+
+	//map the file twice with overlapping ranges
+	char * ptr1 = (char*)ummap(NULL, 4*4096, 4096, 0, PROT_READ|PROT_WRITE, UMMAP_SHARED_CACHE, ummap_driver_create_fd(fd), NULL, "none");
+	char * ptr2 = (char*)ummap(NULL, 4*4096, 4096, 4096, PROT_READ|PROT_WRITE, UMMAP_SHARED_CACHE, ummap_driver_create_fd(fd), NULL, "none");
+	fclose(fp);
+
+	//write with one, see with the other without reading
+	ptr1[4096] = 'b';
+	ASSERT_EQ('b', ptr2[0]);
+	ummap_stats_t stats;
+	ummap_get_stats(ptr2, &stats);
+	EXPECT_EQ(1u, stats.cache_hits);
+	EXPECT_EQ(0u, stats.read_bytes);
+
+	//unmap
+	umunmap(ptr1, true);
+	umunmap(ptr2, false);
+
+	//check
+	fp = fopen(fname, "r");
+	ASSERT_NE(nullptr, fp);
+	ASSERT_EQ(sizeof(buffer), fread(buffer, 1, sizeof(buffer), fp));
+	fclose(fp);
+	ASSERT_EQ('b', buffer[4096]);
+
+	//clear
+	unlink(fname);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, policy_mrc)
+{
+	//policy, the curve covers twice its memory
+	ummap_policy_t * policy = ummap_policy_create_fifo(4*4096, false);
+	ummap_policy_enable_mrc(policy, 1);
+	ummap_policy_group_register("test-mrc", policy);
+
+	//map
+	char * ptr = (char*)ummap(NULL, 8*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(0), NULL, "test-mrc");
+
+	//loop on twice the memory, all the accesses fault
+	for (size_t pass = 0 ; pass < 5 ; pass++) {
+		for (size_t i = 0 ; i < 8 ; i++) {
+			volatile char value = ptr[i*4096];
+			(void)value;
+		}
+	}
+
+	//check
+	ummap_stats_t stats;
+	ummap_policy_get_stats(policy, &stats);
+	EXPECT_EQ(40u, stats.read_faults);
+
+	//check curve, only the cold misses remain with 8 segments
+	ummap_mrc_point_t points[8];
+	ASSERT_EQ(8u, ummap_policy_get_mrc(policy, points, 8));
+	EXPECT_EQ(4*4096u, points[3].memory);
+	EXPECT_DOUBLE_EQ(1.0, points[3].miss_ratio);
+	EXPECT_EQ(8*4096u, points[7].memory);
+	EXPECT_DOUBLE_EQ(0.2, points[7].miss_ratio);
+
+	//unmap
+	umunmap(ptr, false);
+	ummap_policy_group_destroy("test-mrc");
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, policy_mrc_uri)
+{
+	ummap_mrc_point_t points[4];
+
+	//disabled
+	ummap_policy_t * policy = ummap_policy_create_uri("fifo://16KB", true);
+	ASSERT_EQ(0u, ummap_policy_get_mrc(policy, points, 4));
+	ummap_policy_destroy(policy);
+
+	//enabled
+	policy = ummap_policy_create_uri("fifo://16KB?mrc=16", true);
+	ASSERT_EQ(4u, ummap_policy_get_mrc(policy, points, 4));
+	EXPECT_EQ(8*4096u, points[3].memory);
+	EXPECT_EQ(0.0, points[3].miss_ratio);
+	ummap_policy_destroy(policy);
+}
+
+/*******************  FUNCTION  *********************/
+static void residencyHandler(void * addr, size_t size, void * userData)
+{
+	std::vector<char*> * visited = (std::vector<char*>*)userData;
+	visited->push_back((char*)addr);
+	memset(addr, 'a', size);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, residency)
+{
+	//map
+	char * ptr = (char*)ummap(NULL, 8*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(0), NULL, "none");
+
+	//touch
+	ptr[3*4096] = 'b';
+	volatile char value = ptr[6*4096];
+	(void)value;
+
+	//check
+	unsigned char vec[8];
+	ASSERT_EQ(2u, ummap_residency(ptr, 0, vec));
+	EXPECT_EQ(0, vec[0]);
+	EXPECT_EQ(UMMAP_RESIDENT | UMMAP_RESIDENT_DIRTY, vec[3]);
+	EXPECT_EQ(UMMAP_RESIDENT, vec[6]);
+
+	//iterate
+	std::vector<char*> visited;
+	ummap_for_each_resident_first(ptr, 0, residencyHandler, &visited);
+	ASSERT_EQ(8u, visited.size());
+	EXPECT_EQ(ptr + 3*4096, visited[0]);
+	EXPECT_EQ(ptr + 6*4096, visited[1]);
+	EXPECT_EQ(ptr, visited[2]);
+	EXPECT_EQ(8u, ummap_residency(ptr, 0, vec));
+	for (size_t i = 0 ; i < 8 ; i++)
+		EXPECT_EQ(UMMAP_RESIDENT | UMMAP_RESIDENT_DIRTY, vec[i]);
+
+	//unmap
+	umunmap(ptr, false);
+}
+
+/*******************  FUNCTION  *********************/
+static void readHandler(void * addr, size_t size, void * userData)
+{
+	size_t * sum = (size_t*)userData;
+	for (size_t i = 0 ; i < size ; i++)
+		*sum += ((volatile char*)addr)[i];
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, for_each_resident_first_lead)
+{
+	//policy
+	ummap_policy_group_register("test-lead", ummap_policy_create_fifo(4*4096, false));
+
+	//map
+	char * ptr = (char*)ummap(NULL, 16*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(1), NULL, "test-lead");
+
+	//iterate, the prefetcher must not evict the segments not yet handled
+	size_t sum = 0;
+	ummap_for_each_resident_first(ptr, 0, readHandler, &sum);
+	EXPECT_EQ(16*4096u, sum);
+
+	//check
+	ummap_stats_t stats;
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(0u, stats.refaults);
+	EXPECT_LE(stats.resident_bytes, 4*4096u);
+
+	//unmap
+	umunmap(ptr, false);
+	ummap_policy_group_destroy("test-lead");
+}
+
+/*******************  STRUCT  *********************/
+struct LoadAsyncState
+{
+	std::mutex mutex;
+	std::condition_variable cond;
+	void * addr;
+	size_t size;
+	bool done;
+};
+
+/*******************  FUNCTION  *********************/
+static void loadAsyncCallback(void * addr, size_t size, void * userData)
+{
+	LoadAsyncState * state = (LoadAsyncState*)userData;
+	std::lock_guard<std::mutex> lockGuard(state->mutex);
+	state->addr = addr;
+	state->size = size;
+	state->done = true;
+	state->cond.notify_all();
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, load_async)
+{
+	//map
+	char * ptr = (char*)ummap(NULL, 8*4096, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(5), NULL, "none");
+
+	//load in background
+	LoadAsyncState state;
+	state.done = false;
+	ummap_load_async(ptr + 2*4096 + 10, 4*4096 - 10, loadAsyncCallback, &state);
+
+	//wait
+	{
+		std::unique_lock<std::mutex> lock(state.mutex);
+		state.cond.wait(lock, [&state]{return state.done;});
+	}
+
+	//check range
+	EXPECT_EQ(ptr + 2*4096, state.addr);
+	EXPECT_EQ(4*4096u, state.size);
+
+	//check loaded
+	unsigned char vec[8];
+	ASSERT_EQ(4u, ummap_residency(ptr, 0, vec));
+	for (size_t i = 0 ; i < 8 ; i++)
+		EXPECT_EQ((i >= 2 && i < 6) ? UMMAP_RESIDENT : 0, vec[i]);
+
+	//access without fault
+	for (size_t i = 2 ; i < 6 ; i++)
+		EXPECT_EQ(5, ptr[i*4096]);
+	ummap_stats_t stats;
+	ummap_get_stats(ptr, &stats);
+	EXPECT_EQ(0u, stats.read_faults);
+
+	//pending loads are waited by the unmap
+	ummap_load_async(ptr, 0, NULL, NULL);
+	umunmap(ptr, false);
+}
+
 /*******************  FUNCTION  *********************/
 TEST_F(TestPublicAPI, map_driver_dax_fd)
 {
@@ -880,3 +1589,63 @@ TEST_F(TestPublicAPI, quota_inter_proc_env_default)
 	//finalize
 	ummap_quota_destroy(quota);
 }
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, quota_utility)
+{
+	//setup policies
+	ummap_quota_t * quota = ummap_quota_create_utility(8*4096);
+	ummap_policy_t * policy1 = ummap_policy_create_fifo(8*4096, true);
+	ummap_policy_t * policy2 = ummap_policy_create_fifo(8*4096, true);
+	ummap_quota_register_policy(quota, policy1);
+	ummap_quota_register_policy(quota, policy2);
+	ummap_quota_set_policy_share(quota, policy2, 1.0, 6*4096);
+
+	//create mappings
+	void * ptr1 = ummap(NULL, 1024*1024, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(64), policy1, NULL);
+	void * ptr2 = ummap(NULL, 1024*1024, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(64), policy2, NULL);
+	memset(ptr1, 0 , 1024*1024);
+	memset(ptr2, 0 , 1024*1024);
+
+	//check
+	EXPECT_EQ(2*4096, ummap_policy_get_memory(policy1));
+	EXPECT_EQ(6*4096, ummap_policy_get_memory(policy2));
+
+	//destroy
+	umunmap(ptr1, false);
+	umunmap(ptr2, false);
+
+	//finalize
+	ummap_quota_destroy(quota);
+}
+
+/*******************  FUNCTION  *********************/
+TEST_F(TestPublicAPI, quota_async)
+{
+	//setup policies
+	ummap_quota_t * quota = ummap_quota_create_local(4*4096);
+	ummap_quota_set_async(quota, true);
+	ummap_policy_t * policy1 = ummap_policy_create_fifo(8*4096, true);
+	ummap_policy_t * policy2 = ummap_policy_create_fifo(8*4096, true);
+	ummap_quota_register_policy(quota, policy1);
+	ummap_quota_register_policy(quota, policy2);
+
+	//create mappings
+	void * ptr1 = ummap(NULL, 1024*1024, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(64), policy1, NULL);
+	void * ptr2 = ummap(NULL, 1024*1024, 4096, 0, PROT_READ|PROT_WRITE, 0, ummap_driver_create_dummy(64), policy2, NULL);
+	memset(ptr1, 0 , 1024*1024);
+	memset(ptr2, 0 , 1024*1024);
+
+	//wait the background thread
+	for (int i = 0 ; i < 1000 && ummap_policy_get_memory(policy1) + ummap_policy_get_memory(policy2) > 4*4096 ; i++)
+		usleep(1000);
+	EXPECT_LE(ummap_policy_get_memory(policy1) + ummap_policy_get_memory(policy2), 4*4096);
+
+	//destroy
+	ummap_quota_set_async(quota, false);
+	umunmap(ptr1, false);
+	umunmap(ptr2, false);
+
+	//finalize
+	ummap_quota_destroy(quota);
+}
@@ -21,6 +21,7 @@
 #include "../common/Debug.hpp"
 #include "../common/HumanUnits.hpp"
 #include "../core/GlobalHandler.hpp"
+#include "../core/FlushRequest.hpp"
 #include "../uri/MeroRessource.hpp"
 #include "../uri/IocRessource.hpp"
 #include "../drivers/FDDriver.hpp"
@@ -40,6 +41,7 @@
 #include "../policies/LifoPolicy.hpp"
 #include "../core/PolicyQuotaLocal.hpp"
 #include "../core/PolicyQuotaInterProc.hpp"
+#include "../core/PolicyQuotaUtility.hpp"
 #include "ummap.h"
 
 /***************** USING NAMESPACE ******************/
@@ -94,6 +96,24 @@ void * ummap(void * addr, size_t size, size_t segment_size, size_t storage_offse
 	return getGlobalhandler()->ummap(addr, size, segment_size, storage_offset, protection, flags, driv, pol, policy_group_checked);
 }
 
+/*******************  FUNCTION  *********************/
+int ummap_batch(ummap_batch_entry_t * entries, size_t count, size_t segment_size, int protection, int flags, const char * policy_group)
+{
+	//check
+	assert(getGlobalhandler() != NULL);
+
+	//group
+	const char * policy_group_checked = policy_group;
+	if (policy_group_checked == NULL)
+		policy_group_checked = "none";
+
+	//call
+	getGlobalhandler()->ummapBatch(entries, count, segment_size, protection, flags, policy_group_checked);
+
+	//ok
+	return 0;
+}
+
 /*******************  FUNCTION  *********************/
 int umunmap(void * ptr, bool sync)
 {
@@ -105,6 +125,17 @@ int umunmap(void * ptr, bool sync)
 	return getGlobalhandler()->uunmap(ptr, sync);
 }
 
+/*******************  FUNCTION  *********************/
+void * ummap_remap(void * ptr, size_t new_size, int flags, void * new_addr)
+{
+	//check
+	assert(getGlobalhandler() != NULL);
+	assert(ptr != NULL);
+
+	//call
+	return getGlobalhandler()->remap(ptr, new_size, flags, new_addr);
+}
+
 /*******************  FUNCTION  *********************/
 void ummap_skip_first_read(void * ptr)
 {
@@ -294,6 +325,17 @@ size_t ummap_policy_get_memory(ummap_policy_t * policy)
 	return castedPolicy->getCurrentMemory();
 }
 
+/*******************  FUNCTION  *********************/
+void ummap_policy_set_max_pinned(ummap_policy_t * policy, size_t max_size)
+{
+	//check
+	assert(policy != NULL);
+
+	//cast and call
+	Policy * castedPolicy = (Policy*)policy;
+	castedPolicy->setMaxPinnedMemory(max_size);
+}
+
 /*******************  FUNCTION  *********************/
 void umflush(void * ptr, size_t size, bool evict)
 {
@@ -306,6 +348,225 @@ void umsync(void * ptr, size_t size, bool evict)
 	getGlobalhandler()->flush(ptr, size, evict, true);
 }
 
+/*******************  FUNCTION  *********************/
+ummap_request_t * ummap_flush_async(void * ptr, size_t size, int flags)
+{
+	//check
+	assert(ptr != NULL);
+
+	//convert flags
+	bool sync = (flags & UMMAP_FLUSH_ASYNC_SYNC);
+	bool evict = (flags & UMMAP_FLUSH_ASYNC_EVICT);
+
+	//call
+	return (ummap_request_t*)getGlobalhandler()->flushAsync(ptr, size, evict, sync);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_wait(ummap_request_t * request)
+{
+	//check
+	assert(request != NULL);
+
+	//convert
+	FlushRequest * req = (FlushRequest*)request;
+
+	//wait & destroy
+	req->wait();
+	delete req;
+}
+
+/*******************  FUNCTION  *********************/
+bool ummap_test(ummap_request_t * request)
+{
+	//check
+	assert(request != NULL);
+
+	//convert
+	FlushRequest * req = (FlushRequest*)request;
+
+	//test
+	return req->test();
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_set_flush_threads(unsigned int threads)
+{
+	getGlobalhandler()->setFlushThreads(threads);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_sync_group(const char * policy_group)
+{
+	//check
+	assert(policy_group != NULL);
+
+	//call
+	getGlobalhandler()->syncGroup(policy_group);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_advise(void * ptr, size_t size, ummap_advice_t advice)
+{
+	//check
+	assert(ptr != NULL);
+
+	//call
+	getGlobalhandler()->advise(ptr, size, advice);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_load_async(void * ptr, size_t size, ummap_load_callback_t callback, void * user_data)
+{
+	//check
+	assert(ptr != NULL);
+
+	//call
+	getGlobalhandler()->loadAsync(ptr, size, callback, user_data);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_set_fault_around(void * ptr, size_t size)
+{
+	//check
+	assert(ptr != NULL);
+
+	//call
+	getGlobalhandler()->setFaultAround(ptr, size);
+}
+
+/*******************  FUNCTION  *********************/
+int ummap_pin(void * ptr, size_t size)
+{
+	//check
+	assert(ptr != NULL);
+
+	//call
+	return getGlobalhandler()->pin(ptr, size);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_unpin(void * ptr, size_t size)
+{
+	//check
+	assert(ptr != NULL);
+
+	//call
+	getGlobalhandler()->unpin(ptr, size);
+}
+
+/*******************  FUNCTION  *********************/
+int ummap_acquire(void * ptr, size_t size, int mode)
+{
+	//check
+	assert(ptr != NULL);
+
+	//call
+	return getGlobalhandler()->acquire(ptr, size, mode);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_release(void * ptr, size_t size)
+{
+	//check
+	assert(ptr != NULL);
+
+	//call
+	getGlobalhandler()->release(ptr, size);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_discard(void * ptr, size_t size)
+{
+	//check
+	assert(ptr != NULL);
+
+	//call
+	getGlobalhandler()->discard(ptr, size);
+}
+
+/*******************  FUNCTION  *********************/
+size_t ummap_residency(void * ptr, size_t size, unsigned char * vec)
+{
+	//check
+	assert(ptr != NULL);
+	assert(vec != NULL);
+
+	//call
+	return getGlobalhandler()->residency(ptr, size, vec);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_for_each_resident_first(void * ptr, size_t size, ummap_segment_handler_t handler, void * user_data)
+{
+	//check
+	assert(ptr != NULL);
+	assert(handler != NULL);
+
+	//call
+	getGlobalhandler()->forEachResidentFirst(ptr, size, handler, user_data);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_get_stats(void * ptr, ummap_stats_t * stats)
+{
+	//check
+	assert(ptr != NULL);
+	assert(stats != NULL);
+
+	//call
+	getGlobalhandler()->getMapping(ptr)->getStats(*stats);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_policy_get_stats(ummap_policy_t * policy, ummap_stats_t * stats)
+{
+	//check
+	assert(policy != NULL);
+	assert(stats != NULL);
+
+	//call
+	Policy * pol = (Policy*)policy;
+	pol->getStats(*stats);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_policy_enable_mrc(ummap_policy_t * policy, unsigned int sampling)
+{
+	//check
+	assert(policy != NULL);
+
+	//call
+	Policy * pol = (Policy*)policy;
+	pol->enableMissRatioCurve(sampling == 0 ? UMMAP_MRC_DEFAULT_SAMPLING : sampling);
+}
+
+/*******************  FUNCTION  *********************/
+size_t ummap_policy_get_mrc(ummap_policy_t * policy, ummap_mrc_point_t * points, size_t max_points)
+{
+	//check
+	assert(policy != NULL);
+
+	//call
+	Policy * pol = (Policy*)policy;
+	MissRatioCurve * curve = pol->getMissRatioCurve();
+	if (curve == NULL)
+		return 0;
+	else
+		return curve->getCurve(points, max_points);
+}
+
+/*******************  FUNCTION  *********************/
+size_t ummap_checkpoint(void * ptr, const char * target_uri)
+{
+	//check
+	assert(ptr != NULL);
+	assert(target_uri != NULL);
+
+	//call
+	return getGlobalhandler()->checkpoint(ptr, target_uri);
+}
+
 /*******************  FUNCTION  *********************/
 ummap_driver_t * ummap_get_driver(void * ptr)
 {
@@ -663,11 +924,43 @@ ummap_quota_t * ummap_quota_create_inter_proc_env(const char * group_name, const
 		return ummap_quota_create_inter_proc(group_name, value);
 }
 
+/*******************  FUNCTION  *********************/
+ummap_quota_t * ummap_quota_create_utility(size_t max_memory)
+{
+	ummap_quota_t * res = (ummap_quota_t *)new PolicyQuotaUtility(max_memory);
+	return res;
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_quota_set_policy_share(ummap_quota_t * quota, ummap_policy_t * policy, double weight, size_t min_memory)
+{
+	//check
+	assert(quota != NULL);
+	assert(policy != NULL);
+
+	//cast
+	PolicyQuotaUtility * castedQuota = dynamic_cast<PolicyQuotaUtility*>((PolicyQuota*)quota);
+	assume(castedQuota != NULL, "The policy shares can only be set on a utility quota !");
+
+	//call
+	castedQuota->setPolicyShare((Policy*)policy, weight, min_memory);
+}
+
+/*******************  FUNCTION  *********************/
+void ummap_quota_set_async(ummap_quota_t * quota, bool enabled)
+{
+	//check
+	assert(quota != NULL);
+
+	//call
+	((PolicyQuota*)quota)->setAsync(enabled);
+}
+
 /*******************  FUNCTION  *********************/
 void ummap_quota_destroy(ummap_quota_t * quota)
 {
 	if (quota != NULL)
-		delete (PolicyQuotaInterProc*)quota;
+		delete (PolicyQuota*)quota;
 }
 
 /*******************  FUNCTION  *********************/
@@ -35,6 +35,49 @@ extern "C" {
 #define UMMAP_THREAD_UNSAFE 2
 /** Force the mapping address to the given hint like MAP_FIXED for mmap(). **/
 #define UMMAP_FIXED 4
+/**
+ * Take the segment metadata from a pool shared by all the lightweight mappings
+ * instead of allocating it per mapping. This reduces the creation cost and memory
+ * footprint for workloads using many small mappings. It is ignored for mappings
+ * larger than 65536 segments.
+**/
+#define UMMAP_LIGHTWEIGHT 8
+/**
+ * Remember the segments which were dirty when evicted and reload them directly in
+ * write mode on the next read fault. This avoids the second fault of read-modify-write
+ * accesses. As the writes are then not tracked, those segments are considered as
+ * dirty and written back on eviction even if not modified again.
+**/
+#define UMMAP_PREDICT_WRITE 16
+/**
+ * Share the segments with the other mappings of the same storage object using this
+ * flag, so a segment loaded by a mapping is mapped by the others without reading the
+ * storage again and the writes are seen by all of them. The mappings must use the same
+ * segment size and a storage offset aligned on it, otherwise the flag is ignored.
+ * A shared segment is charged once, to the policies of the mapping which loaded it.
+ * When this mapping unmaps it, the charge moves to one of the mappings still using it.
+**/
+#define UMMAP_SHARED_CACHE 32
+
+/*****************  REMAP FLAGS  ********************/
+/** Allow ummap_remap() to move the mapping if it cannot grow in place. **/
+#define UMMAP_REMAP_MAYMOVE 1
+/** Move the mapping to the address given to ummap_remap(). **/
+#define UMMAP_REMAP_FIXED 2
+
+/*****************  ASYNC FLAGS  ********************/
+/** Default value for the ummap_flush_async() flags. **/
+#define UMMAP_FLUSH_ASYNC_DEFAULT 0
+/** Apply a sync operation on the storage after flushing the data. **/
+#define UMMAP_FLUSH_ASYNC_SYNC 1
+/** Evict the segments after flushing them. **/
+#define UMMAP_FLUSH_ASYNC_EVICT 2
+
+/*****************  RESIDENCY FLAGS  *****************/
+/** The segment is mapped in memory (see ummap_residency()). **/
+#define UMMAP_RESIDENT 1
+/** The segment is mapped and not yet written to the storage (see ummap_residency()). **/
+#define UMMAP_RESIDENT_DIRTY 2
 
 /*********************  ENUM  ***********************/
 typedef enum ummap_switch_clean_s
@@ -44,6 +87,26 @@ typedef enum ummap_switch_clean_s
 	UMMAP_MARK_CLEAN_DIRTY = 2,
 } ummap_switch_clean_t;
 
+/*********************  ENUM  ***********************/
+/**
+ * Access hints to be given to ummap_advise(), they follow the madvise() semantic.
+**/
+typedef enum ummap_advice_s
+{
+	/** No special treatment, reset the previous hints. **/
+	UMMAP_ADV_NORMAL = 0,
+	/** Expect sequential accesses, load the next segments on fault (read-ahead). **/
+	UMMAP_ADV_SEQUENTIAL = 1,
+	/** Expect random accesses, never load the neighbour segments. **/
+	UMMAP_ADV_RANDOM = 2,
+	/** The segments will be accessed only once, evict them first. **/
+	UMMAP_ADV_NOREUSE = 3,
+	/** Expect accesses in the near future, load the segments now. **/
+	UMMAP_ADV_WILLNEED = 4,
+	/** Do not expect accesses, write back and evict the segments now. **/
+	UMMAP_ADV_DONTNEED = 5,
+} ummap_advice_t;
+
 /*********************  TYPES  **********************/
 /** Hidden struct used to point ummap C++ policies. **/
 typedef struct ummap_policy_s ummap_policy_t;
@@ -53,6 +116,85 @@ typedef struct ummap_driver_s ummap_driver_t;
 typedef struct ioc_client_s ioc_client_t;
 /** Hidden struct used to point the quota handler. **/
 typedef struct ummap_quota_s ummap_quota_t;
+/** Hidden struct used to point an asynchronous request. **/
+typedef struct ummap_request_s ummap_request_t;
+/**
+ * Function called by ummap_for_each_resident_first() on each segment.
+ * @param addr Address of the segment.
+ * @param size Size of the segment.
+ * @param user_data Pointer given to ummap_for_each_resident_first().
+**/
+typedef void (*ummap_segment_handler_t)(void * addr, size_t size, void * user_data);
+/**
+ * Function called by ummap_load_async() when the range has been loaded.
+ * @param addr Address of the loaded range (aligned on the segment size).
+ * @param size Size of the loaded range (aligned on the segment size). It can
+ * be smaller than the requested one if truncated to the end of the mapping or
+ * to the memory allowed by the policies, the rest is left to the faults.
+ * @param user_data Pointer given to ummap_load_async().
+**/
+typedef void (*ummap_load_callback_t)(void * addr, size_t size, void * user_data);
+
+/*********************  STRUCT  *********************/
+/**
+ * Point of a miss-ratio curve returned by ummap_policy_get_mrc().
+**/
+typedef struct ummap_mrc_point_s {
+	/** Memory budget of the policy. **/
+	size_t memory;
+	/** Estimated fraction of the current faults which would remain with this budget. **/
+	double miss_ratio;
+} ummap_mrc_point_t;
+
+/******************  STATS STRUCT  *****************/
+/**
+ * Counters returned by ummap_get_stats() and ummap_policy_get_stats().
+**/
+typedef struct ummap_stats_s {
+	/** Number of segmentation faults due to a read access. **/
+	size_t read_faults;
+	/** Number of segmentation faults due to a write access. **/
+	size_t write_faults;
+	/** Number of faults on segments which have been evicted before. **/
+	size_t refaults;
+	/** Bytes read from the storage through the driver. **/
+	size_t read_bytes;
+	/** Bytes written to the storage through the driver. **/
+	size_t written_bytes;
+	/** Number of segments evicted without needing a write. **/
+	size_t clean_evictions;
+	/** Number of segments evicted after writing their content. **/
+	size_t dirty_evictions;
+	/** Number of flush operations. **/
+	size_t flushes;
+	/** Number of segments loaded in advance with a faulting neighbour (see ummap_set_fault_around()). **/
+	size_t fault_around;
+	/** Number of segments mapped from another mapping without reading the storage (see UMMAP_SHARED_CACHE). **/
+	size_t cache_hits;
+	/** Memory currently mapped. **/
+	size_t resident_bytes;
+	/** Memory currently mapped and not yet written to the storage. **/
+	size_t dirty_bytes;
+	/** Memory currently pinned (see ummap_pin()). **/
+	size_t pinned_bytes;
+} ummap_stats_t;
+
+/*****************  BATCH STRUCT  ******************/
+/**
+ * Describe one of the mappings to be established by ummap_batch().
+**/
+typedef struct ummap_batch_entry_s {
+	/** Size of the mapping. **/
+	size_t size;
+	/** Offset to apply on the storage to reach the data to be mapped. **/
+	size_t storage_offset;
+	/** Driver of the mapping, it follows the same autoclean rules than for ummap(). **/
+	ummap_driver_t * driver;
+	/** Local policy of the mapping or NULL. **/
+	ummap_policy_t * local_policy;
+	/** Filled by ummap_batch() with the address of the mapping. **/
+	void * addr;
+} ummap_batch_entry_t;
 
 /****************  C DRIVER STRUCT  ******************/
 /**
@@ -155,12 +297,40 @@ void ummap_finalize(void);
  * @param globalPolicy Define the global policy to be used and shared between multiple mappings.
 **/
 void * ummap(void * addr, size_t size, size_t segment_size, size_t storage_offset, int protection, int flags, ummap_driver_t * driver, ummap_policy_t * local_policy, const char * policy_group);
+/**
+ * Establish several mappings at once. The address space of all the mappings is
+ * reserved by a single system call and they are registered by taking the global
+ * locks only once so it is much faster than calling ummap() in a loop to create
+ * many small mappings. Use it with UMMAP_LIGHTWEIGHT to also share the metadata.
+ * Each mapping is released independently by calling umunmap().
+ * @param entries Describe the mappings to establish, their addr field is filled on return.
+ * @param count Number of entries.
+ * @param segment_size Segment size of all the mappings (see ummap()).
+ * @param protection Access protection of all the mappings (see ummap()).
+ * @param flags Flags applied to all the mappings (see ummap()), UMMAP_FIXED is not supported.
+ * @param policy_group Name of the policy group shared by all the mappings or NULL for none.
+ * @return 0 on success.
+**/
+int ummap_batch(ummap_batch_entry_t * entries, size_t count, size_t segment_size, int protection, int flags, const char * policy_group);
 /**
  * Unmap the given mapping if found.
  * @param ptr Base address of the mapping or an address inside the mapping.
  * @param sync If true make a synchronization by flusing data before unmapping or not if false.
 **/
 int umunmap(void * ptr, bool sync);
+/**
+ * Grow, shrink or move the given mapping like mremap() without losing its resident
+ * segments. The segments removed by a shrink are written back. The mapping must not
+ * be accessed by other threads during the call.
+ * @param ptr Base address of the mapping.
+ * @param new_size New size of the mapping.
+ * @param flags UMMAP_REMAP_MAYMOVE to allow moving the mapping if it cannot grow in
+ * place, UMMAP_REMAP_FIXED to move it to new_addr. 0 to only resize in place.
+ * @param new_addr Target address with UMMAP_REMAP_FIXED, ignored otherwise.
+ * @return The new base address of the mapping or NULL if it cannot grow in place
+ * without UMMAP_REMAP_MAYMOVE. In this case the mapping is unchanged.
+**/
+void * ummap_remap(void * ptr, size_t new_size, int flags, void * new_addr);
 /**
  * Apply a flush operation to flush data from ummap-io memory to the storage.
  * See umsync() if you also want the data to be also synced to the final storage.
@@ -176,6 +346,203 @@ void umflush(void * ptr, size_t size, bool evict);
  * @param evict If true evict the synced segments after making the sync operation.
 **/
 void umsync(void * ptr, size_t size, bool evict);
+/**
+ * Start an asynchronous flush operation. The dirty segments of the range are
+ * write protected and written in background so the caller can continue to
+ * work on the rest of the mapping. A write access on a segment still waiting
+ * to be written will write it immediately before opening the access.
+ * The request must be completed by calling ummap_wait().
+ * @param ptr Base address of the mapping or an address inside the mapping.
+ * @param size Size of the range to flush of 0 for all.
+ * @param flags Flags to control the operation: UMMAP_FLUSH_ASYNC_DEFAULT, 
+ * UMMAP_FLUSH_ASYNC_SYNC, UMMAP_FLUSH_ASYNC_EVICT.
+ * @return The request handle.
+**/
+ummap_request_t * ummap_flush_async(void * ptr, size_t size, int flags);
+/**
+ * Wait the end of an asynchronous request and release it.
+ * @param request The request to wait. It cannot be used anymore after this call.
+**/
+void ummap_wait(ummap_request_t * request);
+/**
+ * Check if an asynchronous request has completed. The request still need to be
+ * released by calling ummap_wait().
+ * @param request The request to check.
+ * @return True if the request has completed.
+**/
+bool ummap_test(ummap_request_t * request);
+/**
+ * Define the number of threads used to flush large ranges with umflush(), umsync()
+ * and umunmap(). The dirty segments are split over the threads which write them by
+ * coalescing the neighbour segments.
+ * @param threads Number of threads to use, 0 to use the number of CPUs (default),
+ * 1 to disable the parallel flush.
+**/
+void ummap_set_flush_threads(unsigned int threads);
+/**
+ * Flush and sync all the mappings attached to the given policy group. The dirty
+ * segments of all the mappings accessing the same file or object are written in
+ * storage offset order by merging the neighbours, even across mappings boundaries.
+ * @param policy_group Name of the policy group.
+**/
+void ummap_sync_group(const char * policy_group);
+
+/**
+ * Give a hint on the way the given range will be accessed, like madvise().
+ * UMMAP_ADV_SEQUENTIAL, UMMAP_ADV_RANDOM and UMMAP_ADV_NOREUSE are kept on the
+ * segments until the next call while UMMAP_ADV_WILLNEED and UMMAP_ADV_DONTNEED
+ * are applied immediately.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @param advice The access hint to apply.
+**/
+void ummap_advise(void * ptr, size_t size, ummap_advice_t advice);
+/**
+ * Load the given range in background and call the callback when done so the
+ * caller can overlap the storage reads with its computation. The segments are
+ * loaded read only like with UMMAP_ADV_WILLNEED, in the limit of the memory
+ * allowed by the policies, the callback getting the size really loaded. The
+ * loads run on the internal worker threads shared with the parallel flushes.
+ * The callback is called from one of these threads,
+ * it can unmap the mapping but must not block for long as it delays the
+ * other loads. The mapping waits the pending loads before being unmapped.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @param callback Function called once the range is loaded, can be NULL.
+ * @param user_data Pointer given to the callback.
+**/
+void ummap_load_async(void * ptr, size_t size, ummap_load_callback_t callback, void * user_data);
+/**
+ * Enable the fault-around on the given mapping, like fault_around_bytes of the
+ * kernel page cache. On a fault, the not yet loaded segments of the aligned
+ * window of the given size containing the faulting one are loaded with it by a
+ * single driver request. Only the segments the policy can afford are loaded and
+ * they are evicted first until being accessed. The segments advised as
+ * UMMAP_ADV_RANDOM do not trigger it.
+ * @param ptr Base address of the mapping or an address inside the mapping.
+ * @param size Size of the window, rounded down to the segment size. 0 to disable.
+**/
+void ummap_set_fault_around(void * ptr, size_t size);
+/**
+ * Load the segments of the given range and pin them so they are never evicted by
+ * the local and global policies, like mlock(). They stay charged to the policies
+ * memory within their pin budget (see ummap_policy_set_max_pinned()). A flush with
+ * eviction writes them but keep them mapped, ummap_advise() with UMMAP_ADV_DONTNEED
+ * drops and unpins them.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @return 0 on success, -1 if the pin budget of a policy is exceeded. In this case
+ * the range is not pinned.
+**/
+int ummap_pin(void * ptr, size_t size);
+/**
+ * Unpin the segments of the given range so they can be evicted again.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+**/
+void ummap_unpin(void * ptr, size_t size);
+/**
+ * Synchronously load, map and protect the given range so it can be accessed
+ * without any page fault until ummap_release(). The missing segments are read
+ * by runs of contiguous segments with one driver request each. The segments are
+ * pinned like with ummap_pin() so they count in the pin budget of the policies.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @param mode Access to open, PROT_READ or PROT_READ|PROT_WRITE. It must be allowed
+ * by the mapping protection. In write mode the segments are marked dirty.
+ * @return 0 on success, -1 if the pin budget of a policy is exceeded. In this case
+ * nothing is loaded.
+**/
+int ummap_acquire(void * ptr, size_t size, int mode);
+/**
+ * Release a range acquired by ummap_acquire() so its segments can be evicted again.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+**/
+void ummap_release(void * ptr, size_t size);
+/**
+ * Drop the segments of the given range without writing them back, even the dirty
+ * ones, and ask the driver to deallocate the storage (hole punching for the files).
+ * This avoids writing dead data like scratch buffers. The range reads back as
+ * zeroes on the next access.
+ * Only the segments fully covered by the range are discarded: the range is
+ * rounded inward to the segment boundaries so the partially covered segments
+ * at its ends keep their content (the end of the mapping covers its last
+ * segment). Nothing is done if the range does not contain a whole segment.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+**/
+void ummap_discard(void * ptr, size_t size);
+/**
+ * Get the residency of the segments of the given range, like mincore(). The state
+ * is not locked so it can change after returning, it is to be used as a hint.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @param vec Filled with one byte per segment of the range, set to UMMAP_RESIDENT
+ * if mapped, plus UMMAP_RESIDENT_DIRTY if not yet written to the storage.
+ * @return Number of resident segments in the range.
+**/
+size_t ummap_residency(void * ptr, size_t size, unsigned char * vec);
+/**
+ * Call the given handler on each segment of the range, the resident ones first
+ * in address order then the missing ones. The missing ones are prefetched by a
+ * helper thread while the resident ones are handled so an out-of-core loop can
+ * process the cached data without waiting for the storage. The handler must not
+ * unmap the mapping.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range or 0 for the end of the mapping.
+ * @param handler Function to call on each segment.
+ * @param user_data Pointer given to the handler.
+**/
+void ummap_for_each_resident_first(void * ptr, size_t size, ummap_segment_handler_t handler, void * user_data);
+
+/*********************  STATS  **********************/
+/**
+ * Get the counters of the given mapping.
+ * @param ptr Base address of the mapping or an address inside the mapping.
+ * @param stats Struct to fill.
+**/
+void ummap_get_stats(void * ptr, ummap_stats_t * stats);
+/**
+ * Get the counters summed over all the mappings attached to the given policy.
+ * @param policy The policy (local or registered as a group) to inspect.
+ * @param stats Struct to fill.
+**/
+void ummap_policy_get_stats(ummap_policy_t * policy, ummap_stats_t * stats);
+/**
+ * Enable the online estimation of the miss-ratio curve of the policy. The reuse
+ * distance of the faults is measured on a hashed sample of the segments (SHARDS)
+ * to estimate how many faults a given memory budget would avoid. As the accesses
+ * to the resident segments are not seen, it is accurate for the budgets larger
+ * than the current one. Calling it again resets the estimation.
+ * It can also be enabled with the mrc parameter of the policy URI (fifo://1MB?mrc=64).
+ * @param policy The policy to track.
+ * @param sampling Sampling period, 1 segment over sampling is tracked (0 for the default).
+ * The rate is lowered automatically to bound the memory used by the estimator.
+**/
+void ummap_policy_enable_mrc(ummap_policy_t * policy, unsigned int sampling);
+/**
+ * Get the estimated miss-ratio curve of the policy. The points are evenly spread
+ * up to twice the maximum memory of the policy.
+ * @param policy The policy to inspect.
+ * @param points Array to fill.
+ * @param max_points Size of the array.
+ * @return The number of points filled, 0 if the estimation is not enabled.
+**/
+size_t ummap_policy_get_mrc(ummap_policy_t * policy, ummap_mrc_point_t * points, size_t max_points);
+
+/*******************  CHECKPOINT  *******************/
+/**
+ * Make an incremental checkpoint of the mapping into the given target. Only the
+ * segments modified since the previous checkpoint are written, the others are 
+ * cloned (reflink) from the previous checkpoint (or from the original storage for
+ * the first one) when the driver supports it or copied otherwise.
+ * The mapping keeps the target opened as base for the next checkpoint.
+ * @param ptr Base address of the mapping or an address inside the mapping.
+ * @param target_uri URI of the target storage (eg. file:///tmp/ckpt-1.raw).
+ * @return The checkpoint epoch number (starting at 1).
+**/
+size_t ummap_checkpoint(void * ptr, const char * target_uri);
 
 /********************  SETUP  ***********************/
 /**
@@ -315,6 +682,8 @@ void ummap_policy_group_destroy(const char * name);
  *   - fifo://1MB
  *   - fifo-window://2MB?window=1MB
  *   - lifo://1MB
+ * The mrc parameter enables the miss-ratio curve estimation (see ummap_policy_enable_mrc()),
+ * for example fifo://1MB?mrc=64.
  * @param local Define if it is a local policy to avoid locks or a policy group shared
  * between multiple mappings.
 **/
@@ -344,6 +713,13 @@ ummap_policy_t * ummap_policy_create_lifo(size_t max_size, bool local);
  * Return the current memory consummed by the given policy.
 **/
 size_t ummap_policy_get_memory(ummap_policy_t * policy);
+/**
+ * Define the maximum memory which can be pinned with ummap_pin() in the mappings
+ * handled by the given policy. By default it is half of its maximum memory.
+ * @param policy The policy to configure.
+ * @param max_size The pin budget in bytes.
+**/
+void ummap_policy_set_max_pinned(ummap_policy_t * policy, size_t max_size);
 /**
  * Destroy the given policy. In practice you do not have to do it by hand as it is
  * done by the umunmap() call.
@@ -414,6 +790,38 @@ ummap_quota_t * ummap_quota_create_inter_proc(const char * group_name, size_t ma
  * variable is undefined. You can use 0 to disable.
 **/
 ummap_quota_t * ummap_quota_create_inter_proc_env(const char * group_name, const char * env_name, size_t default_max_mem);
+/**
+ * Create a quota distributing the memory between the policies of the local
+ * process by marginal utility: the memory goes to the policies whose misses
+ * decrease the most with it. The misses are estimated from the miss-ratio
+ * curve of the policies if enabled (see ummap_policy_enable_mrc()), otherwise
+ * from their refault rate, so a policy reusing its segments wins the memory
+ * of a streaming one. The policies can be given a weight and a guaranteed
+ * memory with ummap_quota_set_policy_share().
+ * @param max_memory Define the maximal memory allowed for all the
+ * registered policies.
+**/
+ummap_quota_t * ummap_quota_create_utility(size_t max_memory);
+/**
+ * Define the weight and the guaranteed memory of a policy registered to a quota
+ * created by ummap_quota_create_utility().
+ * @param quota The utility quota.
+ * @param policy The registered policy.
+ * @param weight Multiplier applied to the utility of the policy (1 by default).
+ * @param min_memory Memory always given to the policy (0 by default). If the
+ * guarantees exceed the quota they are reduced proportionally.
+**/
+void ummap_quota_set_policy_share(ummap_quota_t * quota, ummap_policy_t * policy, double weight, size_t min_memory);
+/**
+ * Move the quota updates to a background thread. The faulting threads then
+ * only post a notification when a policy grows instead of redistributing the
+ * memory themselves, removing the quota from the fault latency. The memory
+ * used by the policies can exceed the quota for a short time until the
+ * background thread handles the change. Disabled by default.
+ * @param quota The quota to configure.
+ * @param enabled True to start the background thread, false to stop it.
+**/
+void ummap_quota_set_async(ummap_quota_t * quota, bool enabled);
 /**
  * Register the given policy to the given quota so we start
  * to balanced the memory usage with the other policies already
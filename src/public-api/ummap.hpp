@@ -0,0 +1,352 @@
+/*****************************************************
+*  PROJECT  : ummap-io-v2                            *
+*  LICENSE  : Apache 2.0                             *
+*  COPYRIGHT: 2020-2021 Bull SAS All rights reserved *
+*****************************************************/
+
+#ifndef UMMAP_HPP
+#define UMMAP_HPP
+
+/********************  HEADERS  *********************/
+//std
+#include <cstdlib>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+//coroutines
+#if __cplusplus >= 202002L && defined(__has_include)
+	#if __has_include(<coroutine>)
+		#include <coroutine>
+		#define UMMAP_HAVE_COROUTINE
+	#endif
+#endif
+//ummap-io
+#include "ummap.h"
+
+/********************  NAMESPACE  *******************/
+namespace ummapio
+{
+
+/*********************  DEFINES  ********************/
+/** Default segment size of ummapio::array. **/
+#define UMMAP_ARRAY_DEFAULT_SEGMENT_SIZE 4096
+/** Default number of segments loaded ahead by the iterators of ummapio::array. **/
+#define UMMAP_ARRAY_DEFAULT_READ_AHEAD 16
+
+/*********************  CLASS  **********************/
+/**
+ * Contiguous range of elements of an array, like std::span of C++20.
+ * It does not own the memory.
+**/
+template <class T>
+class span
+{
+	public:
+		typedef T element_type;
+		typedef typename std::remove_cv<T>::type value_type;
+		typedef size_t size_type;
+		typedef T * pointer;
+		typedef T & reference;
+		typedef T * iterator;
+	public:
+		span(void) : ptr(NULL), count(0) {};
+		span(T * ptr, size_t count) : ptr(ptr), count(count) {};
+		template <class U> span(const span<U> & other, typename std::enable_if<std::is_convertible<U*, T*>::value>::type * = NULL) : ptr(other.data()), count(other.size()) {};
+		T * data(void) const {return ptr;};
+		size_t size(void) const {return count;};
+		size_t size_bytes(void) const {return count * sizeof(T);};
+		bool empty(void) const {return count == 0;};
+		T & operator[](size_t index) const {return ptr[index];};
+		T * begin(void) const {return ptr;};
+		T * end(void) const {return ptr + count;};
+		span<T> subspan(size_t offset, size_t count) const {return span<T>(ptr + offset, count);};
+		span<T> first(size_t count) const {return span<T>(ptr, count);};
+		span<T> last(size_t count) const {return span<T>(ptr + this->count - count, count);};
+	private:
+		/** First element. **/
+		T * ptr;
+		/** Number of elements. **/
+		size_t count;
+};
+
+/*********************  CLASS  **********************/
+/**
+ * Random access iterator over an array which loads the next segments in
+ * background with ummap_load_async() while moving forward with ++. When less
+ * than one window is left ahead of the current element, the next window is
+ * requested so the reads overlap the accesses. The copies and the jumps
+ * (+, +=, begin()...) do not issue any request.
+**/
+template <class T>
+class array_iterator
+{
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef typename std::remove_cv<T>::type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T * pointer;
+		typedef T & reference;
+	public:
+		array_iterator(void) : cur(NULL), last(NULL), nextHint(NULL), hintSize(0) {};
+		/**
+		 * Build the iterator.
+		 * @param cur Current element.
+		 * @param last End of the array.
+		 * @param hintSize Size of the window to load ahead, 0 to disable.
+		**/
+		array_iterator(T * cur, T * last, size_t hintSize) : cur(cur), last(last), nextHint((const char*)cur), hintSize(hintSize) {};
+		template <class U> array_iterator(const array_iterator<U> & other, typename std::enable_if<std::is_convertible<U*, T*>::value>::type * = NULL)
+			: cur(other.cur), last(other.last), nextHint(other.nextHint), hintSize(other.hintSize) {};
+		T & operator*(void) const {return *cur;};
+		T * operator->(void) const {return cur;};
+		T & operator[](difference_type index) const {return cur[index];};
+		array_iterator & operator++(void) {++cur; hint(); return *this;};
+		array_iterator operator++(int) {array_iterator res = *this; ++(*this); return res;};
+		array_iterator & operator--(void) {--cur; return *this;};
+		array_iterator operator--(int) {array_iterator res = *this; --cur; return res;};
+		array_iterator & operator+=(difference_type delta) {cur += delta; return *this;};
+		array_iterator & operator-=(difference_type delta) {return *this += -delta;};
+		array_iterator operator+(difference_type delta) const {array_iterator res = *this; return res += delta;};
+		array_iterator operator-(difference_type delta) const {array_iterator res = *this; return res -= delta;};
+		difference_type operator-(const array_iterator & other) const {return cur - other.cur;};
+		bool operator==(const array_iterator & other) const {return cur == other.cur;};
+		bool operator!=(const array_iterator & other) const {return cur != other.cur;};
+		bool operator<(const array_iterator & other) const {return cur < other.cur;};
+		bool operator>(const array_iterator & other) const {return cur > other.cur;};
+		bool operator<=(const array_iterator & other) const {return cur <= other.cur;};
+		bool operator>=(const array_iterator & other) const {return cur >= other.cur;};
+	private:
+		template <class U> friend class array_iterator;
+		/**
+		 * Request the next window if less than one window is already requested
+		 * ahead of the current element. It restarts from the current element if
+		 * it jumped after the requested range.
+		**/
+		void hint(void)
+		{
+			const char * pos = (const char*)cur;
+			const char * end = (const char*)last;
+			if (hintSize == 0 || cur >= last || nextHint >= end || pos + hintSize <= nextHint)
+				return;
+			const char * start = (pos > nextHint) ? pos : nextHint;
+			size_t size = end - start;
+			if (size > hintSize)
+				size = hintSize;
+			ummap_load_async((void*)start, size, NULL, NULL);
+			nextHint = start + size;
+		};
+	private:
+		/** Current element. **/
+		T * cur;
+		/** End of the array. **/
+		T * last;
+		/** End of the already requested range. **/
+		const char * nextHint;
+		/** Size of the window to load ahead. **/
+		size_t hintSize;
+};
+
+/*******************  FUNCTION  *********************/
+template <class T>
+array_iterator<T> operator+(typename array_iterator<T>::difference_type delta, const array_iterator<T> & it)
+{
+	return it + delta;
+}
+
+/*********************  CLASS  **********************/
+#ifdef UMMAP_HAVE_COROUTINE
+/**
+ * Awaitable loading a range in background (see ummap_load_async()). The
+ * coroutine is suspended during the loading and resumed by the loading thread,
+ * so the next accesses to the range do not fault:
+ *
+ *     co_await ummapio::load_async(ptr, size);
+**/
+class load_awaitable
+{
+	public:
+		load_awaitable(void * ptr, size_t size) : ptr(ptr), size(size), loaded(size) {};
+		bool await_ready(void) const noexcept {return size == 0;};
+		void await_suspend(std::coroutine_handle<> handle) {this->handle = handle; ummap_load_async(ptr, size, &load_awaitable::resume, this);};
+		size_t await_resume(void) const noexcept {return loaded;};
+	private:
+		static void resume(void *, size_t size, void * user_data) {load_awaitable * self = (load_awaitable*)user_data; self->loaded = size; self->handle.resume();};
+	private:
+		/** Base address of the range. **/
+		void * ptr;
+		/** Size of the range (0 to not suspend). **/
+		size_t size;
+		/** Size really loaded, given by the callback. **/
+		size_t loaded;
+		/** Coroutine to resume once loaded. **/
+		std::coroutine_handle<> handle;
+};
+
+/*******************  FUNCTION  *********************/
+/**
+ * Build an awaitable loading the given range of a mapping.
+ * @param ptr Base address of the range inside a mapping.
+ * @param size Size of the range, nothing is done if 0.
+ * @return The awaitable, co_await gives the size really loaded.
+**/
+inline load_awaitable load_async(void * ptr, size_t size)
+{
+	return load_awaitable(ptr, size);
+}
+#endif //UMMAP_HAVE_COROUTINE
+
+/*********************  CLASS  **********************/
+/**
+ * Typed array over a ummap mapping. The mapping is established by the constructor
+ * and flushed and unmapped by the destructor (RAII). The array can be moved but not
+ * copied. The segment size is given at compile time so the conversions between the
+ * element indexes and the segments are constant folded.
+ *
+ * The ranges of elements can be given to prefetch(), flush(), advise()... to pass
+ * access hints, and the iterators load the next segments ahead when moving forward
+ * (see set_read_ahead()). The element type must be trivially copyable as the data
+ * are copied from and to the storage.
+**/
+template <class T, size_t SegmentSize = UMMAP_ARRAY_DEFAULT_SEGMENT_SIZE>
+class array
+{
+	public:
+		static_assert(std::is_trivially_copyable<T>::value, "The elements of ummapio::array must be trivially copyable");
+		static_assert(SegmentSize > 0 && SegmentSize % 4096 == 0, "The segment size must be a multiple of the page size");
+		typedef T value_type;
+		typedef size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T & reference;
+		typedef const T & const_reference;
+		typedef T * pointer;
+		typedef const T * const_pointer;
+		typedef array_iterator<T> iterator;
+		typedef array_iterator<const T> const_iterator;
+	public:
+		array(void) : ptr(NULL), count(0), readAhead(UMMAP_ARRAY_DEFAULT_READ_AHEAD) {};
+		/**
+		 * Map the given number of elements.
+		 * @param count Number of elements, it must not be 0.
+		 * @param driver Driver to access the storage, it is destroyed with the mapping.
+		 * @param protection Access protection (PROT_READ, PROT_WRITE).
+		 * @param flags ummap() flags.
+		 * @param storageOffset Offset of the first element in the storage (in bytes).
+		 * @param localPolicy Optional local policy.
+		 * @param policyGroup Policy group to be used, "none" for none.
+		**/
+		array(size_t count, ummap_driver_t * driver, int protection = PROT_READ | PROT_WRITE, int flags = UMMAP_DEFAULT, size_t storageOffset = 0, ummap_policy_t * localPolicy = NULL, const char * policyGroup = "none")
+			:count(count), readAhead(UMMAP_ARRAY_DEFAULT_READ_AHEAD)
+		{
+			this->ptr = (T*)ummap(NULL, count * sizeof(T), SegmentSize, storageOffset, protection, flags, driver, localPolicy, policyGroup);
+		};
+		array(const array & orig) = delete;
+		array(array && orig) : ptr(orig.ptr), count(orig.count), readAhead(orig.readAhead) {orig.ptr = NULL; orig.count = 0;};
+		~array(void) {this->close();};
+		array & operator=(const array & orig) = delete;
+		array & operator=(array && orig)
+		{
+			if (this != &orig) {
+				this->close();
+				this->ptr = orig.ptr;
+				this->count = orig.count;
+				this->readAhead = orig.readAhead;
+				orig.ptr = NULL;
+				orig.count = 0;
+			}
+			return *this;
+		};
+		/**
+		 * Unmap the array, it becomes empty.
+		 * @param sync Write back the dirty elements before unmapping.
+		**/
+		void close(bool sync = true)
+		{
+			if (this->ptr != NULL)
+				umunmap(this->ptr, sync);
+			this->ptr = NULL;
+			this->count = 0;
+		};
+		/**
+		 * Resize the array keeping the loaded elements (see ummap_remap()). The
+		 * array can move so the pointers and iterators are invalidated.
+		 * @param count New number of elements, it must not be 0.
+		**/
+		void resize(size_t count)
+		{
+			this->ptr = (T*)ummap_remap(this->ptr, count * sizeof(T), UMMAP_REMAP_MAYMOVE, NULL);
+			this->count = count;
+		};
+		//access
+		T * data(void) {return ptr;};
+		const T * data(void) const {return ptr;};
+		size_t size(void) const {return count;};
+		size_t size_bytes(void) const {return count * sizeof(T);};
+		bool empty(void) const {return count == 0;};
+		T & operator[](size_t index) {return ptr[index];};
+		const T & operator[](size_t index) const {return ptr[index];};
+		T & at(size_t index) {check(index); return ptr[index];};
+		const T & at(size_t index) const {check(index); return ptr[index];};
+		static constexpr size_t segment_size(void) {return SegmentSize;};
+		//iterators
+		iterator begin(void) {return iterator(ptr, ptr + count, hintSize());};
+		iterator end(void) {return iterator(ptr + count, ptr + count, 0);};
+		const_iterator begin(void) const {return const_iterator(ptr, ptr + count, hintSize());};
+		const_iterator end(void) const {return const_iterator(ptr + count, ptr + count, 0);};
+		const_iterator cbegin(void) const {return begin();};
+		const_iterator cend(void) const {return end();};
+		/**
+		 * Define the number of segments the iterators load ahead in background
+		 * when moving forward with ++, 0 to disable.
+		**/
+		void set_read_ahead(size_t segments) {this->readAhead = segments;};
+		size_t get_read_ahead(void) const {return this->readAhead;};
+		//ranges
+		span<T> range(size_t first, size_t count) {check(first, count); return span<T>(ptr + first, count);};
+		span<const T> range(size_t first, size_t count) const {check(first, count); return span<const T>(ptr + first, count);};
+		/** Load the given range now (UMMAP_ADV_WILLNEED). **/
+		void prefetch(span<const T> range) const {if (!range.empty()) ummap_advise((void*)range.data(), range.size_bytes(), UMMAP_ADV_WILLNEED);};
+		void prefetch(size_t first, size_t count) const {prefetch(range(first, count));};
+		/** Load the given range in background and call the callback when done (see ummap_load_async()). **/
+		void load_async(span<const T> range, ummap_load_callback_t callback, void * userData) const {if (range.empty()) {if (callback != NULL) callback((void*)range.data(), 0, userData);} else {ummap_load_async((void*)range.data(), range.size_bytes(), callback, userData);}};
+		void load_async(size_t first, size_t count, ummap_load_callback_t callback, void * userData) const {load_async(range(first, count), callback, userData);};
+		#ifdef UMMAP_HAVE_COROUTINE
+		/** Awaitable loading the given range in background (see ummapio::load_async()). **/
+		load_awaitable load_async(span<const T> range) const {return load_awaitable((void*)range.data(), range.size_bytes());};
+		load_awaitable load_async(size_t first, size_t count) const {return load_async(range(first, count));};
+		#endif //UMMAP_HAVE_COROUTINE
+		/** Give an access hint on the given range (see ummap_advise()). **/
+		void advise(span<const T> range, ummap_advice_t advice) const {if (!range.empty()) ummap_advise((void*)range.data(), range.size_bytes(), advice);};
+		void advise(size_t first, size_t count, ummap_advice_t advice) const {advise(range(first, count), advice);};
+		/** Write back the dirty segments of the given range (see umflush()). **/
+		void flush(span<const T> range, bool evict = false) const {if (!range.empty()) umflush((void*)range.data(), range.size_bytes(), evict);};
+		void flush(size_t first, size_t count, bool evict = false) const {flush(range(first, count), evict);};
+		void flush(bool evict = false) const {flush(0, count, evict);};
+		/** Write back and sync the dirty segments of the given range (see umsync()). **/
+		void sync(span<const T> range, bool evict = false) const {if (!range.empty()) umsync((void*)range.data(), range.size_bytes(), evict);};
+		void sync(size_t first, size_t count, bool evict = false) const {sync(range(first, count), evict);};
+		void sync(bool evict = false) const {sync(0, count, evict);};
+		/** Pin the given range in memory (see ummap_pin()), false if over the pin budget. **/
+		bool pin(span<const T> range) const {return range.empty() || ummap_pin((void*)range.data(), range.size_bytes()) == 0;};
+		bool pin(size_t first, size_t count) const {return pin(range(first, count));};
+		/** Unpin the given range (see ummap_unpin()). **/
+		void unpin(span<const T> range) const {if (!range.empty()) ummap_unpin((void*)range.data(), range.size_bytes());};
+		void unpin(size_t first, size_t count) const {unpin(range(first, count));};
+		/** Get the event counters of the mapping (see ummap_get_stats()). **/
+		ummap_stats_t stats(void) const {ummap_stats_t res; ummap_get_stats(ptr, &res); return res;};
+	private:
+		size_t hintSize(void) const {return readAhead * SegmentSize;};
+		void check(size_t index) const {if (index >= count) throw std::out_of_range("ummapio::array index out of range");};
+		void check(size_t first, size_t count) const {if (first > this->count || count > this->count - first) throw std::out_of_range("ummapio::array range out of range");};
+	private:
+		/** Base address of the mapping. **/
+		T * ptr;
+		/** Number of elements. **/
+		size_t count;
+		/** Number of segments loaded ahead by the iterators. **/
+		size_t readAhead;
+};
+
+}
+
+#endif //UMMAP_HPP
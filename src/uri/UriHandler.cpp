@@ -249,6 +249,10 @@ Policy * UriHandler::buildPolicy(const std::string & uri, bool local)
 	if (policy != NULL)
 		policy->setUri(realUri);
 
+	//enable the miss-ratio curve estimation
+	if (policy != NULL && parser.getParam("mrc", "").empty() == false)
+		policy->enableMissRatioCurve(parser.getParamAsInt("mrc"));
+
 	//ret
 	return policy;
 }